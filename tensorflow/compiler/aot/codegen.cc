@@ -35,6 +35,46 @@ namespace tfcompile {
 
 namespace {
 
+// Convert an XLA type into a TensorFlow DataType.
+Status XLATypeToDataType(xla::PrimitiveType type, DataType* data_type) {
+  switch (type) {
+    case xla::PRED:
+      *data_type = DT_BOOL;
+      break;
+    case xla::S8:
+      *data_type = DT_INT8;
+      break;
+    case xla::S16:
+      *data_type = DT_INT16;
+      break;
+    case xla::S32:
+      *data_type = DT_INT32;
+      break;
+    case xla::S64:
+      *data_type = DT_INT64;
+      break;
+    case xla::U8:
+      *data_type = DT_UINT8;
+      break;
+    case xla::U16:
+      *data_type = DT_UINT16;
+      break;
+    case xla::F16:
+      *data_type = DT_HALF;
+      break;
+    case xla::F32:
+      *data_type = DT_FLOAT;
+      break;
+    case xla::F64:
+      *data_type = DT_DOUBLE;
+      break;
+    default:
+      return errors::Unimplemented("XLA type ", xla::PrimitiveType_Name(type),
+                                   " has no equivalent DataType");
+  }
+  return Status::OK();
+}
+
 // Convert an XLA type into a C++ type.
 Status XLATypeToCpp(xla::PrimitiveType type, string* str) {
   switch (type) {
@@ -554,6 +594,73 @@ class {{CLASS}} {
   return Status::OK();
 }
 
+Status GenerateMetadata(const Config& config,
+                        const CompileResult& compile_result,
+                        AotMetadata* metadata) {
+  TF_RETURN_IF_ERROR(ValidateConfig(config));
+  const int64 result_index = compile_result.aot->result_buffer_index();
+  const xla::BufferSizes& temp_sizes = compile_result.aot->buffer_sizes();
+  if (result_index < 0 || result_index >= temp_sizes.size()) {
+    return errors::InvalidArgument("result index: ", result_index,
+                                   " is outside the range of temp sizes: [0,",
+                                   temp_sizes.size(), ")");
+  }
+  std::vector<int64> arg_sizes;
+  TF_RETURN_IF_ERROR(ComputeArgSizes(compile_result, &arg_sizes));
+
+  metadata->Clear();
+  metadata->set_entry_point(compile_result.entry_point);
+  for (int64 size : arg_sizes) {
+    metadata->add_arg_sizes(size);
+  }
+  for (int64 size : temp_sizes) {
+    metadata->add_temp_sizes(size);
+  }
+  metadata->set_result_index(result_index);
+  metadata->set_has_context_arg(compile_result.has_context_arg);
+  const xla::ProgramShape& ps = compile_result.program_shape;
+  const int num_args =
+      ps.parameters_size() - (compile_result.has_context_arg ? 1 : 0);
+  for (int i = 0; i < num_args; ++i) {
+    DataType type;
+    TF_RETURN_IF_ERROR(
+        XLATypeToDataType(ps.parameters(i).element_type(), &type));
+    metadata->add_arg_types(type);
+  }
+
+  const xla::Shape& result_shape = ps.result();
+  std::vector<const xla::Shape*> result_shapes;
+  if (result_shape.element_type() == xla::TUPLE) {
+    metadata->set_result_is_tuple(true);
+    for (const xla::Shape& shape : result_shape.tuple_shapes()) {
+      result_shapes.push_back(&shape);
+    }
+  } else {
+    result_shapes.push_back(&result_shape);
+  }
+  if (config.fetch_size() != result_shapes.size()) {
+    return errors::InvalidArgument("mismatch between fetch_size(",
+                                   config.fetch_size(), ") and num_results(",
+                                   result_shapes.size(), ")");
+  }
+  for (const xla::Shape* shape : result_shapes) {
+    if (xla::ShapeUtil::IsTuple(*shape)) {
+      return errors::Unimplemented("nested tuple results are not supported: ",
+                                   xla::ShapeUtil::HumanString(result_shape));
+    }
+    TensorShapeProto* shape_proto = metadata->add_result_shapes();
+    for (int64 dim : shape->dimensions()) {
+      shape_proto->add_dim()->set_size(dim);
+    }
+    metadata->add_result_sizes(
+        xla::ShapeUtil::ByteSizeOf(*shape, compile_result.pointer_size));
+    DataType type;
+    TF_RETURN_IF_ERROR(XLATypeToDataType(shape->element_type(), &type));
+    metadata->add_result_types(type);
+  }
+  return Status::OK();
+}
+
 Status ParseCppClass(const string& cpp_class, string* class_name,
                      std::vector<string>* namespaces) {
   class_name->clear();
@@ -40,6 +40,14 @@ struct HeaderOpts {
 Status GenerateHeader(const HeaderOpts& opts, const Config& config,
                       const CompileResult& compile_result, string* header);
 
+// GenerateMetadata uses the meta-information from compile_result to fill in
+// metadata, which describes how to invoke the function in the generated object
+// file without the generated header.  The metadata is consumed by the
+// XlaAotLaunch op, which loads the function from a shared object at runtime.
+Status GenerateMetadata(const Config& config,
+                        const CompileResult& compile_result,
+                        AotMetadata* metadata);
+
 // ParseCppClass parses `cpp_class` into its `class_name` and `namespaces`
 // components.  The syntax is [[<optional_namespace>::],...]<class_name>.  This
 // mirrors the C++ syntax for referring to a class, where multiple namespaces
@@ -19,6 +19,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
@@ -132,6 +133,75 @@ TEST(GenerateHeader, Golden) {
   EXPECT_EQ(header, golden_data);
 }
 
+TEST(GenerateMetadata, TupleResult) {
+  Config config;
+  Feed* feed = config.add_feed();
+  feed->mutable_id()->set_node_name("feed0");
+  Fetch* fetch = config.add_fetch();
+  fetch->mutable_id()->set_node_name("fetch0");
+  fetch = config.add_fetch();
+  fetch->mutable_id()->set_node_name("fetch1");
+  CompileResult compile_result;
+  compile_result.aot.reset(
+      new xla::cpu::CpuAotCompilationResult({}, {16, -1, 24}, 2));
+  compile_result.program_shape = xla::ShapeUtil::MakeProgramShape(
+      {
+          xla::ShapeUtil::MakeShape(xla::F32, {2, 3}),
+          xla::ShapeUtil::MakeOpaqueShape(),
+      },
+      xla::ShapeUtil::MakeTupleShape({
+          xla::ShapeUtil::MakeShape(xla::F32, {3}),
+          xla::ShapeUtil::MakeShape(xla::S64, {}),
+      }));
+  compile_result.has_context_arg = true;
+  compile_result.entry_point = "entry_point";
+  compile_result.pointer_size = 8;
+  AotMetadata metadata;
+  TF_EXPECT_OK(GenerateMetadata(config, compile_result, &metadata));
+
+  EXPECT_EQ(metadata.entry_point(), "entry_point");
+  ASSERT_EQ(metadata.arg_sizes_size(), 2);
+  EXPECT_EQ(metadata.arg_sizes(0), 24);
+  EXPECT_EQ(metadata.arg_sizes(1), -1);
+  ASSERT_EQ(metadata.temp_sizes_size(), 3);
+  EXPECT_EQ(metadata.temp_sizes(0), 16);
+  EXPECT_EQ(metadata.temp_sizes(1), -1);
+  EXPECT_EQ(metadata.temp_sizes(2), 24);
+  EXPECT_EQ(metadata.result_index(), 2);
+  EXPECT_TRUE(metadata.has_context_arg());
+  EXPECT_TRUE(metadata.result_is_tuple());
+  ASSERT_EQ(metadata.result_shapes_size(), 2);
+  EXPECT_EQ(TensorShape(metadata.result_shapes(0)), TensorShape({3}));
+  EXPECT_EQ(TensorShape(metadata.result_shapes(1)), TensorShape({}));
+  ASSERT_EQ(metadata.result_sizes_size(), 2);
+  EXPECT_EQ(metadata.result_sizes(0), 12);
+  EXPECT_EQ(metadata.result_sizes(1), 8);
+  ASSERT_EQ(metadata.arg_types_size(), 1);
+  EXPECT_EQ(metadata.arg_types(0), DT_FLOAT);
+  ASSERT_EQ(metadata.result_types_size(), 2);
+  EXPECT_EQ(metadata.result_types(0), DT_FLOAT);
+  EXPECT_EQ(metadata.result_types(1), DT_INT64);
+}
+
+TEST(GenerateMetadata, FetchMismatch) {
+  Config config;
+  Feed* feed = config.add_feed();
+  feed->mutable_id()->set_node_name("feed0");
+  Fetch* fetch = config.add_fetch();
+  fetch->mutable_id()->set_node_name("fetch0");
+  fetch = config.add_fetch();
+  fetch->mutable_id()->set_node_name("fetch1");
+  CompileResult compile_result;
+  compile_result.aot.reset(
+      new xla::cpu::CpuAotCompilationResult({}, {16}, 0));
+  compile_result.program_shape = xla::ShapeUtil::MakeProgramShape(
+      {xla::ShapeUtil::MakeShape(xla::F32, {4})},
+      xla::ShapeUtil::MakeShape(xla::F32, {4}));
+  compile_result.pointer_size = 8;
+  AotMetadata metadata;
+  EXPECT_NE(GenerateMetadata(config, compile_result, &metadata), Status::OK());
+}
+
 }  // namespace
 }  // namespace tfcompile
 }  // namespace tensorflow
@@ -64,6 +64,11 @@ void AppendMainFlags(std::vector<Flag>* flag_list, MainFlags* flags) {
        "namespaces are given, within the global namespace."},
       {"out_object", &flags->out_object, "Output object file name."},
       {"out_header", &flags->out_header, "Output header file name."},
+      {"out_metadata", &flags->out_metadata,
+       "Optional output file name for the AotMetadata proto, in binary form.  "
+       "The metadata describes how to invoke the generated function without "
+       "the header, and is used by the XlaAotLaunch op to run the function "
+       "after loading it from a shared object."},
   };
   flag_list->insert(flag_list->end(), tmp.begin(), tmp.end());
 }
@@ -37,6 +37,7 @@ struct MainFlags {
   string cpp_class;
   string out_object;
   string out_header;
+  string out_metadata;
 };
 
 // Appends to flag_list a tensorflow::Flag for each field in MainFlags.
@@ -0,0 +1,113 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Runs the test_graph_tfmatmulandadd function, built into a shared object by
+// tf_library(gen_shared_object=True), through the XlaAotLaunch op.
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace tfcompile {
+namespace {
+
+class XlaAotLaunchOpTest : public OpsTestBase {
+ protected:
+  Status Init(DataTypeSlice arg_types, DataTypeSlice result_types) {
+    const string dir =
+        io::JoinPath(testing::TensorFlowSrcRoot(), "compiler/aot/tests");
+    TF_RETURN_IF_ERROR(
+        NodeDefBuilder("launch", "XlaAotLaunch")
+            .Input(FakeInput(arg_types))
+            .Attr("Tresults", result_types)
+            .Attr("library_path",
+                  io::JoinPath(dir, "libtest_graph_tfmatmulandadd_so.so"))
+            .Attr("metadata_path",
+                  io::JoinPath(dir, "test_graph_tfmatmulandadd_so_metadata.pb"))
+            .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(XlaAotLaunchOpTest, MatMulAndAdd) {
+  TF_ASSERT_OK(Init({DT_FLOAT, DT_FLOAT}, {DT_FLOAT, DT_FLOAT}));
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({2, 2}), {5, 6, 7, 8});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_prod(allocator(), DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&expected_prod, {19, 22, 43, 50});
+  test::ExpectTensorEqual<float>(expected_prod, *GetOutput(0));
+  Tensor expected_sum(allocator(), DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&expected_sum, {6, 8, 10, 12});
+  test::ExpectTensorEqual<float>(expected_sum, *GetOutput(1));
+
+  // The kernel may be run again with other args.
+  inputs_.clear();
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 0, 0, 1});
+  AddInputFromArray<float>(TensorShape({2, 2}), {5, 6, 7, 8});
+  TF_ASSERT_OK(RunOpKernel());
+  test::FillValues<float>(&expected_prod, {5, 6, 7, 8});
+  test::ExpectTensorEqual<float>(expected_prod, *GetOutput(0));
+  test::FillValues<float>(&expected_sum, {6, 6, 7, 9});
+  test::ExpectTensorEqual<float>(expected_sum, *GetOutput(1));
+}
+
+TEST_F(XlaAotLaunchOpTest, WrongArgType) {
+  // An int32 arg has the same size as the float arg the function expects.
+  Status s = Init({DT_INT32, DT_FLOAT}, {DT_FLOAT, DT_FLOAT});
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Arg 0 has type int32, but the generated function "
+                            "expects float"))
+      << s;
+}
+
+TEST_F(XlaAotLaunchOpTest, WrongResultType) {
+  Status s = Init({DT_FLOAT, DT_FLOAT}, {DT_FLOAT, DT_INT32});
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Result 1 has type int32, but the generated "
+                            "function returns float"))
+      << s;
+}
+
+TEST_F(XlaAotLaunchOpTest, WrongNumberOfArgs) {
+  Status s = Init({DT_FLOAT}, {DT_FLOAT, DT_FLOAT});
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Expected 2 args from metadata, but got 1"))
+      << s;
+}
+
+TEST_F(XlaAotLaunchOpTest, WrongArgSize) {
+  TF_ASSERT_OK(Init({DT_FLOAT, DT_FLOAT}, {DT_FLOAT, DT_FLOAT}));
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({3}), {5, 6, 7});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Arg 1 has 12 bytes, but the generated function "
+                            "expects 16 bytes"))
+      << s;
+}
+
+}  // namespace
+}  // namespace tfcompile
+}  // namespace tensorflow
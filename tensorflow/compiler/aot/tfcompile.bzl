@@ -21,7 +21,7 @@ load("//tensorflow:tensorflow.bzl", "if_android", "tf_copts")
 def tf_library(name, graph, config,
                freeze_checkpoint=None, freeze_saver=None,
                cpp_class=None, gen_test=True, gen_benchmark=True,
-               visibility=None, testonly=None,
+               gen_shared_object=False, visibility=None, testonly=None,
                tfcompile_flags=None,
                tfcompile_tool="//tensorflow/compiler/aot:tfcompile",
                deps=None, tags=None):
@@ -50,6 +50,10 @@ def tf_library(name, graph, config,
       test and benchmark.
     gen_benchmark: If True, also generate a binary with a simple benchmark.
       Unlike the output of gen_test, this benchmark can be run on android.
+    gen_shared_object: If True, also generate a shared object lib<name>.so
+      containing the generated function, and the file <name>_metadata.pb
+      describing how to call it.  Together they may be loaded at runtime by
+      the XlaAotLaunch op, without linking the generated code into the binary.
     visibility: Bazel build visibility.
     testonly:   Bazel testonly attribute.
     tfcompile_flags: Extra flags to pass to tfcompile to control compilation.
@@ -114,10 +118,17 @@ def tf_library(name, graph, config,
     )
     tfcompile_graph = freeze_file
 
-  # Rule that runs tfcompile to produce the header and object file.
+  # Rule that runs tfcompile to produce the header and object file, and
+  # optionally the metadata used to call the generated function at runtime.
   header_file = name + ".h"
   object_file = name + ".o"
+  metadata_file = name + "_metadata.pb"
   ep = ("__" + PACKAGE_NAME + "__" + name).replace("/", "_")
+  metadata_outs = []
+  metadata_flags = ""
+  if gen_shared_object:
+    metadata_outs = [metadata_file]
+    metadata_flags = " --out_metadata=$(@D)/" + metadata_file
   native.genrule(
       name=("gen_" + name),
       srcs=[
@@ -127,7 +138,7 @@ def tf_library(name, graph, config,
       outs=[
           header_file,
           object_file,
-      ],
+      ] + metadata_outs,
       cmd=("$(location " + tfcompile_tool + ")" +
            " --graph=$(location " + tfcompile_graph + ")" +
            " --config=$(location " + config + ")" +
@@ -136,6 +147,7 @@ def tf_library(name, graph, config,
            " --target_triple=" + target_llvm_triple() +
            " --out_header=$(@D)/" + header_file +
            " --out_object=$(@D)/" + object_file +
+           metadata_flags +
            " " + (tfcompile_flags or "")),
       tools=[tfcompile_tool],
       visibility=visibility,
@@ -153,6 +165,24 @@ def tf_library(name, graph, config,
       tags=tags,
   )
 
+  # The kernel implementations that may be called by the generated code.
+  # TODO(cwhipkey): only depend on kernel code that the model actually needed.
+  runtime_deps = [
+      "//tensorflow/compiler/tf2xla/kernels:gather_op_kernel_float_int32",
+      "//tensorflow/compiler/tf2xla/kernels:gather_op_kernel_float_int64",
+      "//tensorflow/compiler/tf2xla/kernels:index_ops_kernel_argmax_float_1d",
+      "//tensorflow/compiler/tf2xla/kernels:index_ops_kernel_argmax_float_2d",
+      "//tensorflow/compiler/aot:runtime",
+      "//tensorflow/compiler/tf2xla:xla_local_runtime_context",
+      "//tensorflow/compiler/xla/service/cpu:runtime_conv2d",
+      "//tensorflow/compiler/xla/service/cpu:runtime_matmul",
+      "//tensorflow/compiler/xla/service/cpu:runtime_single_threaded_conv2d",
+      "//tensorflow/compiler/xla/service/cpu:runtime_single_threaded_matmul",
+      "//tensorflow/compiler/xla:executable_run_options",
+      "//third_party/eigen3",
+      "//tensorflow/core:framework_lite",
+  ] + (deps or [])
+
   # The cc_library rule packaging up the header and object file, and needed
   # kernel implementations.
   native.cc_library(
@@ -161,25 +191,24 @@ def tf_library(name, graph, config,
       hdrs=[header_file],
       visibility=visibility,
       testonly=testonly,
-      deps = [
-          # TODO(cwhipkey): only depend on kernel code that the model actually needed.
-          "//tensorflow/compiler/tf2xla/kernels:gather_op_kernel_float_int32",
-          "//tensorflow/compiler/tf2xla/kernels:gather_op_kernel_float_int64",
-          "//tensorflow/compiler/tf2xla/kernels:index_ops_kernel_argmax_float_1d",
-          "//tensorflow/compiler/tf2xla/kernels:index_ops_kernel_argmax_float_2d",
-          "//tensorflow/compiler/aot:runtime",
-          "//tensorflow/compiler/tf2xla:xla_local_runtime_context",
-          "//tensorflow/compiler/xla/service/cpu:runtime_conv2d",
-          "//tensorflow/compiler/xla/service/cpu:runtime_matmul",
-          "//tensorflow/compiler/xla/service/cpu:runtime_single_threaded_conv2d",
-          "//tensorflow/compiler/xla/service/cpu:runtime_single_threaded_matmul",
-          "//tensorflow/compiler/xla:executable_run_options",
-          "//third_party/eigen3",
-          "//tensorflow/core:framework_lite",
-          ] + (deps or []),
+      deps=runtime_deps,
       tags=tags,
   )
 
+  if gen_shared_object:
+    # The shared object containing the generated function and needed kernel
+    # implementations, for use by the XlaAotLaunch op.  The object file is
+    # always generated with a position-independent relocation model.
+    native.cc_binary(
+        name=("lib" + name + ".so"),
+        srcs=[object_file],
+        linkshared=1,
+        visibility=visibility,
+        testonly=testonly,
+        deps=runtime_deps,
+        tags=tags,
+    )
+
   # Variables used for gen_test and gen_benchmark.
   no_ns_name = ""
   cpp_class_split = cpp_class.rsplit("::", maxsplit=2)
@@ -115,6 +115,11 @@ Status Main(const MainFlags& flags) {
   TF_RETURN_IF_ERROR(
       GenerateHeader(header_opts, config, compile_result, &header));
   TF_RETURN_IF_ERROR(WriteStringToFile(env, flags.out_header, header));
+  if (!flags.out_metadata.empty()) {
+    AotMetadata metadata;
+    TF_RETURN_IF_ERROR(GenerateMetadata(config, compile_result, &metadata));
+    TF_RETURN_IF_ERROR(WriteBinaryProto(env, flags.out_metadata, metadata));
+  }
   return Status::OK();
 }
 
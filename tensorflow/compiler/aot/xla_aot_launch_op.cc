@@ -0,0 +1,249 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// XlaAotLaunch runs a function generated by tfcompile, which is loaded from a
+// shared object at runtime rather than linked into the binary.  No LLVM or XLA
+// compiler is needed at runtime; the calling convention of the function is
+// described by the AotMetadata proto written by tfcompile --out_metadata.
+
+#define EIGEN_USE_THREADS
+
+#include <string.h>
+#include <vector>
+
+#include "tensorflow/compiler/aot/runtime.h"
+#include "tensorflow/compiler/aot/tfcompile.pb.h"
+#include "tensorflow/compiler/tf2xla/xla_local_runtime_context.h"
+#include "tensorflow/compiler/xla/executable_run_options.h"
+#include "tensorflow/core/framework/common_shape_fns.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+
+namespace tensorflow {
+namespace tfcompile {
+
+REGISTER_OP("XlaAotLaunch")
+    .Input("args: Targs")
+    .Attr("Targs: list(type) >= 0")
+    .Output("results: Tresults")
+    .Attr("Tresults: list(type) >= 0")
+    .Attr("library_path: string")
+    .Attr("metadata_path: string")
+    // Generated functions may contain stateful XLA ops, e.g. random numbers.
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::UnknownShape)
+    .Doc(R"doc(
+Runs a function generated by tfcompile, loaded from a shared object.
+
+The shared object is built by tf_library with gen_shared_object=True.  The
+arguments and results have the same order, types and shapes as the feeds and
+fetches in the tfcompile config used to generate it.
+
+args: The positional arguments of the generated function.
+results: The positional results of the generated function.
+library_path: Path of the shared object containing the generated function.
+metadata_path: Path of the AotMetadata proto, in binary form, written by
+  tfcompile --out_metadata for the same compilation.
+)doc");
+
+namespace {
+
+// Signature of the entry point generated by tfcompile.
+using EntryPointFunction = void (*)(void* result,
+                                    xla::ExecutableRunOptions* run_options,
+                                    void** args, void** temps);
+
+// Frees buffers allocated by runtime::MallocContiguousBuffers on destruction.
+class ScopedContiguousBuffers {
+ public:
+  explicit ScopedContiguousBuffers(void* contiguous)
+      : contiguous_(contiguous) {}
+  ~ScopedContiguousBuffers() { runtime::FreeContiguous(contiguous_); }
+
+ private:
+  void* contiguous_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedContiguousBuffers);
+};
+
+}  // namespace
+
+class XlaAotLaunchOp : public OpKernel {
+ public:
+  explicit XlaAotLaunchOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
+    string library_path, metadata_path;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("library_path", &library_path));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("metadata_path", &metadata_path));
+    Env* env = Env::Default();
+    OP_REQUIRES_OK(ctx, ReadBinaryProto(env, metadata_path, &metadata_));
+
+    num_args_ = metadata_.arg_sizes_size();
+    if (metadata_.has_context_arg()) {
+      OP_REQUIRES(ctx, num_args_ > 0,
+                  errors::InvalidArgument(
+                      "Metadata has a context arg, but no arg sizes"));
+      --num_args_;
+    }
+    OP_REQUIRES(ctx, ctx->num_inputs() == num_args_,
+                errors::InvalidArgument("Expected ", num_args_,
+                                        " args from metadata, but got ",
+                                        ctx->num_inputs()));
+    OP_REQUIRES(ctx, ctx->num_outputs() == metadata_.result_shapes_size() &&
+                         ctx->num_outputs() == metadata_.result_sizes_size(),
+                errors::InvalidArgument("Expected ",
+                                        metadata_.result_shapes_size(),
+                                        " results from metadata, but got ",
+                                        ctx->num_outputs()));
+    OP_REQUIRES(ctx, metadata_.result_index() >= 0 &&
+                         metadata_.result_index() < metadata_.temp_sizes_size(),
+                errors::InvalidArgument("Result index ",
+                                        metadata_.result_index(),
+                                        " is outside the range of temp sizes"));
+    OP_REQUIRES(ctx, metadata_.arg_types_size() == num_args_ &&
+                         metadata_.result_types_size() == ctx->num_outputs(),
+                errors::InvalidArgument(
+                    "Metadata has ", metadata_.arg_types_size(),
+                    " arg types and ", metadata_.result_types_size(),
+                    " result types, but expected ", num_args_, " and ",
+                    ctx->num_outputs()));
+    for (int i = 0; i < num_args_; ++i) {
+      OP_REQUIRES(ctx, ctx->input_type(i) == metadata_.arg_types(i),
+                  errors::InvalidArgument(
+                      "Arg ", i, " has type ",
+                      DataTypeString(ctx->input_type(i)),
+                      ", but the generated function expects ",
+                      DataTypeString(metadata_.arg_types(i))));
+    }
+    for (int i = 0; i < ctx->num_outputs(); ++i) {
+      OP_REQUIRES(ctx, ctx->output_type(i) == metadata_.result_types(i),
+                  errors::InvalidArgument(
+                      "Result ", i, " has type ",
+                      DataTypeString(ctx->output_type(i)),
+                      ", but the generated function returns ",
+                      DataTypeString(metadata_.result_types(i))));
+      OP_REQUIRES(ctx,
+                  TensorShape::IsValid(metadata_.result_shapes(i)) &&
+                      TensorShape(metadata_.result_shapes(i)).num_elements() *
+                              DataTypeSize(ctx->output_type(i)) ==
+                          metadata_.result_sizes(i),
+                  errors::InvalidArgument(
+                      "Result ", i, " of type ",
+                      DataTypeString(ctx->output_type(i)),
+                      " does not match the result size in the metadata"));
+    }
+    arg_sizes_.assign(metadata_.arg_sizes().begin(),
+                      metadata_.arg_sizes().end());
+    temp_sizes_.assign(metadata_.temp_sizes().begin(),
+                       metadata_.temp_sizes().end());
+
+    // The library handle is intentionally never closed, since the generated
+    // function may be shared by several kernels.
+    void* handle = nullptr;
+    OP_REQUIRES_OK(ctx, env->LoadLibrary(library_path.c_str(), &handle));
+    void* symbol = nullptr;
+    OP_REQUIRES_OK(ctx,
+                   env->GetSymbolFromLibrary(
+                       handle, metadata_.entry_point().c_str(), &symbol));
+    entry_point_ = reinterpret_cast<EntryPointFunction>(symbol);
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    // Arguments are passed without copying, unless they are insufficiently
+    // aligned for the generated code.
+    std::vector<void*> args(arg_sizes_.size(), nullptr);
+    std::vector<intptr_t> realign_sizes(num_args_, -1);
+    for (int i = 0; i < num_args_; ++i) {
+      const Tensor& arg = ctx->input(i);
+      OP_REQUIRES(ctx,
+                  static_cast<intptr_t>(arg.TotalBytes()) == arg_sizes_[i],
+                  errors::InvalidArgument(
+                      "Arg ", i, " has ", arg.TotalBytes(),
+                      " bytes, but the generated function expects ",
+                      arg_sizes_[i], " bytes"));
+      const char* data = arg.tensor_data().data();
+      if (reinterpret_cast<intptr_t>(data) % runtime::kAlign == 0) {
+        args[i] = const_cast<char*>(data);
+      } else {
+        realign_sizes[i] = arg_sizes_[i];
+      }
+    }
+    std::vector<void*> realigned(num_args_, nullptr);
+    ScopedContiguousBuffers realigned_buffers(runtime::MallocContiguousBuffers(
+        realign_sizes.data(), realign_sizes.size(), realigned.data(),
+        /*annotate_initialized=*/false));
+    for (int i = 0; i < num_args_; ++i) {
+      if (realigned[i] != nullptr) {
+        memcpy(realigned[i], ctx->input(i).tensor_data().data(),
+               arg_sizes_[i]);
+        args[i] = realigned[i];
+      }
+    }
+
+    const Eigen::ThreadPoolDevice* pool =
+        &ctx->eigen_device<Eigen::ThreadPoolDevice>();
+    XlaLocalRuntimeContext context;
+    context.thread_pool = pool;
+    if (metadata_.has_context_arg()) {
+      args.back() = &context;
+    }
+    xla::ExecutableRunOptions run_options;
+    run_options.set_intra_op_thread_pool(pool);
+
+    std::vector<void*> temps(temp_sizes_.size(), nullptr);
+    ScopedContiguousBuffers temp_buffers(runtime::MallocContiguousBuffers(
+        temp_sizes_.data(), temp_sizes_.size(), temps.data(),
+        /*annotate_initialized=*/true));
+
+    void* result = temps[metadata_.result_index()];
+    entry_point_(result, &run_options, args.data(), temps.data());
+    OP_REQUIRES(ctx, !context.error,
+                errors::Internal("Generated function ",
+                                 metadata_.entry_point(),
+                                 " failed: ", context.error_msg));
+
+    // The result buffers live in the temps, which are freed on return, so
+    // copy them into the outputs.
+    void** results = metadata_.result_is_tuple() ? static_cast<void**>(result)
+                                                 : &result;
+    for (int i = 0; i < ctx->num_outputs(); ++i) {
+      Tensor* output = nullptr;
+      OP_REQUIRES_OK(ctx,
+                     ctx->allocate_output(
+                         i, TensorShape(metadata_.result_shapes(i)), &output));
+      memcpy(const_cast<char*>(output->tensor_data().data()), results[i],
+             metadata_.result_sizes(i));
+    }
+  }
+
+ private:
+  AotMetadata metadata_;
+  int num_args_ = 0;
+  std::vector<intptr_t> arg_sizes_;
+  std::vector<intptr_t> temp_sizes_;
+  EntryPointFunction entry_point_ = nullptr;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(XlaAotLaunchOp);
+};
+
+REGISTER_KERNEL_BUILDER(Name("XlaAotLaunch").Device(DEVICE_CPU),
+                        XlaAotLaunchOp);
+
+}  // namespace tfcompile
+}  // namespace tensorflow
@@ -39,6 +39,7 @@ static void AllocateFlags() {
   flags->xla_hlo_graph_for_compute_constant = false;
   flags->xla_dump_computations_to = "";
   flags->xla_dump_executions_to = "";
+  flags->xla_hlo_profile_trace_to = "";
   flag_list = new std::vector<tensorflow::Flag>({
       tensorflow::Flag(
           "xla_hlo_profile", &flags->xla_hlo_profile,
@@ -55,6 +56,11 @@ static void AllocateFlags() {
       tensorflow::Flag("xla_dump_executions_to", &flags->xla_dump_executions_to,
                        "Dumps parameters and results of computations that XLA "
                        "executes into the provided directory path"),
+      tensorflow::Flag("xla_hlo_profile_trace_to",
+                       &flags->xla_hlo_profile_trace_to,
+                       "Dumps the timeline of each profiled execution, as a "
+                       "Chrome trace, into the provided directory path. "
+                       "Requires xla_hlo_profile."),
   });
   ParseFlagsFromEnv(*flag_list);
 }
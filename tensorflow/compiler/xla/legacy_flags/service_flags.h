@@ -44,6 +44,9 @@ typedef struct {
   // Dumps parameters and results of computations that XLA executes into
   // the provided directory path
   string xla_dump_executions_to;
+  // Dumps the timeline of each profiled execution, as a Chrome trace, into
+  // the provided directory path. Requires xla_hlo_profile.
+  string xla_hlo_profile_trace_to;
 } ServiceFlags;
 
 // Return a pointer to the ServiceFlags struct;
@@ -50,6 +50,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/cpu/cpu_executable.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_instruction_fusion.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_parallelization_preparation.h"
+#include "tensorflow/compiler/xla/service/cpu/critical_path_priority.h"
 #include "tensorflow/compiler/xla/service/cpu/disassembler.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emitter.h"
@@ -61,6 +62,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_constant_folding.h"
+#include "tensorflow/compiler/xla/service/hlo_cost_analysis.h"
 #include "tensorflow/compiler/xla/service/hlo_cse.h"
 #include "tensorflow/compiler/xla/service/hlo_dce.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
@@ -151,6 +153,7 @@ CpuCompiler::CpuCompiler() {
 namespace {
 
 const char* kXlaParallelCpuOption = "xla_cpu_parallel";
+const char* kXlaMemorySchedulerCpuOption = "xla_cpu_memory_scheduler";
 
 // LLVM makes certain options configurable only through its command-line
 // options; it provide the ParseCommandLineOptions function that lets us set
@@ -167,7 +170,8 @@ void InitializeLLVMCommandLineOptions(const HloModuleConfig& config) {
     fake_argv_storage.push_back("");
     for (const auto& it : options) {
       // Skip options the XLA backend itself consumes.
-      if (it.first != kXlaParallelCpuOption) {
+      if (it.first != kXlaParallelCpuOption &&
+          it.first != kXlaMemorySchedulerCpuOption) {
         if (it.second.empty()) {
           fake_argv_storage.push_back(it.first);
         } else {
@@ -194,6 +198,55 @@ bool CpuParallelBackendRequested(const HloModuleConfig& config) {
   return extra_options_map.count(kXlaParallelCpuOption) > 0;
 }
 
+// Returns the memory scheduler requested in the options of this module
+// configuration, which is one of "list", "dfs" or "post-order". If the option
+// is absent, an empty algorithm is returned, which selects the
+// DefaultMemoryScheduler.
+StatusOr<MemorySchedulerAlgorithm> CpuMemorySchedulerRequested(
+    const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaMemorySchedulerCpuOption);
+  if (it == extra_options_map.end()) {
+    return MemorySchedulerAlgorithm();
+  }
+  if (it->second == "list") {
+    return MemorySchedulerAlgorithm(ListMemoryScheduler);
+  } else if (it->second == "dfs") {
+    return MemorySchedulerAlgorithm(DFSMemoryScheduler);
+  } else if (it->second == "post-order") {
+    return MemorySchedulerAlgorithm(PostOrderMemoryScheduler);
+  }
+  return InvalidArgument("Unknown %s: \"%s\"", kXlaMemorySchedulerCpuOption,
+                         it->second.c_str());
+}
+
+// Returns the sequence in which to emit the HLO instructions of 'module',
+// using the memory scheduler requested in the module configuration. Logs the
+// peak live bytes of the chosen sequence, compared with the plain post-order.
+StatusOr<SequentialHloOrdering::HloModuleSequence> CreateModuleSequence(
+    const HloModule& module, const LogicalBuffer::SizeFunction& size_function) {
+  TF_ASSIGN_OR_RETURN(MemorySchedulerAlgorithm algorithm,
+                      CpuMemorySchedulerRequested(module.config()));
+  TF_ASSIGN_OR_RETURN(
+      SequentialHloOrdering::HloModuleSequence module_sequence,
+      CreateMemoryMinimizingSequence(module, size_function, algorithm));
+  if (VLOG_IS_ON(1)) {
+    TF_ASSIGN_OR_RETURN(SequentialHloOrdering::HloModuleSequence post_order,
+                        CreateMemoryMinimizingSequence(
+                            module, size_function, PostOrderMemoryScheduler));
+    TF_ASSIGN_OR_RETURN(const int64 post_order_bytes,
+                        MinimumMemoryForSequence(post_order, size_function));
+    TF_ASSIGN_OR_RETURN(
+        const int64 scheduled_bytes,
+        MinimumMemoryForSequence(module_sequence, size_function));
+    VLOG(1) << "Peak live bytes for module " << module.name()
+            << ": post-order " << post_order_bytes << ", scheduled "
+            << scheduled_bytes;
+  }
+  return std::move(module_sequence);
+}
+
 // This visitor records which HLO instructions should have profiling information
 // recorded.
 class CollectProfileCandidates : public DfsHloVisitorWithDefault {
@@ -488,12 +541,17 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::Compile(
       ir_module_string = llvm_ir::DumpModuleToString(*llvm_module);
     }
 
+    // Prioritize instructions on the critical path of the entry computation
+    // when dispatching them to the intra-op thread pool.
+    std::unordered_map<const HloInstruction*, int64> instruction_priorities =
+        ComputeCriticalPathPriorities(computation, ShapeSizeBytesFunction());
+
     // JIT compile the LLVM IR module to in-memory machine code.
     jit->AddModule(std::move(llvm_module));
     cpu_executable.reset(new ParallelCpuExecutable(
         std::move(jit), std::move(assignment), std::move(module),
         std::move(function_names), std::move(hlo_to_profile_idx),
-        std::move(aligned_constants)));
+        std::move(aligned_constants), std::move(instruction_priorities)));
 
     if (embed_ir_in_executable) {
       static_cast<CpuExecutable&>(*cpu_executable)
@@ -507,7 +565,7 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::Compile(
     // and reduced memory usage (as compared to using DependencyHloOrdering).
     TF_ASSIGN_OR_RETURN(
         SequentialHloOrdering::HloModuleSequence module_sequence,
-        CreateMemoryMinimizingSequence(*module, BufferSizeBytesFunction()));
+        CreateModuleSequence(*module, BufferSizeBytesFunction()));
 
     // Run buffer analysis on the HLO graph. This analysis figures out which
     // temporary buffers are required to run the computation.
@@ -517,6 +575,8 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::Compile(
             module.get(),
             MakeUnique<SequentialHloOrdering>(module.get(), module_sequence),
             BufferSizeBytesFunction(), memory_alignment));
+    VLOG(1) << "Buffer assignment stats for module " << module->name() << ":\n"
+            << assignment->GetStats().ToString();
 
     if (!dump_debug_json_to.empty()) {
       HloProto proto = MakeHloProto(*module, *assignment);
@@ -674,7 +734,7 @@ CpuCompiler::CompileAheadOfTime(std::vector<std::unique_ptr<HloModule>> modules,
 
     TF_ASSIGN_OR_RETURN(
         SequentialHloOrdering::HloModuleSequence module_sequence,
-        CreateMemoryMinimizingSequence(*module, BufferSizeBytesFunction()));
+        CreateModuleSequence(*module, BufferSizeBytesFunction()));
 
     // Run buffer analysis on the HLO graph. This analysis figures out which
     // temporary buffers are required to run the computation.
@@ -683,6 +743,8 @@ CpuCompiler::CompileAheadOfTime(std::vector<std::unique_ptr<HloModule>> modules,
         BufferAssigner::Run(
             module, MakeUnique<SequentialHloOrdering>(module, module_sequence),
             BufferSizeBytesFunction(), memory_alignment));
+    VLOG(1) << "Buffer assignment stats for module " << module->name() << ":\n"
+            << assignment->GetStats().ToString();
 
     const string dump_debug_json_to =
         module->config().debug_options().xla_dump_debug_json_to();
@@ -0,0 +1,73 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/critical_path_priority.h"
+
+#include <algorithm>
+#include <list>
+
+#include "tensorflow/compiler/xla/map_util.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace xla {
+namespace cpu {
+
+std::unordered_map<const HloInstruction*, int64> ComputeCriticalPathPriorities(
+    HloComputation* computation,
+    const HloCostAnalysis::ShapeSizeFunction& shape_size) {
+  // Note that HloCostAnalysis can return an error status for HLOs which it
+  // does not support yet (like CustomCall), in which case we fall back to a
+  // cost model based on the size of the output.
+  HloCostAnalysis cost_analysis(shape_size);
+  const bool cost_analysis_ok =
+      computation->root_instruction()->Accept(&cost_analysis).ok();
+  std::unordered_map<const HloInstruction*, int64> priorities;
+  const std::list<HloInstruction*> post_order =
+      computation->MakeInstructionPostOrder();
+  // Visit users before their operands.
+  for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+    const HloInstruction* instruction = *it;
+    // Same linear cost model as ParallelizationPreparation.
+    const int64 cost =
+        cost_analysis_ok
+            ? 1 * cost_analysis.flop_count(*instruction) +
+                  2 * cost_analysis.transcendental_count(*instruction) +
+                  10 * cost_analysis.bytes_accessed(*instruction)
+            : shape_size(instruction->shape());
+    int64 max_user_priority = 0;
+    for (const HloInstruction* user : instruction->users()) {
+      max_user_priority =
+          std::max(max_user_priority, FindOrDie(priorities, user));
+    }
+    InsertOrDie(&priorities, instruction, cost + max_user_priority);
+  }
+  return priorities;
+}
+
+void ReadyInstructionQueue::Push(HloInstruction* instruction, int64 position) {
+  auto it = priorities_->find(instruction);
+  const int64 priority = it == priorities_->end() ? 0 : it->second;
+  queue_.push({priority, position, instruction});
+}
+
+HloInstruction* ReadyInstructionQueue::Pop() {
+  CHECK(!queue_.empty());
+  HloInstruction* instruction = queue_.top().instruction;
+  queue_.pop();
+  return instruction;
+}
+
+}  // namespace cpu
+}  // namespace xla
@@ -0,0 +1,81 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_COMPILER_XLA_SERVICE_CPU_CRITICAL_PATH_PRIORITY_H_
+#define THIRD_PARTY_TENSORFLOW_COMPILER_XLA_SERVICE_CPU_CRITICAL_PATH_PRIORITY_H_
+
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_cost_analysis.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+namespace cpu {
+
+// Returns the scheduling priority of each instruction in 'computation' for the
+// parallel CPU backend: the estimated cost of the most expensive path from the
+// instruction (inclusive) to the root of the computation. Dispatching ready
+// instructions in decreasing priority order starts work on the critical path
+// of the computation as early as possible.
+std::unordered_map<const HloInstruction*, int64> ComputeCriticalPathPriorities(
+    HloComputation* computation,
+    const HloCostAnalysis::ShapeSizeFunction& shape_size);
+
+// ReadyInstructionQueue holds the instructions whose operands are all
+// available, and returns them in order of decreasing priority. Instructions
+// missing from 'priorities' have priority 0. Ties are broken by 'position',
+// smallest first, which is the position of the instruction in the order the
+// executor would otherwise run them in.
+class ReadyInstructionQueue {
+ public:
+  explicit ReadyInstructionQueue(
+      const std::unordered_map<const HloInstruction*, int64>* priorities)
+      : priorities_(priorities) {}
+
+  void Push(HloInstruction* instruction, int64 position);
+
+  // Removes and returns the instruction with the highest priority. The queue
+  // must not be empty.
+  HloInstruction* Pop();
+
+  bool empty() const { return queue_.empty(); }
+  size_t size() const { return queue_.size(); }
+
+ private:
+  struct Entry {
+    int64 priority;
+    int64 position;
+    HloInstruction* instruction;
+
+    bool operator<(const Entry& other) const {
+      if (priority != other.priority) {
+        return priority < other.priority;
+      }
+      return position > other.position;
+    }
+  };
+
+  const std::unordered_map<const HloInstruction*, int64>* priorities_;
+  std::priority_queue<Entry> queue_;
+};
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // THIRD_PARTY_TENSORFLOW_COMPILER_XLA_SERVICE_CPU_CRITICAL_PATH_PRIORITY_H_
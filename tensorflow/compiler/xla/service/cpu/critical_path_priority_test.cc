@@ -0,0 +1,114 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/critical_path_priority.h"
+
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/test.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+class CriticalPathPriorityTest : public HloTestBase {
+ protected:
+  static int64 ShapeSize(const Shape& shape) {
+    return ShapeUtil::ByteSizeOf(shape, sizeof(void*));
+  }
+};
+
+TEST_F(CriticalPathPriorityTest, ExpensiveBranchComesFirst) {
+  // An expensive chain of exponentials on a large vector, and a cheap negation
+  // of a scalar, both feeding the root tuple.
+  const Shape vector_shape = ShapeUtil::MakeShape(F32, {4096});
+  const Shape scalar_shape = ShapeUtil::MakeShape(F32, {});
+  auto builder = HloComputation::Builder(TestName());
+  HloInstruction* vector = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, vector_shape, "vector"));
+  HloInstruction* scalar = builder.AddInstruction(
+      HloInstruction::CreateParameter(1, scalar_shape, "scalar"));
+  HloInstruction* exp1 = builder.AddInstruction(
+      HloInstruction::CreateUnary(vector_shape, HloOpcode::kExp, vector));
+  HloInstruction* exp2 = builder.AddInstruction(
+      HloInstruction::CreateUnary(vector_shape, HloOpcode::kExp, exp1));
+  HloInstruction* negate = builder.AddInstruction(
+      HloInstruction::CreateUnary(scalar_shape, HloOpcode::kNegate, scalar));
+  HloInstruction* tuple =
+      builder.AddInstruction(HloInstruction::CreateTuple({exp2, negate}));
+  auto module = CreateNewModule();
+  HloComputation* computation = module->AddEntryComputation(builder.Build());
+
+  std::unordered_map<const HloInstruction*, int64> priorities =
+      ComputeCriticalPathPriorities(computation, ShapeSize);
+  ASSERT_EQ(computation->instruction_count(), priorities.size());
+
+  // The priority of an instruction includes the cost of its users.
+  for (const auto& priority : priorities) {
+    for (const HloInstruction* user : priority.first->users()) {
+      EXPECT_GE(priority.second, priorities.at(user));
+    }
+  }
+  EXPECT_GT(priorities.at(exp1), priorities.at(exp2));
+  EXPECT_GT(priorities.at(vector), priorities.at(scalar));
+  EXPECT_GT(priorities.at(exp1), priorities.at(negate));
+  EXPECT_GT(priorities.at(exp2), priorities.at(negate));
+  EXPECT_GE(priorities.at(negate), priorities.at(tuple));
+
+  // When both branches are ready, the executor starts the expensive one.
+  ReadyInstructionQueue ready(&priorities);
+  ready.Push(negate, 0);
+  ready.Push(exp1, 1);
+  EXPECT_EQ(exp1, ready.Pop());
+  EXPECT_EQ(negate, ready.Pop());
+  EXPECT_TRUE(ready.empty());
+}
+
+TEST_F(CriticalPathPriorityTest, ReadyQueueBreaksTiesByPosition) {
+  const Shape shape = ShapeUtil::MakeShape(F32, {16});
+  auto builder = HloComputation::Builder(TestName());
+  HloInstruction* param0 =
+      builder.AddInstruction(HloInstruction::CreateParameter(0, shape, "p0"));
+  HloInstruction* param1 =
+      builder.AddInstruction(HloInstruction::CreateParameter(1, shape, "p1"));
+  HloInstruction* param2 =
+      builder.AddInstruction(HloInstruction::CreateParameter(2, shape, "p2"));
+  HloInstruction* param3 =
+      builder.AddInstruction(HloInstruction::CreateParameter(3, shape, "p3"));
+  auto module = CreateNewModule();
+  module->AddEntryComputation(builder.Build());
+
+  // 'param3' has no priority, so it comes last.
+  std::unordered_map<const HloInstruction*, int64> priorities = {
+      {param0, 10}, {param1, 20}, {param2, 10}};
+  ReadyInstructionQueue ready(&priorities);
+  ready.Push(param3, 0);
+  ready.Push(param2, 1);
+  ready.Push(param1, 3);
+  ready.Push(param0, 2);
+  ASSERT_EQ(4, ready.size());
+  EXPECT_EQ(param1, ready.Pop());
+  EXPECT_EQ(param2, ready.Pop());
+  EXPECT_EQ(param0, ready.Pop());
+  EXPECT_EQ(param3, ready.Pop());
+  EXPECT_TRUE(ready.empty());
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
@@ -19,7 +19,6 @@ limitations under the License.
 #include <algorithm>
 #include <deque>
 #include <iterator>
-#include <list>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -61,13 +60,15 @@ ParallelCpuExecutable::ParallelCpuExecutable(
     std::unique_ptr<std::map<HloInstruction*, string>> function_names,
     std::unordered_map<const HloInstruction*, size_t> hlo_to_profile_idx,
     std::unordered_map<const HloInstruction*, std::unique_ptr<unsigned char[]>>
-        aligned_constants)
+        aligned_constants,
+    std::unordered_map<const HloInstruction*, int64> instruction_priorities)
     : Executable(std::move(hlo_module), ParallelCpuExecutable::ShapeSizeBytes),
       jit_(std::move(jit)),
       assignment_(std::move(assignment)),
       functions_names_(std::move(function_names)),
       hlo_to_profile_idx_(std::move(hlo_to_profile_idx)),
-      aligned_constants_(std::move(aligned_constants)) {}
+      aligned_constants_(std::move(aligned_constants)),
+      instruction_priorities_(std::move(instruction_priorities)) {}
 
 // Type of the computation function we expect in the JIT.
 using ComputeFunctionType = void (*)(void*, const void*, const void**, void**,
@@ -100,34 +101,50 @@ namespace {
 
 // Executor manages the concurrent execution of 'functions' for instructions
 // in 'pending' on 'thread_pool' (storing resulting data in 'results').
+//
+// Instructions are dispatched as soon as all of their operands are available,
+// so independent instructions of the entry computation run concurrently. When
+// more instructions are ready than there are threads in 'thread_pool', the
+// ready instructions are dispatched in order of decreasing priority (see
+// 'priorities'), which lets instructions on the critical path start first.
+//
+// If 'hlo_execution_profile' is non-null, the wall-clock interval of each
+// task is recorded in it as a timeline event.
 class Executor {
  public:
   Executor(const std::map<HloInstruction*, ComputeFunctionType>& functions,
            const ServiceExecutableRunOptions* run_options,
-           std::list<HloInstruction*>* pending,
+           const std::vector<HloInstruction*>& pending,
+           const std::unordered_map<const HloInstruction*, int64>& priorities,
            std::map<HloInstruction*, const void*>* results, void** temps_array,
-           uint64* profile_counters_array, BufferAssignment* assignment)
+           uint64* profile_counters_array, BufferAssignment* assignment,
+           HloExecutionProfile* hlo_execution_profile)
       : functions_(functions),
         run_options_(run_options),
         pending_(pending),
+        priorities_(priorities),
         results_(results),
         temps_array_(temps_array),
         profile_counters_array_(profile_counters_array),
         thread_pool_(CHECK_NOTNULL(run_options_->xla_intra_op_thread_pool())),
-        assignment_(assignment) {}
+        assignment_(assignment),
+        hlo_execution_profile_(hlo_execution_profile) {}
 
   // Executes pending list of instructions on thread pool.
   // Returns OK status on success, error status otherwise.
   Status Run();
 
  private:
+  // Dispatches the compute function(s) for 'instruction' on 'thread_pool_'.
+  Status Dispatch(HloInstruction* instruction);
+
   // Schedules a parallel invocation of compute function for 'instruction' on
   // 'thread_pool_', storing result in 'result_buffer'.
   // If 'partition_buffers' is non-null, parallel task will be invoked on
   // per-dimension partition [start, limit) values stored in
-  // 'partition_buffers'.
+  // 'partition_buffers'. 'task_index' identifies the task in the profile.
   void Schedule(HloInstruction* instruction, int64* partition_buffers,
-                void* result_buffer);
+                void* result_buffer, int64 task_index);
 
   // Returns true if 'instruction' has been assigned parallel tasks (returns
   // false otherwise).
@@ -141,15 +158,20 @@ class Executor {
   // Returns array of result buffers for all operands in 'instruction'.
   const void** GetOperandBuffers(HloInstruction* instruction);
 
+  // Returns the address of the result buffer of 'instruction'.
+  StatusOr<void*> GetResultBuffer(HloInstruction* instruction);
+
   // Arguments passed into Executor.
   const std::map<HloInstruction*, ComputeFunctionType>& functions_;
   const ServiceExecutableRunOptions* run_options_;
-  std::list<HloInstruction*>* pending_;
+  const std::vector<HloInstruction*>& pending_;
+  const std::unordered_map<const HloInstruction*, int64>& priorities_;
   std::map<HloInstruction*, const void*>* results_;
   void** temps_array_;
   uint64* profile_counters_array_;
   tensorflow::thread::ThreadPool* thread_pool_;
   BufferAssignment* assignment_;
+  HloExecutionProfile* hlo_execution_profile_;
 
   // Members used to manage instruction execution.
   tensorflow::mutex completion_queue_lock_;
@@ -160,110 +182,143 @@ class Executor {
 };
 
 Status Executor::Run() {
-  while (!pending_->empty() || instructions_in_flight_ > 0) {
-    auto pending_it = pending_->begin();
-    while (pending_it != pending_->end()) {
-      HloInstruction* instruction = *pending_it;
-      // Skip pending instructions whose operands aren't ready.
-      if (std::any_of(instruction->operands().begin(),
-                      instruction->operands().end(),
-                      [&](HloInstruction* operand) {
-                        return !ContainsKey(*results_, operand);
-                      })) {
-        ++pending_it;
-        continue;
-      }
-
-      // Get 'result_buffer' reference to result buffer for 'instruction'.
-      TF_ASSIGN_OR_RETURN(const BufferAllocation::Slice result_slice,
-                          assignment_->GetUniqueTopLevelSlice(instruction));
-      void* result_buffer =
-          static_cast<char*>(temps_array_[result_slice.index()]) +
-          result_slice.offset();
-
-      if (HasParallelTasks(instruction)) {
-        // 'instruction' has been assigned parallel task partitions.
-        CHECK_EQ(HloOpcode::kCall, instruction->opcode());
-        HloInstruction* root = instruction->to_apply()->root_instruction();
-
-        // Create ShapePartitionIterator to iterate through all outer dimension
-        // partitions of 'instruction'.
-        ShapePartitionIterator partition_iterator(
-            root->shape(), root->outer_dimension_partitions());
-
-        const int64 partition_count =
-            partition_iterator.GetTotalPartitionCount();
-
-        // Record total parallel task count for 'instruction' before dispatch.
-        {
-          tensorflow::mutex_lock l(completion_queue_lock_);
-          tasks_in_flight_.insert(std::make_pair(instruction, partition_count));
-          VLOG(2) << "Schedule PARALLEL"
-                  << " instruction: " << instruction->name()
-                  << " instruction.callee: "
-                  << instruction->to_apply()->root_instruction()->name()
-                  << " partition_count: " << partition_count;
-        }
-
-        for (int64 i = 0; i < partition_count; ++i) {
-          // Get partition [start, limit) for each dimension.
-          auto partition_buffers =
-              GetPartitionBuffers(partition_iterator.GetPartition(i));
-          Schedule(instruction, partition_buffers, result_buffer);
-        }
-
-      } else {
-        // Set tasks in-flight to '1' for sequential instruction execution.
-        {
-          tensorflow::mutex_lock l(completion_queue_lock_);
-          tasks_in_flight_.insert(std::make_pair(instruction, 1));
-          VLOG(2) << "Schedule SEQUENTIAL"
-                  << " instruction: " << instruction->name()
-                  << " instruction.callee: "
-                  << instruction->to_apply()->root_instruction()->name();
-        }
-        Schedule(instruction, nullptr, result_buffer);
+  // Count the operands of each pending instruction which have not been
+  // computed yet, and seed the ready queue with the instructions which can
+  // run immediately.
+  std::unordered_map<const HloInstruction*, int64> unready_operand_counts;
+  std::unordered_map<const HloInstruction*, int64> positions;
+  ReadyInstructionQueue ready(&priorities_);
+  for (int64 i = 0; i < pending_.size(); ++i) {
+    HloInstruction* instruction = pending_[i];
+    std::unordered_set<const HloInstruction*> unready_operands;
+    for (HloInstruction* operand : instruction->operands()) {
+      if (!ContainsKey(*results_, operand)) {
+        unready_operands.insert(operand);
       }
+    }
+    unready_operand_counts[instruction] = unready_operands.size();
+    positions[instruction] = i;
+    if (unready_operands.empty()) {
+      ready.Push(instruction, i);
+    }
+  }
 
+  // Limit the number of instructions in flight to the number of threads, so
+  // that the thread pool does not queue up low priority work ahead of
+  // instructions which become ready later but are on the critical path.
+  const int64 max_instructions_in_flight =
+      std::max(1, thread_pool_->NumThreads());
+
+  int64 instructions_remaining = pending_.size();
+  while (instructions_remaining > 0) {
+    while (!ready.empty() &&
+           instructions_in_flight_ < max_instructions_in_flight) {
+      HloInstruction* instruction = ready.Pop();
+      TF_RETURN_IF_ERROR(Dispatch(instruction));
       ++instructions_in_flight_;
-      pending_it = pending_->erase(pending_it);
     }
-    // Wait for a completed HLO instruction to be present in the queue.  We will
-    // pop it out of the queue and make the result available to its users.
-    HloInstruction* instruction;
-    do {
+    TF_RET_CHECK(instructions_in_flight_ > 0)
+        << "No instructions in flight but " << instructions_remaining
+        << " instructions remain; the entry computation has a cycle?";
+
+    // Wait for completed HLO instructions to be present in the queue. We
+    // take all of them out of the queue and make their results available to
+    // their users.
+    std::deque<HloInstruction*> completed;
+    {
       tensorflow::mutex_lock l(completion_queue_lock_);
-      if (completion_queue_.empty()) {
+      while (completion_queue_.empty()) {
         completion_queue_cv_.wait(l);
       }
-      if (!completion_queue_.empty()) {
-        instruction = completion_queue_.front();
-        completion_queue_.pop_front();
-        break;
+      completed.swap(completion_queue_);
+    }
+    for (HloInstruction* instruction : completed) {
+      TF_ASSIGN_OR_RETURN(void* result_buffer, GetResultBuffer(instruction));
+      InsertOrDie(results_, instruction, result_buffer);
+      --instructions_in_flight_;
+      --instructions_remaining;
+      for (HloInstruction* user : instruction->users()) {
+        auto it = unready_operand_counts.find(user);
+        if (it != unready_operand_counts.end() && --it->second == 0) {
+          ready.Push(user, FindOrDie(positions, user));
+        }
       }
-    } while (1);
-    TF_ASSIGN_OR_RETURN(const BufferAllocation::Slice result_slice,
-                        assignment_->GetUniqueTopLevelSlice(instruction));
-    void* result_buffer =
-        static_cast<char*>(temps_array_[result_slice.index()]) +
-        result_slice.offset();
-    InsertOrDie(results_, instruction, result_buffer);
-    --instructions_in_flight_;
+    }
   }
   return Status::OK();
 }
 
+Status Executor::Dispatch(HloInstruction* instruction) {
+  // Get 'result_buffer' reference to result buffer for 'instruction'.
+  TF_ASSIGN_OR_RETURN(void* result_buffer, GetResultBuffer(instruction));
+
+  if (HasParallelTasks(instruction)) {
+    // 'instruction' has been assigned parallel task partitions.
+    CHECK_EQ(HloOpcode::kCall, instruction->opcode());
+    HloInstruction* root = instruction->to_apply()->root_instruction();
+
+    // Create ShapePartitionIterator to iterate through all outer dimension
+    // partitions of 'instruction'.
+    ShapePartitionIterator partition_iterator(
+        root->shape(), root->outer_dimension_partitions());
+
+    const int64 partition_count = partition_iterator.GetTotalPartitionCount();
+
+    // Record total parallel task count for 'instruction' before dispatch.
+    {
+      tensorflow::mutex_lock l(completion_queue_lock_);
+      tasks_in_flight_.insert(std::make_pair(instruction, partition_count));
+      VLOG(2) << "Schedule PARALLEL"
+              << " instruction: " << instruction->name()
+              << " instruction.callee: "
+              << instruction->to_apply()->root_instruction()->name()
+              << " partition_count: " << partition_count;
+    }
+
+    for (int64 i = 0; i < partition_count; ++i) {
+      // Get partition [start, limit) for each dimension.
+      auto partition_buffers =
+          GetPartitionBuffers(partition_iterator.GetPartition(i));
+      Schedule(instruction, partition_buffers, result_buffer, i);
+    }
+
+  } else {
+    // Set tasks in-flight to '1' for sequential instruction execution.
+    {
+      tensorflow::mutex_lock l(completion_queue_lock_);
+      tasks_in_flight_.insert(std::make_pair(instruction, 1));
+      VLOG(2) << "Schedule SEQUENTIAL"
+              << " instruction: " << instruction->name()
+              << " instruction.callee: "
+              << instruction->to_apply()->root_instruction()->name();
+    }
+    Schedule(instruction, nullptr, result_buffer, /*task_index=*/0);
+  }
+  return Status::OK();
+}
+
+StatusOr<void*> Executor::GetResultBuffer(HloInstruction* instruction) {
+  TF_ASSIGN_OR_RETURN(const BufferAllocation::Slice result_slice,
+                      assignment_->GetUniqueTopLevelSlice(instruction));
+  return static_cast<char*>(temps_array_[result_slice.index()]) +
+         result_slice.offset();
+}
+
 void Executor::Schedule(HloInstruction* instruction, int64* partition_buffers,
-                        void* result_buffer) {
+                        void* result_buffer, int64 task_index) {
   // The thread pool entry takes ownership of |operand_buffers|.
   auto operand_buffers = GetOperandBuffers(instruction);
 
   auto function = FindOrDie(functions_, instruction);
   const auto* exec_run_options = &run_options_->run_options();
   thread_pool_->Schedule([this, instruction, result_buffer, operand_buffers,
-                          partition_buffers, exec_run_options, function]() {
+                          partition_buffers, exec_run_options, function,
+                          task_index]() {
+    const bool tracing = hlo_execution_profile_ != nullptr;
+    uint64 start_micros = tracing ? tensorflow::Env::Default()->NowMicros() : 0;
     function(result_buffer, exec_run_options, operand_buffers, temps_array_,
              partition_buffers, profile_counters_array_);
+    uint64 end_micros = tracing ? tensorflow::Env::Default()->NowMicros() : 0;
 
     delete[] operand_buffers;
     delete[] partition_buffers;
@@ -276,6 +331,11 @@ void Executor::Schedule(HloInstruction* instruction, int64* partition_buffers,
     // on completion.
     {
       tensorflow::mutex_lock l(completion_queue_lock_);
+      if (tracing) {
+        hlo_execution_profile_->AddTraceEvent(
+            {instruction, task_index, thread_pool_->CurrentThreadId(),
+             start_micros, end_micros});
+      }
       // Decrement in-flight task count for this completion.
       if (--FindOrDie(tasks_in_flight_, instruction) == 0) {
         completion_queue_.push_back(instruction);
@@ -416,7 +476,7 @@ Status ParallelCpuExecutable::ExecuteComputeFunctions(
 
   uint64 start_micros = tensorflow::Env::Default()->NowMicros();
 
-  std::list<HloInstruction*> pending;
+  std::vector<HloInstruction*> pending;
 
   // Call the function for each HLO instruction in topological order.
   const HloComputation& entry_computation = *module().entry_computation();
@@ -437,13 +497,13 @@ Status ParallelCpuExecutable::ExecuteComputeFunctions(
     }
   }
 
-  // TODO(b/27458679) Manage scheduling based on in-flight concurrency limits.
-  // For example, if we expect a library conv/matmul call to run at max
-  // concurrency, we should not dispatch runnable instructions until the
+  // TODO(b/27458679) Take the internal threading of library calls into
+  // account. For example, if we expect a library conv/matmul call to run at
+  // max concurrency, we should not dispatch runnable instructions until the
   // libary call is finished (to avoid expensive cache invalidation).
-  Executor executor(functions, run_options, &pending, &results,
-                    buffer_pointers.data(), profile_counters.data(),
-                    assignment_.get());
+  Executor executor(functions, run_options, pending, instruction_priorities_,
+                    &results, buffer_pointers.data(), profile_counters.data(),
+                    assignment_.get(), hlo_execution_profile);
 
   TF_RETURN_IF_ERROR(executor.Run());
 
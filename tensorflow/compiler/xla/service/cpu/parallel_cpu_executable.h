@@ -55,7 +55,8 @@ class ParallelCpuExecutable : public Executable {
       std::unordered_map<const HloInstruction*, size_t> hlo_to_profile_idx,
       std::unordered_map<const HloInstruction*,
                          std::unique_ptr<unsigned char[]>>
-          aligned_constants);
+          aligned_constants,
+      std::unordered_map<const HloInstruction*, int64> instruction_priorities);
   ~ParallelCpuExecutable() override {}
 
   StatusOr<perftools::gputools::DeviceMemoryBase> ExecuteOnStream(
@@ -144,6 +145,13 @@ class ParallelCpuExecutable : public Executable {
   std::unordered_map<const HloInstruction*, std::unique_ptr<unsigned char[]>>
       aligned_constants_;
 
+  // Map from instructions in the entry computation to their scheduling
+  // priority. When more instructions are ready to run than there are threads
+  // in the intra-op thread pool, instructions with higher priority are
+  // dispatched first. Instructions missing from the map have priority 0.
+  const std::unordered_map<const HloInstruction*, int64>
+      instruction_priorities_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(ParallelCpuExecutable);
 };
 
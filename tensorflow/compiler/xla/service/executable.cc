@@ -78,6 +78,31 @@ static void SanitizeFilename(string* name) {
   }
 }
 
+Status Executable::DumpHloExecutionTrace(
+    const HloExecutionProfile& hlo_execution_profile) {
+  legacy_flags::ServiceFlags* flags = legacy_flags::GetServiceFlags();
+  const string& directory_path = flags->xla_hlo_profile_trace_to;
+  string trace = hlo_execution_profile.ToChromeTraceJson(shape_size_function_);
+  if (trace.empty()) {
+    return Status::OK();
+  }
+  int64 trace_count;
+  {
+    tensorflow::mutex_lock lock(mutex_);
+    trace_count = ++trace_count_;
+  }
+  string filename = tensorflow::strings::Printf(
+      "%s__trace_%lld.json", module().name().c_str(), trace_count);
+  SanitizeFilename(&filename);
+
+  tensorflow::Env* env = tensorflow::Env::Default();
+  if (!env->IsDirectory(directory_path).ok()) {
+    TF_RETURN_IF_ERROR(env->CreateDir(directory_path));
+  }
+  string file_path = tensorflow::io::JoinPath(directory_path, filename);
+  return tensorflow::WriteStringToFile(env, file_path, trace);
+}
+
 /* static */ Status Executable::DumpToDirectory(
     const string& directory_path, string filename,
     const SessionModule& session_module) {
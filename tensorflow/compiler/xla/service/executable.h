@@ -140,6 +140,11 @@ class Executable {
   SessionModule* session_module() const { return session_module_.get(); }
   Status DumpSessionModule();
 
+  // Dumps the timeline recorded in 'hlo_execution_profile', as a Chrome trace,
+  // into the directory given by the xla_hlo_profile_trace_to flag.
+  Status DumpHloExecutionTrace(
+      const HloExecutionProfile& hlo_execution_profile);
+
   // Dump session_module to directory_path/filename.
   static Status DumpToDirectory(const string& directory_path, string filename,
                                 const SessionModule& session_module);
@@ -171,6 +176,10 @@ class Executable {
   // Execution count, used to generate a unique filename for each dumped
   // execution.
   int64 execution_count_ = 0;
+
+  // Trace count, used to generate a unique filename for each dumped execution
+  // trace.
+  int64 trace_count_ GUARDED_BY(mutex_) = 0;
 };
 
 template <typename ReturnT, typename ArgT>
@@ -237,6 +246,12 @@ StatusOr<ReturnT> Executable::ExecuteOnStreamWrapper(
         }
       }
     }
+    if (!flags->xla_hlo_profile_trace_to.empty()) {
+      Status status = DumpHloExecutionTrace(*profile_ptr);
+      if (!status.ok()) {
+        LOG(WARNING) << "Failed to dump HLO execution trace: " << status;
+      }
+    }
     hlo_graph_dumper::MaybeDumpHloModule(module(), "Service::Execute",
                                          profile_ptr);
   }
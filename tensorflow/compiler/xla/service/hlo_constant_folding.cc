@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/layout_util.h"
 #include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/ptr_util.h"
 #include "tensorflow/compiler/xla/service/dfs_hlo_visitor_with_default.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_evaluator.h"
@@ -31,12 +32,28 @@ limitations under the License.
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace xla {
 
+namespace {
+
+// Results with at least this many elements are evaluated in parallel.
+constexpr int64 kMinElementsForParallelEvaluation = 16 * 1024;
+
+}  // namespace
+
 StatusOr<bool> HloConstantFolding::Run(HloModule* module) {
   auto evaluator = MakeUnique<HloEvaluator>();
 
+  // Large results (e.g. from preprocessing the weights of a frozen graph) are
+  // evaluated by an evaluator with a thread pool, which is only created once
+  // such a result is found.
+  std::unique_ptr<tensorflow::thread::ThreadPool> thread_pool;
+  std::unique_ptr<HloEvaluator> parallel_evaluator;
+
   XLA_VLOG_LINES(2,
                  "HloConstantFolding::Run(), before:\n" + module->ToString());
   bool changed = false;
@@ -65,7 +82,21 @@ StatusOr<bool> HloConstantFolding::Run(HloModule* module) {
         continue;
       }
 
-      std::unique_ptr<Literal> result = evaluator->TryEvaluate(instruction);
+      HloEvaluator* instruction_evaluator = evaluator.get();
+      if (ShapeUtil::IsArray(instruction->shape()) &&
+          ShapeUtil::ElementsIn(instruction->shape()) >=
+              kMinElementsForParallelEvaluation) {
+        if (parallel_evaluator == nullptr) {
+          thread_pool = MakeUnique<tensorflow::thread::ThreadPool>(
+              tensorflow::Env::Default(), "constant_folding",
+              tensorflow::port::NumSchedulableCPUs());
+          parallel_evaluator = MakeUnique<HloEvaluator>(thread_pool.get());
+        }
+        instruction_evaluator = parallel_evaluator.get();
+      }
+
+      std::unique_ptr<Literal> result =
+          instruction_evaluator->TryEvaluate(instruction);
       // Currently we skip unimplemented operations.
       // TODO(b/35975797): Fold constant computations for more operations.
       if (result == nullptr) {
@@ -50,10 +50,80 @@ namespace xla {
 
 namespace {
 
+// Evaluations estimated to take fewer cycles than this are not worth
+// partitioning across threads.
+constexpr int64 kMinCostForParallelism = 100000;
+
+// Estimated number of cycles taken to evaluate an elementwise operation on a
+// single element, including the call through std::function.
+constexpr int64 kElementwiseCost = 10;
+
+// Calls 'fn' on ranges [begin, end) which together cover [0, total). The ranges
+// are processed in parallel on 'thread_pool' if it is non-null and 'total'
+// units of work of 'cost_per_unit' cycles each are worth partitioning.
+void ForEachRange(tensorflow::thread::ThreadPool* thread_pool, int64 total,
+                  int64 cost_per_unit,
+                  const std::function<void(int64, int64)>& fn) {
+  if (thread_pool == nullptr ||
+      total * cost_per_unit < kMinCostForParallelism) {
+    fn(0, total);
+    return;
+  }
+  thread_pool->ParallelFor(total, cost_per_unit, fn);
+}
+
+// Returns true if the elements of 'literal' are laid out exactly like those of
+// an array of 'shape', so that both can be indexed by the same linear index.
+bool HasSameLinearLayout(const Shape& shape, const Literal& literal) {
+  return LayoutUtil::HasLayout(shape) &&
+         LayoutUtil::HasLayout(literal.shape()) &&
+         ShapeUtil::SameDimensions(shape, literal.shape()) &&
+         LayoutUtil::Equal(shape.layout(), literal.shape().layout());
+}
+
+// Populates 'literal' like Literal::Populate does. If 'thread_pool' is non-null
+// and the evaluation is expensive enough, ranges of linear indices of the
+// literal are populated in parallel, so 'generator' must be thread-safe.
+template <typename NativeT>
+Status PopulateParallel(
+    Literal* literal, tensorflow::thread::ThreadPool* thread_pool,
+    int64 cost_per_element,
+    const std::function<NativeT(tensorflow::gtl::ArraySlice<int64>)>&
+        generator) {
+  const Shape& shape = literal->shape();
+  const int64 element_count = ShapeUtil::ElementsIn(shape);
+  if (thread_pool == nullptr || ShapeUtil::Rank(shape) == 0 ||
+      element_count * cost_per_element < kMinCostForParallelism) {
+    return literal->Populate<NativeT>(generator);
+  }
+  TF_RET_CHECK(shape.element_type() ==
+               primitive_util::NativeToPrimitiveType<NativeT>());
+  TF_RET_CHECK(!LayoutUtil::IsPadded(shape));
+  tensorflow::gtl::MutableArraySlice<NativeT> data =
+      literal->GetMutableArraySlice<NativeT>();
+  ForEachRange(
+      thread_pool, element_count, cost_per_element,
+      [&](int64 begin, int64 end) {
+        std::vector<int64> multi_index =
+            IndexUtil::LinearIndexToMultidimensionalIndex(shape, begin);
+        for (int64 i = begin; i < end; ++i) {
+          data[i] = generator(multi_index);
+          // Step to the next index in linear order.
+          for (int64 dimension : shape.layout().minor_to_major()) {
+            if (++multi_index[dimension] < shape.dimensions(dimension)) {
+              break;
+            }
+            multi_index[dimension] = 0;
+          }
+        }
+      });
+  return Status::OK();
+}
+
 template <typename OperandT>
-StatusOr<std::unique_ptr<Literal>> Compare(const Shape& shape, HloOpcode opcode,
-                                           const Literal& lhs_literal,
-                                           const Literal& rhs_literal) {
+StatusOr<std::unique_ptr<Literal>> Compare(
+    const Shape& shape, HloOpcode opcode, const Literal& lhs_literal,
+    const Literal& rhs_literal, tensorflow::thread::ThreadPool* thread_pool) {
   std::function<bool(OperandT, OperandT)> compare_op;
   switch (opcode) {
     case HloOpcode::kEq:
@@ -92,6 +162,23 @@ StatusOr<std::unique_ptr<Literal>> Compare(const Shape& shape, HloOpcode opcode,
   }
 
   auto result = Literal::CreateFromShape(shape);
+  if (HasSameLinearLayout(shape, lhs_literal) &&
+      HasSameLinearLayout(shape, rhs_literal)) {
+    tensorflow::gtl::ArraySlice<OperandT> lhs_data =
+        lhs_literal.GetArraySlice<OperandT>();
+    tensorflow::gtl::ArraySlice<OperandT> rhs_data =
+        rhs_literal.GetArraySlice<OperandT>();
+    tensorflow::gtl::MutableArraySlice<bool> result_data =
+        result->GetMutableArraySlice<bool>();
+    ForEachRange(thread_pool, result_data.size(), kElementwiseCost,
+                 [&](int64 begin, int64 end) {
+                   for (int64 i = begin; i < end; ++i) {
+                     result_data[i] = compare_op(lhs_data[i], rhs_data[i]);
+                   }
+                 });
+    return std::move(result);
+  }
+
   TF_RETURN_IF_ERROR(result->Populate<bool>(
       [&](tensorflow::gtl::ArraySlice<int64> multi_index) {
         return compare_op(lhs_literal.Get<OperandT>(multi_index),
@@ -105,7 +192,8 @@ template <typename ReturnT, typename NativeT>
 StatusOr<std::unique_ptr<Literal>> ElementWiseUnaryOpImpl(
     HloInstruction* instruction,
     const std::function<ReturnT(NativeT)>& unary_op,
-    const Literal& operand_literal) {
+    const Literal& operand_literal,
+    tensorflow::thread::ThreadPool* thread_pool) {
   const auto shape = instruction->shape();
   const auto* operand = instruction->operand(0);
 
@@ -121,6 +209,22 @@ StatusOr<std::unique_ptr<Literal>> ElementWiseUnaryOpImpl(
 
   auto result = Literal::CreateFromShape(shape);
 
+  // Fast path: the operand and result elements line up, so there is no need to
+  // compute multi-dimensional indices.
+  if (HasSameLinearLayout(shape, operand_literal)) {
+    tensorflow::gtl::ArraySlice<NativeT> operand_data =
+        operand_literal.GetArraySlice<NativeT>();
+    tensorflow::gtl::MutableArraySlice<ReturnT> result_data =
+        result->GetMutableArraySlice<ReturnT>();
+    ForEachRange(thread_pool, result_data.size(), kElementwiseCost,
+                 [&](int64 begin, int64 end) {
+                   for (int64 i = begin; i < end; ++i) {
+                     result_data[i] = unary_op(operand_data[i]);
+                   }
+                 });
+    return std::move(result);
+  }
+
   TF_RETURN_IF_ERROR(result->Populate<ReturnT>(
       [&](tensorflow::gtl::ArraySlice<int64> multi_index) {
         return unary_op(operand_literal.Get<NativeT>(multi_index));
@@ -170,20 +274,32 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
   };
 
   Status HandleBroadcast(HloInstruction* broadcast) override {
-    parent_->evaluated_[broadcast] =
-        Literal::CreateFromShape(broadcast->shape());
-    auto output = parent_->evaluated_[broadcast].get();
-    auto operand_to_broadcast =
+    const Literal& operand_to_broadcast =
         parent_->GetEvaluatedLiteralFor(broadcast->operand(0));
-    std::vector<int64> broadcast_indices(
-        ShapeUtil::Rank(broadcast->operand(0)->shape()), 0);
-    return output->Populate<ReturnT>(
+    auto output = Literal::CreateFromShape(broadcast->shape());
+
+    // Dimension i of the operand is broadcast along output dimension
+    // broadcast->dimensions(i), so each output element reads the operand
+    // element at the linear index formed from those output dimensions.
+    std::vector<int64> operand_strides;
+    for (int64 i = 0; i < broadcast->dimensions().size(); ++i) {
+      operand_strides.push_back(
+          IndexUtil::GetDimensionStride(operand_to_broadcast.shape(), i));
+    }
+    tensorflow::gtl::ArraySlice<ReturnT> operand_data =
+        operand_to_broadcast.GetArraySlice<ReturnT>();
+    TF_RETURN_IF_ERROR(PopulateParallel<ReturnT>(
+        output.get(), parent_->thread_pool_, operand_strides.size() + 1,
         [&](tensorflow::gtl::ArraySlice<int64> multi_index) {
-          for (int64 i = 0; i < broadcast->dimensions().size(); ++i) {
-            broadcast_indices[i] = multi_index[broadcast->dimensions(i)];
+          int64 operand_index = 0;
+          for (int64 i = 0; i < operand_strides.size(); ++i) {
+            operand_index +=
+                multi_index[broadcast->dimensions(i)] * operand_strides[i];
           }
-          return operand_to_broadcast.Get<ReturnT>(broadcast_indices);
-        });
+          return operand_data[operand_index];
+        }));
+    parent_->evaluated_[broadcast] = std::move(output);
+    return Status::OK();
   }
 
   Status HandleCeil(HloInstruction* ceil, HloInstruction* operand) override {
@@ -452,63 +568,85 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
     const Shape& window_shape = ShapeUtil::MakeShape(
         rhs->shape().element_type(), window_dimension_sizes);
 
+    // The operands are indexed directly by their linear indices, computed from
+    // the strides of their dimensions.
+    std::vector<int64> lhs_strides(lhs_rank);
+    for (int64 i = 0; i < lhs_rank; ++i) {
+      lhs_strides[i] = IndexUtil::GetDimensionStride(lhs_literal.shape(), i);
+    }
+    std::vector<int64> rhs_strides(rhs_rank);
+    for (int64 i = 0; i < rhs_rank; ++i) {
+      rhs_strides[i] = IndexUtil::GetDimensionStride(rhs_literal.shape(), i);
+    }
+    tensorflow::gtl::ArraySlice<ReturnT> lhs_data =
+        lhs_literal.GetArraySlice<ReturnT>();
+    tensorflow::gtl::ArraySlice<ReturnT> rhs_data =
+        rhs_literal.GetArraySlice<ReturnT>();
+
     auto result = Literal::CreateFromShape(conv->shape());
-    TF_RETURN_IF_ERROR(result->Populate<ReturnT>(
+    TF_RETURN_IF_ERROR(PopulateParallel<ReturnT>(
+        result.get(), parent_->thread_pool_,
+        2 * z_size * ShapeUtil::ElementsIn(window_shape),
         [&](tensorflow::gtl::ArraySlice<int64> out_index) {
           ReturnT result_val = static_cast<ReturnT>(0);
 
-          std::vector<int64> lhs_index(lhs_rank, 0);
-          std::vector<int64> rhs_index(rhs_rank, 0);
-
-          lhs_index[batch_dim] = out_index[batch_dim];
-          rhs_index[kernel_output_z_dim] = out_index[z_dim];
+          const int64 lhs_batch_offset =
+              out_index[batch_dim] * lhs_strides[batch_dim];
+          const int64 rhs_output_z_offset =
+              out_index[z_dim] * rhs_strides[kernel_output_z_dim];
 
           std::vector<int64> rhs_spatial_index(
               dnums.kernel_spatial_dimensions_size(), 0);
 
           // Convolve input feature with kernel.
           do {
-            for (int64 iz = 0; iz < z_size; ++iz) {
-              lhs_index[z_dim] = iz;
-              rhs_index[kernel_input_z_dim] = iz;
-
-              // Find corresponding spatial dimension index for input (lhs).
-              for (int64 ki = 0; ki < rhs_spatial_index.size(); ++ki) {
-                // Spatial dimension number for input (lhs) and output.
-                const int64 spatial_dim = dnums.spatial_dimensions(ki);
-
-                // Calculate lhs (input) index without taking base dilation into
-                // account.
-                const int64 undilated_index =
-                    out_index[spatial_dim] * window.dimensions(ki).stride() -
-                    window.dimensions(ki).padding_low() +
-                    rhs_spatial_index[ki] *
-                        window.dimensions(ki).window_dilation();
-                // Skip if the lhs (input) index is to be dilated.
-                if (undilated_index % window.dimensions(ki).base_dilation() !=
-                    0) {
-                  goto cnt;
-                }
-
-                // Calculate the actual lhs (input) index after dilation.
-                lhs_index[spatial_dim] =
-                    undilated_index / window.dimensions(ki).base_dilation();
-
-                // Skip if input index is not in bound.
-                if (!(lhs_index[spatial_dim] >= 0 &&
-                      lhs_index[spatial_dim] <
-                          lhs->shape().dimensions(spatial_dim))) {
-                  goto cnt;
-                }
-
-                rhs_index[dnums.kernel_spatial_dimensions(ki)] =
-                    rhs_spatial_index[ki];
+            int64 lhs_offset = lhs_batch_offset;
+            int64 rhs_offset = rhs_output_z_offset;
+
+            // Find corresponding spatial dimension index for input (lhs).
+            bool in_bounds = true;
+            for (int64 ki = 0; ki < rhs_spatial_index.size(); ++ki) {
+              // Spatial dimension number for input (lhs) and output.
+              const int64 spatial_dim = dnums.spatial_dimensions(ki);
+
+              // Calculate lhs (input) index without taking base dilation into
+              // account.
+              const int64 undilated_index =
+                  out_index[spatial_dim] * window.dimensions(ki).stride() -
+                  window.dimensions(ki).padding_low() +
+                  rhs_spatial_index[ki] *
+                      window.dimensions(ki).window_dilation();
+              // Skip if the lhs (input) index is to be dilated.
+              if (undilated_index % window.dimensions(ki).base_dilation() !=
+                  0) {
+                in_bounds = false;
+                break;
               }
 
-              result_val += lhs_literal.Get<ReturnT>(lhs_index) *
-                            rhs_literal.Get<ReturnT>(rhs_index);
+              // Calculate the actual lhs (input) index after dilation.
+              const int64 lhs_spatial_index =
+                  undilated_index / window.dimensions(ki).base_dilation();
+
+              // Skip if input index is not in bound.
+              if (!(lhs_spatial_index >= 0 &&
+                    lhs_spatial_index < lhs->shape().dimensions(spatial_dim))) {
+                in_bounds = false;
+                break;
+              }
+
+              lhs_offset += lhs_spatial_index * lhs_strides[spatial_dim];
+              rhs_offset += rhs_spatial_index[ki] *
+                            rhs_strides[dnums.kernel_spatial_dimensions(ki)];
+            }
+
+            if (in_bounds) {
+              for (int64 iz = 0; iz < z_size; ++iz) {
+                result_val +=
+                    lhs_data[lhs_offset + iz * lhs_strides[z_dim]] *
+                    rhs_data[rhs_offset +
+                             iz * rhs_strides[kernel_input_z_dim]];
+              }
             }
-          cnt:;
           } while (IndexUtil::BumpIndices(window_shape, &rhs_spatial_index));
 
           return result_val;
@@ -554,28 +692,41 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
     const Literal& lhs_literal = parent_->GetEvaluatedLiteralFor(lhs);
     const Literal& rhs_literal = parent_->GetEvaluatedLiteralFor(rhs);
 
+    // The operands are indexed directly by their linear indices, computed from
+    // the strides of their dimensions.
+    const int64 lhs_contracted_stride = IndexUtil::GetDimensionStride(
+        lhs_literal.shape(), lhs_contracted_dimension);
+    const int64 rhs_contracted_stride = IndexUtil::GetDimensionStride(
+        rhs_literal.shape(), rhs_contracted_dimension);
+    const int64 lhs_row_stride =
+        lhs_rank > 1 ? IndexUtil::GetDimensionStride(lhs_literal.shape(), 0)
+                     : 0;
+    const int64 rhs_column_stride =
+        rhs_rank > 1 ? IndexUtil::GetDimensionStride(rhs_literal.shape(), 1)
+                     : 0;
+    tensorflow::gtl::ArraySlice<ReturnT> lhs_data =
+        lhs_literal.GetArraySlice<ReturnT>();
+    tensorflow::gtl::ArraySlice<ReturnT> rhs_data =
+        rhs_literal.GetArraySlice<ReturnT>();
+
     auto result = Literal::CreateFromShape(dot->shape());
-    TF_RETURN_IF_ERROR(result->Populate<ReturnT>(
+    TF_RETURN_IF_ERROR(PopulateParallel<ReturnT>(
+        result.get(), parent_->thread_pool_, 2 * contracted_dimension_size,
         [&](tensorflow::gtl::ArraySlice<int64> multi_index) {
           ReturnT result_val = static_cast<ReturnT>(0);
 
-          std::vector<int64> lhs_index(lhs_rank, 0);
-          std::vector<int64> rhs_index(rhs_rank, 0);
-          // Set index for non-contracted dimension for lhs and rhs.
-          if (lhs_rank > 1) {
-            lhs_index[0] = multi_index[0];
-          }
-          if (rhs_rank > 1) {
-            rhs_index[1] = multi_index[multi_index.size() - 1];
-          }
+          // Offsets of the non-contracted dimension for lhs and rhs.
+          const int64 lhs_offset =
+              lhs_rank > 1 ? multi_index[0] * lhs_row_stride : 0;
+          const int64 rhs_offset =
+              rhs_rank > 1 ? multi_index[multi_index.size() - 1] *
+                                 rhs_column_stride
+                           : 0;
 
           // Accumulates resulting product along the contracted dimension.
           for (int64 i = 0; i < contracted_dimension_size; ++i) {
-            lhs_index[lhs_contracted_dimension] = i;
-            rhs_index[rhs_contracted_dimension] = i;
-
-            result_val += lhs_literal.Get<ReturnT>(lhs_index) *
-                          rhs_literal.Get<ReturnT>(rhs_index);
+            result_val += lhs_data[lhs_offset + i * lhs_contracted_stride] *
+                          rhs_data[rhs_offset + i * rhs_contracted_stride];
           }
 
           return result_val;
@@ -665,8 +816,8 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
       const std::function<ReturnT(ReturnT)>& unary_op) {
     const Literal& operand_literal =
         parent_->GetEvaluatedLiteralFor(instruction->operand(0));
-    return ElementWiseUnaryOpImpl<ReturnT, ReturnT>(instruction, unary_op,
-                                                    operand_literal);
+    return ElementWiseUnaryOpImpl<ReturnT, ReturnT>(
+        instruction, unary_op, operand_literal, parent_->thread_pool_);
   }
 
   StatusOr<std::unique_ptr<Literal>> ElementWiseBinaryOp(
@@ -693,6 +844,25 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
 
     auto result = Literal::CreateFromShape(shape);
 
+    // Fast path: the operand and result elements line up, so there is no need
+    // to compute multi-dimensional indices.
+    if (HasSameLinearLayout(shape, lhs_literal) &&
+        HasSameLinearLayout(shape, rhs_literal)) {
+      tensorflow::gtl::ArraySlice<ReturnT> lhs_data =
+          lhs_literal.GetArraySlice<ReturnT>();
+      tensorflow::gtl::ArraySlice<ReturnT> rhs_data =
+          rhs_literal.GetArraySlice<ReturnT>();
+      tensorflow::gtl::MutableArraySlice<ReturnT> result_data =
+          result->GetMutableArraySlice<ReturnT>();
+      ForEachRange(parent_->thread_pool_, result_data.size(), kElementwiseCost,
+                   [&](int64 begin, int64 end) {
+                     for (int64 i = begin; i < end; ++i) {
+                       result_data[i] = binary_op(lhs_data[i], rhs_data[i]);
+                     }
+                   });
+      return std::move(result);
+    }
+
     TF_RETURN_IF_ERROR(result->Populate<ReturnT>(
         [&](tensorflow::gtl::ArraySlice<int64> multi_index) {
           return binary_op(lhs_literal.Get<ReturnT>(multi_index),
@@ -730,6 +900,29 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
 
     auto result = Literal::CreateFromShape(shape);
 
+    // Fast path: the operand and result elements line up, so there is no need
+    // to compute multi-dimensional indices.
+    if (HasSameLinearLayout(shape, lhs_literal) &&
+        HasSameLinearLayout(shape, rhs_literal) &&
+        HasSameLinearLayout(shape, ehs_literal)) {
+      tensorflow::gtl::ArraySlice<LhsType> lhs_data =
+          lhs_literal.GetArraySlice<LhsType>();
+      tensorflow::gtl::ArraySlice<RhsType> rhs_data =
+          rhs_literal.GetArraySlice<RhsType>();
+      tensorflow::gtl::ArraySlice<EhsType> ehs_data =
+          ehs_literal.GetArraySlice<EhsType>();
+      tensorflow::gtl::MutableArraySlice<ReturnT> result_data =
+          result->GetMutableArraySlice<ReturnT>();
+      ForEachRange(parent_->thread_pool_, result_data.size(), kElementwiseCost,
+                   [&](int64 begin, int64 end) {
+                     for (int64 i = begin; i < end; ++i) {
+                       result_data[i] =
+                           ternary_op(lhs_data[i], rhs_data[i], ehs_data[i]);
+                     }
+                   });
+      return std::move(result);
+    }
+
     TF_RETURN_IF_ERROR(result->Populate<ReturnT>(
         [&](tensorflow::gtl::ArraySlice<int64> multi_index) {
           return ternary_op(lhs_literal.Get<LhsType>(multi_index),
@@ -743,7 +936,8 @@ class HloEvaluator::TypedVisitor : public DfsHloVisitorWithDefault {
   HloEvaluator* parent_;
 };
 
-HloEvaluator::HloEvaluator() {
+HloEvaluator::HloEvaluator(tensorflow::thread::ThreadPool* thread_pool)
+    : thread_pool_(thread_pool) {
   typed_visitors_[PRED] = MakeUnique<TypedVisitor<bool>>(this);
   typed_visitors_[U8] = MakeUnique<TypedVisitor<uint8>>(this);
   typed_visitors_[U16] = MakeUnique<FunctionVisitor>([](HloInstruction*) {
@@ -777,8 +971,7 @@ StatusOr<std::unique_ptr<Literal>> HloEvaluator::Evaluate(
   evaluated_.clear();
 
   TF_RETURN_IF_ERROR(computation->Accept(this));
-  return MakeUnique<Literal>(
-      GetEvaluatedLiteralFor(computation->root_instruction()));
+  return ReleaseEvaluatedLiteralFor(computation->root_instruction());
 }
 
 StatusOr<std::unique_ptr<Literal>> HloEvaluator::Evaluate(
@@ -804,7 +997,7 @@ StatusOr<std::unique_ptr<Literal>> HloEvaluator::Evaluate(
   }
 
   TF_RETURN_IF_ERROR(instruction->Visit(this));
-  return MakeUnique<Literal>(GetEvaluatedLiteralFor(instruction));
+  return ReleaseEvaluatedLiteralFor(instruction);
 }
 
 StatusOr<std::unique_ptr<Literal>> HloEvaluator::Evaluate(
@@ -816,7 +1009,7 @@ StatusOr<std::unique_ptr<Literal>> HloEvaluator::Evaluate(
   arg_literals_.clear();
   evaluated_.clear();
   TF_RETURN_IF_ERROR(instruction->Visit(this));
-  return MakeUnique<Literal>(GetEvaluatedLiteralFor(instruction));
+  return ReleaseEvaluatedLiteralFor(instruction);
 }
 
 std::unique_ptr<Literal> HloEvaluator::TryEvaluate(
@@ -917,7 +1110,7 @@ Status HloEvaluator::HandleIsFinite(HloInstruction* is_finite,
       auto result_or = ElementWiseUnaryOpImpl<bool, float>(
           is_finite,
           [](float elem_operand) { return std::isfinite(elem_operand); },
-          GetEvaluatedLiteralFor(operand));
+          GetEvaluatedLiteralFor(operand), thread_pool_);
       TF_ASSIGN_OR_RETURN(evaluated_[is_finite], std::move(result_or));
       break;
     }
@@ -925,7 +1118,7 @@ Status HloEvaluator::HandleIsFinite(HloInstruction* is_finite,
       auto result_or = ElementWiseUnaryOpImpl<bool, double>(
           is_finite,
           [](double elem_operand) { return std::isfinite(elem_operand); },
-          GetEvaluatedLiteralFor(operand));
+          GetEvaluatedLiteralFor(operand), thread_pool_);
       TF_ASSIGN_OR_RETURN(evaluated_[is_finite], std::move(result_or));
       break;
     }
@@ -960,53 +1153,62 @@ Status HloEvaluator::HandleCompare(HloInstruction* compare, HloOpcode opcode,
     case PRED: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<bool>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<bool>(compare->shape(), opcode, lhs_literal,
+                        rhs_literal, thread_pool_));
     } break;
     case U8: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<uint8>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<uint8>(compare->shape(), opcode, lhs_literal,
+                         rhs_literal, thread_pool_));
     } break;
     case U16:
       return Unimplemented("unhandled primitive type: U16.");
     case U32: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<uint32>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<uint32>(compare->shape(), opcode, lhs_literal,
+                          rhs_literal, thread_pool_));
     } break;
     case U64: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<uint64>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<uint64>(compare->shape(), opcode, lhs_literal,
+                          rhs_literal, thread_pool_));
     } break;
     case S8: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<int8>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<int8>(compare->shape(), opcode, lhs_literal,
+                        rhs_literal, thread_pool_));
     } break;
     case S16:
       return Unimplemented("unhandled primitive type: S16.");
     case S32: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<int32>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<int32>(compare->shape(), opcode, lhs_literal,
+                         rhs_literal, thread_pool_));
     } break;
     case S64: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<int64>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<int64>(compare->shape(), opcode, lhs_literal,
+                         rhs_literal, thread_pool_));
     } break;
     case F16:
       return Unimplemented("unhandled primitive type: F16.");
     case F32: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<float>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<float>(compare->shape(), opcode, lhs_literal,
+                         rhs_literal, thread_pool_));
     } break;
     case F64: {
       TF_ASSIGN_OR_RETURN(
           evaluated_[compare],
-          Compare<double>(compare->shape(), opcode, lhs_literal, rhs_literal));
+          Compare<double>(compare->shape(), opcode, lhs_literal,
+                          rhs_literal, thread_pool_));
     } break;
     default:
       LOG(FATAL) << "unknown primitive type.";
@@ -18,12 +18,14 @@ limitations under the License.
 
 #include <memory>
 
+#include "tensorflow/compiler/xla/ptr_util.h"
 #include "tensorflow/compiler/xla/service/dfs_hlo_visitor_with_default.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/platform/macros.h"
@@ -35,7 +37,9 @@ namespace xla {
 // This class is not thread-safe.
 class HloEvaluator : public DfsHloVisitorWithDefault {
  public:
-  HloEvaluator();
+  // If 'thread_pool' is non-null, large results are evaluated in parallel on
+  // it. The thread pool is not owned, and must outlive the evaluator.
+  explicit HloEvaluator(tensorflow::thread::ThreadPool* thread_pool = nullptr);
   // Evaluates a HLO computation and an array of pointers to literals.
   // Return the evaluated result as literal if successful.
   // Precondition: argument literals are corresponds to the input computation's
@@ -131,6 +135,19 @@ class HloEvaluator : public DfsHloVisitorWithDefault {
     return *(it->second);
   }
 
+  // Same as GetEvaluatedLiteralFor, except that the result of a non-Constant
+  // instruction is moved out of the cache rather than copied.
+  std::unique_ptr<Literal> ReleaseEvaluatedLiteralFor(
+      const HloInstruction* hlo) {
+    if (hlo->IsConstant()) {
+      return MakeUnique<Literal>(hlo->literal());
+    }
+    auto it = evaluated_.find(hlo);
+    CHECK(it != evaluated_.end())
+        << "could not find evaluated value for: " << hlo->ToString();
+    return std::move(it->second);
+  }
+
   // Map from a primitive type to its associated (templated) DfsHloVisitor.
   // Note: the hash function here is only needed because current gcc std::hash
   // does not specialize for enum types. This should however be fixed in the
@@ -151,6 +168,9 @@ class HloEvaluator : public DfsHloVisitorWithDefault {
   // this class.
   tensorflow::gtl::ArraySlice<const Literal*> arg_literals_;
 
+  // Thread pool on which large results are evaluated in parallel, or null.
+  tensorflow::thread::ThreadPool* thread_pool_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(HloEvaluator);
 };
 
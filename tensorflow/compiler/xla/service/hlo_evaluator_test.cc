@@ -35,6 +35,9 @@ limitations under the License.
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace xla {
@@ -946,5 +949,130 @@ TEST_F(HloEvaluatorTest,
   LiteralTestUtil::ExpectEqual(*expected, *result);
 }
 
+// Builds a computation which multiplies random matrices of the given sizes.
+std::unique_ptr<HloComputation> MakeDotComputation(int64 m, int64 k, int64 n,
+                                                   Array2D<float>* lhs_array,
+                                                   Array2D<float>* rhs_array) {
+  HloComputation::Builder b("dot");
+  *lhs_array = Array2D<float>(m, k);
+  lhs_array->FillRandom(1.0f);
+  *rhs_array = Array2D<float>(k, n);
+  rhs_array->FillRandom(1.0f);
+  HloInstruction* lhs_instruction =
+      b.AddInstruction(HloInstruction::CreateConstant(
+          Literal::CreateR2FromArray2D<float>(*lhs_array)));
+  HloInstruction* rhs_instruction =
+      b.AddInstruction(HloInstruction::CreateConstant(
+          Literal::CreateR2FromArray2D<float>(*rhs_array)));
+  b.AddInstruction(HloInstruction::CreateBinary(
+      ShapeUtil::MakeShape(F32, {m, n}), HloOpcode::kDot, lhs_instruction,
+      rhs_instruction));
+  return b.Build();
+}
+
+// Verifies that a dot large enough to be evaluated in parallel matches the
+// reference implementation.
+TEST_F(HloEvaluatorTest, ParallelDotMatchesReference) {
+  Array2D<float> lhs_array, rhs_array;
+  auto computation = MakeDotComputation(128, 96, 64, &lhs_array, &rhs_array);
+
+  tensorflow::thread::ThreadPool pool(tensorflow::Env::Default(), "test", 4);
+  HloEvaluator evaluator(&pool);
+  std::unique_ptr<Literal> result =
+      evaluator.Evaluate(computation.get(), {}).ConsumeValueOrDie();
+
+  auto expected = Literal::CreateR2FromArray2D<float>(
+      *ReferenceUtil::MatmulArray2D(lhs_array, rhs_array));
+  LiteralTestUtil::ExpectNear(*expected, *result, ErrorSpec(1e-4, 1e-4));
+}
+
+// Verifies that broadcasts and elementwise operations large enough to be
+// evaluated in parallel give the same results as evaluating them serially.
+TEST_F(HloEvaluatorTest, ParallelBroadcastAddMatchesSerial) {
+  HloComputation::Builder b(TestName());
+  const int64 size = 256;
+  std::vector<float> values(size);
+  for (int64 i = 0; i < size; ++i) {
+    values[i] = i;
+  }
+  HloInstruction* operand = b.AddInstruction(
+      HloInstruction::CreateConstant(Literal::CreateR1<float>(values)));
+  const Shape shape = ShapeUtil::MakeShape(F32, {size, size});
+  HloInstruction* rows = b.AddInstruction(
+      HloInstruction::CreateBroadcast(shape, operand, {0}));
+  HloInstruction* columns = b.AddInstruction(
+      HloInstruction::CreateBroadcast(shape, operand, {1}));
+  b.AddInstruction(
+      HloInstruction::CreateBinary(shape, HloOpcode::kAdd, rows, columns));
+  auto computation = b.Build();
+
+  tensorflow::thread::ThreadPool pool(tensorflow::Env::Default(), "test", 4);
+  HloEvaluator parallel_evaluator(&pool);
+  std::unique_ptr<Literal> result =
+      parallel_evaluator.Evaluate(computation.get(), {}).ConsumeValueOrDie();
+  std::unique_ptr<Literal> expected =
+      evaluator_->Evaluate(computation.get(), {}).ConsumeValueOrDie();
+
+  LiteralTestUtil::ExpectEqual(*expected, *result);
+  EXPECT_EQ(2 * (size - 1), result->Get<float>({size - 1, size - 1}));
+}
+
+// Benchmarks evaluating a 256x256x256 dot, serially if num_threads is 0.
+void BM_EvaluateDot(int num_iters, int num_threads) {
+  tensorflow::testing::StopTiming();
+  Array2D<float> lhs_array, rhs_array;
+  auto computation = MakeDotComputation(256, 256, 256, &lhs_array, &rhs_array);
+  std::unique_ptr<tensorflow::thread::ThreadPool> pool;
+  if (num_threads > 0) {
+    pool = MakeUnique<tensorflow::thread::ThreadPool>(
+        tensorflow::Env::Default(), "bench", num_threads);
+  }
+  HloEvaluator evaluator(pool.get());
+  tensorflow::testing::StartTiming();
+  for (int i = 0; i < num_iters; ++i) {
+    ASSERT_TRUE(evaluator.Evaluate(computation.get(), {}).ok());
+  }
+}
+BENCHMARK(BM_EvaluateDot)->Arg(0)->Arg(4);
+
+// Benchmarks the reference implementation of the dot in BM_EvaluateDot.
+void BM_ReferenceDot(int num_iters) {
+  tensorflow::testing::StopTiming();
+  Array2D<float> lhs_array, rhs_array;
+  auto computation = MakeDotComputation(256, 256, 256, &lhs_array, &rhs_array);
+  tensorflow::testing::StartTiming();
+  for (int i = 0; i < num_iters; ++i) {
+    ReferenceUtil::MatmulArray2D(lhs_array, rhs_array);
+  }
+}
+BENCHMARK(BM_ReferenceDot);
+
+// Benchmarks evaluating an add of two 1024x1024 constants, serially if
+// num_threads is 0.
+void BM_EvaluateAdd(int num_iters, int num_threads) {
+  tensorflow::testing::StopTiming();
+  HloComputation::Builder b("add");
+  Array2D<float> array(1024, 1024);
+  array.FillRandom(1.0f);
+  HloInstruction* lhs = b.AddInstruction(HloInstruction::CreateConstant(
+      Literal::CreateR2FromArray2D<float>(array)));
+  HloInstruction* rhs = b.AddInstruction(HloInstruction::CreateConstant(
+      Literal::CreateR2FromArray2D<float>(array)));
+  b.AddInstruction(
+      HloInstruction::CreateBinary(lhs->shape(), HloOpcode::kAdd, lhs, rhs));
+  auto computation = b.Build();
+  std::unique_ptr<tensorflow::thread::ThreadPool> pool;
+  if (num_threads > 0) {
+    pool = MakeUnique<tensorflow::thread::ThreadPool>(
+        tensorflow::Env::Default(), "bench", num_threads);
+  }
+  HloEvaluator evaluator(pool.get());
+  tensorflow::testing::StartTiming();
+  for (int i = 0; i < num_iters; ++i) {
+    ASSERT_TRUE(evaluator.Evaluate(computation.get(), {}).ok());
+  }
+}
+BENCHMARK(BM_EvaluateAdd)->Arg(0)->Arg(4);
+
 }  // namespace
 }  // namespace xla
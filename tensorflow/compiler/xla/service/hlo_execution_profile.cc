@@ -16,10 +16,13 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/hlo_execution_profile.h"
 
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "tensorflow/compiler/xla/metric_table_report.h"
+#include "tensorflow/compiler/xla/ptr_util.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
 #include "tensorflow/compiler/xla/service/hlo_module.h"
 #include "tensorflow/compiler/xla/types.h"
@@ -36,6 +39,11 @@ void HloExecutionProfile::AddProfileResult(const HloInstruction* hlo,
   profiled_computations_.insert(hlo->parent());
 }
 
+void HloExecutionProfile::AddTraceEvent(const TraceEvent& event) {
+  trace_events_.push_back(event);
+  profiled_computations_.insert(event.hlo->parent());
+}
+
 uint64 HloExecutionProfile::GetProfileResult(const HloInstruction& hlo) const {
   auto iter = hlo_to_cycles_taken_.find(&hlo);
   if (iter == hlo_to_cycles_taken_.end()) {
@@ -147,4 +155,98 @@ string HloExecutionProfile::ToString(
   return result;
 }
 
+namespace {
+
+// Returns 'text' as a quoted JSON string.
+string JsonString(const string& text) {
+  string result = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result.push_back('\\');
+      result.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      tensorflow::strings::Appendf(&result, "\\u%04x",
+                                   static_cast<unsigned char>(c));
+    } else {
+      result.push_back(c);
+    }
+  }
+  result.push_back('"');
+  return result;
+}
+
+}  // namespace
+
+string HloExecutionProfile::ToChromeTraceJson(
+    const HloCostAnalysis::ShapeSizeFunction& shape_size) const {
+  if (trace_events_.empty()) {
+    return "";
+  }
+
+  // Analyze the cost of each computation with events in the timeline, and
+  // find the wall time spanned by the tasks of each HLO.
+  std::unordered_map<const HloComputation*, std::unique_ptr<HloCostAnalysis>>
+      cost_analyses;
+  std::unordered_map<const HloInstruction*, std::pair<uint64, uint64>>
+      hlo_to_wall_interval;
+  uint64 trace_start_micros = trace_events_.front().start_micros;
+  for (const TraceEvent& event : trace_events_) {
+    const HloComputation* computation = event.hlo->parent();
+    if (cost_analyses.count(computation) == 0) {
+      auto cost_analysis = MakeUnique<HloCostAnalysis>(shape_size);
+      if (!computation->root_instruction()->Accept(cost_analysis.get()).ok()) {
+        return "";
+      }
+      cost_analyses[computation] = std::move(cost_analysis);
+    }
+    auto it = hlo_to_wall_interval.find(event.hlo);
+    if (it == hlo_to_wall_interval.end()) {
+      hlo_to_wall_interval[event.hlo] = {event.start_micros, event.end_micros};
+    } else {
+      it->second.first = std::min(it->second.first, event.start_micros);
+      it->second.second = std::max(it->second.second, event.end_micros);
+    }
+    trace_start_micros = std::min(trace_start_micros, event.start_micros);
+  }
+
+  string result = "{\"traceEvents\":[";
+  for (size_t i = 0; i < trace_events_.size(); ++i) {
+    const TraceEvent& event = trace_events_[i];
+    const HloInstruction* hlo = event.hlo;
+    const HloCostAnalysis& cost_analysis = *cost_analyses.at(hlo->parent());
+    const int64 flops = cost_analysis.flop_count(*hlo);
+    const int64 transcendentals = cost_analysis.transcendental_count(*hlo);
+    const int64 bytes_accessed = cost_analysis.bytes_accessed(*hlo);
+
+    // The interesting category of a call (e.g. one emitted for a parallel
+    // task) is that of the computation it calls.
+    const HloInstruction* categorized =
+        hlo->opcode() == HloOpcode::kCall ? hlo->to_apply()->root_instruction()
+                                          : hlo;
+
+    const std::pair<uint64, uint64>& wall_interval =
+        hlo_to_wall_interval.at(hlo);
+    const double wall_seconds =
+        std::max<uint64>(wall_interval.second - wall_interval.first, 1) / 1e6;
+
+    tensorflow::strings::StrAppend(&result, i == 0 ? "\n" : ",\n");
+    tensorflow::strings::Appendf(
+        &result,
+        "{\"name\":%s,\"cat\":%s,\"ph\":\"X\",\"pid\":0,\"tid\":%lld,"
+        "\"ts\":%llu,\"dur\":%llu,\"args\":{\"task\":%lld,\"flops\":%lld,"
+        "\"transcendentals\":%lld,\"bytes_accessed\":%lld,"
+        "\"hlo_wall_usec\":%.0f,\"achieved_gflops_per_sec\":%.3f,"
+        "\"achieved_gbytes_per_sec\":%.3f,\"flops_per_byte\":%.3f}}",
+        JsonString(hlo->name()).c_str(),
+        JsonString(categorized->ToCategory()).c_str(), event.thread_id,
+        event.start_micros - trace_start_micros,
+        event.end_micros - event.start_micros, event.task_index, flops,
+        transcendentals, bytes_accessed, wall_seconds * 1e6,
+        flops / wall_seconds / 1e9, bytes_accessed / wall_seconds / 1e9,
+        bytes_accessed > 0 ? static_cast<double>(flops) / bytes_accessed : 0.0);
+  }
+  result += "\n]}\n";
+  return result;
+}
+
 }  // namespace xla
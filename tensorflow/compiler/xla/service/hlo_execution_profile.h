@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_COMPILER_XLA_SERVICE_HLO_EXECUTION_PROFILE_H_
 
 #include <unordered_map>
+#include <vector>
 
 #include "tensorflow/compiler/xla/service/hlo_cost_analysis.h"
 #include "tensorflow/compiler/xla/types.h"
@@ -35,6 +36,19 @@ class HloExecutionProfile {
  public:
   using DeviceDescription = perftools::gputools::DeviceDescription;
 
+  // A single invocation of an HLO (or of one of its parallel tasks) with
+  // wall-clock timestamps, used to build a timeline of the execution.
+  struct TraceEvent {
+    const HloInstruction* hlo;
+    // Index of the parallel task of 'hlo' which ran, or 0 if 'hlo' was not
+    // partitioned into parallel tasks.
+    int64 task_index;
+    // Id of the thread which ran the task, or -1 if unknown.
+    int64 thread_id;
+    uint64 start_micros;
+    uint64 end_micros;
+  };
+
   // Record how many cycles this HLO took to execute.
   void AddProfileResult(const HloInstruction* hlo, uint64 cycles_taken);
 
@@ -67,6 +81,23 @@ class HloExecutionProfile {
                   const DeviceDescription& device_description,
                   const HloCostAnalysis::ShapeSizeFunction& shape_size) const;
 
+  // Record an invocation of 'event.hlo' in the timeline of the execution.
+  void AddTraceEvent(const TraceEvent& event);
+
+  // Returns the timeline events recorded so far, in the order they were added.
+  const std::vector<TraceEvent>& trace_events() const { return trace_events_; }
+
+  // Returns the timeline of the execution as a JSON string in the Chrome trace
+  // event format, which can be loaded into chrome://tracing. Each event is
+  // annotated with the cost of its HLO given by HloCostAnalysis, and with the
+  // FLOP/s and bytes/s achieved over the wall time of the HLO (from the start
+  // of its first task to the end of its last task), so that memory-bound HLOs
+  // stand out.
+  // Returns an empty string if no events were recorded or if it wasn't
+  // possible to analyze the cost of the profiled computations.
+  string ToChromeTraceJson(
+      const HloCostAnalysis::ShapeSizeFunction& shape_size) const;
+
   // Returns the computations we have profiled.
   std::unordered_set<const HloComputation*> profiled_computations() const {
     return profiled_computations_;
@@ -82,6 +113,9 @@ class HloExecutionProfile {
 
   // The computations we have profiled.
   std::unordered_set<const HloComputation*> profiled_computations_;
+
+  // The timeline events of the execution, if the backend records them.
+  std::vector<TraceEvent> trace_events_;
 };
 
 }  // namespace xla
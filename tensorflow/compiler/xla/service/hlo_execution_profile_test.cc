@@ -0,0 +1,80 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/hlo_execution_profile.h"
+
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_opcode.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace xla {
+namespace {
+
+class HloExecutionProfileTest : public HloTestBase {
+ protected:
+  static int64 ShapeSize(const Shape& shape) {
+    return ShapeUtil::ByteSizeOf(shape, /*pointer_size=*/8);
+  }
+};
+
+TEST_F(HloExecutionProfileTest, ChromeTraceWithoutEventsIsEmpty) {
+  HloExecutionProfile profile;
+  EXPECT_EQ("", profile.ToChromeTraceJson(ShapeSize));
+}
+
+TEST_F(HloExecutionProfileTest, ChromeTraceHasEventPerTask) {
+  auto module = CreateNewModule();
+  const Shape shape = ShapeUtil::MakeShape(F32, {1000});
+  auto builder = HloComputation::Builder(TestName());
+  HloInstruction* lhs =
+      builder.AddInstruction(HloInstruction::CreateParameter(0, shape, "lhs"));
+  HloInstruction* rhs =
+      builder.AddInstruction(HloInstruction::CreateParameter(1, shape, "rhs"));
+  HloInstruction* add = builder.AddInstruction(
+      HloInstruction::CreateBinary(shape, HloOpcode::kAdd, lhs, rhs));
+  module->AddEntryComputation(builder.Build());
+
+  // Two parallel tasks of 'add', which together span 100 usec.
+  HloExecutionProfile profile;
+  profile.AddTraceEvent({add, /*task_index=*/0, /*thread_id=*/0,
+                         /*start_micros=*/1100, /*end_micros=*/1150});
+  profile.AddTraceEvent({add, /*task_index=*/1, /*thread_id=*/1,
+                         /*start_micros=*/1120, /*end_micros=*/1200});
+  EXPECT_EQ(2, profile.trace_events().size());
+  EXPECT_EQ(1, profile.profiled_computations().count(add->parent()));
+
+  const string trace = profile.ToChromeTraceJson(ShapeSize);
+  EXPECT_EQ(0, trace.find("{\"traceEvents\":["));
+  const string name = tensorflow::strings::StrCat("\"name\":\"", add->name(),
+                                                  "\",\"cat\":\"");
+  EXPECT_NE(string::npos, trace.find(name));
+  EXPECT_NE(string::npos,
+            trace.find("\"tid\":0,\"ts\":0,\"dur\":50,\"args\":{\"task\":0,"
+                       "\"flops\":1000,"));
+  EXPECT_NE(string::npos,
+            trace.find("\"tid\":1,\"ts\":20,\"dur\":80,\"args\":{\"task\":1,"
+                       "\"flops\":1000,"));
+  // 1000 flops over the 100 usec spanned by both tasks.
+  EXPECT_NE(string::npos, trace.find("\"hlo_wall_usec\":100,"
+                                     "\"achieved_gflops_per_sec\":0.010,"));
+}
+
+}  // namespace
+}  // namespace xla
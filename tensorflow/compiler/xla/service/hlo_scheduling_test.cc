@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/hlo_scheduling.h"
 
+#include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
@@ -89,6 +91,76 @@ TEST_F(MinimumMemoryForSequenceTest, MultiComputation) {
             MinimumMemoryForSequence(module_sequence, size_fn).ValueOrDie());
 }
 
+class MemorySchedulerTest : public HloTestBase {};
+
+TEST_F(MemorySchedulerTest, DefaultSchedulerIsNeverWorseThanCandidates) {
+  // Two independent chains of elementwise ops, joined at the root. The
+  // post-order computes one chain at a time; the schedulers may interleave
+  // them.
+  auto module = CreateNewModule();
+  const Shape small_shape = ShapeUtil::MakeShape(xla::F32, {4});
+  const Shape large_shape = ShapeUtil::MakeShape(xla::F32, {1024});
+
+  auto builder = HloComputation::Builder(TestName());
+  HloInstruction* param = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, small_shape, "param"));
+  HloInstruction* large = builder.AddInstruction(
+      HloInstruction::CreateBroadcast(large_shape, param, {}));
+  HloInstruction* large_neg = builder.AddInstruction(
+      HloInstruction::CreateUnary(large_shape, HloOpcode::kNegate, large));
+  HloInstruction* large_exp = builder.AddInstruction(
+      HloInstruction::CreateUnary(large_shape, HloOpcode::kExp, large_neg));
+  HloInstruction* small_neg = builder.AddInstruction(
+      HloInstruction::CreateUnary(small_shape, HloOpcode::kNegate, param));
+  HloInstruction* small_exp = builder.AddInstruction(
+      HloInstruction::CreateUnary(small_shape, HloOpcode::kExp, small_neg));
+  builder.AddInstruction(HloInstruction::CreateTuple({large_exp, small_exp}));
+  module->AddEntryComputation(builder.Build());
+
+  auto size_fn = [](const LogicalBuffer& buffer) {
+    return ShapeUtil::ByteSizeOf(buffer.shape(), /*pointer_size=*/8);
+  };
+  auto memory_for = [&](const MemorySchedulerAlgorithm& algorithm) {
+    SequentialHloOrdering::HloModuleSequence sequence =
+        CreateMemoryMinimizingSequence(*module, size_fn, algorithm)
+            .ConsumeValueOrDie();
+    return MinimumMemoryForSequence(sequence, size_fn).ValueOrDie();
+  };
+
+  const int64 default_memory = memory_for(DefaultMemoryScheduler);
+  EXPECT_EQ(default_memory, memory_for(MemorySchedulerAlgorithm()));
+  EXPECT_LE(default_memory, memory_for(ListMemoryScheduler));
+  EXPECT_LE(default_memory, memory_for(DFSMemoryScheduler));
+  EXPECT_LE(default_memory, memory_for(PostOrderMemoryScheduler));
+}
+
+TEST_F(MemorySchedulerTest, PostOrderSchedulerMatchesPostOrder) {
+  auto module = CreateNewModule();
+  const Shape shape = ShapeUtil::MakeShape(xla::F32, {4});
+  auto builder = HloComputation::Builder(TestName());
+  HloInstruction* param = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, shape, "param"));
+  HloInstruction* neg = builder.AddInstruction(
+      HloInstruction::CreateUnary(shape, HloOpcode::kNegate, param));
+  HloInstruction* exp = builder.AddInstruction(
+      HloInstruction::CreateUnary(shape, HloOpcode::kExp, param));
+  builder.AddInstruction(
+      HloInstruction::CreateBinary(shape, HloOpcode::kAdd, neg, exp));
+  HloComputation* computation = module->AddEntryComputation(builder.Build());
+
+  auto size_fn = [](const LogicalBuffer& buffer) {
+    return ShapeUtil::ByteSizeOf(buffer.shape(), /*pointer_size=*/8);
+  };
+  std::vector<const HloInstruction*> sequence =
+      CreateMemoryMinimizingSequence(*computation, size_fn,
+                                     PostOrderMemoryScheduler)
+          .ConsumeValueOrDie();
+  const std::list<HloInstruction*> post_order =
+      computation->MakeInstructionPostOrder();
+  EXPECT_EQ(sequence, std::vector<const HloInstruction*>(post_order.begin(),
+                                                         post_order.end()));
+}
+
 }  // namespace
 }  // namespace xla
 
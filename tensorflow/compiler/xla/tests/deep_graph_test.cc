@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include "tensorflow/compiler/xla/array2d.h"
 #include "tensorflow/compiler/xla/legacy_flags/debug_options_flags.h"
 #include "tensorflow/compiler/xla/tests/client_library_test_base.h"
 
@@ -35,6 +36,35 @@ TEST_F(ClientLibraryTestBase, DeepGraph) {
   ComputeAndCompareR0<int32>(&b, /*expected=*/kDepth + 3,
                              {x_data.get(), y_data.get()});
 }
+
+TEST_F(ClientLibraryTestBase, WideGraph) {
+  // Independent chains of dots of different lengths, so that the parallel CPU
+  // backend has more ready instructions than threads and has to pick which to
+  // dispatch first. Each dot by 'x + x' doubles the chain.
+  const int kWidth = 32;
+  const int kMaxDepth = 6;
+  const int64 kSize = 8;
+  ComputationBuilder b(client_, TestName());
+  ComputationDataHandle x;
+  auto x_data =
+      CreateR2Parameter<float>(Array2D<float>(kSize, kSize, 1.0f / kSize), 0,
+                               "x", &b, &x);
+  ComputationDataHandle ones;
+  auto ones_data = CreateR2Parameter<float>(Array2D<float>(kSize, kSize, 1.0f),
+                                            1, "ones", &b, &ones);
+  ComputationDataHandle sum = ones;
+  float expected = 1.0f;
+  for (int i = 0; i < kWidth; ++i) {
+    ComputationDataHandle chain = b.Add(ones, ones);
+    for (int j = 0; j < i % kMaxDepth; ++j) {
+      chain = b.Dot(chain, b.Add(x, x));
+    }
+    sum = b.Add(sum, chain);
+    expected += 1 << (1 + i % kMaxDepth);
+  }
+  ComputeAndCompareR2<float>(&b, Array2D<float>(kSize, kSize, expected),
+                             {x_data.get(), ones_data.get()}, ErrorSpec(1e-4));
+}
 }  // namespace
 }  // namespace xla
 
@@ -15,8 +15,10 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <iterator>
 #include <set>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/constant_folding.h"
@@ -27,8 +29,11 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_runner.h"
 #include "tensorflow/core/common_runtime/memory_types.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/node_builder.h"
@@ -37,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -195,7 +201,8 @@ int64 UniqueConstantId() {
 // new constant node.
 bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
                                NodeAndOutput tensor, const Tensor& constant,
-                               const gtl::FlatSet<Node*>& control_deps) {
+                               const gtl::FlatSet<Node*>& control_deps,
+                               int64 max_constant_size_in_bytes) {
   // Be conservative when replacing a tensor with a constant, when not
   // running on CPU.
   // 1) If the destination tensor is not an int32 tensor, and has HOST_MEMORY
@@ -204,8 +211,9 @@ bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
   // constraint, do not replace it.
   // 3) If the constant op created does not have a kernel implementation
   // for the device, do not use it.
-  // 4) If the size of the constant in bytes is too large (> 10M), do not
-  // replace it. This prevents the size of the Graph from growing too large.
+  // 4) If the size of the constant in bytes is too large (more than
+  // max_constant_size_in_bytes), do not replace it. This prevents the size of
+  // the Graph from growing too large.
   // TODO(keveman): Consider adding a new constant op that has a kernel
   // implementation for all types, but with HostMemory constraint on it's
   // output.
@@ -229,7 +237,7 @@ bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
       return false;
     }
   }
-  if (constant.TotalBytes() > 10 * 1024 * 1024) {
+  if (static_cast<int64>(constant.TotalBytes()) > max_constant_size_in_bytes) {
     return false;
   }
 
@@ -282,8 +290,220 @@ bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
   return true;
 }
 
+// Returns the CPU device on which the constant foldable subgraphs are
+// evaluated when using the default environment. Creating a device spins up
+// its thread pools, so it is done once for the whole process.
+Device* SharedEvaluationDevice() {
+  static Device* device = [] {
+    std::vector<Device*> devices;
+    SessionOptions session_options;
+    Status s = DeviceFactory::GetFactory(DEVICE_CPU)
+                   ->CreateDevices(session_options, "", &devices);
+    if (!s.ok() || devices.empty()) {
+      LOG(WARNING) << "Unable to create a device for constant folding: " << s;
+      return static_cast<Device*>(nullptr);
+    }
+    for (size_t i = 1; i < devices.size(); ++i) {
+      delete devices[i];
+    }
+    return devices[0];
+  }();
+  return device;
+}
+
+// Only this many bytes of the content of the tensor attributes are hashed.
+const size_t kMaxTensorBytesToFingerprint = 1024;
+
+// Returns a fingerprint of 'constant_graph' and of the names of the tensors
+// fetched from it, which identifies the values of these tensors. Tensor
+// attributes, i.e. the values of the constants, may be large: only their type,
+// their shape and the start of their content are hashed, the cache compares
+// the whole graph anyway.
+uint64 FingerprintConstantGraph(const Graph& constant_graph,
+                                const std::vector<string>& fetch_names) {
+  uint64 fingerprint = 0;
+  for (const Node* n : constant_graph.nodes()) {
+    if (!n->IsOp()) {
+      continue;
+    }
+    const NodeDef& def = n->def();
+    fingerprint = FingerprintCat64(fingerprint, Fingerprint64(def.name()));
+    fingerprint = FingerprintCat64(fingerprint, Fingerprint64(def.op()));
+    for (const string& input : def.input()) {
+      fingerprint = FingerprintCat64(fingerprint, Fingerprint64(input));
+    }
+    // The attributes are a map: visit them in a deterministic order.
+    std::vector<string> attr_names;
+    for (const auto& attr : def.attr()) {
+      attr_names.push_back(attr.first);
+    }
+    std::sort(attr_names.begin(), attr_names.end());
+    for (const string& attr_name : attr_names) {
+      const AttrValue& attr = def.attr().at(attr_name);
+      fingerprint = FingerprintCat64(fingerprint, Fingerprint64(attr_name));
+      if (attr.value_case() == AttrValue::kTensor) {
+        const TensorProto& tensor = attr.tensor();
+        string shape;
+        tensor.tensor_shape().SerializeToString(&shape);
+        fingerprint = FingerprintCat64(fingerprint, tensor.dtype());
+        fingerprint = FingerprintCat64(fingerprint, Fingerprint64(shape));
+        fingerprint = FingerprintCat64(
+            fingerprint, Fingerprint64(tensor.tensor_content().substr(
+                             0, kMaxTensorBytesToFingerprint)));
+      } else {
+        string serialized;
+        attr.SerializeToString(&serialized);
+        fingerprint = FingerprintCat64(fingerprint, Fingerprint64(serialized));
+      }
+    }
+  }
+  for (const string& name : fetch_names) {
+    fingerprint = FingerprintCat64(fingerprint, Fingerprint64(name));
+  }
+  return fingerprint;
+}
+
+// Returns true if 'a' and 'b' hold the same tensor. Large tensors keep their
+// values in tensor_content, which is compared without copying it.
+bool SameTensorProto(const TensorProto& a, const TensorProto& b) {
+  if (a.tensor_content().empty() || b.tensor_content().empty()) {
+    string a_serialized, b_serialized;
+    a.SerializeToString(&a_serialized);
+    b.SerializeToString(&b_serialized);
+    return a_serialized == b_serialized;
+  }
+  // Tensor::FromProto ignores the typed values when the content is set.
+  string a_shape, b_shape;
+  a.tensor_shape().SerializeToString(&a_shape);
+  b.tensor_shape().SerializeToString(&b_shape);
+  return a.dtype() == b.dtype() && a_shape == b_shape &&
+         a.version_number() == b.version_number() &&
+         a.tensor_content() == b.tensor_content();
+}
+
+// Returns true if 'a' and 'b' are the same node.
+bool SameNodeDef(const NodeDef& a, const NodeDef& b) {
+  if (a.name() != b.name() || a.op() != b.op() || a.device() != b.device() ||
+      a.input_size() != b.input_size() || a.attr_size() != b.attr_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.input_size(); ++i) {
+    if (a.input(i) != b.input(i)) {
+      return false;
+    }
+  }
+  for (const auto& a_attr : a.attr()) {
+    auto b_attr = b.attr().find(a_attr.first);
+    if (b_attr == b.attr().end()) {
+      return false;
+    }
+    if (a_attr.second.value_case() == AttrValue::kTensor &&
+        b_attr->second.value_case() == AttrValue::kTensor) {
+      if (!SameTensorProto(a_attr.second.tensor(), b_attr->second.tensor())) {
+        return false;
+      }
+    } else if (!AreAttrValuesEqual(a_attr.second, b_attr->second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
+ConstantFoldingCache::ConstantFoldingCache(int64 capacity_in_bytes)
+    : capacity_in_bytes_(capacity_in_bytes) {}
+
+ConstantFoldingCache* ConstantFoldingCache::Global() {
+  static ConstantFoldingCache* cache =
+      new ConstantFoldingCache(64 * 1024 * 1024);
+  return cache;
+}
+
+bool ConstantFoldingCache::Lookup(uint64 key, const Graph& graph,
+                                  const std::vector<string>& fetch_names,
+                                  std::vector<Tensor>* tensors) {
+  mutex_lock l(mu_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  const Entry& entry = *it->second;
+  if (entry.fetch_names != fetch_names) {
+    return false;
+  }
+  // The nodes are visited in the same order as when the entry was inserted.
+  size_t i = 0;
+  for (const Node* n : graph.nodes()) {
+    if (!n->IsOp()) {
+      continue;
+    }
+    if (i >= entry.nodes.size() || !SameNodeDef(entry.nodes[i], n->def())) {
+      return false;
+    }
+    ++i;
+  }
+  if (i != entry.nodes.size()) {
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *tensors = it->second->tensors;
+  ++num_hits_;
+  return true;
+}
+
+void ConstantFoldingCache::Insert(uint64 key, const Graph& graph,
+                                  const std::vector<string>& fetch_names,
+                                  const std::vector<Tensor>& tensors) {
+  Entry entry;
+  entry.key = key;
+  entry.fetch_names = fetch_names;
+  entry.tensors = tensors;
+  entry.size_in_bytes = 0;
+  for (const Tensor& t : tensors) {
+    entry.size_in_bytes += t.TotalBytes();
+  }
+  if (entry.size_in_bytes > capacity_in_bytes_) {
+    return;
+  }
+  for (const Node* n : graph.nodes()) {
+    if (n->IsOp()) {
+      entry.nodes.push_back(n->def());
+      entry.size_in_bytes += n->def().ByteSize();
+    }
+  }
+  if (entry.size_in_bytes > capacity_in_bytes_) {
+    return;
+  }
+  mutex_lock l(mu_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    Erase(it->second);
+  }
+  size_in_bytes_ += entry.size_in_bytes;
+  entries_.push_front(std::move(entry));
+  index_[key] = entries_.begin();
+  while (size_in_bytes_ > capacity_in_bytes_) {
+    Erase(std::prev(entries_.end()));
+  }
+}
+
+void ConstantFoldingCache::Erase(std::list<Entry>::iterator entry) {
+  size_in_bytes_ -= entry->size_in_bytes;
+  index_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+int64 ConstantFoldingCache::num_hits() const {
+  mutex_lock l(mu_);
+  return num_hits_;
+}
+
+int64 ConstantFoldingCache::size_in_bytes() const {
+  mutex_lock l(mu_);
+  return size_in_bytes_;
+}
+
 Status ConstantFold(const ConstantFoldingOptions& opts,
                     FunctionLibraryRuntime* function_library, Env* env,
                     Device* partition_device, Graph* graph, bool* was_mutated) {
@@ -314,31 +534,64 @@ Status ConstantFold(const ConstantFoldingOptions& opts,
   VLOG(1) << "Constant foldable " << constant_graph->num_node_ids() << " : "
           << graph->num_node_ids();
 
+  // Fetch the tensors in the order of their names, which unlike the nodes
+  // they come from is the same in every copy of the graph.
+  std::vector<std::pair<string, NodeAndOutput>> fetches;
+  for (auto n : tensors_to_fetch) {
+    fetches.emplace_back(
+        strings::StrCat(n.first.first->name(), ":", n.first.second),
+        NodeAndOutput(n.second, n.first.second));
+  }
+  std::sort(fetches.begin(), fetches.end(),
+            [](const std::pair<string, NodeAndOutput>& a,
+               const std::pair<string, NodeAndOutput>& b) {
+              return a.first < b.first;
+            });
   std::vector<string> tensors_to_fetch_names;
   std::vector<NodeAndOutput> tensors_to_replace;
-  for (auto n : tensors_to_fetch) {
-    tensors_to_fetch_names.push_back(
-        strings::StrCat(n.first.first->name(), ":", n.first.second));
-    tensors_to_replace.push_back({n.second, n.first.second});
+  for (const auto& fetch : fetches) {
+    tensors_to_fetch_names.push_back(fetch.first);
+    tensors_to_replace.push_back(fetch.second);
   }
 
-  auto graph_runner = std::unique_ptr<GraphRunner>(new GraphRunner(env));
-  // Evaluate the constant foldable nodes.
   std::vector<Tensor> outputs;
-  auto delete_tensors = gtl::MakeCleanup([&graph_runner, &outputs] {
-    // Output tensors need to be cleared before the GraphRunner is deleted.
-    outputs.clear();
-    graph_runner.reset(nullptr);
-  });
-
-  Status s =
-      graph_runner->Run(constant_graph.get(), function_library, {} /* inputs*/,
-                        tensors_to_fetch_names, &outputs);
-  if (!s.ok()) {
-    VLOG(1) << "Could not fetch constants: " << s;
-    *was_mutated = false;
-    // This is not an error, so return the status as OK.
-    return s;
+  uint64 cache_key = 0;
+  if (opts.cache != nullptr) {
+    cache_key =
+        FingerprintConstantGraph(*constant_graph, tensors_to_fetch_names);
+  }
+  if (opts.cache != nullptr &&
+      opts.cache->Lookup(cache_key, *constant_graph, tensors_to_fetch_names,
+                         &outputs)) {
+    VLOG(1) << "Reusing the constants of an identical graph";
+  } else {
+    // Evaluate the constant foldable nodes. The GraphRunner deep copies the
+    // fetched tensors, so they outlive it.
+    Device* device =
+        env == Env::Default() ? SharedEvaluationDevice() : nullptr;
+    std::unique_ptr<GraphRunner> graph_runner(
+        device != nullptr ? new GraphRunner(device) : new GraphRunner(env));
+    Status s = graph_runner->Run(constant_graph.get(), function_library,
+                                 {} /* inputs*/, tensors_to_fetch_names,
+                                 &outputs);
+    if (!s.ok()) {
+      VLOG(1) << "Could not fetch constants: " << s;
+      *was_mutated = false;
+      // This is not an error, so return the status as OK.
+      return s;
+    }
+    if (opts.cache != nullptr) {
+      // Tensors over the budget are never materialized: don't hold onto them.
+      bool within_budget = true;
+      for (const Tensor& output : outputs) {
+        within_budget &= static_cast<int64>(output.TotalBytes()) <=
+                         opts.max_constant_size_in_bytes;
+      }
+      if (within_budget) {
+        opts.cache->Insert(cache_key, *constant_graph, tensors_to_fetch_names,
+                           outputs);
+      }
+    }
   }
 
   // Fetch the constant tensors and replace the corresponding tensors in the
@@ -349,7 +602,8 @@ Status ConstantFold(const ConstantFoldingOptions& opts,
         constant_control_deps[tensors_to_replace[c].first];
     if (ReplaceTensorWithConstant(graph, partition_device,
                                   tensors_to_replace[c], outputs[c],
-                                  control_deps)) {
+                                  control_deps,
+                                  opts.max_constant_size_in_bytes)) {
       ++num_nodes_replaced;
     }
   }
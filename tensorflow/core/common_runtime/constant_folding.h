@@ -16,19 +16,90 @@ limitations under the License.
 #ifndef TENSORFLOW_COMMON_RUNTIME_CONSTANT_FOLDING_H_
 #define TENSORFLOW_COMMON_RUNTIME_CONSTANT_FOLDING_H_
 
+#include <list>
+#include <unordered_map>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 
+// Caches the tensors computed by constant folding, keyed by a fingerprint of
+// the constant foldable subgraph they were computed from. This lets the many
+// sessions that load the same graph evaluate its constant subgraphs once.
+// Each entry keeps a copy of the nodes of its subgraph, which are compared to
+// the looked up subgraph, so that graphs whose fingerprints collide don't
+// share their constants.
+// The least recently used entries are evicted once the tensors and nodes take
+// more than 'capacity_in_bytes'. Thread-safe.
+class ConstantFoldingCache {
+ public:
+  explicit ConstantFoldingCache(int64 capacity_in_bytes);
+
+  // Returns a cache of 64MB shared by the whole process.
+  static ConstantFoldingCache* Global();
+
+  // Returns true and fills 'tensors' if an entry exists for 'key' that was
+  // computed by fetching 'fetch_names' from a graph with the same nodes as
+  // 'graph'.
+  bool Lookup(uint64 key, const Graph& graph,
+              const std::vector<string>& fetch_names,
+              std::vector<Tensor>* tensors);
+
+  // Records the 'tensors' computed by fetching 'fetch_names' from 'graph' for
+  // 'key', replacing the entry of another graph with the same key. Entries
+  // larger than the capacity of the cache are ignored.
+  void Insert(uint64 key, const Graph& graph,
+              const std::vector<string>& fetch_names,
+              const std::vector<Tensor>& tensors);
+
+  int64 num_hits() const;
+  int64 size_in_bytes() const;
+
+ private:
+  struct Entry {
+    uint64 key;
+    std::vector<NodeDef> nodes;
+    std::vector<string> fetch_names;
+    std::vector<Tensor> tensors;
+    int64 size_in_bytes;
+  };
+
+  // Removes 'entry' from the cache.
+  void Erase(std::list<Entry>::iterator entry) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64 capacity_in_bytes_;
+  mutable mutex mu_;
+  // Most recently used entries first.
+  std::list<Entry> entries_ GUARDED_BY(mu_);
+  std::unordered_map<uint64, std::list<Entry>::iterator> index_ GUARDED_BY(mu_);
+  int64 size_in_bytes_ GUARDED_BY(mu_) = 0;
+  int64 num_hits_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ConstantFoldingCache);
+};
+
 // Options specific to constant folding optimizations.
 struct ConstantFoldingOptions {
   // If "consider" is not a nullptr, then only constant fold a node "n" if
   // consider(n) returns true.
   std::function<bool(const Node*)> consider = nullptr;
+
+  // Tensors larger than this aren't materialized as constants, to keep the
+  // graph from growing too large.
+  int64 max_constant_size_in_bytes = 10 * 1024 * 1024;
+
+  // If not a nullptr, the results of the evaluation of the constant foldable
+  // subgraphs are looked up in, and added to, this cache.
+  ConstantFoldingCache* cache = nullptr;
 };
 
 // Perform constant folding optimization on "graph".
@@ -37,6 +108,8 @@ struct ConstantFoldingOptions {
 // and replaces those nodes with the result of the evaluation.
 // "partition_device", if non-null, is the device where all the graph nodes are
 // assumed to execute.
+// The evaluation runs on a CPU device shared by all the calls that use the
+// default environment.
 // Sets `was_mutated` to true if and only if "graph" has been mutated.
 // The status is only set to a non-OK state if an unexpected error is hit
 // running the graph.
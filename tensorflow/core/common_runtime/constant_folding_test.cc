@@ -261,6 +261,130 @@ TEST_F(ConstantFoldingTest, TestNoReplaceLargeConstant) {
   EXPECT_FALSE(was_mutated);
 }
 
+TEST_F(ConstantFoldingTest, TestMaxConstantSize) {
+  Scope s = Scope::NewRootScope();
+  BuildSimpleGraph(&s);
+  Graph g(OpRegistry::Global());
+  TF_ASSERT_OK(s.ToGraph(&g));
+
+  // The folded 2x2 float matrices take 16 bytes.
+  ConstantFoldingOptions opts;
+  opts.max_constant_size_in_bytes = 15;
+  bool was_mutated;
+  TF_EXPECT_OK(
+      ConstantFold(opts, nullptr, Env::Default(), nullptr, &g, &was_mutated));
+  EXPECT_FALSE(was_mutated);
+
+  opts.max_constant_size_in_bytes = 16;
+  TF_EXPECT_OK(
+      ConstantFold(opts, nullptr, Env::Default(), nullptr, &g, &was_mutated));
+  EXPECT_TRUE(was_mutated);
+}
+
+TEST_F(ConstantFoldingTest, CacheIdenticalGraphs) {
+  ConstantFoldingCache cache(4096);
+  ConstantFoldingOptions opts;
+  opts.cache = &cache;
+  int64 size_in_bytes = 0;
+  for (int i = 0; i < 2; ++i) {
+    Scope s = Scope::NewRootScope();
+    BuildSimpleGraph(&s);
+    Graph g(OpRegistry::Global());
+    TF_ASSERT_OK(s.ToGraph(&g));
+
+    bool was_mutated;
+    TF_ASSERT_OK(
+        ConstantFold(opts, nullptr, Env::Default(), nullptr, &g, &was_mutated));
+    EXPECT_TRUE(was_mutated);
+    EXPECT_EQ(i, cache.num_hits());
+    // The two folded 2x2 float matrices, and the nodes they come from.
+    EXPECT_LT(32, cache.size_in_bytes());
+    if (i == 0) {
+      size_in_bytes = cache.size_in_bytes();
+    }
+    EXPECT_EQ(size_in_bytes, cache.size_in_bytes());
+
+    std::unordered_map<string, Node*> index = NodeNameIndex(g);
+    ExpectNodeClose<float>(*(index.at("s1")->in_nodes().begin()),
+                           {1.0, 2.0, 3.0, 4.0}, {2, 2});
+    ExpectNodeClose<float>(*(index.at("s2")->in_nodes().begin()),
+                           {2.0, 1.0, 4.0, 3.0}, {2, 2});
+  }
+
+  // A graph with different constants doesn't reuse the cached values.
+  Scope s = Scope::NewRootScope();
+  auto a = ops::Const<float>(s, {2.0, 0.0, 0.0, 2.0}, {2, 2});
+  auto b = ops::Const<float>(s, {1.0, 2.0, 3.0, 4.0}, {2, 2});
+  auto m1 = ops::MatMul(s, a, b);
+  ops::_Send(s.WithOpName("s1"), m1, "m1", "sender", 0, "receiver");
+  Graph g(OpRegistry::Global());
+  TF_ASSERT_OK(s.ToGraph(&g));
+  bool was_mutated;
+  TF_ASSERT_OK(
+      ConstantFold(opts, nullptr, Env::Default(), nullptr, &g, &was_mutated));
+  EXPECT_TRUE(was_mutated);
+  EXPECT_EQ(1, cache.num_hits());
+  std::unordered_map<string, Node*> index = NodeNameIndex(g);
+  ExpectNodeClose<float>(*(index.at("s1")->in_nodes().begin()),
+                         {2.0, 4.0, 6.0, 8.0}, {2, 2});
+}
+
+TEST_F(ConstantFoldingTest, CacheComparesGraphsWithSameFingerprint) {
+  // Only the start of large constants is fingerprinted: these graphs only
+  // differ by the last value of their constant.
+  ConstantFoldingCache cache(1024 * 1024);
+  ConstantFoldingOptions opts;
+  opts.cache = &cache;
+  for (int i = 0; i < 2; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({4096}));
+    t.flat<float>().setZero();
+    t.flat<float>()(4095) = i;
+    Scope s = Scope::NewRootScope();
+    auto a = ops::Const(s.WithOpName("a"), Input::Initializer(t));
+    auto n = ops::Neg(s.WithOpName("n"), a);
+    ops::_Send(s.WithOpName("s"), n, "n", "sender", 0, "receiver");
+    Graph g(OpRegistry::Global());
+    TF_ASSERT_OK(s.ToGraph(&g));
+
+    bool was_mutated;
+    TF_ASSERT_OK(
+        ConstantFold(opts, nullptr, Env::Default(), nullptr, &g, &was_mutated));
+    EXPECT_TRUE(was_mutated);
+    EXPECT_EQ(0, cache.num_hits());
+    std::unordered_map<string, Node*> index = NodeNameIndex(g);
+    std::vector<float> expected(4096, 0.0);
+    expected[4095] = -i;
+    ExpectNodeEqual<float>(*(index.at("s")->in_nodes().begin()), expected,
+                           {4096});
+  }
+}
+
+TEST(ConstantFoldingCacheTest, EvictsLeastRecentlyUsed) {
+  // The graph has no nodes to keep: only the tensors count.
+  Graph g(OpRegistry::Global());
+  ConstantFoldingCache cache(8);
+  Tensor t(DT_FLOAT, TensorShape({1}));
+  t.flat<float>()(0) = 1.0;
+  cache.Insert(1, g, {"a:0"}, {t});
+  cache.Insert(2, g, {"a:0"}, {t});
+  std::vector<Tensor> tensors;
+  EXPECT_TRUE(cache.Lookup(1, g, {"a:0"}, &tensors));
+  ASSERT_EQ(1, tensors.size());
+  test::ExpectTensorEqual<float>(t, tensors[0]);
+  // Entry 2 is now the least recently used.
+  cache.Insert(3, g, {"a:0"}, {t});
+  EXPECT_EQ(8, cache.size_in_bytes());
+  EXPECT_TRUE(cache.Lookup(1, g, {"a:0"}, &tensors));
+  EXPECT_FALSE(cache.Lookup(2, g, {"a:0"}, &tensors));
+  EXPECT_TRUE(cache.Lookup(3, g, {"a:0"}, &tensors));
+  // Entries larger than the cache are ignored.
+  cache.Insert(4, g, {"a:0"}, {Tensor(DT_FLOAT, TensorShape({3}))});
+  EXPECT_FALSE(cache.Lookup(4, g, {"a:0"}, &tensors));
+  // Entries fetching other tensors don't match.
+  EXPECT_FALSE(cache.Lookup(1, g, {"b:0"}, &tensors));
+  EXPECT_EQ(3, cache.num_hits());
+}
+
 TEST_F(ConstantFoldingTest, TestNoReplaceFunctionCall) {
   FunctionDefLibrary flib;
   *flib.add_function() = test::function::XTimesTwo();
@@ -0,0 +1,61 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/constant_weights.h"
+
+#include "tensorflow/core/framework/node_def_util.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the name of the boolean attr that tells the kernel of 'n' that its
+// weights are constant, or nullptr if 'n' has no such attr.
+const char* ConstantWeightsAttr(const Node* n) {
+  const string& op = n->type_string();
+  if (op == "MatMul" || op == "Conv2D") return "_constant_weights";
+  if (op == "QuantizedMatMul") return "b_is_constant";
+  return nullptr;
+}
+
+// Returns true if the output of 'n' holds the same buffer on every run.
+// Const and ImmutableConst kernels return the tensor they own, and Identity
+// forwards its input.
+bool IsConstantSource(const Node* n) {
+  while (n->IsIdentity()) {
+    if (!n->input_node(0, &n).ok()) return false;
+  }
+  return n->IsConstant() || n->type_string() == "ImmutableConst";
+}
+
+}  // namespace
+
+bool MarkConstantWeights(Graph* g) {
+  bool changed = false;
+  for (Node* n : g->op_nodes()) {
+    const char* attr = ConstantWeightsAttr(n);
+    if (attr == nullptr) continue;
+    const Node* weights;
+    if (!n->input_node(1, &weights).ok() || !IsConstantSource(weights)) {
+      continue;
+    }
+    bool marked;
+    if (GetNodeAttr(n->attrs(), attr, &marked).ok() && marked) continue;
+    n->AddAttr(attr, true);
+    changed = true;
+  }
+  return changed;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,35 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_CONSTANT_WEIGHTS_H_
+#define TENSORFLOW_COMMON_RUNTIME_CONSTANT_WEIGHTS_H_
+
+#include "tensorflow/core/graph/graph.h"
+
+namespace tensorflow {
+
+// Marks the MatMul, Conv2D and QuantizedMatMul nodes of 'g' whose weights
+// (their second input) are produced by a Const or ImmutableConst node,
+// possibly through Identity nodes, so that their kernels can pack the weights
+// once and reuse them on every run.  MatMul and Conv2D get the boolean attr
+// "_constant_weights" (see kernels/packed_matmul.h), and QuantizedMatMul gets
+// its b_is_constant attr set.
+//
+// Returns true if and only if 'g' is mutated.
+bool MarkConstantWeights(Graph* g);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_CONSTANT_WEIGHTS_H_
@@ -0,0 +1,66 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/constant_weights.h"
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+bool HasConstantWeights(const Node* n) {
+  bool value = false;
+  return GetNodeAttr(n->attrs(), "_constant_weights", &value).ok() && value;
+}
+
+TEST(MarkConstantWeightsTest, MatMul) {
+  Graph g(OpRegistry::Global());
+  Tensor weights(DT_FLOAT, TensorShape({2, 2}));
+  weights.flat<float>().setZero();
+  Node* input = test::graph::Var(&g, DT_FLOAT, TensorShape({2, 2}));
+  Node* constant = test::graph::Constant(&g, weights);
+  Node* const_weights = test::graph::Matmul(&g, input, constant, false, false);
+  Node* identity_weights = test::graph::Matmul(
+      &g, input, test::graph::Identity(&g, constant), false, false);
+  Node* variable_weights = test::graph::Matmul(
+      &g, constant, test::graph::Identity(&g, input), false, false);
+
+  EXPECT_TRUE(MarkConstantWeights(&g));
+  EXPECT_TRUE(HasConstantWeights(const_weights));
+  EXPECT_TRUE(HasConstantWeights(identity_weights));
+  EXPECT_FALSE(HasConstantWeights(variable_weights));
+
+  // Marked nodes are left unchanged.
+  EXPECT_FALSE(MarkConstantWeights(&g));
+}
+
+TEST(MarkConstantWeightsTest, OtherOps) {
+  Graph g(OpRegistry::Global());
+  Tensor weights(DT_FLOAT, TensorShape({2, 2}));
+  weights.flat<float>().setZero();
+  Node* input = test::graph::Var(&g, DT_FLOAT, TensorShape({2, 2}));
+  Node* add =
+      test::graph::Binary(&g, "Add", input, test::graph::Constant(&g, weights));
+
+  EXPECT_FALSE(MarkConstantWeights(&g));
+  EXPECT_FALSE(HasConstantWeights(add));
+}
+
+}  // namespace
+}  // namespace tensorflow
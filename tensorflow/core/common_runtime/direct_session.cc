@@ -1166,6 +1166,7 @@ Status DirectSession::GetOrCreateExecutors(
       }
     };
     params.node_outputs_cb = node_outputs_callback_;
+    params.plan_memory = optimizer_opts.do_memory_planning();
 
     optimizer.Optimize(lib, options_.env, device, &iter->second);
 
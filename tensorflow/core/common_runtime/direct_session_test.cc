@@ -424,6 +424,56 @@ class DarthOp : public OpKernel {
 };
 REGISTER_KERNEL_BUILDER(Name("Darth").Device(DEVICE_CPU), DarthOp);
 
+// Runs a chain of unary ops on a constant and fetches every other output,
+// with or without memory planning.
+Status RunUnaryChain(bool plan_memory, std::vector<Tensor>* outputs) {
+  Graph g(OpRegistry::Global());
+  Tensor a_tensor(DT_FLOAT, TensorShape({1024}));
+  for (int i = 0; i < 1024; ++i) {
+    a_tensor.flat<float>()(i) = i;
+  }
+  Node* a = test::graph::Constant(&g, a_tensor);
+  Node* b = test::graph::Unary(&g, "Neg", a);
+  Node* c = test::graph::Unary(&g, "Square", b);
+  Node* d = test::graph::Unary(&g, "Neg", c);
+  GraphDef def;
+  test::graph::ToGraphDef(&g, &def);
+
+  SessionOptions options;
+  // Keep constant folding from evaluating the whole chain.
+  OptimizerOptions* optimizer_options =
+      options.config.mutable_graph_options()->mutable_optimizer_options();
+  optimizer_options->set_opt_level(OptimizerOptions_Level_L0);
+  optimizer_options->set_do_memory_planning(plan_memory);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_RETURN_IF_ERROR(session->Create(def));
+
+  // The plan places d where b was, but b is still alive when d is computed
+  // since it is fetched. Keeping the outputs of the first run alive through
+  // the second one makes the fetched outputs of the latter overlap as well.
+  std::vector<Tensor> first_outputs;
+  TF_RETURN_IF_ERROR(session->Run(
+      {}, {b->name() + ":0", d->name() + ":0"}, {}, &first_outputs));
+  TF_RETURN_IF_ERROR(session->Run(
+      {}, {b->name() + ":0", d->name() + ":0"}, {}, outputs));
+  outputs->insert(outputs->end(), first_outputs.begin(), first_outputs.end());
+  return session->Close();
+}
+
+TEST(DirectSessionTest, MemoryPlanningMatchesUnplanned) {
+  std::vector<Tensor> expected;
+  TF_ASSERT_OK(RunUnaryChain(false, &expected));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(RunUnaryChain(true, &outputs));
+  ASSERT_EQ(4, expected.size());
+  ASSERT_EQ(4, outputs.size());
+  EXPECT_EQ(-1023, expected[0].flat<float>()(1023));
+  EXPECT_EQ(-1023 * 1023, expected[1].flat<float>()(1023));
+  for (int i = 0; i < outputs.size(); ++i) {
+    test::ExpectTensorEqual<float>(expected[i], outputs[i]);
+  }
+}
+
 TEST(DirectSessionTest, DarthKernel) {
   Graph g(OpRegistry::Global());
   Tensor vx(DT_FLOAT, TensorShape({}));
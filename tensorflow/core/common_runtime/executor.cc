@@ -23,6 +23,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocation_description.pb.h"
@@ -234,6 +235,10 @@ struct NodeItem {
   // Number of output edges.
   size_t num_output_edges;
 
+  // Array of per-output planned allocators, or nullptr if none of the
+  // outputs is planned.
+  Allocator* const* output_allocators = nullptr;
+
   PendingCounts::Handle pending_id;
 
   const EdgeInfo* output_edge_list() const { return output_edge_base(); }
@@ -347,6 +352,9 @@ class ExecutorImpl : public Executor {
     for (auto fiter : frame_info_) {
       delete fiter.second;
     }
+    if (planned_arena_ != nullptr) {
+      planned_arena_->Unref();
+    }
     delete graph_;
   }
 
@@ -401,6 +409,10 @@ class ExecutorImpl : public Executor {
                                      ControlFlowInfo* cf_info);
   void InitializePending(const Graph* graph, const ControlFlowInfo& cf_info);
 
+  // Plans the offsets of the fixed size outputs of the nodes outside of
+  // loops in a preallocated arena, and sets the allocators of their items.
+  Status PlanOutputMemory(const ControlFlowInfo& cf_info);
+
   FrameInfo* EnsureFrameInfo(const string& fname) {
     auto slot = &frame_info_[fname];
     if (*slot == nullptr) {
@@ -425,6 +437,11 @@ class ExecutorImpl : public Executor {
   // the overhead of constructing it for each executor instance.
   gtl::FlatMap<string, FrameInfo*, HashStr> frame_info_;
 
+  // The arena of the planned outputs, if params_.plan_memory is set.  Each
+  // planned output of the items has its allocator in planned_allocators_.
+  PlannedArena* planned_arena_ = nullptr;  // One reference owned.
+  std::vector<Allocator*> planned_allocators_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
 
@@ -677,7 +694,62 @@ Status ExecutorImpl::Initialize() {
   // all nodes.
   InitializePending(graph_, cf_info);
 
-  return gview_.SetAllocAttrs(graph_, params_.device);
+  TF_RETURN_IF_ERROR(gview_.SetAllocAttrs(graph_, params_.device));
+  if (params_.plan_memory) {
+    TF_RETURN_IF_ERROR(PlanOutputMemory(cf_info));
+  }
+  return Status::OK();
+}
+
+Status ExecutorImpl::PlanOutputMemory(const ControlFlowInfo& cf_info) {
+  // Kernels on other devices may still use their outputs after Compute()
+  // returns, when the buffers could already be handed to other outputs.
+  if (params_.device->device_type() != DEVICE_CPU) {
+    return Status::OK();
+  }
+  auto include = [this, &cf_info](const Node* n, int output) {
+    // The outputs of nodes in loops are allocated once per iteration.
+    if (!cf_info.frame_names[n->id()].empty()) {
+      return false;
+    }
+    // These nodes forward tensors allocated elsewhere.
+    if (n->IsConstant() || n->IsIdentity() || n->IsRecv() ||
+        n->IsControlFlow() || n->IsVariable()) {
+      return false;
+    }
+    const NodeItem* item = gview_.node(n->id());
+    return !IsRefType(item->output_type(output)) &&
+           item->output_attrs()[output].value == 0;
+  };
+  MemoryPlan plan;
+  TF_RETURN_IF_ERROR(PlanMemory(*graph_, include, &plan));
+  planned_arena_ = PlannedArena::Create(
+      params_.device->GetAllocator(AllocatorAttributes()), plan);
+  if (planned_arena_ == nullptr) {
+    return Status::OK();
+  }
+  VLOG(1) << "Planned " << plan.allocations.size() << " outputs in an arena of "
+          << plan.arena_size << " bytes";
+
+  // Lay out the allocators of each node contiguously, indexed by output.
+  gtl::FlatMap<int, int> first_allocator;
+  for (const PlannedAllocation& allocation : plan.allocations) {
+    if (first_allocator.find(allocation.node_id) == first_allocator.end()) {
+      first_allocator[allocation.node_id] = planned_allocators_.size();
+      planned_allocators_.resize(planned_allocators_.size() +
+                                 gview_.node(allocation.node_id)->num_outputs);
+    }
+  }
+  for (int i = 0; i < plan.allocations.size(); ++i) {
+    const PlannedAllocation& allocation = plan.allocations[i];
+    planned_allocators_[first_allocator[allocation.node_id] +
+                        allocation.output] = planned_arena_->allocator(i);
+  }
+  for (const auto& it : first_allocator) {
+    gview_.node(it.first)->output_allocators =
+        planned_allocators_.data() + it.second;
+  }
+  return Status::OK();
 }
 
 Status GraphView::SetAllocAttrs(const Graph* g, const Device* device) {
@@ -1593,6 +1665,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
       params.frame_iter = FrameAndIter(input_frame->frame_id, input_iter);
       params.is_input_dead = is_input_dead;
       params.output_attr_array = item.output_attrs();
+      params.output_allocator_array = item.output_allocators;
 
       if (item.kernel_is_async) {
         // Asynchronous computes.
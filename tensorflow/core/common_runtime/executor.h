@@ -141,6 +141,11 @@ struct LocalExecutorParams {
   std::function<void(OpKernel*)> delete_kernel;
 
   Executor::Args::NodeOutputsCallback node_outputs_cb;
+
+  // If true, the outputs whose size is known statically are allocated at
+  // offsets planned when the executor is created, in an arena preallocated
+  // from the device allocator.  Only applies to CPU devices.
+  bool plan_memory = false;
 };
 ::tensorflow::Status NewLocalExecutor(const LocalExecutorParams& params,
                                       const Graph* graph, Executor** executor);
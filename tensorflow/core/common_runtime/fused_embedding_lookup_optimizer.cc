@@ -0,0 +1,135 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the CPU device in the same task as `device_name`, or nullptr if
+// there is none.
+const Device* HostCpuDevice(const DeviceSet& device_set,
+                            const DeviceNameUtils::ParsedName& device_name) {
+  const Device* host = nullptr;
+  for (const Device* d : device_set.devices()) {
+    const DeviceNameUtils::ParsedName& name = d->parsed_name();
+    if (name.type != DEVICE_CPU ||
+        !DeviceNameUtils::IsSameAddressSpace(name, device_name)) {
+      continue;
+    }
+    if (host == nullptr || name.id < host->parsed_name().id) {
+      host = d;
+    }
+  }
+  return host;
+}
+
+// Places FusedEmbeddingLookupSparse nodes next to their params.
+//
+// embedding_lookup_sparse only colocates the fused op with params that are
+// pinned to a CPU device, since the op has no kernel for other devices. For
+// params without a device type the decision is left to this pass, once the
+// placer has picked a device for them:
+//
+// * params on a CPU device: the fused node is moved to that device, so that
+//   the table is read in place rather than sent to wherever the placer put
+//   the fused node.
+// * params on another device: the looked up rows are gathered on the params'
+//   device and only those rows are combined by the fused node, on a CPU of the
+//   same task. The ids are deduplicated first, so each row is copied once.
+class FusedEmbeddingLookupPlacementPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override {
+    if (options.graph == nullptr) {
+      return Status::OK();
+    }
+    Graph* g = options.graph->get();
+    if (g == nullptr) {
+      return errors::Internal(
+          "Fused embedding lookup placement should happen before "
+          "partitioning and a graph should be available.");
+    }
+    gtl::InlinedVector<Node*, 2> matches;
+    for (Node* n : g->op_nodes()) {
+      if (n->type_string() == "FusedEmbeddingLookupSparse") {
+        matches.push_back(n);
+      }
+    }
+    for (Node* n : matches) {
+      const Edge* params_edge;
+      TF_RETURN_IF_ERROR(n->input_edge(0, &params_edge));
+      Node* params = params_edge->src();
+      const int params_output = params_edge->src_output();
+      const string& params_device = params->assigned_device_name();
+      DeviceNameUtils::ParsedName params_name;
+      if (!DeviceNameUtils::ParseFullName(params_device, &params_name) ||
+          !params_name.has_type) {
+        continue;
+      }
+      if (params_name.type == DEVICE_CPU) {
+        n->set_assigned_device_name(params_device);
+        continue;
+      }
+      if (options.device_set == nullptr) {
+        continue;
+      }
+      const Device* host = HostCpuDevice(*options.device_set, params_name);
+      if (host == nullptr) {
+        continue;
+      }
+
+      const Edge* ids_edge;
+      TF_RETURN_IF_ERROR(n->input_edge(1, &ids_edge));
+      Node* ids = ids_edge->src();
+      const int ids_output = ids_edge->src_output();
+
+      Node* unique;
+      TF_RETURN_IF_ERROR(
+          NodeBuilder(g->NewName(strings::StrCat(n->name(), "/Unique")),
+                      "Unique")
+              .Input(ids, ids_output)
+              .Attr("out_idx", DT_INT32)
+              .Finalize(g, &unique));
+      unique->set_assigned_device_name(host->name());
+
+      Node* gather;
+      TF_RETURN_IF_ERROR(
+          NodeBuilder(g->NewName(strings::StrCat(n->name(), "/Gather")),
+                      "Gather")
+              .Input(params, params_output)
+              .Input(unique, 0)
+              .Finalize(g, &gather));
+      gather->set_assigned_device_name(params_device);
+
+      g->RemoveEdge(params_edge);
+      g->RemoveEdge(ids_edge);
+      g->AddEdge(gather, 0, n, 0);
+      g->AddEdge(unique, 1, n, 1);
+      n->set_assigned_device_name(host->name());
+    }
+    return Status::OK();
+  }
+};
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_PLACEMENT, 0,
+                      FusedEmbeddingLookupPlacementPass);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,155 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class FakeDevice : public Device {
+ public:
+  explicit FakeDevice(const string& name, const string& type)
+      : Device(nullptr, Attributes(name, type)) {}
+
+  Status Sync() override { return errors::Unimplemented("FakeDevice::Sync()"); }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override { return nullptr; }
+
+ private:
+  static DeviceAttributes Attributes(const string& name, const string& type) {
+    DeviceAttributes attributes;
+    attributes.set_name(name);
+    attributes.set_device_type(type);
+    return attributes;
+  }
+};
+
+class FusedEmbeddingLookupPlacementTest : public ::testing::Test {
+ protected:
+  FusedEmbeddingLookupPlacementTest()
+      : graph_(new Graph(OpRegistry::Global())) {
+    for (const string& name : {kCpu0, kCpu1, kGpu0, kPsCpu0}) {
+      devices_.emplace_back(new FakeDevice(
+          name, name.find("/gpu:") == string::npos ? "CPU" : "GPU"));
+      device_set_.AddDevice(devices_.back().get());
+    }
+  }
+
+  // Adds a fused lookup of `params` placed on `params_device`, and places
+  // the fused node on `fused_device`.
+  Node* AddLookup(const string& params_device, const string& fused_device) {
+    Graph* g = graph_.get();
+    params_ = test::graph::Constant(
+        g, test::AsTensor<float>({0, 1, 2, 3, 4, 5}, TensorShape({3, 2})));
+    params_->set_assigned_device_name(params_device);
+    ids_ = test::graph::Constant(g, test::AsTensor<int32>({1, 0, 1}));
+    ids_->set_assigned_device_name(kCpu0);
+    Node* segment_ids =
+        test::graph::Constant(g, test::AsTensor<int32>({0, 0, 1}));
+    segment_ids->set_assigned_device_name(kCpu0);
+    Node* fused;
+    TF_CHECK_OK(NodeBuilder("fused", "FusedEmbeddingLookupSparse")
+                    .Input(params_)
+                    .Input(ids_)
+                    .Input(segment_ids)
+                    .Attr("combiner", "sum")
+                    .Finalize(g, &fused));
+    fused->set_assigned_device_name(fused_device);
+    return fused;
+  }
+
+  Status Run() {
+    GraphOptimizationPassOptions options;
+    options.graph = &graph_;
+    options.device_set = &device_set_;
+    return OptimizationPassRegistry::Global()->RunGrouping(
+        OptimizationPassRegistry::POST_PLACEMENT, options);
+  }
+
+  static constexpr const char* kCpu0 = "/job:a/replica:0/task:0/cpu:0";
+  static constexpr const char* kCpu1 = "/job:a/replica:0/task:0/cpu:1";
+  static constexpr const char* kGpu0 = "/job:a/replica:0/task:0/gpu:0";
+  static constexpr const char* kPsCpu0 = "/job:ps/replica:0/task:0/cpu:0";
+
+  std::unique_ptr<Graph> graph_;
+  std::vector<std::unique_ptr<Device>> devices_;
+  DeviceSet device_set_;
+  Node* params_ = nullptr;
+  Node* ids_ = nullptr;
+};
+
+constexpr const char* FusedEmbeddingLookupPlacementTest::kCpu0;
+constexpr const char* FusedEmbeddingLookupPlacementTest::kCpu1;
+constexpr const char* FusedEmbeddingLookupPlacementTest::kGpu0;
+constexpr const char* FusedEmbeddingLookupPlacementTest::kPsCpu0;
+
+TEST_F(FusedEmbeddingLookupPlacementTest, MovesNextToParamsOnCpu) {
+  Node* fused = AddLookup(kPsCpu0, kCpu0);
+  const int num_nodes = graph_->num_op_nodes();
+  TF_ASSERT_OK(Run());
+  EXPECT_EQ(num_nodes, graph_->num_op_nodes());
+  EXPECT_EQ(kPsCpu0, fused->assigned_device_name());
+  const Node* input;
+  TF_ASSERT_OK(fused->input_node(0, &input));
+  EXPECT_EQ(params_, input);
+  TF_ASSERT_OK(fused->input_node(1, &input));
+  EXPECT_EQ(ids_, input);
+}
+
+TEST_F(FusedEmbeddingLookupPlacementTest, GathersRowsOfParamsOnGpu) {
+  Node* fused = AddLookup(kGpu0, kCpu1);
+  TF_ASSERT_OK(Run());
+  EXPECT_EQ(kCpu0, fused->assigned_device_name());
+
+  const Node* gather;
+  TF_ASSERT_OK(fused->input_node(0, &gather));
+  EXPECT_EQ("Gather", gather->type_string());
+  EXPECT_EQ(kGpu0, gather->assigned_device_name());
+  const Node* input;
+  TF_ASSERT_OK(gather->input_node(0, &input));
+  EXPECT_EQ(params_, input);
+
+  const Edge* edge;
+  TF_ASSERT_OK(fused->input_edge(1, &edge));
+  const Node* unique = edge->src();
+  EXPECT_EQ("Unique", unique->type_string());
+  EXPECT_EQ(1, edge->src_output());
+  EXPECT_EQ(kCpu0, unique->assigned_device_name());
+  TF_ASSERT_OK(unique->input_node(0, &input));
+  EXPECT_EQ(ids_, input);
+  TF_ASSERT_OK(gather->input_edge(1, &edge));
+  EXPECT_EQ(unique, edge->src());
+  EXPECT_EQ(0, edge->src_output());
+}
+
+TEST_F(FusedEmbeddingLookupPlacementTest, LeavesUnplacedParamsAlone) {
+  Node* fused = AddLookup("", kCpu1);
+  const int num_nodes = graph_->num_op_nodes();
+  TF_ASSERT_OK(Run());
+  EXPECT_EQ(num_nodes, graph_->num_op_nodes());
+  EXPECT_EQ(kCpu1, fused->assigned_device_name());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_optimizer.h"
 
 #include "tensorflow/core/common_runtime/constant_folding.h"
+#include "tensorflow/core/common_runtime/constant_weights.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph_constructor.h"
@@ -57,6 +58,9 @@ void GraphOptimizer::Optimize(FunctionLibraryRuntime* runtime, Env* env,
 
     if (opts_.do_constant_folding()) {
       ConstantFoldingOptions cf_opts;
+      if (opts_.cache_constant_folding()) {
+        cf_opts.cache = ConstantFoldingCache::Global();
+      }
       bool was_mutated;
       ConstantFold(cf_opts, runtime, env, device, g, &was_mutated)
           .IgnoreError();
@@ -83,6 +87,12 @@ void GraphOptimizer::Optimize(FunctionLibraryRuntime* runtime, Env* env,
     if (!changed) break;
   }
 
+  // Done after constant folding, which can create new constant weights, and
+  // only at the optimizer levels that fold constants.
+  if (opts_.do_constant_folding() && MarkConstantWeights(g)) {
+    DumpGraph("MarkConstantWeights", g);
+  }
+
   // Note that we use the Graph constructor that copies the input
   // FunctionLibraryDefinition, since the original lib def will go out of scope.
   std::unique_ptr<Graph> copy(new Graph(g->flib_def()));
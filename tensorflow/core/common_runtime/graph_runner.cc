@@ -97,7 +97,10 @@ class SimpleRendezvous : public Rendezvous {
 
 }  // namespace
 
-GraphRunner::GraphRunner(Env* env) : cpu_device_(GetCPUDevice(env)) {}
+GraphRunner::GraphRunner(Env* env)
+    : device_deleter_(GetCPUDevice(env)), cpu_device_(device_deleter_.get()) {}
+
+GraphRunner::GraphRunner(Device* device) : cpu_device_(device) {}
 
 GraphRunner::~GraphRunner() {}
 
@@ -150,10 +153,10 @@ Status GraphRunner::Run(Graph* graph, FunctionLibraryRuntime* function_library,
 
   LocalExecutorParams params;
   // The ownership of the output tensors are bound to this device's lifetime.
-  params.device = cpu_device_.get();
+  params.device = cpu_device_;
   params.function_library = function_library;
   params.create_kernel = [this, g](const NodeDef& ndef, OpKernel** kernel) {
-    return CreateNonCachedKernel(cpu_device_.get(), nullptr, ndef,
+    return CreateNonCachedKernel(cpu_device_, nullptr, ndef,
                                  g->versions().producer(), kernel);
   };
   params.delete_kernel = [](OpKernel* kernel) { delete kernel; };
@@ -0,0 +1,292 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+struct Lifetime {
+  PlannedAllocation allocation;
+  // Positions of the producer and of the last consumer in the schedule.
+  int first_use;
+  int last_use;
+};
+
+// Returns the size in bytes of 'output' of 'node', or 0 if it isn't known
+// statically.
+size_t StaticOutputSize(const ShapeRefiner& refiner, const Node* node,
+                        int output) {
+  const size_t element_size = DataTypeSize(node->output_type(output));
+  if (element_size == 0) {
+    // Strings, resources and references aren't plain buffers.
+    return 0;
+  }
+  shape_inference::InferenceContext* c = refiner.GetContext(node);
+  if (c == nullptr) {
+    return 0;
+  }
+  shape_inference::ShapeHandle shape = c->output(output);
+  if (!c->FullyDefined(shape)) {
+    return 0;
+  }
+  size_t num_elements = 1;
+  for (int i = 0; i < c->Rank(shape); ++i) {
+    num_elements *= c->Value(c->Dim(shape, i));
+  }
+  return num_elements * element_size;
+}
+
+size_t RoundUp(size_t num_bytes) {
+  const size_t alignment = Allocator::kAllocatorAlignment;
+  return (num_bytes + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+Status PlanMemory(const Graph& graph,
+                  const std::function<bool(const Node*, int)>& include,
+                  MemoryPlan* plan) {
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  std::vector<int> position(graph.num_node_ids(), -1);
+  for (int i = 0; i < order.size(); ++i) {
+    position[order[i]->id()] = i;
+  }
+
+  ShapeRefiner refiner(graph.versions().producer(), graph.op_registry());
+  std::vector<Lifetime> lifetimes;
+  for (const Node* node : order) {
+    if (!refiner.AddNode(node).ok()) {
+      // The inputs of the node are unknown (e.g. it is the Merge of a loop),
+      // or its shape function failed: leave it out of the plan.
+      VLOG(2) << "Not planning the outputs of " << node->name();
+      continue;
+    }
+    if (!node->IsOp()) {
+      continue;
+    }
+    const int first_use = position[node->id()];
+    for (int i = 0; i < node->num_outputs(); ++i) {
+      if (!include(node, i)) {
+        continue;
+      }
+      const size_t size = StaticOutputSize(refiner, node, i);
+      if (size == 0) {
+        continue;
+      }
+      Lifetime lifetime;
+      lifetime.allocation.node_id = node->id();
+      lifetime.allocation.output = i;
+      lifetime.allocation.offset = 0;
+      lifetime.allocation.size = size;
+      lifetime.first_use = first_use;
+      lifetime.last_use = first_use;
+      lifetimes.push_back(lifetime);
+    }
+  }
+
+  // Extend the lifetimes to the last consumers.
+  std::unordered_map<int, std::vector<Lifetime*>> lifetimes_by_node;
+  for (Lifetime& lifetime : lifetimes) {
+    lifetimes_by_node[lifetime.allocation.node_id].push_back(&lifetime);
+  }
+  for (auto& node_lifetimes : lifetimes_by_node) {
+    const Node* node = graph.FindNodeId(node_lifetimes.first);
+    for (const Edge* edge : node->out_edges()) {
+      if (edge->IsControlEdge()) {
+        continue;
+      }
+      for (Lifetime* lifetime : node_lifetimes.second) {
+        if (lifetime->allocation.output == edge->src_output()) {
+          lifetime->last_use =
+              std::max(lifetime->last_use, position[edge->dst()->id()]);
+        }
+      }
+    }
+  }
+
+  std::sort(lifetimes.begin(), lifetimes.end(),
+            [](const Lifetime& a, const Lifetime& b) {
+              if (a.allocation.size != b.allocation.size) {
+                return a.allocation.size > b.allocation.size;
+              }
+              return a.first_use < b.first_use;
+            });
+
+  plan->arena_size = 0;
+  plan->allocations.clear();
+  std::vector<const Lifetime*> placed;
+  for (Lifetime& lifetime : lifetimes) {
+    std::vector<const Lifetime*> overlapping;
+    for (const Lifetime* other : placed) {
+      if (other->first_use <= lifetime.last_use &&
+          lifetime.first_use <= other->last_use) {
+        overlapping.push_back(other);
+      }
+    }
+    std::sort(overlapping.begin(), overlapping.end(),
+              [](const Lifetime* a, const Lifetime* b) {
+                return a->allocation.offset < b->allocation.offset;
+              });
+    // Look for the first gap large enough between the live allocations.
+    const size_t size = RoundUp(lifetime.allocation.size);
+    size_t offset = 0;
+    for (const Lifetime* other : overlapping) {
+      if (other->allocation.offset >= offset + size) {
+        break;
+      }
+      offset = std::max(offset, other->allocation.offset +
+                                    RoundUp(other->allocation.size));
+    }
+    lifetime.allocation.offset = offset;
+    plan->arena_size = std::max(plan->arena_size, offset + size);
+    placed.push_back(&lifetime);
+    plan->allocations.push_back(lifetime.allocation);
+  }
+  return Status::OK();
+}
+
+// Serves the allocations of one planned output.
+class PlannedArena::ChunkAllocator : public Allocator {
+ public:
+  ChunkAllocator(PlannedArena* arena, const PlannedAllocation& allocation)
+      : arena_(arena),
+        name_(strings::StrCat("planned_",
+                              arena->device_allocator_->Name())),
+        offset_(allocation.offset),
+        size_(allocation.size) {}
+
+  string Name() override { return name_; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return AllocateRaw(alignment, num_bytes, AllocationAttributes());
+  }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes,
+                    const AllocationAttributes& allocation_attr) override {
+    void* ptr = nullptr;
+    if (num_bytes <= size_ && alignment <= kAllocatorAlignment) {
+      ptr = arena_->Claim(offset_, num_bytes);
+    }
+    if (ptr == nullptr) {
+      ptr = arena_->device_allocator_->AllocateRaw(alignment, num_bytes,
+                                                    allocation_attr);
+      if (ptr == nullptr) {
+        return nullptr;
+      }
+    }
+    arena_->Ref();
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    // Releasing the reference of the allocation may delete this allocator.
+    PlannedArena* arena = arena_;
+    if (!arena->Release(ptr)) {
+      arena->device_allocator_->DeallocateRaw(ptr);
+    }
+    arena->Unref();
+  }
+
+ private:
+  PlannedArena* const arena_;
+  const string name_;
+  const size_t offset_;
+  const size_t size_;
+};
+
+PlannedArena* PlannedArena::Create(Allocator* device_allocator,
+                                   const MemoryPlan& plan) {
+  if (plan.arena_size == 0) {
+    return nullptr;
+  }
+  void* base = device_allocator->AllocateRaw(Allocator::kAllocatorAlignment,
+                                             plan.arena_size);
+  if (base == nullptr) {
+    LOG(WARNING) << "Unable to allocate a memory arena of " << plan.arena_size
+                 << " bytes";
+    return nullptr;
+  }
+  PlannedArena* arena = new PlannedArena(
+      device_allocator, static_cast<char*>(base), plan.arena_size);
+  for (const PlannedAllocation& allocation : plan.allocations) {
+    arena->allocators_.emplace_back(new ChunkAllocator(arena, allocation));
+  }
+  return arena;
+}
+
+PlannedArena::PlannedArena(Allocator* device_allocator, char* base,
+                           size_t size)
+    : device_allocator_(device_allocator), base_(base), size_(size) {}
+
+PlannedArena::~PlannedArena() {
+  DCHECK(in_use_.empty());
+  device_allocator_->DeallocateRaw(base_);
+}
+
+size_t PlannedArena::bytes_in_use() const {
+  mutex_lock l(mu_);
+  size_t bytes = 0;
+  for (const auto& allocation : in_use_) {
+    bytes += allocation.second;
+  }
+  return bytes;
+}
+
+void* PlannedArena::Claim(size_t offset, size_t num_bytes) {
+  // Empty allocations still get a distinct address.
+  const size_t size = std::max<size_t>(num_bytes, 1);
+  mutex_lock l(mu_);
+  // The allocation starting after 'offset', if any.
+  auto next = in_use_.lower_bound(offset);
+  if (next != in_use_.end() && next->first < offset + size) {
+    return nullptr;
+  }
+  if (next != in_use_.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second > offset) {
+      return nullptr;
+    }
+  }
+  in_use_.emplace(offset, size);
+  return base_ + offset;
+}
+
+bool PlannedArena::Release(void* ptr) {
+  char* p = static_cast<char*>(ptr);
+  if (p < base_ || p >= base_ + size_) {
+    return false;
+  }
+  mutex_lock l(mu_);
+  const size_t erased = in_use_.erase(p - base_);
+  DCHECK_EQ(erased, 1);
+  return true;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,117 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_MEMORY_PLANNER_H_
+#define TENSORFLOW_COMMON_RUNTIME_MEMORY_PLANNER_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// The place of a node output in the arena of a MemoryPlan.
+struct PlannedAllocation {
+  int node_id;
+  int output;
+  size_t offset;
+  size_t size;
+};
+
+// Offsets, in a single arena, of node outputs that are allocated every step.
+struct MemoryPlan {
+  size_t arena_size = 0;
+  std::vector<PlannedAllocation> allocations;
+};
+
+// Plans the offsets of the outputs of the nodes of 'graph' whose size is
+// known statically, so that two outputs that are alive at the same time
+// don't overlap.  Only the outputs for which 'include(node, output)' returns
+// true are planned.
+//
+// Lifetimes are derived from a reverse post order of the graph: an output is
+// alive from the step of its producer to the step of its last consumer.  The
+// outputs are then placed greedily, largest first, at the lowest offset that
+// doesn't overlap the outputs already placed with overlapping lifetimes.
+//
+// The sizes come from shape inference.  Nodes whose output shapes are only
+// known at run time, as well as nodes in cycles, are left out of the plan.
+Status PlanMemory(const Graph& graph,
+                  const std::function<bool(const Node*, int)>& include,
+                  MemoryPlan* plan);
+
+// A buffer preallocated from a device allocator in which the outputs of a
+// MemoryPlan live at their planned offsets.
+//
+// Since nodes don't necessarily run in the planned order, and since outputs
+// can be kept alive beyond their last consumer (e.g. when fetched), the
+// arena keeps track of the ranges in use: an allocation that would overlap
+// a live one is served by the device allocator instead.  Allocations whose
+// size exceeds the planned size are served by the device allocator as well.
+//
+// The arena is reference counted, and each allocation made through one of
+// its allocators holds a reference, so that tensors may outlive the owner of
+// the arena.
+class PlannedArena : public core::RefCounted {
+ public:
+  // Allocates an arena of plan.arena_size bytes from 'device_allocator', or
+  // returns nullptr if it fails.
+  static PlannedArena* Create(Allocator* device_allocator,
+                              const MemoryPlan& plan);
+
+  // Returns the allocator of the planned allocation 'index' of the plan the
+  // arena was created for.  Owned by the arena.
+  Allocator* allocator(int index) const { return allocators_[index].get(); }
+
+  // Returns the number of bytes of the arena currently in use.
+  size_t bytes_in_use() const;
+
+ private:
+  class ChunkAllocator;
+
+  PlannedArena(Allocator* device_allocator, char* base, size_t size);
+  ~PlannedArena() override;
+
+  // Returns the address of 'num_bytes' at 'offset' of the arena, or nullptr
+  // if they overlap an allocation in use.
+  void* Claim(size_t offset, size_t num_bytes);
+  // Releases the allocation at 'ptr' and returns true if 'ptr' is in the
+  // arena, returns false otherwise.
+  bool Release(void* ptr);
+
+  Allocator* const device_allocator_;  // Not owned.
+  char* const base_;
+  const size_t size_;
+  std::vector<std::unique_ptr<Allocator>> allocators_;
+
+  mutable mutex mu_;
+  // The allocations in use, as offset -> size.
+  std::map<size_t, size_t> in_use_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedArena);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_MEMORY_PLANNER_H_
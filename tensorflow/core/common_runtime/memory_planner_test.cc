@@ -0,0 +1,113 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+const PlannedAllocation* FindAllocation(const MemoryPlan& plan,
+                                        const Node* node) {
+  for (const PlannedAllocation& allocation : plan.allocations) {
+    if (allocation.node_id == node->id()) {
+      return &allocation;
+    }
+  }
+  return nullptr;
+}
+
+TEST(MemoryPlannerTest, ReusesMemoryOfDeadOutputs) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor v(DT_FLOAT, TensorShape({1024}));
+  v.flat<float>().setZero();
+  Node* a = test::graph::Constant(g, v);
+  Node* b = test::graph::Unary(g, "Neg", a);
+  Node* c = test::graph::Unary(g, "Neg", b);
+  Node* d = test::graph::Unary(g, "Neg", c);
+
+  MemoryPlan plan;
+  TF_EXPECT_OK(PlanMemory(
+      *g, [](const Node* n, int output) { return !n->IsConstant(); }, &plan));
+  ASSERT_EQ(3, plan.allocations.size());
+  const PlannedAllocation* b_alloc = FindAllocation(plan, b);
+  const PlannedAllocation* c_alloc = FindAllocation(plan, c);
+  const PlannedAllocation* d_alloc = FindAllocation(plan, d);
+  ASSERT_NE(nullptr, b_alloc);
+  ASSERT_NE(nullptr, c_alloc);
+  ASSERT_NE(nullptr, d_alloc);
+  EXPECT_EQ(4096, b_alloc->size);
+  // b is dead once c is computed, so d can take its place.
+  EXPECT_NE(b_alloc->offset, c_alloc->offset);
+  EXPECT_EQ(b_alloc->offset, d_alloc->offset);
+  EXPECT_EQ(8192, plan.arena_size);
+  delete g;
+}
+
+TEST(MemoryPlannerTest, SkipsDynamicShapes) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* a = test::graph::Recv(g, "a", "float", "sender", 0, "receiver");
+  test::graph::Unary(g, "Neg", a);
+
+  MemoryPlan plan;
+  TF_EXPECT_OK(PlanMemory(
+      *g, [](const Node* n, int output) { return true; }, &plan));
+  EXPECT_EQ(0, plan.allocations.size());
+  EXPECT_EQ(0, plan.arena_size);
+  delete g;
+}
+
+TEST(PlannedArenaTest, FallsBackOnOverlap) {
+  MemoryPlan plan;
+  plan.arena_size = 128;
+  plan.allocations.push_back({2, 0, 0, 64});
+  plan.allocations.push_back({3, 0, 0, 64});
+  PlannedArena* arena = PlannedArena::Create(cpu_allocator(), plan);
+  ASSERT_NE(nullptr, arena);
+
+  void* first = arena->allocator(0)->AllocateRaw(32, 64);
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(64, arena->bytes_in_use());
+  // The second allocation overlaps the first one, which is still in use.
+  void* second = arena->allocator(1)->AllocateRaw(32, 64);
+  ASSERT_NE(nullptr, second);
+  EXPECT_EQ(64, arena->bytes_in_use());
+  // Allocations larger than planned don't use the arena.
+  void* large = arena->allocator(0)->AllocateRaw(32, 256);
+  ASSERT_NE(nullptr, large);
+  EXPECT_EQ(64, arena->bytes_in_use());
+
+  arena->allocator(0)->DeallocateRaw(large);
+  arena->allocator(1)->DeallocateRaw(second);
+  arena->allocator(0)->DeallocateRaw(first);
+  EXPECT_EQ(0, arena->bytes_in_use());
+
+  // Once released, the memory is available for the other allocation.
+  second = arena->allocator(1)->AllocateRaw(32, 64);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(64, arena->bytes_in_use());
+
+  // The allocation keeps the arena alive.
+  Allocator* allocator = arena->allocator(1);
+  arena->Unref();
+  allocator->DeallocateRaw(second);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -616,7 +616,13 @@ Status OpKernelContext::allocate_output(StringPiece name,
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+  return allocate_tensor(get_allocator(attr), type, shape, out_tensor,
+                         allocation_attr);
+}
+
+Status OpKernelContext::allocate_tensor(
+    Allocator* a, DataType type, const TensorShape& shape, Tensor* out_tensor,
+    const AllocationAttributes& allocation_attr) {
   AllocationAttributes logged_attr(allocation_attr);
   logged_attr.allocation_will_be_logged = true;
   Tensor new_tensor(a, type, shape, logged_attr);
@@ -643,7 +649,20 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
   DCHECK(!IsRefType(type));
   DCHECK(mutable_output(index) == nullptr);
   Tensor* output_tensor = new Tensor();
-  Status s = allocate_tensor(type, shape, output_tensor, attr);
+  Allocator* planned_allocator =
+      params_->output_allocator_array == nullptr
+          ? nullptr
+          : params_->output_allocator_array[index];
+  Status s;
+  // The planned allocators don't track allocations, and only apply to the
+  // outputs allocated as planned.
+  if (planned_allocator != nullptr && !track_allocations() &&
+      attr.value == output_alloc_attr(index).value) {
+    s = allocate_tensor(planned_allocator, type, shape, output_tensor,
+                        AllocationAttributes());
+  } else {
+    s = allocate_tensor(type, shape, output_tensor, attr);
+  }
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor);
     *output = outputs_[index].tensor;
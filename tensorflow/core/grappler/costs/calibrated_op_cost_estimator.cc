@@ -0,0 +1,182 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/calibrated_op_cost_estimator.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/grappler/costs/robust_stats.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Returns the key under which the ratios of the measured to the analytical
+// costs of 'op_info' are recorded.
+string RatioKey(const OpInfo& op_info) {
+  return strings::StrCat(op_info.op(), "@", op_info.device().type());
+}
+
+// Returns the key under which the run times of 'op_info' are recorded: two
+// ops have the same signature when they run the same computation on the same
+// kind of device.
+string Signature(const OpInfo& op_info) {
+  string signature = RatioKey(op_info);
+  for (const auto& input : op_info.inputs()) {
+    strings::StrAppend(&signature, ";", DataTypeString(input.dtype()), "[");
+    if (input.shape().unknown_rank()) {
+      strings::StrAppend(&signature, "?");
+    }
+    for (const auto& dim : input.shape().dim()) {
+      strings::StrAppend(&signature, dim.size(), ",");
+    }
+    strings::StrAppend(&signature, "]");
+  }
+  std::vector<string> attr_names;
+  for (const auto& attr : op_info.attr()) {
+    // Skip the internal attributes, such as _class or _output_shapes, which
+    // don't change the computation.
+    if (attr.first.empty() || attr.first[0] == '_') {
+      continue;
+    }
+    attr_names.push_back(attr.first);
+  }
+  std::sort(attr_names.begin(), attr_names.end());
+  for (const string& name : attr_names) {
+    strings::StrAppend(&signature, ";", name, "=",
+                       SummarizeAttrValue(op_info.attr().at(name)));
+  }
+  return signature;
+}
+
+}  // namespace
+
+void CalibratedOpCostEstimator::UpdateStats(Samples* samples) {
+  RobustStats stats(samples->values);
+  samples->mean = stats.mean();
+  samples->lo = stats.lo();
+  samples->hi = stats.hi();
+}
+
+void CalibratedOpCostEstimator::AddMeasurements(
+    const OpPerformanceList& performance) {
+  std::unordered_set<Samples*> updated;
+  for (const auto& perf : performance.op_performance()) {
+    if (perf.compute_cost() <= 0) {
+      continue;
+    }
+    const OpInfo& op_info = perf.op();
+    Samples* measured = &measured_[Signature(op_info)];
+    measured->values.push_back(perf.compute_cost());
+    updated.insert(measured);
+
+    const Costs analytical = OpLevelCostEstimator::PredictCosts(op_info);
+    if (!analytical.inaccurate && analytical.execution_time.count() > 0) {
+      Samples* ratios = &ratios_[RatioKey(op_info)];
+      ratios->values.push_back(static_cast<double>(perf.compute_cost()) /
+                               analytical.execution_time.count());
+      updated.insert(ratios);
+    }
+  }
+  // Pointers to the elements of an unordered_map stay valid on insertion.
+  for (Samples* samples : updated) {
+    UpdateStats(samples);
+  }
+}
+
+Status CalibratedOpCostEstimator::AddRunMetadata(
+    const GraphDef& graph, const RunMetadata& run_metadata) {
+  if (run_metadata.cost_graph().node_size() == 0) {
+    return errors::InvalidArgument(
+        "The run metadata doesn't contain a cost graph");
+  }
+  OpPerformanceList performance =
+      CostGraphToOpPerformanceData(run_metadata.cost_graph(), graph);
+
+  // The cost graph only keeps the last run of each node, so use the step
+  // stats, which have them all, when available.
+  std::unordered_map<string, std::vector<int64>> run_times;
+  for (const auto& device_stats : run_metadata.step_stats().dev_stats()) {
+    for (const auto& node_stats : device_stats.node_stats()) {
+      const int64 duration =
+          node_stats.op_end_rel_micros() - node_stats.op_start_rel_micros();
+      if (duration > 0) {
+        run_times[node_stats.node_name()].push_back(duration * 1000);
+      }
+    }
+  }
+
+  OpPerformanceList measurements;
+  for (const auto& perf : performance.op_performance()) {
+    auto it = run_times.find(perf.node());
+    if (it == run_times.end()) {
+      *measurements.add_op_performance() = perf;
+      continue;
+    }
+    for (int64 run_time : it->second) {
+      OpPerformance* measurement = measurements.add_op_performance();
+      *measurement = perf;
+      measurement->set_compute_cost(run_time);
+    }
+  }
+  AddMeasurements(measurements);
+  return Status::OK();
+}
+
+Costs CalibratedOpCostEstimator::PredictCosts(
+    const OpInfo& op_features) const {
+  auto it = measured_.find(Signature(op_features));
+  if (it != measured_.end()) {
+    const Samples& samples = it->second;
+    Costs costs;
+    costs.execution_time = Costs::NanoSeconds(samples.mean);
+    costs.min_execution_time = Costs::NanoSeconds(samples.lo);
+    costs.max_execution_time = Costs::NanoSeconds(samples.hi);
+    costs.compute_time = costs.execution_time;
+    costs.memory_time = Costs::Duration::zero();
+    costs.inaccurate = false;
+    VLOG(1) << "Operation " << op_features.op() << " was measured to take "
+            << costs.execution_time.count() << " ns.";
+    return costs;
+  }
+
+  Costs costs = OpLevelCostEstimator::PredictCosts(op_features);
+  auto ratio = ratios_.find(RatioKey(op_features));
+  if (ratio == ratios_.end() || costs.inaccurate) {
+    return costs;
+  }
+  const Samples& samples = ratio->second;
+  const double execution_time = costs.execution_time.count();
+  costs.execution_time = Costs::NanoSeconds(execution_time * samples.mean);
+  costs.min_execution_time = Costs::NanoSeconds(execution_time * samples.lo);
+  costs.max_execution_time = Costs::NanoSeconds(execution_time * samples.hi);
+  costs.compute_time =
+      Costs::NanoSeconds(costs.compute_time.count() * samples.mean);
+  costs.memory_time =
+      Costs::NanoSeconds(costs.memory_time.count() * samples.mean);
+  return costs;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,87 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_CALIBRATED_OP_COST_ESTIMATOR_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_CALIBRATED_OP_COST_ESTIMATOR_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+class GraphDef;
+class RunMetadata;
+}  // namespace tensorflow
+
+namespace tensorflow {
+namespace grappler {
+
+// Predicts the cost of ops from the run times measured in earlier runs of
+// the same ops, on the same kind of device and with the same input shapes
+// and attributes.  Samples are aggregated with RobustStats so that a few slow
+// runs don't skew the prediction.
+//
+// Ops that haven't been measured with the same signature fall back to the
+// analytical estimate of OpLevelCostEstimator, scaled by the robust mean of
+// the ratios between the measured and analytical costs of the same op on the
+// same kind of device.
+//
+// Can be passed to AnalyticalCostEstimator to drive the VirtualScheduler.
+// The measurements must all be added before the estimator is used for
+// predictions.
+class CalibratedOpCostEstimator : public OpLevelCostEstimator {
+ public:
+  CalibratedOpCostEstimator() {}
+  ~CalibratedOpCostEstimator() override {}
+
+  // Adds the compute cost of each entry of 'performance' as a sample.
+  void AddMeasurements(const OpPerformanceList& performance);
+
+  // Adds a sample for each node of 'graph' that ran in the step described by
+  // 'run_metadata', which must have been collected with full tracing so that
+  // it holds a cost graph.  The durations come from the step stats if
+  // present, and from the cost graph otherwise.
+  Status AddRunMetadata(const GraphDef& graph, const RunMetadata& run_metadata);
+
+  Costs PredictCosts(const OpInfo& op_features) const override;
+
+  // Returns the number of distinct op signatures that were measured.
+  int num_measured_ops() const { return measured_.size(); }
+
+ private:
+  struct Samples {
+    std::vector<double> values;
+    // RobustStats of the values.
+    double mean = 0;
+    double lo = 0;
+    double hi = 0;
+  };
+
+  // Recomputes the statistics of 'samples' from its values.
+  static void UpdateStats(Samples* samples);
+
+  // Run times in nanoseconds, by op signature.
+  std::unordered_map<string, Samples> measured_;
+  // Ratios of the measured to the analytical costs, by op and device type.
+  std::unordered_map<string, Samples> ratios_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_CALIBRATED_OP_COST_ESTIMATOR_H_
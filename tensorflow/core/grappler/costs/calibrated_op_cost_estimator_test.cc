@@ -0,0 +1,124 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/calibrated_op_cost_estimator.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/device_properties.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+// Returns an OpInfo for a MatMul of a m x l matrix by a l x n matrix on CPU.
+OpInfo DescribeMatMul(int m, int l, int n) {
+  OpInfo op_features;
+  op_features.set_op("MatMul");
+  auto device = op_features.mutable_device();
+  device->set_type("CPU");
+  device->set_num_cores(10);
+  device->set_bandwidth(10000000);  // 10000000 KB/s = 10 GB/s
+  device->set_frequency(1000);      // 1000 Mhz = 1 GHz
+
+  for (const auto& dims : {std::make_pair(m, l), std::make_pair(l, n)}) {
+    auto input = op_features.add_inputs();
+    input->set_dtype(DT_FLOAT);
+    input->mutable_shape()->add_dim()->set_size(dims.first);
+    input->mutable_shape()->add_dim()->set_size(dims.second);
+  }
+  return op_features;
+}
+
+void AddMeasurement(const OpInfo& op_features, int64 compute_cost,
+                    OpPerformanceList* performance) {
+  OpPerformance* perf = performance->add_op_performance();
+  *perf->mutable_op() = op_features;
+  perf->set_compute_cost(compute_cost);
+}
+}  // namespace
+
+class CalibratedOpCostEstimatorTest : public ::testing::Test {
+ protected:
+  Costs PredictCosts(const OpInfo& op_features) const {
+    return estimator_.PredictCosts(op_features);
+  }
+
+  CalibratedOpCostEstimator estimator_;
+};
+
+TEST_F(CalibratedOpCostEstimatorTest, UsesMeasuredCosts) {
+  const OpInfo matmul = DescribeMatMul(100, 100, 100);
+  OpPerformanceList performance;
+  for (int64 cost : {10000, 10200, 9800, 10100, 9900, 500000}) {
+    AddMeasurement(matmul, cost, &performance);
+  }
+  estimator_.AddMeasurements(performance);
+  EXPECT_EQ(1, estimator_.num_measured_ops());
+
+  // The outlier barely moves the prediction.
+  Costs costs = PredictCosts(matmul);
+  EXPECT_FALSE(costs.inaccurate);
+  EXPECT_NEAR(10000, costs.execution_time.count(), 500);
+  EXPECT_EQ(costs.execution_time, costs.compute_time);
+  EXPECT_LE(costs.min_execution_time, costs.execution_time);
+  EXPECT_GE(costs.max_execution_time, costs.execution_time);
+}
+
+TEST_F(CalibratedOpCostEstimatorTest, ScalesAnalyticalCosts) {
+  const OpInfo measured = DescribeMatMul(100, 100, 100);
+  const OpInfo unmeasured = DescribeMatMul(200, 200, 200);
+  const Costs analytical = PredictCosts(unmeasured);
+  const int64 analytical_cost = PredictCosts(measured).execution_time.count();
+  ASSERT_GT(analytical_cost, 0);
+
+  // The measured MatMul runs 3 times slower than the analytical estimate.
+  OpPerformanceList performance;
+  AddMeasurement(measured, 3 * analytical_cost, &performance);
+  estimator_.AddMeasurements(performance);
+
+  Costs costs = PredictCosts(unmeasured);
+  EXPECT_FALSE(costs.inaccurate);
+  EXPECT_NEAR(3 * analytical.execution_time.count(),
+              costs.execution_time.count(), 1);
+  EXPECT_NEAR(3 * analytical.compute_time.count(), costs.compute_time.count(),
+              1);
+}
+
+TEST_F(CalibratedOpCostEstimatorTest, FallsBackToAnalyticalCosts) {
+  OpPerformanceList performance;
+  AddMeasurement(DescribeMatMul(100, 100, 100), 1000000, &performance);
+  estimator_.AddMeasurements(performance);
+
+  // Other ops aren't affected by the MatMul measurements.
+  OpInfo relu = DescribeMatMul(100, 100, 100);
+  relu.set_op("Relu");
+  relu.mutable_inputs()->RemoveLast();
+  OpLevelCostEstimator analytical_estimator;
+  EXPECT_EQ(analytical_estimator.PredictCosts(relu).execution_time,
+            PredictCosts(relu).execution_time);
+}
+
+TEST_F(CalibratedOpCostEstimatorTest, RequiresCostGraph) {
+  GraphDef graph;
+  RunMetadata run_metadata;
+  EXPECT_FALSE(estimator_.AddRunMetadata(graph, run_metadata).ok());
+  EXPECT_EQ(0, estimator_.num_measured_ops());
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -15,10 +15,16 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/costs/graph_memory.h"
 
+#include <deque>
+#include <unordered_map>
+
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -52,6 +58,8 @@ Status GraphMemory::InferFromGraphProperties(GraphProperties* properties) {
   best_case_memory_usage_ =
       std::max(best_case_init_mem_usage, best_case_main_mem_usage);
 
+  InferPeakMemUsageForNodes(item_.MainOpsFanin(), properties, &peak_usage_);
+
   return Status::OK();
 }
 
@@ -82,28 +90,163 @@ void GraphMemory::InferMemUsageForNodes(
   }
 }
 
+void GraphMemory::InferPeakMemUsageForNodes(
+    const std::vector<const NodeDef*>& nodes, GraphProperties* properties,
+    MemoryUsage* peak_usage) const {
+  std::unordered_map<string, const NodeDef*> name_to_node;
+  for (const NodeDef* node : nodes) {
+    name_to_node[node->name()] = node;
+  }
+
+  // Count the inputs each node waits for and the consumers of each tensor.
+  std::unordered_map<const NodeDef*, int> num_pending_inputs;
+  std::unordered_map<string, std::vector<const NodeDef*>> fanouts;
+  std::unordered_map<string, std::vector<const NodeDef*>> consumers;
+  for (const NodeDef* node : nodes) {
+    int& num_pending = num_pending_inputs[node];
+    for (const string& input : node->input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      auto it = name_to_node.find(input_name);
+      // Ignore the back edges of loops, which would never be ready.
+      if (it == name_to_node.end() || IsNextIteration(*it->second)) {
+        continue;
+      }
+      ++num_pending;
+      fanouts[input_name].push_back(node);
+      if (position >= 0) {
+        consumers[strings::StrCat(input_name, ":", position)].push_back(node);
+      }
+    }
+  }
+
+  // Run the nodes one at a time, in the order in which they become ready.
+  std::deque<const NodeDef*> ready;
+  for (const NodeDef* node : nodes) {
+    if (num_pending_inputs[node] == 0) {
+      ready.push_back(node);
+    }
+  }
+  std::unordered_map<const NodeDef*, int> steps;
+  std::vector<const NodeDef*> schedule;
+  std::unordered_map<string, int64> live_tensors;
+  std::unordered_map<string, int> num_pending_consumers;
+  int64 used_memory = 0;
+  int peak_step = -1;
+  peak_usage->used_memory = 0;
+  while (!ready.empty()) {
+    const NodeDef* node = ready.front();
+    ready.pop_front();
+    const int step = schedule.size();
+    steps[node] = step;
+    schedule.push_back(node);
+
+    const std::vector<OpInfo::TensorProperties> outputs =
+        properties->GetOutputProperties(node->name());
+    for (int i = 0; i < outputs.size(); ++i) {
+      const string tensor = strings::StrCat(node->name(), ":", i);
+      const int64 size = InferMemUsageForTensor(outputs[i]);
+      live_tensors[tensor] = size;
+      num_pending_consumers[tensor] = consumers[tensor].size();
+      used_memory += size;
+    }
+    if (used_memory > peak_usage->used_memory) {
+      peak_usage->used_memory = used_memory;
+      peak_step = step;
+    }
+
+    // Free the tensors that won't be read anymore.
+    for (const string& input : node->input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      const string tensor = strings::StrCat(input_name, ":", position);
+      if (position < 0 || live_tensors.count(tensor) == 0) {
+        continue;
+      }
+      if (--num_pending_consumers[tensor] == 0) {
+        used_memory -= live_tensors[tensor];
+        live_tensors.erase(tensor);
+      }
+    }
+    for (int i = 0; i < outputs.size(); ++i) {
+      const string tensor = strings::StrCat(node->name(), ":", i);
+      if (num_pending_consumers[tensor] == 0) {
+        used_memory -= live_tensors[tensor];
+        live_tensors.erase(tensor);
+      }
+    }
+
+    for (const NodeDef* fanout : fanouts[node->name()]) {
+      if (--num_pending_inputs[fanout] == 0) {
+        ready.push_back(fanout);
+      }
+    }
+  }
+
+  peak_usage->peak_node.clear();
+  peak_usage->live_tensors.clear();
+  if (peak_step < 0) {
+    return;
+  }
+  peak_usage->peak_node = schedule[peak_step]->name();
+
+  // A tensor is alive at the peak if it was produced by then and is still
+  // needed, or if it was produced by the peak node itself.
+  for (int step = 0; step <= peak_step; ++step) {
+    const NodeDef* node = schedule[step];
+    const std::vector<OpInfo::TensorProperties> outputs =
+        properties->GetOutputProperties(node->name());
+    for (int i = 0; i < outputs.size(); ++i) {
+      LiveTensor live;
+      live.node = node->name();
+      live.output_id = i;
+      live.memory_used = InferMemUsageForTensor(outputs[i]);
+      bool alive = step == peak_step;
+      for (const NodeDef* consumer :
+           consumers[strings::StrCat(node->name(), ":", i)]) {
+        auto it = steps.find(consumer);
+        // Consumers that never ran keep the tensor alive until the end.
+        if (it == steps.end() || it->second >= peak_step) {
+          alive = true;
+        }
+        if (it == steps.end() || it->second > peak_step) {
+          live.pending_consumers.push_back(consumer->name());
+        }
+      }
+      if (alive) {
+        peak_usage->live_tensors.push_back(live);
+      }
+    }
+  }
+}
+
 int64 GraphMemory::InferMemUsageForNeighbors(
     const std::vector<OpInfo::TensorProperties>& props) const {
   int64 neighbors_memory_usage = 0;
   for (const auto& prop : props) {
-    DataType dtype = prop.dtype();
-    int size = DataTypeSize(dtype);
-    TensorShapeProto shape = prop.shape();
-    if (shape.unknown_rank()) {
-      // Can't infer the size if the rank is unknown, just skip.
-      continue;
-    }
-    // If one of the dimensions is unknown statically, assume it's one.
-    for (int i = 0; i < shape.dim_size(); ++i) {
-      if (shape.dim(i).size() < 0) {
-        shape.mutable_dim(i)->set_size(1);
-      }
-    }
-    int num_elems = TensorShape(shape).num_elements();
-    neighbors_memory_usage += num_elems * size;
+    neighbors_memory_usage += InferMemUsageForTensor(prop);
   }
   return neighbors_memory_usage;
 }
 
+int64 GraphMemory::InferMemUsageForTensor(
+    const OpInfo::TensorProperties& prop) const {
+  DataType dtype = prop.dtype();
+  int size = DataTypeSize(dtype);
+  TensorShapeProto shape = prop.shape();
+  if (shape.unknown_rank()) {
+    // Can't infer the size if the rank is unknown, just skip.
+    return 0;
+  }
+  // If one of the dimensions is unknown statically, assume it's one.
+  for (int i = 0; i < shape.dim_size(); ++i) {
+    if (shape.dim(i).size() < 0) {
+      shape.mutable_dim(i)->set_size(1);
+    }
+  }
+  int64 num_elems = TensorShape(shape).num_elements();
+  return num_elems * size;
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_GRAPPLER_COSTS_GRAPH_MEMORY_H_
 #define TENSORFLOW_GRAPPLER_COSTS_GRAPH_MEMORY_H_
 
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
@@ -42,17 +45,43 @@ class GraphMemory {
   // that which is needed for a single node to perform its computations.
   int64 GetBestCaseMemoryUsage() const { return best_case_memory_usage_; }
 
+  struct LiveTensor {
+    string node;
+    int output_id;
+    int64 memory_used;
+    // The consumers of the tensor that run after the peak.
+    std::vector<string> pending_consumers;
+  };
+  struct MemoryUsage {
+    int64 used_memory = -1;
+    // The node running when the peak is reached.
+    string peak_node;
+    // The tensors alive at the peak, including the inputs and outputs of
+    // peak_node.
+    std::vector<LiveTensor> live_tensors;
+  };
+
+  // Peak memory usage of the main ops when they run one at a time in
+  // topological order and every tensor is freed as soon as all its consumers
+  // ran. The used memory is -1 if the usage is unknown.
+  const MemoryUsage& GetPeakMemoryUsage() const { return peak_usage_; }
+
  private:
   void InferMemUsageForNodes(const std::vector<const NodeDef*>& nodes,
                              GraphProperties* properties, int64* worst_case,
                              int64* best_case) const;
+  void InferPeakMemUsageForNodes(const std::vector<const NodeDef*>& nodes,
+                                 GraphProperties* properties,
+                                 MemoryUsage* peak_usage) const;
   int64 InferMemUsageForNeighbors(
       const std::vector<OpInfo::TensorProperties>& props) const;
+  int64 InferMemUsageForTensor(const OpInfo::TensorProperties& prop) const;
 
   // Inputs
   GrapplerItem item_;
   int64 worst_case_memory_usage_;
   int64 best_case_memory_usage_;
+  MemoryUsage peak_usage_;
 };
 
 }  // end namespace grappler
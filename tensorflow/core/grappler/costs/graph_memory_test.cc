@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/grappler/costs/graph_memory.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
 #include "tensorflow/core/platform/test.h"
@@ -54,6 +56,39 @@ TEST_F(GraphMemoryTest, UnknownBatchSize) {
   EXPECT_EQ(12, memory.GetBestCaseMemoryUsage());
 }
 
+TEST_F(GraphMemoryTest, PeakMemoryUsage) {
+  using test::function::NDef;
+  GrapplerItem item;
+  item.graph = test::function::GDef({
+      NDef("a", "Const", {},
+           {{"dtype", DT_FLOAT},
+            {"value", test::AsTensor<float>(std::vector<float>(100), {100})}}),
+      NDef("b", "Neg", {"a"}, {{"T", DT_FLOAT}}),
+      NDef("c", "Neg", {"b"}, {{"T", DT_FLOAT}}),
+      NDef("d", "Neg", {"c"}, {{"T", DT_FLOAT}}),
+      NDef("e", "Add", {"b", "d"}, {{"T", DT_FLOAT}}),
+  });
+  item.fetch.push_back("e");
+
+  GraphMemory memory(item);
+  Status s = memory.InferStatically();
+  TF_CHECK_OK(s);
+  // The peak is reached when d runs: b, c and d are all alive.
+  const GraphMemory::MemoryUsage& peak = memory.GetPeakMemoryUsage();
+  EXPECT_EQ(1200, peak.used_memory);
+  EXPECT_EQ("d", peak.peak_node);
+  ASSERT_EQ(3, peak.live_tensors.size());
+  EXPECT_EQ("b", peak.live_tensors[0].node);
+  EXPECT_EQ(0, peak.live_tensors[0].output_id);
+  EXPECT_EQ(400, peak.live_tensors[0].memory_used);
+  ASSERT_EQ(1, peak.live_tensors[0].pending_consumers.size());
+  EXPECT_EQ("e", peak.live_tensors[0].pending_consumers[0]);
+  // c is read by the peak node.
+  EXPECT_EQ("c", peak.live_tensors[1].node);
+  EXPECT_TRUE(peak.live_tensors[1].pending_consumers.empty());
+  EXPECT_EQ("d", peak.live_tensors[2].node);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -34,6 +34,7 @@ constexpr char kIdentity[] = "Identity";
 constexpr char kNoOp[] = "NoOp";
 constexpr char kReshape[] = "Reshape";
 constexpr char kRecv[] = "_Recv";
+constexpr char kSend[] = "_Send";
 constexpr char kBatchMatMul[] = "BatchMatMul";
 constexpr char kVariable[] = "Variable";
 constexpr char kVariableV2[] = "VariableV2";
@@ -158,6 +159,7 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
       {kNoOp, wrap(&OpLevelCostEstimator::PredictNoOp)},
       {kReshape, wrap(&OpLevelCostEstimator::PredictNoOp)},
       {kRecv, wrap(&OpLevelCostEstimator::PredictNoOp)},
+      {kSend, wrap(&OpLevelCostEstimator::PredictTransfer)},
       {kVariable, wrap(&OpLevelCostEstimator::PredictNoOp)},
       {kVariableV2, wrap(&OpLevelCostEstimator::PredictNoOp)},
       {kBatchMatMul, wrap(&OpLevelCostEstimator::PredictBatchMatMul)},
@@ -842,6 +844,30 @@ Costs OpLevelCostEstimator::PredictNoOp(const OpInfo& op_features) const {
   return Costs::ZeroCosts();
 }
 
+Costs OpLevelCostEstimator::PredictTransfer(const OpInfo& op_features) const {
+  // The device of a _Send is the channel between the two devices, see
+  // GetChannelProperties().
+  bool found_unknown_shapes = false;
+  const double total_input_size =
+      CalculateInputSize(op_features, &found_unknown_shapes);
+  const double bandwidth = op_features.device().bandwidth() / 1e6;  // GB/s
+  if (bandwidth <= 0) {
+    Costs costs = Costs::ZeroCosts();
+    costs.inaccurate = true;
+    return costs;
+  }
+  Costs costs;
+  costs.compute_time = Costs::Duration::zero();
+  costs.memory_time =
+      Costs::NanoSeconds(std::ceil(total_input_size / bandwidth));
+  costs.execution_time = costs.memory_time;
+  costs.inaccurate = found_unknown_shapes;
+  VLOG(1) << "Op:" << op_features.op()
+          << " Size (KB):" << total_input_size / 1e3
+          << " Transfer Time (ns):" << costs.execution_time.count();
+  return costs;
+}
+
 Costs OpLevelCostEstimator::PredictBatchMatMul(
     const OpInfo& op_features) const {
   bool found_unknown_shapes = false;
@@ -130,6 +130,7 @@ class OpLevelCostEstimator {
   Costs PredictNoOp(const OpInfo& op_features) const;
   Costs PredictBatchMatMul(const OpInfo& op_features) const;
   Costs PredictMetadata(const OpInfo& op_features) const;
+  Costs PredictTransfer(const OpInfo& op_features) const;
 
   // Utility function for safe division. Returns 0
   // if rhs is 0 or negative.
@@ -232,5 +232,20 @@ TEST_F(OpLevelCostEstimatorTest, BatchMatMul) {
   EXPECT_NE(matmul_inaccurate, batch_matmul_inaccurate);
 }
 
+TEST_F(OpLevelCostEstimatorTest, TransferExecutionTime) {
+  OpInfo op_features;
+  op_features.set_op("_Send");
+  op_features.mutable_device()->set_type("Channel");
+  op_features.mutable_device()->set_bandwidth(1000000);  // 1 GB/s
+  DescribeMatrix(1000, 1000, &op_features);
+
+  // 4 MB at 1 GB/s.
+  auto cost = PredictCosts(op_features);
+  EXPECT_EQ(Costs::Duration(4000000), cost.memory_time);
+  EXPECT_EQ(Costs::Duration(0), cost.compute_time);
+  EXPECT_EQ(Costs::Duration(4000000), cost.execution_time);
+  EXPECT_FALSE(cost.inaccurate);
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/costs/utils.h"
 
 #include <stddef.h>
+#include <algorithm>
 #include <utility>
 
 #include "third_party/eigen3/Eigen/Core"
@@ -202,6 +203,30 @@ DeviceProperties GetDeviceInfo(const CostGraphDef::Node& node) {
   return GetDeviceInfo(node.device());
 }
 
+DeviceProperties GetChannelProperties(const string& src_name,
+                                      const DeviceProperties& src,
+                                      const string& dst_name,
+                                      const DeviceProperties& dst) {
+  // Bandwidths in KB/s.
+  const int64 kDefaultLocalBandwidth = 32 * 1000 * 1000;  // 32 GB/s
+  const int64 kNetworkBandwidth = 1250 * 1000;            // 10 Gb/s
+
+  DeviceProperties channel;
+  channel.set_type("Channel");
+  if (!DeviceNameUtils::IsSameAddressSpace(src_name, dst_name)) {
+    channel.set_bandwidth(kNetworkBandwidth);
+    return channel;
+  }
+  int64 bandwidth = kDefaultLocalBandwidth;
+  for (int64 device_bandwidth : {src.bandwidth(), dst.bandwidth()}) {
+    if (device_bandwidth > 0) {
+      bandwidth = std::min(bandwidth, device_bandwidth);
+    }
+  }
+  channel.set_bandwidth(bandwidth);
+  return channel;
+}
+
 OpInfo BuildOpInfoWithoutDevice(
     const NodeDef& node,
     const std::unordered_map<string, const NodeDef*>& name_to_node,
@@ -46,6 +46,15 @@ std::vector<OpInfo::TensorProperties> FindInputFeatures(
 DeviceProperties GetDeviceInfo(const CostGraphDef::Node& node);
 DeviceProperties GetDeviceInfo(const string& device_str);
 
+// Returns the properties of the channel through which the tensors produced on
+// the device 'src_name' are sent to the device 'dst_name'. Transfers within a
+// task are bounded by the bandwidth of the slowest of the two devices,
+// transfers between tasks by the bandwidth of the network.
+DeviceProperties GetChannelProperties(const string& src_name,
+                                      const DeviceProperties& src,
+                                      const string& dst_name,
+                                      const DeviceProperties& dst);
+
 // Return a string describing a node given a nodeinfo.
 string GetOpDescription(const OpInfo& op_info);
 
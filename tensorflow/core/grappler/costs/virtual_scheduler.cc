@@ -317,8 +317,19 @@ NodeInfo VirtualScheduler::GetCurrNodeInfo() const {
   DeviceProperties device;
   device = placer_.get_device(*node);
 
-  // Special case for _Send op.
+  // Special case for _Send op: it runs on the channel between the devices.
   if (IsSend(*node)) {
+    const auto& attr = node->attr();
+    if (attr.count(kAttrSrcDevice) > 0 && attr.count(kAttrDstDevice) > 0) {
+      const string& src_name = attr.at(kAttrSrcDevice).s();
+      const string& dst_name = attr.at(kAttrDstDevice).s();
+      NodeDef src;
+      src.set_device(src_name);
+      NodeDef dst;
+      dst.set_device(dst_name);
+      device = GetChannelProperties(src_name, placer_.get_device(src),
+                                    dst_name, placer_.get_device(dst));
+    }
     device.set_type(kChannelDevice);
   }
 
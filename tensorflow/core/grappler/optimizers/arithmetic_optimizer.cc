@@ -0,0 +1,630 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
+#include <algorithm>
+#include <vector>
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Computes an order in which every node comes after its inputs, ignoring the
+// back edges of loops.  Returns false if there is no such order.
+bool TopologicalOrder(const GraphDef& graph, std::vector<int>* order) {
+  std::unordered_map<string, int> index;
+  for (int i = 0; i < graph.node_size(); ++i) {
+    index[graph.node(i).name()] = i;
+  }
+  std::vector<int> num_pending(graph.node_size(), 0);
+  std::vector<std::vector<int>> fanouts(graph.node_size());
+  for (int i = 0; i < graph.node_size(); ++i) {
+    const NodeDef& node = graph.node(i);
+    for (const string& input : node.input()) {
+      auto it = index.find(NodeName(input));
+      if (it == index.end()) {
+        return false;
+      }
+      if (IsMerge(node) && IsNextIteration(graph.node(it->second))) {
+        continue;
+      }
+      ++num_pending[i];
+      fanouts[it->second].push_back(i);
+    }
+  }
+  order->clear();
+  for (int i = 0; i < graph.node_size(); ++i) {
+    if (num_pending[i] == 0) {
+      order->push_back(i);
+    }
+  }
+  for (size_t i = 0; i < order->size(); ++i) {
+    for (int fanout : fanouts[(*order)[i]]) {
+      if (--num_pending[fanout] == 0) {
+        order->push_back(fanout);
+      }
+    }
+  }
+  return order->size() == static_cast<size_t>(graph.node_size());
+}
+
+// Adds a control dependency on 'node_name' to 'node' if it doesn't have it
+// yet.
+void AddControlInput(const string& node_name, NodeDef* node) {
+  const string control_input = OutputName(node_name, -1);
+  for (const string& input : node->input()) {
+    if (input == control_input) {
+      return;
+    }
+  }
+  node->add_input(control_input);
+}
+
+bool IsCommutative(const NodeDef& node) {
+  const auto& op = node.op();
+  if (op != "Add" && op != "AddN" && op != "Equal" && op != "LogicalAnd" &&
+      op != "LogicalOr" && op != "Maximum" && op != "Minimum" && op != "Mul" &&
+      op != "NotEqual" && op != "SquaredDifference") {
+    return false;
+  }
+  // Adding strings concatenates them.
+  auto type = node.attr().find("T");
+  return type == node.attr().end() || type->second.type() != DT_STRING;
+}
+
+// Returns true if 'node' has no side effects, and two nodes with the same op,
+// attributes and inputs as 'node' always compute the same value.
+bool IsDedupable(const NodeDef& node) {
+  if (IsEnter(node) || IsExit(node) || IsLoopCond(node) || IsMerge(node) ||
+      IsNextIteration(node) || IsSwitch(node) || IsPlaceholder(node) ||
+      IsRecv(node) || IsSend(node)) {
+    return false;
+  }
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok()) {
+    return false;
+  }
+  return !op_def->is_stateful();
+}
+
+// Returns the inputs of 'node' in canonical form: the data inputs, sorted if
+// the op is commutative, followed by the sorted control inputs.
+std::vector<string> CanonicalInputs(const NodeDef& node) {
+  std::vector<string> data_inputs;
+  std::vector<string> control_inputs;
+  for (const string& input : node.input()) {
+    int position;
+    const string name = ParseNodeName(input, &position);
+    if (position < 0) {
+      control_inputs.push_back(OutputName(name, position));
+    } else {
+      data_inputs.push_back(OutputName(name, position));
+    }
+  }
+  if (IsCommutative(node)) {
+    std::sort(data_inputs.begin(), data_inputs.end());
+  }
+  std::sort(control_inputs.begin(), control_inputs.end());
+  control_inputs.erase(
+      std::unique(control_inputs.begin(), control_inputs.end()),
+      control_inputs.end());
+  data_inputs.insert(data_inputs.end(), control_inputs.begin(),
+                     control_inputs.end());
+  return data_inputs;
+}
+
+uint64 HashNode(const NodeDef& node, const std::vector<string>& inputs) {
+  uint64 hash = Hash64Combine(Hash64(node.op()), Hash64(node.device()));
+  for (const string& input : inputs) {
+    hash = Hash64Combine(hash, Hash64(input));
+  }
+  // The attributes are combined in an order independent way.  Tensor values,
+  // which can be large, are left to SameNode().
+  uint64 attrs_hash = 0;
+  for (const auto& attr : node.attr()) {
+    uint64 attr_hash = Hash64(attr.first);
+    if (attr.second.value_case() != AttrValue::kTensor) {
+      attr_hash = Hash64Combine(attr_hash,
+                                Hash64(attr.second.SerializeAsString()));
+    }
+    attrs_hash += attr_hash;
+  }
+  return Hash64Combine(hash, attrs_hash);
+}
+
+bool SameNode(const NodeDef& node1, const NodeDef& node2,
+              const std::vector<string>& inputs2) {
+  if (node1.op() != node2.op() || node1.device() != node2.device() ||
+      node1.attr_size() != node2.attr_size() ||
+      CanonicalInputs(node1) != inputs2) {
+    return false;
+  }
+  for (const auto& attr1 : node1.attr()) {
+    auto attr2 = node2.attr().find(attr1.first);
+    if (attr2 == node2.attr().end() ||
+        !AreAttrValuesEqual(attr1.second, attr2->second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GetConstant(const NodeDef* node, Tensor* value) {
+  if (node == nullptr || !IsConstant(*node)) {
+    return false;
+  }
+  auto attr = node->attr().find("value");
+  return attr != node->attr().end() && value->FromProto(attr->second.tensor());
+}
+
+bool GetIntegerVector(const NodeDef* node, std::vector<int64>* values) {
+  Tensor value;
+  if (!GetConstant(node, &value) || value.dims() != 1) {
+    return false;
+  }
+  values->clear();
+  if (value.dtype() == DT_INT32) {
+    for (int64 i = 0; i < value.NumElements(); ++i) {
+      values->push_back(value.flat<int32>()(i));
+    }
+  } else if (value.dtype() == DT_INT64) {
+    for (int64 i = 0; i < value.NumElements(); ++i) {
+      values->push_back(value.flat<int64>()(i));
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool AllValuesAre(const Tensor& tensor, const T& value) {
+  auto values = tensor.flat<T>();
+  for (int64 i = 0; i < values.size(); ++i) {
+    if (values(i) != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsOnes(const Tensor& tensor) {
+  switch (tensor.dtype()) {
+#define HANDLE_TYPE(T)            \
+  case DataTypeToEnum<T>::value: \
+    return AllValuesAre<T>(tensor, static_cast<T>(1));
+    HANDLE_TYPE(float);
+    HANDLE_TYPE(double);
+    HANDLE_TYPE(Eigen::half);
+    HANDLE_TYPE(int8);
+    HANDLE_TYPE(int16);
+    HANDLE_TYPE(int32);
+    HANDLE_TYPE(int64);
+    HANDLE_TYPE(uint8);
+    HANDLE_TYPE(uint16);
+    HANDLE_TYPE(complex64);
+    HANDLE_TYPE(complex128);
+#undef HANDLE_TYPE
+    default:
+      return false;
+  }
+}
+
+// Returns true if every value of type 'from' is exactly representable in type
+// 'to', so that casting to 'to' and back is the identity.
+bool IsLosslessCast(DataType from, DataType to) {
+  switch (from) {
+    case DT_INT8:
+      return to == DT_INT16 || to == DT_INT32 || to == DT_INT64 ||
+             to == DT_HALF || to == DT_FLOAT || to == DT_DOUBLE;
+    case DT_UINT8:
+      return to == DT_INT16 || to == DT_UINT16 || to == DT_INT32 ||
+             to == DT_INT64 || to == DT_HALF || to == DT_FLOAT ||
+             to == DT_DOUBLE;
+    case DT_INT16:
+    case DT_UINT16:
+      return to == DT_INT32 || to == DT_INT64 || to == DT_FLOAT ||
+             to == DT_DOUBLE;
+    case DT_INT32:
+      return to == DT_INT64 || to == DT_DOUBLE;
+    case DT_HALF:
+      return to == DT_FLOAT || to == DT_DOUBLE;
+    case DT_FLOAT:
+      return to == DT_DOUBLE;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+void ArithmeticOptimizer::ReplaceWithIdentity(const string& input,
+                                              DataType type, NodeDef* node) {
+  // 'input' may refer to an input of 'node', which is about to be cleared.
+  const string forwarded_input = input;
+  std::vector<string> control_inputs;
+  for (const string& old_input : node->input()) {
+    if (IsControlInput(old_input)) {
+      control_inputs.push_back(NodeName(old_input));
+    } else if (!IsSameInput(old_input, input)) {
+      const NodeDef* producer = node_map_->GetNode(old_input);
+      dead_candidates_.insert(producer->name());
+      for (const string& producer_input : producer->input()) {
+        if (IsControlInput(producer_input)) {
+          control_inputs.push_back(NodeName(producer_input));
+        }
+      }
+    }
+  }
+  node->set_op("Identity");
+  node->clear_attr();
+  (*node->mutable_attr())["T"].set_type(type);
+  node->clear_input();
+  node->add_input(forwarded_input);
+  for (const string& control_input : control_inputs) {
+    AddControlInput(control_input, node);
+  }
+}
+
+bool ArithmeticOptimizer::SimplifyTransposePair(NodeDef* node) {
+  if (!IsTranspose(*node) || node->input_size() < 2) {
+    return false;
+  }
+  const NodeDef* inner = node_map_->GetNode(node->input(0));
+  if (inner == nullptr || !IsTranspose(*inner) || inner->input_size() < 2) {
+    return false;
+  }
+  std::vector<int64> outer_perm;
+  std::vector<int64> inner_perm;
+  if (!GetIntegerVector(node_map_->GetNode(node->input(1)), &outer_perm) ||
+      !GetIntegerVector(node_map_->GetNode(inner->input(1)), &inner_perm) ||
+      outer_perm.size() != inner_perm.size()) {
+    return false;
+  }
+  // Dimension i of the result is dimension inner_perm[outer_perm[i]] of the
+  // input of the inner transpose.
+  const int64 rank = outer_perm.size();
+  for (int64 i = 0; i < rank; ++i) {
+    if (outer_perm[i] < 0 || outer_perm[i] >= rank ||
+        inner_perm[outer_perm[i]] != i) {
+      return false;
+    }
+  }
+  ReplaceWithIdentity(inner->input(0), node->attr().at("T").type(), node);
+  return true;
+}
+
+bool ArithmeticOptimizer::SimplifyReshapePair(NodeDef* node) {
+  if (!IsReshape(*node) || node->input_size() < 2) {
+    return false;
+  }
+  const NodeDef* inner = node_map_->GetNode(node->input(0));
+  if (inner == nullptr || !IsReshape(*inner) || inner->input_size() < 2) {
+    return false;
+  }
+  // The result only depends on the shape given to the outer reshape.
+  node->set_input(0, inner->input(0));
+  for (const string& input : inner->input()) {
+    if (IsControlInput(input)) {
+      AddControlInput(NodeName(input), node);
+    }
+  }
+  dead_candidates_.insert(inner->name());
+  return true;
+}
+
+bool ArithmeticOptimizer::SimplifyMulByOne(NodeDef* node) {
+  if (!IsMul(*node) || node->input_size() < 2) {
+    return false;
+  }
+  for (int i = 0; i < 2; ++i) {
+    Tensor value;
+    if (!GetConstant(node_map_->GetNode(node->input(i)), &value) ||
+        !IsOnes(value)) {
+      continue;
+    }
+    const string other = node->input(1 - i);
+    // Multiplying by a tensor of ones can broadcast the other operand.
+    if (value.dims() > 0 && !HasSameShape(other, *node)) {
+      continue;
+    }
+    ReplaceWithIdentity(other, node->attr().at("T").type(), node);
+    return true;
+  }
+  return false;
+}
+
+bool ArithmeticOptimizer::SimplifyCastPair(NodeDef* node) {
+  if (!IsCast(*node) || node->input_size() < 1) {
+    return false;
+  }
+  const DataType type = node->attr().at("DstT").type();
+  if (node->attr().at("SrcT").type() == type) {
+    ReplaceWithIdentity(node->input(0), type, node);
+    return true;
+  }
+  const NodeDef* inner = node_map_->GetNode(node->input(0));
+  if (inner == nullptr || !IsCast(*inner) || inner->input_size() < 1 ||
+      inner->attr().at("SrcT").type() != type ||
+      !IsLosslessCast(type, inner->attr().at("DstT").type())) {
+    return false;
+  }
+  ReplaceWithIdentity(inner->input(0), type, node);
+  return true;
+}
+
+bool ArithmeticOptimizer::HoistCommonFactor(NodeDef* node) {
+  if (!IsAddN(*node) || node->input_size() < 2) {
+    return false;
+  }
+  std::vector<const NodeDef*> products;
+  std::vector<string> control_inputs;
+  for (const string& input : node->input()) {
+    if (IsControlInput(input)) {
+      control_inputs.push_back(NodeName(input));
+      continue;
+    }
+    const NodeDef* product = node_map_->GetNode(input);
+    if (product == nullptr || !IsMul(*product) || product->input_size() < 2 ||
+        IsControlInput(product->input(1))) {
+      return false;
+    }
+    products.push_back(product);
+  }
+  if (products.size() < 2) {
+    return false;
+  }
+  const string sum_name = AddPrefixToNodeName(
+      node->name(),
+      strings::StrCat(kArithmeticOptimizer, "/HoistCommonFactor"));
+  if (node_map_->GetNode(sum_name) != nullptr) {
+    return false;
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    const string factor = products[0]->input(i);
+    std::vector<string> terms;
+    for (const NodeDef* product : products) {
+      if (IsSameInput(product->input(0), factor)) {
+        terms.push_back(product->input(1));
+      } else if (IsSameInput(product->input(1), factor)) {
+        terms.push_back(product->input(0));
+      } else {
+        break;
+      }
+    }
+    if (terms.size() != products.size()) {
+      continue;
+    }
+    // AddN doesn't broadcast its inputs, and the product of 'factor' with the
+    // sum must have the shape of the original sum.
+    bool same_shapes = true;
+    for (const string& term : terms) {
+      same_shapes &= HasSameShape(term, *node);
+    }
+    if (!same_shapes) {
+      continue;
+    }
+
+    NodeDef* sum = graph_->add_node();
+    sum->set_name(sum_name);
+    sum->set_op("AddN");
+    sum->set_device(node->device());
+    (*sum->mutable_attr())["N"].set_i(terms.size());
+    (*sum->mutable_attr())["T"] = node->attr().at("T");
+    for (const string& term : terms) {
+      sum->add_input(term);
+    }
+    for (const NodeDef* product : products) {
+      dead_candidates_.insert(product->name());
+      for (const string& input : product->input()) {
+        if (IsControlInput(input)) {
+          AddControlInput(NodeName(input), sum);
+        }
+      }
+    }
+    node_map_->AddNode(sum_name, sum);
+
+    node->set_op("Mul");
+    node->mutable_attr()->erase("N");
+    node->clear_input();
+    node->add_input(factor);
+    node->add_input(sum_name);
+    for (const string& control_input : control_inputs) {
+      AddControlInput(control_input, node);
+    }
+    return true;
+  }
+  return false;
+}
+
+void ArithmeticOptimizer::SimplifyNode(NodeDef* node) {
+  if (SimplifyTransposePair(node) || SimplifyReshapePair(node) ||
+      SimplifyMulByOne(node) || SimplifyCastPair(node) ||
+      HoistCommonFactor(node)) {
+    VLOG(2) << "Simplified " << node->name() << " into a " << node->op();
+  }
+}
+
+const NodeDef* ArithmeticOptimizer::FindDuplicate(const NodeDef* node) {
+  const std::vector<string> inputs = CanonicalInputs(*node);
+  const uint64 hash = HashNode(*node, inputs);
+  auto range = representatives_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (SameNode(*it->second, *node, inputs)) {
+      return it->second;
+    }
+  }
+  // The preserved nodes may be fed, in which case their value differs from
+  // the one of their duplicates: they can't replace other nodes.
+  if (nodes_to_preserve_.find(node->name()) == nodes_to_preserve_.end()) {
+    representatives_.insert(std::make_pair(hash, node));
+  }
+  return nullptr;
+}
+
+bool ArithmeticOptimizer::HasSameShape(const string& input,
+                                       const NodeDef& node) const {
+  int position;
+  const string producer = ParseNodeName(input, &position);
+  if (position < 0 || !properties_->HasOutputProperties(producer) ||
+      !properties_->HasOutputProperties(node.name())) {
+    return false;
+  }
+  const auto& input_properties = properties_->GetOutputProperties(producer);
+  const auto& node_properties = properties_->GetOutputProperties(node.name());
+  if (position >= static_cast<int>(input_properties.size()) ||
+      node_properties.empty()) {
+    return false;
+  }
+  const PartialTensorShape input_shape(input_properties[position].shape());
+  const PartialTensorShape shape(node_properties[0].shape());
+  return input_shape.IsFullyDefined() && input_shape.IsIdenticalTo(shape);
+}
+
+void ArithmeticOptimizer::RemoveDeadNodes() {
+  std::unordered_set<string> dead_nodes;
+  for (const auto& replacement : replacements_) {
+    dead_nodes.insert(replacement.first);
+  }
+  std::unordered_map<string, int> num_consumers;
+  for (const NodeDef& node : graph_->node()) {
+    if (dead_nodes.find(node.name()) == dead_nodes.end()) {
+      for (const string& input : node.input()) {
+        ++num_consumers[NodeName(input)];
+      }
+    }
+  }
+  std::vector<string> ready;
+  for (const string& name : dead_candidates_) {
+    if (num_consumers[name] == 0) {
+      ready.push_back(name);
+    }
+  }
+  // The inputs of the removed nodes are removed in turn once they have no
+  // consumer left, unless they have side effects.
+  while (!ready.empty()) {
+    const NodeDef* node = node_map_->GetNode(ready.back());
+    ready.pop_back();
+    if (nodes_to_preserve_.find(node->name()) != nodes_to_preserve_.end() ||
+        !IsDedupable(*node) || !dead_nodes.insert(node->name()).second) {
+      continue;
+    }
+    for (const string& input : node->input()) {
+      const string input_name = NodeName(input);
+      if (--num_consumers[input_name] == 0) {
+        ready.push_back(input_name);
+      }
+    }
+  }
+
+  const int num_deleted = DeleteNodes(dead_nodes, graph_);
+  VLOG(1) << "Removed " << num_deleted << " nodes from the graph.";
+}
+
+Status ArithmeticOptimizer::Optimize(Cluster* /*cluster*/,
+                                     const GrapplerItem& item,
+                                     GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  graph_ = optimized_graph;
+  nodes_to_preserve_.clear();
+  replacements_.clear();
+  dead_candidates_.clear();
+  representatives_.clear();
+  for (const auto& node : item.fetch) {
+    nodes_to_preserve_.insert(NodeName(node));
+  }
+  for (const auto& feed : item.feed) {
+    nodes_to_preserve_.insert(NodeName(feed.first));
+  }
+  for (const auto& node : item.init_ops) {
+    nodes_to_preserve_.insert(NodeName(node));
+  }
+
+  std::vector<int> order;
+  if (!TopologicalOrder(*optimized_graph, &order)) {
+    VLOG(1) << "Failed to sort the graph, skipping arithmetic optimizations";
+    return Status::OK();
+  }
+  node_map_.reset(new NodeMap(optimized_graph));
+  properties_.reset(new GraphProperties(item));
+  Status s = properties_->InferStatically();
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer graph shapes: " << s;
+  }
+
+  // The nodes are visited after their inputs, so that chains of redundant
+  // nodes collapse in a single pass.
+  for (int i : order) {
+    NodeDef* node = optimized_graph->mutable_node(i);
+    bool replaced_control_input = false;
+    for (int j = 0; j < node->input_size(); ++j) {
+      int position;
+      const string input = ParseNodeName(node->input(j), &position);
+      auto replacement = replacements_.find(input);
+      if (replacement != replacements_.end()) {
+        node->set_input(j, OutputName(replacement->second, position));
+        replaced_control_input |= position < 0;
+      }
+    }
+    if (replaced_control_input) {
+      std::vector<string> control_inputs;
+      while (node->input_size() > 0 &&
+             IsControlInput(node->input(node->input_size() - 1))) {
+        control_inputs.push_back(NodeName(node->input(node->input_size() - 1)));
+        node->mutable_input()->RemoveLast();
+      }
+      for (auto it = control_inputs.rbegin(); it != control_inputs.rend();
+           ++it) {
+        AddControlInput(*it, node);
+      }
+    }
+
+    SimplifyNode(node);
+
+    if (IsDedupable(*node)) {
+      const NodeDef* duplicate = FindDuplicate(node);
+      if (duplicate != nullptr &&
+          nodes_to_preserve_.find(node->name()) == nodes_to_preserve_.end()) {
+        VLOG(2) << "Replacing " << node->name() << " with its duplicate "
+                << duplicate->name();
+        replacements_[node->name()] = duplicate->name();
+      }
+    }
+  }
+
+  RemoveDeadNodes();
+  return Status::OK();
+}
+
+void ArithmeticOptimizer::Feedback(Cluster* /*cluster*/,
+                                   const GrapplerItem& /*item*/,
+                                   const GraphDef& /*optimized_graph*/,
+                                   double /*result*/) {
+  // Nothing to do for ArithmeticOptimizer.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,96 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_ARITHMETIC_OPTIMIZER_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_ARITHMETIC_OPTIMIZER_H_
+
+#include <unordered_map>
+#include <unordered_set>
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/utils.h"
+
+namespace tensorflow {
+namespace grappler {
+
+const char kArithmeticOptimizer[] = "ArithmeticOptimizer";
+
+// Removes redundant computations from a graph:
+//  * Transpose(Transpose(x, p1), p2) where the permutations cancel out, and
+//    Cast(Cast(x)) where the inner cast is lossless, become Identity(x).
+//  * Reshape(Reshape(x, s1), s2) becomes Reshape(x, s2).
+//  * Mul(x, 1) becomes Identity(x) when the ones don't broadcast x.
+//  * AddN(Mul(a, x1), ..., Mul(a, xn)) becomes Mul(a, AddN(x1, ..., xn)).
+//  * Nodes that compute the same value as another node (same op, attributes,
+//    device and inputs) are merged.
+// The bypassed nodes are removed once nothing else uses them, as are the
+// inputs that only they used.
+class ArithmeticOptimizer : public GraphOptimizer {
+ public:
+  ArithmeticOptimizer() {}
+  ~ArithmeticOptimizer() override {}
+
+  string name() const override { return "arithmetic_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+
+ private:
+  // Rewrites 'node' in place if one of the simplifications above applies.
+  void SimplifyNode(NodeDef* node);
+  bool SimplifyTransposePair(NodeDef* node);
+  bool SimplifyReshapePair(NodeDef* node);
+  bool SimplifyMulByOne(NodeDef* node);
+  bool SimplifyCastPair(NodeDef* node);
+  bool HoistCommonFactor(NodeDef* node);
+
+  // Returns the node that 'node' duplicates and can be replaced with, or
+  // nullptr if there is none, in which case 'node' is recorded as the
+  // representative of its value.
+  const NodeDef* FindDuplicate(const NodeDef* node);
+
+  // Returns true if the output of 'node' is known to have the same fully
+  // defined shape as the tensor 'input'.
+  bool HasSameShape(const string& input, const NodeDef& node) const;
+
+  // Rewrites 'node' into an Identity of type 'type' forwarding 'input'.  The
+  // producers of the other data inputs of 'node' become dead candidates, and
+  // their control dependencies are moved to 'node'.
+  void ReplaceWithIdentity(const string& input, DataType type, NodeDef* node);
+
+  // Removes the duplicates from graph_, along with the dead candidates that no
+  // longer have any consumer and, transitively, their unused inputs.
+  void RemoveDeadNodes();
+
+  GraphDef* graph_;
+  std::unique_ptr<NodeMap> node_map_;
+  std::unique_ptr<GraphProperties> properties_;
+  std::unordered_set<string> nodes_to_preserve_;
+  // Nodes removed as duplicates, mapped to the node that replaces them.
+  std::unordered_map<string, string> replacements_;
+  // Nodes bypassed by a rewrite, removed at the end if they are unused.
+  std::unordered_set<string> dead_candidates_;
+  // Representatives of the values computed so far, keyed by hash.
+  std::unordered_multimap<uint64, const NodeDef*> representatives_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_ARITHMETIC_OPTIMIZER_H_
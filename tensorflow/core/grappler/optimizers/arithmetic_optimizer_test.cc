@@ -0,0 +1,344 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class ArithmeticOptimizerTest : public ::testing::Test {
+ protected:
+  // Returns the node named 'name' in 'graph', or nullptr.
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+
+  std::vector<Tensor> EvaluateNodes(const GraphDef& graph,
+                                    const std::vector<string>& fetch) {
+    SessionOptions options;
+    std::unique_ptr<tensorflow::Session> session(NewSession(options));
+    TF_CHECK_OK(session->Create(graph));
+    RunOptions run_options;
+    std::vector<Tensor> output_tensors;
+    TF_CHECK_OK(
+        session->Run(run_options, {}, fetch, fetch, &output_tensors, nullptr));
+    TF_CHECK_OK(session->Close());
+    return output_tensors;
+  }
+};
+
+TEST_F(ArithmeticOptimizerTest, NoOp) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {2});
+  Output b = ops::Const(s.WithOpName("b"), 2.0f, {2});
+  Output c = ops::Sub(s.WithOpName("c"), a, b);
+  Output d = ops::Sub(s.WithOpName("d"), b, a);
+  Output e = ops::AddN(s.WithOpName("e"), {c, d});
+
+  GrapplerItem item;
+  item.fetch.push_back("e");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    EXPECT_EQ(item.graph.node(i).DebugString(), output.node(i).DebugString());
+  }
+}
+
+TEST_F(ArithmeticOptimizerTest, DedupComputations) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {2});
+  Output b = ops::Const(s.WithOpName("b"), 2.0f, {2});
+  Output a2 = ops::Const(s.WithOpName("a2"), 1.0f, {2});
+  Output c1 = ops::Add(s.WithOpName("c1"), a, b);
+  Output c2 = ops::Add(s.WithOpName("c2"), b, a2);
+  Output d = ops::Mul(s.WithOpName("d"), c1, c2);
+
+  GrapplerItem item;
+  item.fetch.push_back("d");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(4, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "a2"));
+  EXPECT_EQ(nullptr, FindNode(output, "c2"));
+  const NodeDef* new_d = FindNode(output, "d");
+  ASSERT_NE(nullptr, new_d);
+  ASSERT_EQ(2, new_d->input_size());
+  EXPECT_EQ("c1", new_d->input(0));
+  EXPECT_EQ("c1", new_d->input(1));
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"d"});
+  auto tensors = EvaluateNodes(output, {"d"});
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
+TEST_F(ArithmeticOptimizerTest, DedupKeepsFetchedNodes) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {2});
+  Output b = ops::Const(s.WithOpName("b"), 2.0f, {2});
+  Output c1 = ops::Add(s.WithOpName("c1"), a, b);
+  Output c2 = ops::Add(s.WithOpName("c2"), a, b);
+
+  GrapplerItem item;
+  item.fetch.push_back("c1");
+  item.fetch.push_back("c2");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(4, output.node_size());
+  EXPECT_NE(nullptr, FindNode(output, "c1"));
+  EXPECT_NE(nullptr, FindNode(output, "c2"));
+}
+
+TEST_F(ArithmeticOptimizerTest, DedupDoesNotReplaceByFedNodes) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {2});
+  Output b = ops::Const(s.WithOpName("b"), 2.0f, {2});
+  Output c1 = ops::Add(s.WithOpName("c1"), a, b);
+  Output c2 = ops::Add(s.WithOpName("c2"), a, b);
+  Output d = ops::Mul(s.WithOpName("d"), c1, c2);
+
+  GrapplerItem item;
+  item.feed.emplace_back("c1", test::AsTensor<float>({5.0f, 6.0f}, {2}));
+  item.fetch.push_back("d");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // c1 is fed, so c2 doesn't compute the same value.
+  EXPECT_EQ(5, output.node_size());
+  const NodeDef* new_d = FindNode(output, "d");
+  ASSERT_NE(nullptr, new_d);
+  ASSERT_EQ(2, new_d->input_size());
+  EXPECT_EQ("c1", new_d->input(0));
+  EXPECT_EQ("c2", new_d->input(1));
+}
+
+TEST_F(ArithmeticOptimizerTest, DedupSkipsStatefulOps) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output shape = ops::Const(s.WithOpName("shape"), {2, 2});
+  Output r1 = ops::RandomUniform(s.WithOpName("r1"), shape, DT_FLOAT);
+  Output r2 = ops::RandomUniform(s.WithOpName("r2"), shape, DT_FLOAT);
+  Output sum = ops::Add(s.WithOpName("sum"), r1, r2);
+
+  GrapplerItem item;
+  item.fetch.push_back("sum");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(4, output.node_size());
+}
+
+TEST_F(ArithmeticOptimizerTest, TransposePair) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT);
+  Output t1 = ops::Transpose(s.WithOpName("t1"), x, {1, 2, 0});
+  Output t2 = ops::Transpose(s.WithOpName("t2"), t1, {2, 0, 1});
+  Output t3 = ops::Transpose(s.WithOpName("t3"), t2, {1, 0, 2});
+  Output t4 = ops::Transpose(s.WithOpName("t4"), t3, {0, 2, 1});
+
+  GrapplerItem item;
+  item.fetch.push_back("t4");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // t2 cancels t1, but t4 doesn't cancel t3.
+  EXPECT_EQ(nullptr, FindNode(output, "t1"));
+  const NodeDef* new_t2 = FindNode(output, "t2");
+  ASSERT_NE(nullptr, new_t2);
+  EXPECT_EQ("Identity", new_t2->op());
+  ASSERT_EQ(1, new_t2->input_size());
+  EXPECT_EQ("x", new_t2->input(0));
+  const NodeDef* new_t4 = FindNode(output, "t4");
+  ASSERT_NE(nullptr, new_t4);
+  EXPECT_EQ("Transpose", new_t4->op());
+  EXPECT_EQ(6, output.node_size());
+}
+
+TEST_F(ArithmeticOptimizerTest, ReshapePair) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT);
+  Output r1 = ops::Reshape(s.WithOpName("r1"), x, {6, 4});
+  Output r2 = ops::Reshape(s.WithOpName("r2"), r1, {4, 6});
+
+  GrapplerItem item;
+  item.fetch.push_back("r2");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(3, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "r1"));
+  const NodeDef* new_r2 = FindNode(output, "r2");
+  ASSERT_NE(nullptr, new_r2);
+  EXPECT_EQ("Reshape", new_r2->op());
+  EXPECT_EQ("x", new_r2->input(0));
+}
+
+TEST_F(ArithmeticOptimizerTest, MulByOne) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({2, 3}));
+  Output one = ops::Const(s.WithOpName("one"), 1.0f);
+  Output ones = ops::Const(s.WithOpName("ones"), 1.0f, {2, 3});
+  Output broadcast_ones = ops::Const(s.WithOpName("broadcast_ones"), 1.0f,
+                                     {4, 2, 3});
+  Output m1 = ops::Mul(s.WithOpName("m1"), x, one);
+  Output m2 = ops::Mul(s.WithOpName("m2"), ones, m1);
+  Output m3 = ops::Mul(s.WithOpName("m3"), m2, broadcast_ones);
+
+  GrapplerItem item;
+  item.fetch.push_back("m3");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  const NodeDef* new_m1 = FindNode(output, "m1");
+  ASSERT_NE(nullptr, new_m1);
+  EXPECT_EQ("Identity", new_m1->op());
+  EXPECT_EQ("x", new_m1->input(0));
+  const NodeDef* new_m2 = FindNode(output, "m2");
+  ASSERT_NE(nullptr, new_m2);
+  EXPECT_EQ("Identity", new_m2->op());
+  EXPECT_EQ("m1", new_m2->input(0));
+  // The last multiplication changes the shape of its input.
+  const NodeDef* new_m3 = FindNode(output, "m3");
+  ASSERT_NE(nullptr, new_m3);
+  EXPECT_EQ("Mul", new_m3->op());
+  EXPECT_EQ(nullptr, FindNode(output, "one"));
+  EXPECT_EQ(nullptr, FindNode(output, "ones"));
+  EXPECT_NE(nullptr, FindNode(output, "broadcast_ones"));
+}
+
+TEST_F(ArithmeticOptimizerTest, CastPair) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_INT32);
+  Output c1 = ops::Cast(s.WithOpName("c1"), x, DT_INT64);
+  Output c2 = ops::Cast(s.WithOpName("c2"), c1, DT_INT32);
+  Output y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT);
+  Output c3 = ops::Cast(s.WithOpName("c3"), y, DT_INT32);
+  Output c4 = ops::Cast(s.WithOpName("c4"), c3, DT_FLOAT);
+
+  GrapplerItem item;
+  item.fetch.push_back("c2");
+  item.fetch.push_back("c4");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(nullptr, FindNode(output, "c1"));
+  const NodeDef* new_c2 = FindNode(output, "c2");
+  ASSERT_NE(nullptr, new_c2);
+  EXPECT_EQ("Identity", new_c2->op());
+  EXPECT_EQ(DT_INT32, new_c2->attr().at("T").type());
+  EXPECT_EQ("x", new_c2->input(0));
+  // Casting a float to an integer is lossy.
+  const NodeDef* new_c4 = FindNode(output, "c4");
+  ASSERT_NE(nullptr, new_c4);
+  EXPECT_EQ("Cast", new_c4->op());
+  EXPECT_NE(nullptr, FindNode(output, "c3"));
+}
+
+TEST_F(ArithmeticOptimizerTest, HoistCommonFactor) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), {1.0f, 2.0f}, {2});
+  Output x = ops::Const(s.WithOpName("x"), {3.0f, 4.0f}, {2});
+  Output y = ops::Const(s.WithOpName("y"), {5.0f, 6.0f}, {2});
+  Output m1 = ops::Mul(s.WithOpName("m1"), a, x);
+  Output m2 = ops::Mul(s.WithOpName("m2"), y, a);
+  Output sum = ops::AddN(s.WithOpName("sum"), {m1, m2});
+
+  GrapplerItem item;
+  item.fetch.push_back("sum");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ArithmeticOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(5, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "m1"));
+  EXPECT_EQ(nullptr, FindNode(output, "m2"));
+  const NodeDef* new_sum = FindNode(output, "sum");
+  ASSERT_NE(nullptr, new_sum);
+  EXPECT_EQ("Mul", new_sum->op());
+  ASSERT_EQ(2, new_sum->input_size());
+  EXPECT_EQ("a", new_sum->input(0));
+  EXPECT_EQ("ArithmeticOptimizer/HoistCommonFactor/sum", new_sum->input(1));
+  const NodeDef* hoisted_sum =
+      FindNode(output, "ArithmeticOptimizer/HoistCommonFactor/sum");
+  ASSERT_NE(nullptr, hoisted_sum);
+  EXPECT_EQ("AddN", hoisted_sum->op());
+  ASSERT_EQ(2, hoisted_sum->input_size());
+  EXPECT_EQ("x", hoisted_sum->input(0));
+  EXPECT_EQ("y", hoisted_sum->input(1));
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"sum"});
+  auto tensors = EvaluateNodes(output, {"sum"});
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -98,6 +98,10 @@ string AsControlDependency(const NodeDef& node) {
   return strings::StrCat("^", node.name());
 }
 
+// Folded tensors larger than this aren't materialized as constants, to keep
+// the size of the graph in check (e.g. when folding a large Fill or Tile).
+constexpr int64 kMaxConstantSize = 10 * 1024 * 1024;
+
 }  // namespace
 
 ConstantFolding::ConstantFolding() {
@@ -375,26 +379,43 @@ Status ConstantFolding::EvaluateNode(const NodeDef& node,
 Status ConstantFolding::EvaluateOneFoldable(const NodeDef& node,
                                             std::vector<NodeDef>* outputs) {
   TensorVector inputs;
-  auto inputs_cleanup = gtl::MakeCleanup([&inputs] {
+  TensorVector output_tensors;
+  auto tensors_cleanup = gtl::MakeCleanup([&inputs, &output_tensors] {
     for (const auto& input : inputs) {
       delete input.tensor;
     }
+    for (const auto& output : output_tensors) {
+      delete output.tensor;
+    }
   });
 
   for (const auto& input : node.input()) {
     if (IsControlInput(input)) {
       break;
     }
-    TensorVector output;
-    TF_RETURN_IF_ERROR(
-        EvaluateNode(*node_map_->GetNode(input), TensorVector(), &output));
-    inputs.push_back(output[0]);
+    // The inputs are constants: parse their value directly instead of
+    // instantiating a kernel for each of them.
+    const NodeDef* input_node = node_map_->GetNode(input);
+    Tensor* value = new Tensor;
+    inputs.push_back(TensorValue(value));
+    AllocatorAttributes attr;
+    attr.set_on_host(true);
+    TF_RETURN_IF_ERROR(device_->MakeTensorFromProto(
+        input_node->attr().at("value").tensor(), attr, value));
   }
 
-  TensorVector output_tensors;
   TF_RETURN_IF_ERROR(EvaluateNode(node, inputs, &output_tensors));
   if (output_tensors.empty()) {
-    Status(error::INVALID_ARGUMENT, "Expected at least one output.");
+    return errors::InvalidArgument("Expected at least one output.");
+  }
+  for (const auto& output_tensor : output_tensors) {
+    if (output_tensor.tensor &&
+        static_cast<int64>(output_tensor->TotalBytes()) > kMaxConstantSize) {
+      return errors::ResourceExhausted(
+          "Folding ", node.name(), " would create a constant of ",
+          output_tensor->TotalBytes(), " bytes, more than the limit of ",
+          kMaxConstantSize);
+    }
   }
   for (size_t i = 0; i < output_tensors.size(); i++) {
     string node_name = AddPrefixToNodeName(node.name(), kConstantFoldingConst);
@@ -403,7 +424,6 @@ Status ConstantFolding::EvaluateOneFoldable(const NodeDef& node,
     }
     if (output_tensors[i].tensor) {
       outputs->push_back(CreateNodeDef(node_name, output_tensors[i]));
-      delete output_tensors[i].tensor;
     } else {
       // Create an empty NodeDef to identify dead outputs (e.g. the output of a
       // switch that's not selected by the switch predicate).
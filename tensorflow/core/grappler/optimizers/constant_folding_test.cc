@@ -607,6 +607,40 @@ TEST_F(ConstantFoldingTest, NoOpReshape) {
   EXPECT_EQ(4, found);
 }
 
+TEST_F(ConstantFoldingTest, NoLargeConstants) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  // A 4M element float tensor takes 16MB.
+  Output dims = ops::Const(s.WithOpName("dims"), {4, 1024, 1024}, {3});
+  Output value = ops::Const(s.WithOpName("value"), 1.0f, {});
+  Output fill = ops::Fill(s.WithOpName("fill"), dims, value);
+  Output neg = ops::Neg(s.WithOpName("neg"), fill);
+  Output small_dims = ops::Const(s.WithOpName("small_dims"), {2}, {1});
+  Output small_fill = ops::Fill(s.WithOpName("small_fill"), small_dims, value);
+  Output small_neg = ops::Neg(s.WithOpName("small_neg"), small_fill);
+
+  GrapplerItem item;
+  item.fetch = {"neg", "small_neg"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ConstantFolding fold;
+  GraphDef output;
+  TF_EXPECT_OK(fold.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const auto& node : output.node()) {
+    EXPECT_NE(AddPrefixToNodeName("fill", kConstantFoldingConst), node.name());
+    if (node.name() == "neg") {
+      ++found;
+      EXPECT_EQ("fill", node.input(0));
+    } else if (node.name() == "small_neg") {
+      ++found;
+      EXPECT_EQ(AddPrefixToNodeName("small_fill", kConstantFoldingConst),
+                node.input(0));
+    }
+  }
+  EXPECT_EQ(2, found);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -0,0 +1,611 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/input_staging_optimizer.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+bool IsIteratorGetNext(const NodeDef& node) {
+  return node.op() == "IteratorGetNext";
+}
+
+// The end of the input of a source can be detected without losing an element:
+// a dequeue runs out once its queue is closed and holds too few elements, and
+// IteratorHasNext gets the next element of an iterator ahead of its
+// IteratorGetNext.
+bool IsInputSource(const NodeDef& node) {
+  return IsDequeueOp(node) || IsIteratorGetNext(node);
+}
+
+// Returns true if 'node' can run ahead of the step that consumes its outputs,
+// i.e. it only reads its inputs.
+bool CanRunAhead(const NodeDef& node) {
+  if (IsPlaceholder(node) || IsVariable(node) || IsSend(node) ||
+      IsRecv(node) || IsEnter(node) || IsExit(node) || IsMerge(node) ||
+      IsSwitch(node) || IsNextIteration(node) || IsLoopCond(node)) {
+    return false;
+  }
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok() ||
+      op_def->is_stateful()) {
+    return false;
+  }
+  DataTypeVector inputs;
+  DataTypeVector outputs;
+  if (!InOutTypesForNode(node, *op_def, &inputs, &outputs).ok()) {
+    return false;
+  }
+  for (const DataTypeVector* types : {&inputs, &outputs}) {
+    for (DataType type : *types) {
+      if (IsRefType(type) || type == DT_RESOURCE) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns true if 'node' runs a node of the input pipeline, i.e. if one is in
+// its transitive fan-in. The inputs of the fed nodes don't run.
+bool ReadsPipeline(const NodeDef& node,
+                   const std::unordered_set<string>& pipeline,
+                   const std::unordered_set<string>& fed,
+                   const NodeMap& node_map) {
+  std::unordered_set<string> visited = {node.name()};
+  std::vector<const NodeDef*> to_visit = {&node};
+  while (!to_visit.empty()) {
+    const NodeDef* current = to_visit.back();
+    to_visit.pop_back();
+    for (const string& input : current->input()) {
+      const string input_name = NodeName(input);
+      if (pipeline.count(input_name) > 0) {
+        return true;
+      }
+      if (fed.count(input_name) > 0 || !visited.insert(input_name).second) {
+        continue;
+      }
+      const NodeDef* input_node = node_map.GetNode(input_name);
+      if (input_node != nullptr) {
+        to_visit.push_back(input_node);
+      }
+    }
+  }
+  return false;
+}
+
+Status OutputType(const NodeDef& node, int port, DataType* type) {
+  const OpDef* op_def = nullptr;
+  TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUpOpDef(node.op(), &op_def));
+  DataTypeVector inputs;
+  DataTypeVector outputs;
+  TF_RETURN_IF_ERROR(InOutTypesForNode(node, *op_def, &inputs, &outputs));
+  if (port >= static_cast<int>(outputs.size())) {
+    return errors::InvalidArgument("Node ", node.name(), " has no output ",
+                                   port);
+  }
+  *type = outputs[port];
+  return Status::OK();
+}
+
+string AsControlDependency(const string& node_name) {
+  return strings::StrCat("^", node_name);
+}
+
+string StagingNodeName(const string& name) {
+  return AddPrefixToNodeName(name, kInputStagingPrefix);
+}
+
+NodeDef* AddNode(const string& prefix, const string& name, const string& op,
+                 const string& device, GraphDef* graph) {
+  NodeDef* node = graph->add_node();
+  node->set_name(AddPrefixToNodeName(name, prefix));
+  node->set_op(op);
+  node->set_device(device);
+  return node;
+}
+
+NodeDef* AddInt32Const(const string& prefix, const string& name, int32 value,
+                       const string& device, GraphDef* graph) {
+  NodeDef* node = AddNode(prefix, name, "Const", device, graph);
+  (*node->mutable_attr())["dtype"].set_type(DT_INT32);
+  TensorProto* tensor = (*node->mutable_attr())["value"].mutable_tensor();
+  tensor->set_dtype(DT_INT32);
+  tensor->mutable_tensor_shape();
+  tensor->add_int_val(value);
+  return node;
+}
+
+NodeDef* AddBoolOp(const string& prefix, const string& name, const string& op,
+                   const std::vector<string>& inputs, const string& device,
+                   GraphDef* graph) {
+  NodeDef* node = AddNode(prefix, name, op, device, graph);
+  if (op == "Identity" || op == "Switch" || op == "Merge") {
+    (*node->mutable_attr())["T"].set_type(DT_BOOL);
+  }
+  if (op == "Merge") {
+    (*node->mutable_attr())["N"].set_i(inputs.size());
+  }
+  for (const string& input : inputs) {
+    *node->add_input() = input;
+  }
+  return node;
+}
+
+// Adds the nodes telling, once 'wait' ran, whether the queue of the dequeue
+// 'source' is closed and holds fewer elements than it takes. Returns the name
+// of the boolean result.
+string AddQueueExhaustedCheck(const string& prefix, const string& suffix,
+                              const NodeDef& source, const string& wait,
+                              const string& device, GraphDef* graph) {
+  const bool is_v2 = StringPiece(source.op()).ends_with("V2");
+  NodeDef* closed =
+      AddNode(prefix, strings::StrCat("closed", suffix),
+              is_v2 ? "QueueIsClosedV2" : "QueueIsClosed", device, graph);
+  *closed->add_input() = source.input(0);
+  *closed->add_input() = AsControlDependency(wait);
+  // The size is read once the queue is known to be closed, so that no
+  // element can be enqueued in between.
+  NodeDef* queue_size =
+      AddNode(prefix, strings::StrCat("queue_size", suffix),
+              is_v2 ? "QueueSizeV2" : "QueueSize", device, graph);
+  *queue_size->add_input() = source.input(0);
+  *queue_size->add_input() = AsControlDependency(closed->name());
+  string needed;
+  if (source.op() == "QueueDequeueMany" ||
+      source.op() == "QueueDequeueManyV2") {
+    needed = source.input(1);
+  } else {
+    needed = AddInt32Const(prefix, strings::StrCat("one", suffix), 1, device,
+                           graph)
+                 ->name();
+  }
+  NodeDef* too_small = AddNode(prefix, strings::StrCat("too_small", suffix),
+                               "Less", device, graph);
+  (*too_small->mutable_attr())["T"].set_type(DT_INT32);
+  *too_small->add_input() = queue_size->name();
+  *too_small->add_input() = needed;
+  return AddBoolOp(prefix, strings::StrCat("exhausted", suffix), "LogicalAnd",
+                   {closed->name(), too_small->name()}, device, graph)
+      ->name();
+}
+
+// Adds the nodes telling, once 'wait' ran, whether the input of the pipeline
+// is exhausted, i.e. whether one of the queues it dequeues from is closed and
+// holds fewer elements than its dequeue takes, or one of the iterators it
+// reads has no next element. Returns the name of the boolean result.
+string AddExhaustedCheck(const string& prefix,
+                         const std::vector<NodeDef>& sources,
+                         const string& wait, const string& device,
+                         GraphDef* graph) {
+  string exhausted;
+  for (int i = 0; i < static_cast<int>(sources.size()); ++i) {
+    const NodeDef& source = sources[i];
+    const string suffix = strings::StrCat("_", i);
+    string source_exhausted;
+    if (IsIteratorGetNext(source)) {
+      // The element gotten by IteratorHasNext is the one the IteratorGetNext
+      // returns when it runs next.
+      NodeDef* has_next = AddNode(prefix, strings::StrCat("has_next", suffix),
+                                  "IteratorHasNext", device, graph);
+      *has_next->add_input() = source.input(0);
+      *has_next->add_input() = AsControlDependency(wait);
+      source_exhausted =
+          AddBoolOp(prefix, strings::StrCat("exhausted", suffix), "LogicalNot",
+                    {has_next->name()}, device, graph)
+              ->name();
+    } else {
+      source_exhausted =
+          AddQueueExhaustedCheck(prefix, suffix, source, wait, device, graph);
+    }
+    if (exhausted.empty()) {
+      exhausted = source_exhausted;
+    } else {
+      exhausted =
+          AddBoolOp(prefix, strings::StrCat("any_exhausted", suffix),
+                    "LogicalOr", {exhausted, source_exhausted}, device, graph)
+              ->name();
+    }
+  }
+  return exhausted;
+}
+// Adds a Switch on the boolean 'pred', and returns the name of a node that is
+// only alive when it is true. The nodes waiting for it don't run otherwise.
+string AddGate(const string& prefix, const string& pred, const string& device,
+               GraphDef* graph) {
+  NodeDef* gate = AddBoolOp(prefix, "gate", "Switch", {pred, pred}, device,
+                            graph);
+  return AddBoolOp(prefix, "alive", "Identity",
+                   {strings::StrCat(gate->name(), ":1")}, device, graph)
+      ->name();
+}
+
+// Returns the name of a node that is alive once 'stage' ran, or once the gate
+// added by AddGate() for 'prefix' skipped it.
+string AddDone(const string& prefix, const string& stage,
+               const string& device, GraphDef* graph) {
+  const string gate = AddPrefixToNodeName("gate", prefix);
+  NodeDef* staged = AddBoolOp(
+      prefix, "staged", "Identity",
+      {strings::StrCat(gate, ":1"), AsControlDependency(stage)}, device, graph);
+  NodeDef* skipped =
+      AddBoolOp(prefix, "skipped", "Identity", {strings::StrCat(gate, ":0")},
+                device, graph);
+  return AddBoolOp(prefix, "done", "Merge", {staged->name(), skipped->name()},
+                   device, graph)
+      ->name();
+}
+
+// Returns a name for the staging area of 'item' that doesn't collide with the
+// staging areas of the other items rewritten in the same process.
+string StagingAreaName(const GrapplerItem& item,
+                       const std::vector<string>& staged) {
+  uint64 fingerprint = Fingerprint64(item.id);
+  for (const string& tensor : staged) {
+    fingerprint = FingerprintCat64(fingerprint, Fingerprint64(tensor));
+  }
+  return strings::StrCat(kInputStagingPrefix, "_", fingerprint);
+}
+
+// Sets the attributes shared by the ops accessing the staging area.
+void SetStagingAttributes(const DataTypeVector& dtypes, int capacity,
+                          const string& shared_name, NodeDef* node) {
+  auto& attr = *node->mutable_attr();
+  for (DataType dtype : dtypes) {
+    attr["dtypes"].mutable_list()->add_type(dtype);
+  }
+  attr["capacity"].set_i(capacity);
+  attr["memory_limit"].set_i(0);
+  attr["container"].set_s("");
+  attr["shared_name"].set_s(shared_name);
+}
+
+}  // namespace
+
+Status InputStagingOptimizer::Optimize(Cluster* cluster,
+                                       const GrapplerItem& item,
+                                       GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  GraphDef* graph = optimized_graph;
+
+  std::unordered_set<string> fed;
+  for (const auto& feed : item.feed) {
+    fed.insert(NodeName(feed.first));
+  }
+  std::unordered_set<string> fetched;
+  for (const string& fetch : item.fetch) {
+    fetched.insert(NodeName(fetch));
+  }
+  for (const NodeDef& node : graph->node()) {
+    if (StringPiece(node.name())
+            .starts_with(strings::StrCat(kInputStagingPrefix, "/"))) {
+      VLOG(1) << "The inputs are already staged";
+      return Status::OK();
+    }
+  }
+
+  // The nodes that aren't placed yet go to a GPU if the cluster has one.
+  int num_gpus = 0;
+  if (cluster != nullptr) {
+    for (const auto& device : cluster->GetDevices()) {
+      if (device.second.type() == "GPU") {
+        ++num_gpus;
+      }
+    }
+  }
+
+  // Find the input pipeline. The nodes feeding the fetches must stay in the
+  // step, and can't be part of it.
+  NodeMap node_map(graph);
+  std::unordered_set<string> pipeline;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const NodeDef& node : graph->node()) {
+      if (pipeline.count(node.name()) > 0 || fed.count(node.name()) > 0 ||
+          fetched.count(node.name()) > 0 || !IsOnCpu(node, num_gpus)) {
+        continue;
+      }
+      if (IsInputSource(node)) {
+        pipeline.insert(node.name());
+        changed = true;
+        continue;
+      }
+      if (!CanRunAhead(node)) {
+        continue;
+      }
+      bool reads_pipeline = false;
+      bool only_reads_pipeline = true;
+      for (const string& input : node.input()) {
+        const string input_name = NodeName(input);
+        if (pipeline.count(input_name) > 0) {
+          reads_pipeline |= !IsControlInput(input);
+          continue;
+        }
+        const NodeDef* input_node = node_map.GetNode(input_name);
+        if (IsControlInput(input) || input_node == nullptr ||
+            !IsConstant(*input_node)) {
+          only_reads_pipeline = false;
+          break;
+        }
+      }
+      if (reads_pipeline && only_reads_pipeline) {
+        pipeline.insert(node.name());
+        changed = true;
+      }
+    }
+  }
+  if (pipeline.empty()) {
+    VLOG(1) << "No input pipeline found";
+    return Status::OK();
+  }
+
+  // The tensors produced by the input pipeline and consumed by the step go
+  // through the staging area.
+  std::vector<string> staged;
+  std::unordered_map<string, int> staged_index;
+  DataTypeVector dtypes;
+  std::vector<NodeDef> pipeline_nodes;
+  std::vector<NodeDef> sources;
+  string device;
+  for (const NodeDef& node : graph->node()) {
+    if (pipeline.count(node.name()) > 0) {
+      pipeline_nodes.push_back(node);
+      if (IsInputSource(node)) {
+        sources.push_back(node);
+        if (device.empty()) {
+          device = node.device();
+        }
+      }
+      continue;
+    }
+    for (const string& input : node.input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      if (position < 0 || pipeline.count(input_name) == 0) {
+        continue;
+      }
+      const string tensor = strings::StrCat(input_name, ":", position);
+      if (staged_index.count(tensor) > 0) {
+        continue;
+      }
+      DataType dtype;
+      TF_RETURN_IF_ERROR(
+          OutputType(*node_map.GetNode(input_name), position, &dtype));
+      if (IsRefType(dtype) || dtype == DT_RESOURCE) {
+        VLOG(1) << "Can't stage " << tensor << " of type "
+                << DataTypeString(dtype);
+        return Status::OK();
+      }
+      staged_index[tensor] = staged.size();
+      staged.push_back(tensor);
+      dtypes.push_back(dtype);
+    }
+  }
+  if (staged.empty()) {
+    VLOG(1) << "The input pipeline isn't used by the step";
+    return Status::OK();
+  }
+  // Only the fetch nodes that read the input pipeline wait for the element of
+  // a later step to be staged. The items whose fetches don't read it, e.g. the
+  // ones enqueuing the input or initializing the variables, are left alone:
+  // they neither consume the staged elements nor should they produce more.
+  std::vector<NodeDef*> fetch_nodes;
+  for (const string& fetch : fetched) {
+    NodeDef* node = node_map.GetNode(fetch);
+    if (node != nullptr && fed.count(fetch) == 0 &&
+        ReadsPipeline(*node, pipeline, fed, node_map)) {
+      fetch_nodes.push_back(node);
+    }
+  }
+  if (fetch_nodes.empty()) {
+    VLOG(1) << "The fetch nodes don't read the input pipeline";
+    return Status::OK();
+  }
+  VLOG(1) << "Staging " << staged.size() << " tensors produced by "
+          << pipeline.size() << " nodes";
+
+  const string shared_name = StagingAreaName(item, staged);
+  const string unstage_name = StagingNodeName("unstage");
+  const string done_name = StagingNodeName("done");
+
+  // Read the staged tensors from the staging area. The control dependencies
+  // on the input pipeline now wait for the element read from it, and the
+  // fetch nodes for the element of a later step to be staged (or skipped at
+  // the end of the input).
+  for (NodeDef* fetch_node : fetch_nodes) {
+    *fetch_node->add_input() = AsControlDependency(done_name);
+  }
+  for (NodeDef& node : *graph->mutable_node()) {
+    if (pipeline.count(node.name()) > 0) {
+      continue;
+    }
+    bool reads_unstage = false;
+    int num_inputs = 0;
+    for (int i = 0; i < node.input_size(); ++i) {
+      int position;
+      const string input_name = ParseNodeName(node.input(i), &position);
+      string new_input = node.input(i);
+      if (pipeline.count(input_name) > 0) {
+        if (position < 0) {
+          new_input = AsControlDependency(unstage_name);
+        } else {
+          new_input = strings::StrCat(
+              unstage_name, ":",
+              staged_index[strings::StrCat(input_name, ":", position)]);
+          reads_unstage = true;
+        }
+      }
+      if (new_input == AsControlDependency(unstage_name)) {
+        if (reads_unstage) {
+          continue;
+        }
+        reads_unstage = true;
+      }
+      node.set_input(num_inputs++, new_input);
+    }
+    while (node.input_size() > num_inputs) {
+      node.mutable_input()->RemoveLast();
+    }
+  }
+
+  // The first step finds the staging area empty, and primes it by running up
+  // to 'depth_' copies of the input pipeline before staging its own element.
+  // The copies stop once the input is exhausted.
+  // Checking the size and staging the elements isn't atomic: this relies on
+  // the steps running one at a time, see the class comment.
+  const string prefix = kInputStagingPrefix;
+  NodeDef* size = AddNode(prefix, "size", "StageSize", device, graph);
+  SetStagingAttributes(dtypes, depth_ + 1, shared_name, size);
+  NodeDef* zero = AddInt32Const(prefix, "zero", 0, device, graph);
+  NodeDef* empty = AddNode(prefix, "empty", "Equal", device, graph);
+  (*empty->mutable_attr())["T"].set_type(DT_INT32);
+  *empty->add_input() = size->name();
+  *empty->add_input() = zero->name();
+  NodeDef* switch_node =
+      AddBoolOp(prefix, "switch", "Switch", {empty->name(), empty->name()},
+                device, graph);
+  NodeDef* prime =
+      AddBoolOp(prefix, "prime", "Identity",
+                {strings::StrCat(switch_node->name(), ":1")}, device, graph);
+
+  // The copies run one after the other, so that the elements are staged in
+  // the order in which they are produced.
+  string last_prime_done = prime->name();
+  for (int k = 0; k < depth_; ++k) {
+    const string prime_prefix = StagingNodeName(strings::StrCat("prime_", k));
+    const string exhausted = AddExhaustedCheck(prime_prefix, sources,
+                                               last_prime_done, device, graph);
+    NodeDef* run = AddBoolOp(prime_prefix, "run", "LogicalNot", {exhausted},
+                             device, graph);
+    const string alive = AddGate(prime_prefix, run->name(), device, graph);
+    for (const NodeDef& node : pipeline_nodes) {
+      NodeDef* copy = graph->add_node();
+      *copy = node;
+      copy->set_name(AddPrefixToNodeName(node.name(), prime_prefix));
+      copy->clear_input();
+      for (const string& input : node.input()) {
+        if (pipeline.count(NodeName(input)) > 0) {
+          *copy->add_input() = AddPrefixToNodeName(input, prime_prefix);
+        } else {
+          *copy->add_input() = input;
+        }
+      }
+      *copy->add_input() = AsControlDependency(alive);
+    }
+    NodeDef* prime_stage =
+        AddNode(prime_prefix, "stage", "Stage", device, graph);
+    SetStagingAttributes(dtypes, depth_ + 1, shared_name, prime_stage);
+    for (const string& tensor : staged) {
+      *prime_stage->add_input() = AddPrefixToNodeName(tensor, prime_prefix);
+    }
+    last_prime_done =
+        AddDone(prime_prefix, prime_stage->name(), device, graph);
+  }
+
+  NodeDef* primed = AddBoolOp(prefix, "primed", "Identity",
+                              {strings::StrCat(switch_node->name(), ":1"),
+                               AsControlDependency(last_prime_done)},
+                              device, graph);
+  NodeDef* skip =
+      AddBoolOp(prefix, "skip", "Identity",
+                {strings::StrCat(switch_node->name(), ":0")}, device, graph);
+  NodeDef* ready = AddBoolOp(prefix, "ready", "Merge",
+                             {primed->name(), skip->name()}, device, graph);
+
+  // Stage the element of a later step once the staging area is primed. At the
+  // end of the input, the step reads one of the elements still staged
+  // instead, and only runs the input pipeline to report the end of the input
+  // once none is left.
+  const string exhausted =
+      AddExhaustedCheck(prefix, sources, ready->name(), device, graph);
+  NodeDef* remaining = AddNode(prefix, "remaining", "StageSize", device, graph);
+  SetStagingAttributes(dtypes, depth_ + 1, shared_name, remaining);
+  *remaining->add_input() = AsControlDependency(ready->name());
+  NodeDef* none_remaining = AddNode(prefix, "none_remaining", "Equal", device,
+                                    graph);
+  (*none_remaining->mutable_attr())["T"].set_type(DT_INT32);
+  *none_remaining->add_input() = remaining->name();
+  *none_remaining->add_input() = zero->name();
+  NodeDef* has_input = AddBoolOp(prefix, "has_input", "LogicalNot",
+                                 {exhausted}, device, graph);
+  NodeDef* run =
+      AddBoolOp(prefix, "run", "LogicalOr",
+                {has_input->name(), none_remaining->name()}, device, graph);
+  const string alive = AddGate(prefix, run->name(), device, graph);
+  for (const NodeDef& node : sources) {
+    *node_map.GetNode(node.name())->add_input() = AsControlDependency(alive);
+  }
+  NodeDef* stage = AddNode(prefix, "stage", "Stage", device, graph);
+  SetStagingAttributes(dtypes, depth_ + 1, shared_name, stage);
+  for (const string& tensor : staged) {
+    *stage->add_input() = tensor;
+  }
+  AddDone(prefix, stage->name(), device, graph);
+
+  // The element of the step is read right away when one is staged already.
+  // Otherwise it is the one staged by this step: the Unstage waits for it,
+  // and doesn't run when the input pipeline fails at the end of the input.
+  NodeDef* unstage_gate = AddBoolOp(
+      prefix, "unstage_gate", "Switch",
+      {none_remaining->name(), none_remaining->name()}, device, graph);
+  NodeDef* unstage_now =
+      AddBoolOp(prefix, "unstage_now", "Identity",
+                {strings::StrCat(unstage_gate->name(), ":0")}, device, graph);
+  NodeDef* unstage_later = AddBoolOp(
+      prefix, "unstage_later", "Identity",
+      {strings::StrCat(unstage_gate->name(), ":1"),
+       AsControlDependency(done_name)},
+      device, graph);
+  NodeDef* unstage_ready =
+      AddBoolOp(prefix, "unstage_ready", "Merge",
+                {unstage_now->name(), unstage_later->name()}, device, graph);
+  NodeDef* unstage = AddNode(prefix, "unstage", "Unstage", device, graph);
+  SetStagingAttributes(dtypes, depth_ + 1, shared_name, unstage);
+  *unstage->add_input() = AsControlDependency(unstage_ready->name());
+
+  return Status::OK();
+}
+
+void InputStagingOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                     const GraphDef& optimized_graph,
+                                     double result) {
+  // Nothing to do for InputStagingOptimizer.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,71 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_INPUT_STAGING_OPTIMIZER_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_INPUT_STAGING_OPTIMIZER_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+const char kInputStagingPrefix[] = "InputStaging";
+
+// Overlaps the input pipeline of a step with the computation of the previous
+// steps, by inserting a staging area (Stage/Unstage) between the two.
+//
+// The input pipeline is made of the dequeue and IteratorGetNext nodes placed
+// on CPU, and of the stateless nodes that only depend on them and on constants
+// (e.g. decoding and preprocessing). The computation reads the elements from
+// the staging area instead, while the input pipeline prepares the element of a
+// later step. The fetch nodes reading the input pipeline wait for that element
+// to be staged. The items whose fetches don't read it, such as the steps
+// filling the queues or initializing the iterators, are left unchanged.
+//
+// 'depth' elements are prepared in advance. The first step, which finds the
+// staging area empty, runs as many extra copies of the input pipeline to
+// prime it. The input pipeline only runs while its input isn't exhausted: the
+// queues must hold enough elements or stay open, and the iterators must have a
+// next element, which IteratorHasNext gets ahead of the IteratorGetNext. Once
+// the input is exhausted, the steps read the elements left in the staging
+// area, and the following step fails with OutOfRange as the original graph
+// would.
+//
+// The rewrite assumes that the steps of the graph run one at a time, e.g.
+// from a single training loop. Steps running concurrently share the staging
+// area: they could all find it empty and prime it together, and then block
+// on a staging area holding more elements than it can.
+class InputStagingOptimizer : public GraphOptimizer {
+ public:
+  explicit InputStagingOptimizer(int depth = 1)
+      : depth_(depth > 0 ? depth : 1) {}
+  ~InputStagingOptimizer() override {}
+
+  string name() const override { return "input_staging_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+
+ private:
+  const int depth_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_INPUT_STAGING_OPTIMIZER_H_
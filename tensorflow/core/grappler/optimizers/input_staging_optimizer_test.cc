@@ -0,0 +1,369 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/input_staging_optimizer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class InputStagingOptimizerTest : public ::testing::Test {
+ protected:
+  // Builds a graph that squares the elements of a queue holding 1, 2, ... 6.
+  // The queue is filled by running "enqueue", and closed by running "close".
+  static GrapplerItem CreateItem() {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+    auto queue = ops::FIFOQueue(s.WithOpName("queue"), {DT_FLOAT});
+    Output values = ops::Const(s.WithOpName("values"),
+                               {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f}, {6});
+    ops::QueueEnqueueMany(s.WithOpName("enqueue"), queue, {values});
+    ops::QueueClose(s.WithOpName("close"), queue);
+    auto dequeue =
+        ops::QueueDequeue(s.WithOpName("dequeue"), queue, {DT_FLOAT});
+    Output square = ops::Square(s.WithOpName("square"), dequeue[0]);
+    Output out = ops::Identity(s.WithOpName("out"), square);
+
+    GrapplerItem item;
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    item.fetch.push_back("out");
+    return item;
+  }
+
+  static const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(InputStagingOptimizerTest, StagesInputPipeline) {
+  GrapplerItem item = CreateItem();
+  InputStagingOptimizer optimizer(2);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* out = FindNode(output, "out");
+  ASSERT_NE(nullptr, out);
+  ASSERT_EQ(2, out->input_size());
+  EXPECT_EQ("InputStaging/unstage:0", out->input(0));
+  EXPECT_EQ("^InputStaging/done", out->input(1));
+
+  const NodeDef* stage = FindNode(output, "InputStaging/stage");
+  ASSERT_NE(nullptr, stage);
+  EXPECT_EQ("square:0", stage->input(0));
+  EXPECT_EQ(3, stage->attr().at("capacity").i());
+
+  // The element of a later step is produced once the staging area is primed,
+  // unless the input is exhausted.
+  const NodeDef* dequeue = FindNode(output, "dequeue");
+  ASSERT_NE(nullptr, dequeue);
+  ASSERT_EQ(2, dequeue->input_size());
+  EXPECT_EQ("^InputStaging/alive", dequeue->input(1));
+  const NodeDef* closed = FindNode(output, "InputStaging/closed_0");
+  ASSERT_NE(nullptr, closed);
+  ASSERT_EQ(2, closed->input_size());
+  EXPECT_EQ("queue", closed->input(0));
+  EXPECT_EQ("^InputStaging/ready", closed->input(1));
+  const NodeDef* unstage = FindNode(output, "InputStaging/unstage");
+  ASSERT_NE(nullptr, unstage);
+  ASSERT_EQ(1, unstage->input_size());
+  EXPECT_EQ("^InputStaging/unstage_ready", unstage->input(0));
+
+  // The input pipeline is copied once per primed element, and the copies
+  // run one after the other.
+  const NodeDef* dequeue_0 = FindNode(output, "InputStaging/prime_0/dequeue");
+  ASSERT_NE(nullptr, dequeue_0);
+  EXPECT_EQ("queue", dequeue_0->input(0));
+  EXPECT_EQ("^InputStaging/prime_0/alive", dequeue_0->input(1));
+  const NodeDef* closed_0 = FindNode(output, "InputStaging/prime_0/closed_0");
+  ASSERT_NE(nullptr, closed_0);
+  EXPECT_EQ("^InputStaging/prime", closed_0->input(1));
+  const NodeDef* square_0 = FindNode(output, "InputStaging/prime_0/square");
+  ASSERT_NE(nullptr, square_0);
+  EXPECT_EQ("InputStaging/prime_0/dequeue", square_0->input(0));
+  const NodeDef* dequeue_1 = FindNode(output, "InputStaging/prime_1/dequeue");
+  ASSERT_NE(nullptr, dequeue_1);
+  EXPECT_EQ("^InputStaging/prime_1/alive", dequeue_1->input(1));
+  const NodeDef* closed_1 = FindNode(output, "InputStaging/prime_1/closed_0");
+  ASSERT_NE(nullptr, closed_1);
+  EXPECT_EQ("^InputStaging/prime_0/done", closed_1->input(1));
+  EXPECT_EQ(nullptr, FindNode(output, "InputStaging/prime_2/dequeue"));
+
+  // Nodes outside of the input pipeline are left alone.
+  const NodeDef* enqueue = FindNode(output, "enqueue");
+  ASSERT_NE(nullptr, enqueue);
+  EXPECT_EQ("queue", enqueue->input(0));
+  EXPECT_EQ(nullptr, FindNode(output, "InputStaging/prime_0/enqueue"));
+  EXPECT_EQ(nullptr, FindNode(output, "InputStaging/prime_0/close"));
+}
+
+TEST_F(InputStagingOptimizerTest, UsesOneStagingAreaPerItem) {
+  GrapplerItem item = CreateItem();
+  item.id = "first";
+  InputStagingOptimizer optimizer(2);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // All the accesses to the staging area of the item go to the same one.
+  string shared_name;
+  for (const NodeDef& node : output.node()) {
+    if (node.op() != "Stage" && node.op() != "Unstage" &&
+        node.op() != "StageSize") {
+      continue;
+    }
+    const string& name = node.attr().at("shared_name").s();
+    if (shared_name.empty()) {
+      shared_name = name;
+    }
+    EXPECT_EQ(shared_name, name) << node.name();
+  }
+  EXPECT_NE("", shared_name);
+
+  item.id = "second";
+  GraphDef other_output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &other_output));
+  const NodeDef* other_stage = FindNode(other_output, "InputStaging/stage");
+  ASSERT_NE(nullptr, other_stage);
+  EXPECT_NE(shared_name, other_stage->attr().at("shared_name").s());
+}
+
+TEST_F(InputStagingOptimizerTest, LeavesItemsNotReadingInputAlone) {
+  for (const string& fetch : {"enqueue", "close"}) {
+    GrapplerItem item = CreateItem();
+    item.fetch = {fetch};
+    InputStagingOptimizer optimizer(2);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+    EXPECT_EQ(item.graph.node_size(), output.node_size()) << fetch;
+    const NodeDef* node = FindNode(output, fetch);
+    ASSERT_NE(nullptr, node);
+    EXPECT_EQ(FindNode(item.graph, fetch)->DebugString(), node->DebugString());
+  }
+
+  // Only the fetch nodes reading the input pipeline wait for the staging.
+  GrapplerItem item = CreateItem();
+  item.fetch = {"out", "enqueue"};
+  InputStagingOptimizer optimizer(2);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  const NodeDef* out = FindNode(output, "out");
+  ASSERT_NE(nullptr, out);
+  EXPECT_EQ("^InputStaging/done", out->input(out->input_size() - 1));
+  const NodeDef* enqueue = FindNode(output, "enqueue");
+  ASSERT_NE(nullptr, enqueue);
+  EXPECT_EQ(FindNode(item.graph, "enqueue")->DebugString(),
+            enqueue->DebugString());
+}
+
+TEST_F(InputStagingOptimizerTest, PreservesOrderOfElements) {
+  GrapplerItem item = CreateItem();
+  InputStagingOptimizer optimizer(2);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  SessionOptions options;
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(output));
+  TF_ASSERT_OK(session->Run({}, {}, {"enqueue"}, nullptr));
+  // The first step primes the staging area with the first two elements.
+  for (int i = 1; i <= 4; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {"out"}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(i * i), outputs[0]);
+  }
+  TF_ASSERT_OK(session->Close());
+}
+
+TEST_F(InputStagingOptimizerTest, DrainsInput) {
+  // The input is exhausted while elements are still staged, including while
+  // the staging area is being primed.
+  for (int depth : {2, 8}) {
+    GrapplerItem item = CreateItem();
+    InputStagingOptimizer optimizer(depth);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+    SessionOptions options;
+    std::unique_ptr<Session> session(NewSession(options));
+    TF_ASSERT_OK(session->Create(output));
+    TF_ASSERT_OK(session->Run({}, {}, {"enqueue"}, nullptr));
+    TF_ASSERT_OK(session->Run({}, {}, {"close"}, nullptr));
+    for (int i = 1; i <= 6; ++i) {
+      std::vector<Tensor> outputs;
+      TF_ASSERT_OK(session->Run({}, {"out"}, {}, &outputs)) << depth;
+      ASSERT_EQ(1, outputs.size());
+      test::ExpectTensorEqual<float>(test::AsScalar<float>(i * i), outputs[0]);
+    }
+    // The end of the input is reported once all the elements were read.
+    std::vector<Tensor> outputs;
+    Status status = session->Run({}, {"out"}, {}, &outputs);
+    EXPECT_TRUE(errors::IsOutOfRange(status)) << status;
+    TF_ASSERT_OK(session->Close());
+  }
+}
+
+TEST_F(InputStagingOptimizerTest, RunsInSession) {
+  // The session rewrites the graph of each step, including the ones filling
+  // and closing the queue.
+  SessionOptions options;
+  InputStagingOptions* staging = options.config.mutable_graph_options()
+                                     ->mutable_rewrite_options()
+                                     ->mutable_input_staging();
+  staging->set_enable(true);
+  staging->set_depth(2);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(CreateItem().graph));
+  TF_ASSERT_OK(session->Run({}, {}, {"enqueue"}, nullptr));
+  int expected = 1;
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {"out"}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(expected * expected),
+                                   outputs[0]);
+    ++expected;
+  }
+  // Filling the queue again doesn't run the input pipeline.
+  TF_ASSERT_OK(session->Run({}, {}, {"enqueue"}, nullptr));
+  TF_ASSERT_OK(session->Run({}, {}, {"close"}, nullptr));
+  for (int i = 0; i < 10; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {"out"}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    const int value = (expected - 1) % 6 + 1;
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(value * value),
+                                   outputs[0]);
+    ++expected;
+  }
+  std::vector<Tensor> outputs;
+  Status status = session->Run({}, {"out"}, {}, &outputs);
+  EXPECT_TRUE(errors::IsOutOfRange(status)) << status;
+  TF_ASSERT_OK(session->Close());
+}
+
+TEST_F(InputStagingOptimizerTest, StagesIteratorInput) {
+  // Squares the elements of an iterator over 0, 1, ... 5, made by running
+  // "make_iterator".
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  ops::Const(s.WithOpName("start"), int64{0});
+  ops::Const(s.WithOpName("stop"), int64{6});
+  ops::Const(s.WithOpName("step"), int64{1});
+  GraphDef graph;
+  TF_CHECK_OK(s.ToGraphDef(&graph));
+  const DataTypeVector types = {DT_INT64};
+  const std::vector<PartialTensorShape> shapes = {PartialTensorShape({})};
+  TF_CHECK_OK(NodeDefBuilder("range", "RangeDataset")
+                  .Input("start", 0, DT_INT64)
+                  .Input("stop", 0, DT_INT64)
+                  .Input("step", 0, DT_INT64)
+                  .Attr("output_types", types)
+                  .Attr("output_shapes", shapes)
+                  .Finalize(graph.add_node()));
+  TF_CHECK_OK(NodeDefBuilder("iterator", "Iterator")
+                  .Attr("shared_name", "iterator")
+                  .Attr("container", "")
+                  .Attr("output_types", types)
+                  .Attr("output_shapes", shapes)
+                  .Finalize(graph.add_node()));
+  TF_CHECK_OK(NodeDefBuilder("make_iterator", "MakeIterator")
+                  .Input("range", 0, DT_RESOURCE)
+                  .Input("iterator", 0, DT_RESOURCE)
+                  .Finalize(graph.add_node()));
+  TF_CHECK_OK(NodeDefBuilder("get_next", "IteratorGetNext")
+                  .Input("iterator", 0, DT_RESOURCE)
+                  .Attr("output_types", types)
+                  .Attr("output_shapes", shapes)
+                  .Finalize(graph.add_node()));
+  TF_CHECK_OK(NodeDefBuilder("square", "Square")
+                  .Input("get_next", 0, DT_INT64)
+                  .Finalize(graph.add_node()));
+  TF_CHECK_OK(NodeDefBuilder("out", "Identity")
+                  .Input("square", 0, DT_INT64)
+                  .Finalize(graph.add_node()));
+
+  GrapplerItem item;
+  item.graph = graph;
+  item.fetch.push_back("out");
+  InputStagingOptimizer optimizer(2);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  const NodeDef* out = FindNode(output, "out");
+  ASSERT_NE(nullptr, out);
+  EXPECT_EQ("InputStaging/unstage:0", out->input(0));
+  const NodeDef* has_next = FindNode(output, "InputStaging/has_next_0");
+  ASSERT_NE(nullptr, has_next);
+  EXPECT_EQ("iterator", has_next->input(0));
+  EXPECT_EQ("^InputStaging/ready", has_next->input(1));
+
+  // The end of the input is reported once all the elements were read, and
+  // making the iterator again starts over.
+  SessionOptions options;
+  InputStagingOptions* staging = options.config.mutable_graph_options()
+                                     ->mutable_rewrite_options()
+                                     ->mutable_input_staging();
+  staging->set_enable(true);
+  staging->set_depth(2);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(graph));
+  for (int pass = 0; pass < 2; ++pass) {
+    TF_ASSERT_OK(session->Run({}, {}, {"make_iterator"}, nullptr));
+    for (int64 i = 0; i < 6; ++i) {
+      std::vector<Tensor> outputs;
+      TF_ASSERT_OK(session->Run({}, {"out"}, {}, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      test::ExpectTensorEqual<int64>(test::AsScalar<int64>(i * i),
+                                     outputs[0]);
+    }
+    std::vector<Tensor> outputs;
+    Status status = session->Run({}, {"out"}, {}, &outputs);
+    EXPECT_TRUE(errors::IsOutOfRange(status)) << status;
+  }
+  TF_ASSERT_OK(session->Close());
+}
+
+TEST_F(InputStagingOptimizerTest, NoInputPipeline) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {1});
+  Output b = ops::Square(s.WithOpName("b"), a);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("b");
+
+  InputStagingOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,518 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/control_flow.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Returns true if 'node' is a control flow op, which can't leave its frame.
+bool IsControlFlow(const NodeDef& node) {
+  return IsEnter(node) || IsExit(node) || IsLoopCond(node) || IsMerge(node) ||
+         IsNextIteration(node) || IsSwitch(node) ||
+         node.op() == "ControlTrigger";
+}
+
+// Gets the value of 'node' if it is a scalar boolean constant that doesn't
+// depend on anything else.
+bool GetConstantPredicate(const NodeDef& node, bool* value) {
+  if (!IsConstant(node) || node.input_size() > 0) {
+    return false;
+  }
+  auto tensor = node.attr().find("value");
+  Tensor predicate;
+  if (tensor == node.attr().end() ||
+      !predicate.FromProto(tensor->second.tensor()) ||
+      predicate.dtype() != DT_BOOL || predicate.NumElements() != 1) {
+    return false;
+  }
+  *value = predicate.flat<bool>()(0);
+  return true;
+}
+
+}  // namespace
+
+bool LoopOptimizer::IsPreserved(const NodeDef& node) const {
+  return nodes_to_preserve_.find(node.name()) != nodes_to_preserve_.end();
+}
+
+bool LoopOptimizer::IsOutputUsed(const NodeDef& node, int position) const {
+  const string output = OutputName(node.name(), position);
+  if (fetched_outputs_.find(output) != fetched_outputs_.end()) {
+    return true;
+  }
+  for (const NodeDef* consumer : node_map_->GetOutputs(node.name())) {
+    if (dead_nodes_.find(consumer->name()) != dead_nodes_.end()) {
+      continue;
+    }
+    for (const string& input : consumer->input()) {
+      int input_position;
+      if (ParseNodeName(input, &input_position) == node.name() &&
+          input_position == position) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool LoopOptimizer::IsHoistable(const NodeDef& node) const {
+  if (IsPreserved(node) || IsControlFlow(node) || IsSend(node) ||
+      IsRecv(node)) {
+    return false;
+  }
+  auto it = loop_nodes_.find(node.name());
+  if (it == loop_nodes_.end()) {
+    return false;
+  }
+  const Node* graph_node = it->second;
+  if (graph_node->op_def().is_stateful() || graph_node->num_outputs() == 0) {
+    return false;
+  }
+  for (DataType type : graph_node->input_types()) {
+    if (IsRefType(type)) {
+      return false;
+    }
+  }
+  for (DataType type : graph_node->output_types()) {
+    if (IsRefType(type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+NodeDef* LoopOptimizer::GetInvariantEnter(const NodeDef& node, int position,
+                                          const string& frame_name,
+                                          const NodeDef& frame_enter) {
+  const string output = OutputName(node.name(), position);
+  auto it = invariant_enters_.find(output);
+  if (it != invariant_enters_.end()) {
+    return it->second;
+  }
+  string suffix = "/Enter";
+  if (position > 0) {
+    strings::StrAppend(&suffix, "_", position);
+  }
+  const string base_name =
+      AddPrefixToNodeName(strings::StrCat(node.name(), suffix), kLoopOptimizer);
+  // The graph may already have a node with that name, e.g. if it went through
+  // this optimizer before.
+  string name = base_name;
+  for (int i = 1; node_map_->GetNode(name) != nullptr; ++i) {
+    name = strings::StrCat(base_name, "/", i);
+  }
+  NodeDef* enter = graph_->add_node();
+  enter->set_name(name);
+  enter->set_op("Enter");
+  enter->set_device(node.device());
+  enter->add_input(output);
+  auto& attr = *enter->mutable_attr();
+  attr["T"].set_type(loop_nodes_.at(node.name())->output_type(position));
+  attr["frame_name"].set_s(frame_name);
+  attr["is_constant"].set_b(true);
+  attr["parallel_iterations"] = frame_enter.attr().at("parallel_iterations");
+  node_map_->AddNode(enter->name(), enter);
+  node_map_->AddOutput(node.name(), enter->name());
+  invariant_enters_[output] = enter;
+  return enter;
+}
+
+int LoopOptimizer::HoistLoopInvariants(const string& frame_name,
+                                       const std::vector<NodeDef*>& members) {
+  std::unordered_set<string> in_frame;
+  for (const NodeDef* node : members) {
+    in_frame.insert(node->name());
+  }
+
+  // The constants of the loop body are only invariant when their control
+  // inputs merely place them in the loop, i.e. come from a constant Enter node
+  // or from the pivot of the loop (an Identity on the Switch of the LoopCond).
+  // The constants of a cond in the loop body are gated by another Switch and
+  // must only be produced when their branch is taken.
+  auto is_constant_enter = [](const NodeDef& node) {
+    if (!IsEnter(node)) {
+      return false;
+    }
+    auto is_constant = node.attr().find("is_constant");
+    return is_constant != node.attr().end() && is_constant->second.b();
+  };
+  auto is_loop_pivot = [this](const NodeDef& node) {
+    if (!IsIdentity(node) || node.input_size() < 1) {
+      return false;
+    }
+    const NodeDef* pivot_switch = node_map_->GetNode(NodeName(node.input(0)));
+    if (pivot_switch == nullptr || !IsSwitch(*pivot_switch) ||
+        pivot_switch->input_size() < 2) {
+      return false;
+    }
+    const NodeDef* pred = node_map_->GetNode(NodeName(pivot_switch->input(1)));
+    return pred != nullptr && IsLoopCond(*pred);
+  };
+  auto is_placed_in_loop = [&](const NodeDef& node) {
+    for (const string& input : node.input()) {
+      if (!IsControlInput(input)) {
+        return false;
+      }
+      const NodeDef* input_node = node_map_->GetNode(NodeName(input));
+      if (input_node == nullptr ||
+          (!is_constant_enter(*input_node) && !is_loop_pivot(*input_node))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // Propagate invariance from the constant Enter nodes and the constants of
+  // the loop body that are placed in the loop by them or by the loop pivot.
+  const NodeDef* frame_enter = nullptr;
+  std::unordered_set<string> invariant;
+  std::deque<const NodeDef*> ready;
+  for (const NodeDef* node : members) {
+    if (IsEnter(*node)) {
+      if (frame_enter == nullptr &&
+          node->attr().count("parallel_iterations") > 0) {
+        frame_enter = node;
+      }
+      if (is_constant_enter(*node)) {
+        invariant.insert(node->name());
+        ready.push_back(node);
+      }
+    } else if (IsConstant(*node) && IsHoistable(*node) &&
+               is_placed_in_loop(*node)) {
+      invariant.insert(node->name());
+      ready.push_back(node);
+    }
+  }
+  if (frame_enter == nullptr) {
+    return 0;
+  }
+  while (!ready.empty()) {
+    const NodeDef* node = ready.front();
+    ready.pop_front();
+    for (const NodeDef* consumer : node_map_->GetOutputs(node->name())) {
+      if (in_frame.find(consumer->name()) == in_frame.end() ||
+          invariant.find(consumer->name()) != invariant.end() ||
+          !IsHoistable(*consumer)) {
+        continue;
+      }
+      bool is_invariant = true;
+      for (const string& input : consumer->input()) {
+        if (invariant.find(NodeName(input)) == invariant.end()) {
+          is_invariant = false;
+          break;
+        }
+      }
+      if (is_invariant) {
+        invariant.insert(consumer->name());
+        ready.push_back(consumer);
+      }
+    }
+  }
+
+  // Only move the constants that feed a moved computation: moving the others
+  // would just add an Enter node in front of their consumers.
+  std::unordered_set<string> hoisted;
+  for (const string& name : invariant) {
+    const NodeDef* node = node_map_->GetNode(name);
+    if (!IsEnter(*node) && !IsConstant(*node)) {
+      hoisted.insert(name);
+    }
+  }
+  if (hoisted.empty()) {
+    return 0;
+  }
+  for (const string& name : invariant) {
+    const NodeDef* node = node_map_->GetNode(name);
+    if (!IsConstant(*node)) {
+      continue;
+    }
+    for (const NodeDef* consumer : node_map_->GetOutputs(name)) {
+      if (hoisted.find(consumer->name()) != hoisted.end() &&
+          !IsConstant(*consumer)) {
+        hoisted.insert(name);
+        break;
+      }
+    }
+  }
+
+  // Read the inputs of the moved nodes from outside the loop.  The control
+  // inputs that only placed constants in the loop are dropped.
+  for (const string& name : hoisted) {
+    NodeDef* node = node_map_->GetNode(name);
+    std::vector<string> inputs;
+    for (const string& input : node->input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      if (hoisted.find(input_name) != hoisted.end()) {
+        inputs.push_back(input);
+        continue;
+      }
+      const NodeDef* input_node = node_map_->GetNode(input_name);
+      if (!IsEnter(*input_node)) {
+        continue;
+      }
+      int outer_position;
+      const string outer_name =
+          ParseNodeName(input_node->input(0), &outer_position);
+      inputs.push_back(
+          OutputName(outer_name, position < 0 ? -1 : outer_position));
+      node_map_->AddOutput(outer_name, name);
+      dead_candidates_.insert(input_name);
+    }
+    node->clear_input();
+    for (const string& input : inputs) {
+      node->add_input(input);
+    }
+  }
+
+  // Feed the moved results back into the loop.
+  for (const string& name : hoisted) {
+    const NodeDef* node = node_map_->GetNode(name);
+    const std::set<NodeDef*> consumers = node_map_->GetOutputs(name);
+    for (NodeDef* consumer : consumers) {
+      if (hoisted.find(consumer->name()) != hoisted.end()) {
+        continue;
+      }
+      for (int i = 0; i < consumer->input_size(); ++i) {
+        int position;
+        if (ParseNodeName(consumer->input(i), &position) != name) {
+          continue;
+        }
+        const NodeDef* enter = GetInvariantEnter(
+            *node, std::max(position, 0), frame_name, *frame_enter);
+        consumer->set_input(
+            i, position < 0 ? OutputName(enter->name(), -1) : enter->name());
+        node_map_->AddOutput(enter->name(), consumer->name());
+      }
+    }
+  }
+  return hoisted.size();
+}
+
+bool LoopOptimizer::RemoveIdentityInput(NodeDef* node) {
+  if (node->op() != "Identity" || node->input_size() == 0 ||
+      IsControlInput(node->input(0))) {
+    return false;
+  }
+  NodeDef* input = node_map_->GetNode(NodeName(node->input(0)));
+  if (input == nullptr || input->op() != "Identity" || IsPreserved(*input) ||
+      input->device() != node->device() || input->input_size() == 0 ||
+      dead_nodes_.find(input->name()) != dead_nodes_.end()) {
+    return false;
+  }
+  const std::set<NodeDef*>& consumers = node_map_->GetOutputs(input->name());
+  if (consumers.size() != 1 || *consumers.begin() != node ||
+      IsOutputUsed(*input, -1)) {
+    return false;
+  }
+  node->set_input(0, input->input(0));
+  node_map_->UpdateOutput(NodeName(input->input(0)), input->name(),
+                          node->name());
+  for (int i = 1; i < input->input_size(); ++i) {
+    node->add_input(input->input(i));
+    node_map_->UpdateOutput(NodeName(input->input(i)), input->name(),
+                            node->name());
+  }
+  dead_nodes_.insert(input->name());
+  return true;
+}
+
+bool LoopOptimizer::SimplifyMerge(NodeDef* node) {
+  if (node->op() != "Merge") {
+    return false;
+  }
+  int num_data_inputs = 0;
+  for (const string& input : node->input()) {
+    if (!IsControlInput(input)) {
+      ++num_data_inputs;
+    }
+  }
+  // The second output of Merge is the index of the input it forwarded.
+  if (num_data_inputs != 1 || IsControlInput(node->input(0)) ||
+      IsOutputUsed(*node, 1)) {
+    return false;
+  }
+  node->set_op("Identity");
+  node->mutable_attr()->erase("N");
+  return true;
+}
+
+bool LoopOptimizer::SimplifySwitch(NodeDef* node) {
+  if (node->op() != "Switch" || node->input_size() < 2 ||
+      IsControlInput(node->input(1))) {
+    return false;
+  }
+  const NodeDef* predicate = node_map_->GetNode(NodeName(node->input(1)));
+  bool value;
+  if (predicate == nullptr || !GetConstantPredicate(*predicate, &value)) {
+    return false;
+  }
+  // Switch forwards its input to output 1 if the predicate is true, and to
+  // output 0 otherwise.  The control output fires in both cases.
+  const int taken = value ? 1 : 0;
+  if (IsOutputUsed(*node, 1 - taken) || IsOutputUsed(*node, -1)) {
+    return false;
+  }
+  if (taken == 1) {
+    const string output = OutputName(node->name(), 1);
+    for (NodeDef* consumer : node_map_->GetOutputs(node->name())) {
+      for (int i = 0; i < consumer->input_size(); ++i) {
+        if (consumer->input(i) == output) {
+          consumer->set_input(i, node->name());
+        }
+      }
+    }
+  }
+  // The predicate stays a control input so that the node stays in its frame.
+  node->set_op("Identity");
+  node->set_input(1, OutputName(predicate->name(), -1));
+  return true;
+}
+
+bool LoopOptimizer::SimplifyControlFlow(NodeDef* node) {
+  if (IsPreserved(*node) ||
+      dead_nodes_.find(node->name()) != dead_nodes_.end()) {
+    return false;
+  }
+  if (SimplifyMerge(node) || SimplifySwitch(node)) {
+    return true;
+  }
+  bool simplified = false;
+  while (RemoveIdentityInput(node)) {
+    simplified = true;
+  }
+  return simplified;
+}
+
+void LoopOptimizer::RemoveDeadNodes() {
+  std::unordered_map<string, int> num_consumers;
+  for (const NodeDef& node : graph_->node()) {
+    if (dead_nodes_.find(node.name()) != dead_nodes_.end()) {
+      continue;
+    }
+    for (const string& input : node.input()) {
+      ++num_consumers[NodeName(input)];
+    }
+  }
+  for (const string& name : dead_candidates_) {
+    if (num_consumers[name] == 0 &&
+        nodes_to_preserve_.find(name) == nodes_to_preserve_.end()) {
+      dead_nodes_.insert(name);
+    }
+  }
+
+  const int num_deleted = DeleteNodes(dead_nodes_, graph_);
+  VLOG(1) << "Removed " << num_deleted << " nodes from the graph.";
+}
+
+Status LoopOptimizer::Optimize(Cluster* /*cluster*/, const GrapplerItem& item,
+                               GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  graph_ = optimized_graph;
+  nodes_to_preserve_.clear();
+  fetched_outputs_.clear();
+  invariant_enters_.clear();
+  dead_nodes_.clear();
+  dead_candidates_.clear();
+  std::vector<string> outputs = item.fetch;
+  for (const auto& feed : item.feed) {
+    outputs.push_back(feed.first);
+  }
+  for (const string& output : outputs) {
+    int position;
+    const string name = ParseNodeName(output, &position);
+    nodes_to_preserve_.insert(name);
+    fetched_outputs_.insert(OutputName(name, position));
+  }
+  node_map_.reset(new NodeMap(graph_));
+
+  bool has_loops = false;
+  for (const NodeDef& node : graph_->node()) {
+    if (IsEnter(node)) {
+      has_loops = true;
+      break;
+    }
+  }
+  if (has_loops) {
+    // The frames are found on a Graph, which also provides the op
+    // definitions and types of the nodes.
+    FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                               graph_->library());
+    Graph graph(function_library);
+    GraphConstructorOptions options;
+    options.allow_internal_ops = true;
+    std::vector<ControlFlowInfo> control_flow_info;
+    Status status = ConvertGraphDefToGraph(options, *graph_, &graph);
+    if (status.ok()) {
+      status = BuildControlFlowInfo(&graph, &control_flow_info);
+    }
+    if (!status.ok()) {
+      VLOG(1) << "Not moving loop invariants: " << status;
+    } else {
+      std::map<string, std::vector<NodeDef*>> frames;
+      for (const Node* node : graph.op_nodes()) {
+        const ControlFlowInfo& info = control_flow_info[node->id()];
+        if (info.frame_name.empty() ||
+            !control_flow_info[info.parent_frame->id()].frame_name.empty()) {
+          continue;
+        }
+        loop_nodes_[node->name()] = node;
+        frames[info.frame_name].push_back(node_map_->GetNode(node->name()));
+      }
+      int num_hoisted = 0;
+      for (const auto& frame : frames) {
+        num_hoisted += HoistLoopInvariants(frame.first, frame.second);
+      }
+      VLOG(1) << "Moved " << num_hoisted << " loop invariant nodes.";
+      loop_nodes_.clear();
+    }
+  }
+
+  int num_simplified = 0;
+  for (int i = 0; i < graph_->node_size(); ++i) {
+    if (SimplifyControlFlow(graph_->mutable_node(i))) {
+      ++num_simplified;
+    }
+  }
+  VLOG(1) << "Simplified " << num_simplified << " control flow nodes.";
+
+  RemoveDeadNodes();
+  return Status::OK();
+}
+
+void LoopOptimizer::Feedback(Cluster* /*cluster*/, const GrapplerItem& /*item*/,
+                             const GraphDef& /*optimized_graph*/,
+                             double /*result*/) {
+  // Nothing to do for LoopOptimizer.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
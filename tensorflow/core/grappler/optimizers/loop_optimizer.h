@@ -0,0 +1,106 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_LOOP_OPTIMIZER_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_LOOP_OPTIMIZER_H_
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/utils.h"
+
+namespace tensorflow {
+
+class Node;
+
+namespace grappler {
+
+const char kLoopOptimizer[] = "LoopOptimizer";
+
+// Optimizes the control flow of a graph:
+//  * Nodes of a while loop that only depend on constants and on the loop
+//    invariant inputs of the loop (the Enter nodes with is_constant set) are
+//    moved in front of the loop, so that they run once instead of once per
+//    iteration.  Their results are fed back into the loop through new
+//    constant Enter nodes.  Loops nested in other loops are left alone.
+//  * Identity(Identity(x)) becomes Identity(x), a Merge with a single input
+//    becomes an Identity, and so does a Switch whose predicate is a constant
+//    when nothing reads its other output.
+class LoopOptimizer : public GraphOptimizer {
+ public:
+  LoopOptimizer() {}
+  ~LoopOptimizer() override {}
+
+  string name() const override { return "loop_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+
+ private:
+  // Moves the loop invariant nodes among 'members', the nodes of the frame
+  // 'frame_name', in front of the loop.  Returns the number of nodes moved.
+  int HoistLoopInvariants(const string& frame_name,
+                          const std::vector<NodeDef*>& members);
+
+  // Returns true if 'node' may be moved out of its loop when its inputs are
+  // loop invariant.
+  bool IsHoistable(const NodeDef& node) const;
+
+  // Returns a constant Enter node of the frame 'frame_name' that forwards
+  // output 'position' of 'node' into the loop, creating it if needed.
+  NodeDef* GetInvariantEnter(const NodeDef& node, int position,
+                             const string& frame_name,
+                             const NodeDef& frame_enter);
+
+  // Simplifies the Identity, Merge or Switch 'node'.
+  bool SimplifyControlFlow(NodeDef* node);
+  bool RemoveIdentityInput(NodeDef* node);
+  bool SimplifyMerge(NodeDef* node);
+  bool SimplifySwitch(NodeDef* node);
+
+  // Returns true if output 'position' of 'node' is consumed or fetched.
+  // Position -1 stands for the control output.
+  bool IsOutputUsed(const NodeDef& node, int position) const;
+
+  bool IsPreserved(const NodeDef& node) const;
+
+  // Removes the bypassed nodes from graph_, along with the Enter nodes that
+  // no longer have any consumer.
+  void RemoveDeadNodes();
+
+  GraphDef* graph_;
+  std::unique_ptr<NodeMap> node_map_;
+  std::unordered_set<string> nodes_to_preserve_;
+  // The fetched and fed outputs, in the form used by inputs.
+  std::unordered_set<string> fetched_outputs_;
+  // The nodes of the top-level loops, as built from graph_ to find the
+  // frames, by name.
+  std::unordered_map<string, const Node*> loop_nodes_;
+  // The Enter nodes created to forward hoisted outputs, by output.
+  std::unordered_map<string, NodeDef*> invariant_enters_;
+  // Nodes bypassed by a rewrite.
+  std::unordered_set<string> dead_nodes_;
+  // Enter nodes that may have lost all their consumers.
+  std::unordered_set<string> dead_candidates_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_LOOP_OPTIMIZER_H_
@@ -0,0 +1,334 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+class LoopOptimizerTest : public ::testing::Test {
+ protected:
+  // Returns the node named 'name' in 'graph', or nullptr.
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+
+  NodeDef Enter(const string& name, const string& input, DataType type,
+                bool is_constant) {
+    return NDef(name, "Enter", {input},
+                {{"T", type},
+                 {"frame_name", "loop"},
+                 {"is_constant", is_constant},
+                 {"parallel_iterations", 10}});
+  }
+
+  std::vector<Tensor> EvaluateNodes(const GraphDef& graph,
+                                    const std::vector<string>& fetch) {
+    SessionOptions options;
+    std::unique_ptr<tensorflow::Session> session(NewSession(options));
+    TF_CHECK_OK(session->Create(graph));
+    RunOptions run_options;
+    std::vector<Tensor> output_tensors;
+    TF_CHECK_OK(
+        session->Run(run_options, {}, fetch, fetch, &output_tensors, nullptr));
+    TF_CHECK_OK(session->Close());
+    return output_tensors;
+  }
+
+  // acc = 0; for (i = 0; i < 3; ++i) acc += matmul(a, b) * 2;
+  GraphDef MatMulLoop() {
+    return test::function::GDef({
+        NDef("a", "Const", {},
+             {{"dtype", DT_FLOAT},
+              {"value", test::AsTensor<float>({1, 2, 3, 4}, {2, 2})}}),
+        NDef("b", "Const", {},
+             {{"dtype", DT_FLOAT},
+              {"value", test::AsTensor<float>({5, 6, 7, 8}, {2, 2})}}),
+        NDef("acc_init", "Const", {},
+             {{"dtype", DT_FLOAT},
+              {"value", test::AsTensor<float>({0, 0, 0, 0}, {2, 2})}}),
+        NDef("i_init", "Const", {},
+             {{"dtype", DT_INT32}, {"value", test::AsScalar<int32>(0)}}),
+        NDef("limit", "Const", {},
+             {{"dtype", DT_INT32}, {"value", test::AsScalar<int32>(3)}}),
+        Enter("a_enter", "a", DT_FLOAT, true),
+        Enter("b_enter", "b", DT_FLOAT, true),
+        Enter("limit_enter", "limit", DT_INT32, true),
+        Enter("acc_enter", "acc_init", DT_FLOAT, false),
+        Enter("i_enter", "i_init", DT_INT32, false),
+        NDef("acc_merge", "Merge", {"acc_enter", "acc_next"},
+             {{"T", DT_FLOAT}, {"N", 2}}),
+        NDef("i_merge", "Merge", {"i_enter", "i_next"},
+             {{"T", DT_INT32}, {"N", 2}}),
+        NDef("less", "Less", {"i_merge", "limit_enter"}, {{"T", DT_INT32}}),
+        NDef("cond", "LoopCond", {"less"}),
+        NDef("acc_switch", "Switch", {"acc_merge", "cond"},
+             {{"T", DT_FLOAT}}),
+        NDef("i_switch", "Switch", {"i_merge", "cond"}, {{"T", DT_INT32}}),
+        NDef("acc_body", "Identity", {"acc_switch:1"}, {{"T", DT_FLOAT}}),
+        NDef("i_body", "Identity", {"i_switch:1"}, {{"T", DT_INT32}}),
+        NDef("one", "Const", {"^i_body"},
+             {{"dtype", DT_INT32}, {"value", test::AsScalar<int32>(1)}}),
+        NDef("two", "Const", {"^i_body"},
+             {{"dtype", DT_FLOAT}, {"value", test::AsScalar<float>(2)}}),
+        NDef("matmul", "MatMul", {"a_enter", "b_enter"}, {{"T", DT_FLOAT}}),
+        NDef("scaled", "Mul", {"matmul", "two"}, {{"T", DT_FLOAT}}),
+        NDef("acc_add", "Add", {"acc_body", "scaled"}, {{"T", DT_FLOAT}}),
+        NDef("i_add", "Add", {"i_body", "one"}, {{"T", DT_INT32}}),
+        NDef("acc_next", "NextIteration", {"acc_add"}, {{"T", DT_FLOAT}}),
+        NDef("i_next", "NextIteration", {"i_add"}, {{"T", DT_INT32}}),
+        NDef("acc_exit", "Exit", {"acc_switch"}, {{"T", DT_FLOAT}}),
+        NDef("i_exit", "Exit", {"i_switch"}, {{"T", DT_INT32}}),
+    });
+  }
+};
+
+TEST_F(LoopOptimizerTest, HoistLoopInvariants) {
+  GrapplerItem item;
+  item.graph = MatMulLoop();
+  item.fetch.push_back("acc_exit");
+
+  LoopOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // The constant Enter nodes of a and b are no longer used.
+  EXPECT_EQ(item.graph.node_size() - 1, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "a_enter"));
+  EXPECT_EQ(nullptr, FindNode(output, "b_enter"));
+  const NodeDef* matmul = FindNode(output, "matmul");
+  ASSERT_NE(nullptr, matmul);
+  ASSERT_EQ(2, matmul->input_size());
+  EXPECT_EQ("a", matmul->input(0));
+  EXPECT_EQ("b", matmul->input(1));
+  const NodeDef* two = FindNode(output, "two");
+  ASSERT_NE(nullptr, two);
+  EXPECT_EQ(0, two->input_size());
+  // The constant used by the loop variant computation stays in the loop.
+  const NodeDef* one = FindNode(output, "one");
+  ASSERT_NE(nullptr, one);
+  ASSERT_EQ(1, one->input_size());
+  EXPECT_EQ("^i_body", one->input(0));
+
+  const NodeDef* acc_add = FindNode(output, "acc_add");
+  ASSERT_NE(nullptr, acc_add);
+  ASSERT_EQ(2, acc_add->input_size());
+  EXPECT_EQ("acc_body", acc_add->input(0));
+  const NodeDef* enter = FindNode(output, acc_add->input(1));
+  ASSERT_NE(nullptr, enter);
+  EXPECT_EQ("Enter", enter->op());
+  ASSERT_EQ(1, enter->input_size());
+  EXPECT_EQ("scaled", enter->input(0));
+  EXPECT_EQ("loop", enter->attr().at("frame_name").s());
+  EXPECT_TRUE(enter->attr().at("is_constant").b());
+  EXPECT_EQ(10, enter->attr().at("parallel_iterations").i());
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"acc_exit"});
+  auto tensors = EvaluateNodes(output, {"acc_exit"});
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
+TEST_F(LoopOptimizerTest, HoistedEnterGetsUniqueName) {
+  GrapplerItem item;
+  item.graph = MatMulLoop();
+  // Takes the name the hoisted Enter of 'scaled' would get.
+  *item.graph.add_node() =
+      NDef("LoopOptimizer/scaled/Enter", "Const", {},
+           {{"dtype", DT_FLOAT}, {"value", test::AsScalar<float>(7)}});
+  item.fetch.push_back("acc_exit");
+  item.fetch.push_back("LoopOptimizer/scaled/Enter");
+
+  LoopOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* existing = FindNode(output, "LoopOptimizer/scaled/Enter");
+  ASSERT_NE(nullptr, existing);
+  EXPECT_EQ("Const", existing->op());
+  const NodeDef* acc_add = FindNode(output, "acc_add");
+  ASSERT_NE(nullptr, acc_add);
+  ASSERT_EQ(2, acc_add->input_size());
+  EXPECT_EQ("LoopOptimizer/scaled/Enter/1", acc_add->input(1));
+  const NodeDef* enter = FindNode(output, acc_add->input(1));
+  ASSERT_NE(nullptr, enter);
+  EXPECT_EQ("Enter", enter->op());
+  ASSERT_EQ(1, enter->input_size());
+  EXPECT_EQ("scaled", enter->input(0));
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+  auto tensors = EvaluateNodes(output, item.fetch);
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+  test::ExpectTensorEqual<float>(tensors_expected[1], tensors[1]);
+}
+
+TEST_F(LoopOptimizerTest, KeepsCondConstantsInLoop) {
+  // acc = 0; for (i = 0; i < 3; ++i) acc += i < 1 ? square(10) : square(20);
+  GrapplerItem item;
+  item.graph = test::function::GDef({
+      NDef("acc_init", "Const", {},
+           {{"dtype", DT_FLOAT}, {"value", test::AsScalar<float>(0)}}),
+      NDef("i_init", "Const", {},
+           {{"dtype", DT_INT32}, {"value", test::AsScalar<int32>(0)}}),
+      NDef("limit", "Const", {},
+           {{"dtype", DT_INT32}, {"value", test::AsScalar<int32>(3)}}),
+      Enter("limit_enter", "limit", DT_INT32, true),
+      Enter("acc_enter", "acc_init", DT_FLOAT, false),
+      Enter("i_enter", "i_init", DT_INT32, false),
+      NDef("acc_merge", "Merge", {"acc_enter", "acc_next"},
+           {{"T", DT_FLOAT}, {"N", 2}}),
+      NDef("i_merge", "Merge", {"i_enter", "i_next"},
+           {{"T", DT_INT32}, {"N", 2}}),
+      NDef("less", "Less", {"i_merge", "limit_enter"}, {{"T", DT_INT32}}),
+      NDef("cond", "LoopCond", {"less"}),
+      NDef("acc_switch", "Switch", {"acc_merge", "cond"}, {{"T", DT_FLOAT}}),
+      NDef("i_switch", "Switch", {"i_merge", "cond"}, {{"T", DT_INT32}}),
+      NDef("acc_body", "Identity", {"acc_switch:1"}, {{"T", DT_FLOAT}}),
+      NDef("i_body", "Identity", {"i_switch:1"}, {{"T", DT_INT32}}),
+      NDef("one", "Const", {"^i_body"},
+           {{"dtype", DT_INT32}, {"value", test::AsScalar<int32>(1)}}),
+      NDef("first", "Less", {"i_body", "one"}, {{"T", DT_INT32}}),
+      NDef("branch_switch", "Switch", {"acc_body", "first"},
+           {{"T", DT_FLOAT}}),
+      NDef("then_pivot", "Identity", {"branch_switch:1"}, {{"T", DT_FLOAT}}),
+      NDef("else_pivot", "Identity", {"branch_switch"}, {{"T", DT_FLOAT}}),
+      NDef("then_value", "Const", {"^then_pivot"},
+           {{"dtype", DT_FLOAT}, {"value", test::AsScalar<float>(10)}}),
+      NDef("else_value", "Const", {"^else_pivot"},
+           {{"dtype", DT_FLOAT}, {"value", test::AsScalar<float>(20)}}),
+      NDef("then_square", "Square", {"then_value"}, {{"T", DT_FLOAT}}),
+      NDef("else_square", "Square", {"else_value"}, {{"T", DT_FLOAT}}),
+      NDef("branch_merge", "Merge", {"else_square", "then_square"},
+           {{"T", DT_FLOAT}, {"N", 2}}),
+      NDef("acc_add", "Add", {"acc_body", "branch_merge"}, {{"T", DT_FLOAT}}),
+      NDef("i_add", "Add", {"i_body", "one"}, {{"T", DT_INT32}}),
+      NDef("acc_next", "NextIteration", {"acc_add"}, {{"T", DT_FLOAT}}),
+      NDef("i_next", "NextIteration", {"i_add"}, {{"T", DT_INT32}}),
+      NDef("acc_exit", "Exit", {"acc_switch"}, {{"T", DT_FLOAT}}),
+      NDef("i_exit", "Exit", {"i_switch"}, {{"T", DT_INT32}}),
+  });
+  item.fetch.push_back("acc_exit");
+
+  LoopOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // The constants of the branches only exist when their branch is taken, so
+  // neither they nor their consumers leave the loop.
+  for (const string& name : {"then_value", "else_value"}) {
+    const NodeDef* value = FindNode(output, name);
+    ASSERT_NE(nullptr, value);
+    ASSERT_EQ(1, value->input_size());
+  }
+  EXPECT_EQ("^then_pivot", FindNode(output, "then_value")->input(0));
+  EXPECT_EQ("^else_pivot", FindNode(output, "else_value")->input(0));
+  const NodeDef* then_square = FindNode(output, "then_square");
+  ASSERT_NE(nullptr, then_square);
+  ASSERT_EQ(1, then_square->input_size());
+  EXPECT_EQ("then_value", then_square->input(0));
+  const NodeDef* branch_merge = FindNode(output, "branch_merge");
+  ASSERT_NE(nullptr, branch_merge);
+  ASSERT_EQ(2, branch_merge->input_size());
+  EXPECT_EQ("else_square", branch_merge->input(0));
+  EXPECT_EQ("then_square", branch_merge->input(1));
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"acc_exit"});
+  auto tensors = EvaluateNodes(output, {"acc_exit"});
+  test::ExpectTensorEqual<float>(test::AsScalar<float>(900),
+                                 tensors_expected[0]);
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
+TEST_F(LoopOptimizerTest, SimplifyControlFlow) {
+  GrapplerItem item;
+  item.graph = test::function::GDef({
+      NDef("x", "Const", {},
+           {{"dtype", DT_FLOAT},
+            {"value", test::AsTensor<float>({1, 2}, {2})}}),
+      NDef("pred", "Const", {},
+           {{"dtype", DT_BOOL}, {"value", test::AsScalar<bool>(true)}}),
+      NDef("id1", "Identity", {"x"}, {{"T", DT_FLOAT}}),
+      NDef("id2", "Identity", {"id1"}, {{"T", DT_FLOAT}}),
+      NDef("merge", "Merge", {"id2"}, {{"T", DT_FLOAT}, {"N", 1}}),
+      NDef("switch", "Switch", {"merge", "pred"}, {{"T", DT_FLOAT}}),
+      NDef("out", "Identity", {"switch:1"}, {{"T", DT_FLOAT}}),
+  });
+  item.fetch.push_back("out");
+
+  LoopOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // The Merge and Switch become Identity nodes, and the chain of Identity
+  // nodes collapses into the fetched one.
+  EXPECT_EQ(3, output.node_size());
+  const NodeDef* out = FindNode(output, "out");
+  ASSERT_NE(nullptr, out);
+  ASSERT_EQ(2, out->input_size());
+  EXPECT_EQ("x", out->input(0));
+  EXPECT_EQ("^pred", out->input(1));
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"out"});
+  auto tensors = EvaluateNodes(output, {"out"});
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
+TEST_F(LoopOptimizerTest, KeepsUsedSwitchOutputs) {
+  GrapplerItem item;
+  item.graph = test::function::GDef({
+      NDef("x", "Const", {},
+           {{"dtype", DT_FLOAT},
+            {"value", test::AsTensor<float>({1, 2}, {2})}}),
+      NDef("pred", "Const", {},
+           {{"dtype", DT_BOOL}, {"value", test::AsScalar<bool>(false)}}),
+      NDef("switch", "Switch", {"x", "pred"}, {{"T", DT_FLOAT}}),
+      NDef("f", "Identity", {"switch"}, {{"T", DT_FLOAT}}),
+      NDef("t", "Identity", {"switch:1"}, {{"T", DT_FLOAT}}),
+      NDef("merge", "Merge", {"f", "t"}, {{"T", DT_FLOAT}, {"N", 2}}),
+  });
+  item.fetch.push_back("merge");
+
+  LoopOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    EXPECT_EQ(item.graph.node(i).DebugString(), output.node(i).DebugString());
+  }
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -23,7 +23,11 @@ limitations under the License.
 
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_def.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/graph_memory.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/op_types.h"
@@ -441,7 +445,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                  (cheap_to_recompute_ops.count(node.op()) > 0 ||
                   node.attr().count(kRecomputeHint) > 0);
         });
-  } else {  // optimization_level == RewriterConfig::MANUAL
+  } else {  // MANUAL, SWAPPING_HEURISTICS or RECOMPUTATION_HEURISTICS
     recomputed_subgraphs =
         GetOpGroupsToRecompute(graph, node_map, [](const NodeDef& node) {
           return !IsTargetOp(node) && node.attr().count(kRecomputeHint) > 0;
@@ -462,21 +466,223 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
 }
 
+// Returns the memory of the smallest device of 'cluster', or 0 if unknown.
+static int64 GetMemoryLimit(const Cluster& cluster) {
+  int64 memory_limit = 0;
+  for (const auto& device : cluster.GetDevices()) {
+    const int64 memory_size = device.second.memory_size();
+    if (memory_size > 0 && (memory_limit == 0 || memory_size < memory_limit)) {
+      memory_limit = memory_size;
+    }
+  }
+  return memory_limit;
+}
+
+// Returns the number of GPUs of 'cluster'.
+static int GetNumGpus(const Cluster& cluster) {
+  int num_gpus = 0;
+  for (const auto& device : cluster.GetDevices()) {
+    if (device.second.type() == "GPU") {
+      ++num_gpus;
+    }
+  }
+  return num_gpus;
+}
+
+// Returns true if 'node' may be copied and run a second time.
+static bool IsRecomputable(const NodeDef& node) {
+  if (IsConstant(node) || IsVariable(node) || IsPlaceholder(node) ||
+      IsEnter(node) || IsExit(node) || IsMerge(node) || IsSwitch(node) ||
+      IsNextIteration(node) || IsSend(node) || IsRecv(node)) {
+    return false;
+  }
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok()) {
+    return false;
+  }
+  // Stateful ops, such as random ops, may give a different result.
+  return !op_def->is_stateful();
+}
+
+struct RecomputationCandidate {
+  NodeDef* node = nullptr;
+  // The memory freed during the peak if the node is recomputed.
+  int64 memory_saved = 0;
+  // The nodes that read the outputs of the node after the peak.
+  std::unordered_set<NodeDef*> target_nodes;
+};
+
+// Recomputes, instead of keeping them in memory, the outputs that are alive
+// at the peak of the memory usage but only read after it, until the peak
+// fits in the memory of the smallest device of 'cluster' (or all of them if
+// the memory of the devices is unknown). The nodes that are the cheapest to
+// recompute for the memory they free are picked first. Only the nodes whose
+// inputs stay in memory through the peak anyway are considered, so that
+// recomputing them doesn't extend the life of other tensors.
+void AutomaticRecomputationPass(Cluster* cluster, const GrapplerItem& item,
+                                GraphDef* graph) {
+  // As in RecomputationRewritingPass, sort the graph before taking pointers to
+  // its nodes.
+  TopologicalSort(graph);
+  GrapplerItem optimized_item = item;
+  optimized_item.graph = *graph;
+  GraphMemory memory(optimized_item);
+  Status status = memory.InferStatically();
+  if (!status.ok()) {
+    VLOG(1) << "Failed to infer the memory usage: " << status;
+    return;
+  }
+  const GraphMemory::MemoryUsage& peak = memory.GetPeakMemoryUsage();
+  const int64 memory_limit = GetMemoryLimit(*cluster);
+  if (memory_limit > 0 && peak.used_memory <= memory_limit) {
+    return;
+  }
+
+  std::unordered_map<const NodeDef*, Costs::NanoSeconds> optimized_times;
+  status = EstimateExecutionTimes(optimized_item, cluster, &optimized_times);
+  if (!status.ok()) {
+    VLOG(1) << "Failed to estimate the execution times: " << status;
+    return;
+  }
+  std::unordered_map<string, Costs::NanoSeconds> execution_times;
+  for (const auto& time : optimized_times) {
+    execution_times[time.first->name()] = time.second;
+  }
+
+  NodeMap node_map(graph);
+  // Nodes in while loops can't be copied outside their frame.
+  std::unordered_set<string> loop_nodes;
+  for (const NodeDef& node : graph->node()) {
+    bool in_loop = IsEnter(node);
+    for (const string& input : node.input()) {
+      in_loop |= !IsExit(node) && loop_nodes.count(NodeName(input)) > 0;
+    }
+    if (in_loop) {
+      loop_nodes.insert(node.name());
+    }
+  }
+
+  // The outputs that stay in memory through the peak.
+  std::unordered_set<string> live_outputs;
+  for (const auto& live : peak.live_tensors) {
+    live_outputs.insert(strings::StrCat(live.node, ":", live.output_id));
+  }
+  std::unordered_set<string> peak_inputs;
+  const NodeDef* peak_node = node_map.GetNode(peak.peak_node);
+  if (peak_node != nullptr) {
+    for (const string& input : peak_node->input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      peak_inputs.insert(strings::StrCat(input_name, ":", position));
+    }
+  }
+
+  std::unordered_map<string, RecomputationCandidate> candidates;
+  std::unordered_set<string> rejected;
+  for (const auto& live : peak.live_tensors) {
+    const string output = strings::StrCat(live.node, ":", live.output_id);
+    if (live.node == peak.peak_node || peak_inputs.count(output) > 0 ||
+        live.pending_consumers.empty()) {
+      // All the outputs of a node must be freed for the node to be worth
+      // recomputing.
+      rejected.insert(live.node);
+      continue;
+    }
+    RecomputationCandidate& candidate = candidates[live.node];
+    candidate.memory_saved += live.memory_used;
+    for (const string& consumer : live.pending_consumers) {
+      candidate.target_nodes.insert(node_map.GetNode(consumer));
+    }
+  }
+
+  std::vector<RecomputationCandidate*> selected;
+  for (auto& it : candidates) {
+    RecomputationCandidate& candidate = it.second;
+    candidate.node = node_map.GetNode(it.first);
+    if (rejected.count(it.first) > 0 || candidate.node == nullptr ||
+        !IsRecomputable(*candidate.node) || loop_nodes.count(it.first) > 0 ||
+        candidate.memory_saved <= 0) {
+      continue;
+    }
+    bool inputs_alive = true;
+    for (const string& input : candidate.node->input()) {
+      int position;
+      const string input_name = ParseNodeName(input, &position);
+      const NodeDef* input_node = node_map.GetNode(input_name);
+      if (position < 0 || input_node == nullptr || IsConstant(*input_node) ||
+          IsVariable(*input_node)) {
+        continue;
+      }
+      if (live_outputs.count(strings::StrCat(input_name, ":", position)) ==
+          0) {
+        inputs_alive = false;
+        break;
+      }
+    }
+    if (inputs_alive) {
+      selected.push_back(&candidate);
+    }
+  }
+  // Pick the nodes that cost the least time per byte freed first.
+  auto cost_per_byte = [&execution_times](const RecomputationCandidate* c) {
+    return static_cast<double>(execution_times[c->node->name()].count()) /
+           c->memory_saved;
+  };
+  std::sort(selected.begin(), selected.end(),
+            [&cost_per_byte](const RecomputationCandidate* a,
+                             const RecomputationCandidate* b) {
+              const double a_cost = cost_per_byte(a);
+              const double b_cost = cost_per_byte(b);
+              return a_cost < b_cost ||
+                     (a_cost == b_cost && a->node->name() < b->node->name());
+            });
+
+  std::unordered_map<const NodeDef*, int> topological_numbering;
+  for (int node_number = 0; node_number < graph->node().size();
+       ++node_number) {
+    topological_numbering[graph->mutable_node(node_number)] =
+        graph->node().size() - node_number - 1;
+  }
+  int64 used_memory = peak.used_memory;
+  for (const RecomputationCandidate* candidate : selected) {
+    if (memory_limit > 0 && used_memory <= memory_limit) {
+      break;
+    }
+    VLOG(1) << "Recomputing " << candidate->node->name() << " to free "
+            << candidate->memory_saved << " bytes";
+    RecomputeSubgraph({candidate->node}, candidate->target_nodes, node_map,
+                      topological_numbering, graph);
+    used_memory -= candidate->memory_saved;
+  }
+}
+
 std::pair<NodeDef*, NodeDef*> BuildSwapPair(NodeDef* node, int input_to_swap,
+                                            DataType type, bool on_host,
                                             GraphDef* graph) {
   string tensor_to_swap = strings::StrCat(node->name(), "_", input_to_swap);
 
-  // Force the tensor to be copied to cpu.
   NodeDef* swap_out_node = graph->add_node();
   swap_out_node->set_name(strings::StrCat("swap_out_", tensor_to_swap));
-  swap_out_node->set_op("Identity");
-  swap_out_node->set_device("/CPU");
-
-  // Force the tensor to be restored to the device.
   NodeDef* swap_in_node = graph->add_node();
   swap_in_node->set_name(strings::StrCat("swap_in_", tensor_to_swap));
-  swap_in_node->set_op("Identity");
   *swap_in_node->add_input() = swap_out_node->name();
+  if (on_host) {
+    // Copying the tensor to the host wouldn't free anything: keep it
+    // compressed instead.
+    swap_out_node->set_op("_SwapOut");
+    swap_out_node->set_device(node->device());
+    swap_in_node->set_op("_SwapIn");
+  } else {
+    // Force the tensor to be copied to cpu.
+    swap_out_node->set_op("Identity");
+    swap_out_node->set_device("/CPU");
+    // Force the tensor to be restored to the device.
+    swap_in_node->set_op("Identity");
+  }
+  if (type != DT_INVALID) {
+    (*swap_out_node->mutable_attr())["T"].set_type(type);
+    (*swap_in_node->mutable_attr())["T"].set_type(type);
+  }
 
   // Colocate the swap_in_ node with the node itself.
   string coloc_group = strings::StrCat("loc@", tensor_to_swap);
@@ -507,9 +713,145 @@ static int64 EstimateSize(const OpInfo::TensorProperties& t) {
 
 struct SwapInfo {
   std::vector<int> inputs_to_swap;
+  // The types of the inputs to swap, if known.
+  std::vector<DataType> types_to_swap;
   Costs::NanoSeconds time_to_swap = 0;
 };
 
+// Tensors smaller than this aren't worth swapping.
+static const int64 kMinBytesToSwap = 32 * 1024;
+
+// _SwapOut serializes the tensor to a proto, which can't be larger than 2GB.
+// Leave some room for the overhead of the proto itself.
+static const int64 kMaxBytesToSwapOnHost = kint32max - (1 << 20);
+
+// Returns the number of bytes a tensor of 'size' bytes is expected to keep
+// resident once _SwapOut compressed it. Activations tend to compress well, but
+// random values don't compress at all, so only count on half of it.
+static int64 ExpectedCompressedSize(int64 size) { return size / 2; }
+
+// Returns true if the output of 'node' may be swapped out, or swapped in
+// before 'node' runs.
+static bool IsSwappable(const NodeDef& node) {
+  return !IsConstant(node) && !IsVariable(node) && !IsEnter(node) &&
+         !IsExit(node) && !IsMerge(node) && !IsNextIteration(node) &&
+         !IsSwitch(node);
+}
+
+// Marks with the '_swap_to_host' attribute the inputs of 'graph' that hold
+// large tensors through the peak of the memory usage while nothing reads
+// them, until the peak fits in the memory of the smallest device of 'cluster'
+// (or all of them if the memory of the devices is unknown).
+//
+// Tensors consumed on a GPU are copied to the host and free all their memory.
+// On the host, the compressed copy stays resident, and while _SwapOut runs it
+// also holds the serialized tensor and the compressed copy next to the
+// original. Skip the tensor if these transient buffers wouldn't fit under the
+// limit next to the tensors alive at the peak that were produced by then.
+static void IdentifySwappingCandidates(Cluster* cluster,
+                                       const GrapplerItem& item,
+                                       GraphDef* graph) {
+  GrapplerItem optimized_item = item;
+  optimized_item.graph = *graph;
+  GraphMemory memory(optimized_item);
+  Status status = memory.InferStatically();
+  if (!status.ok()) {
+    VLOG(1) << "Failed to infer the memory usage: " << status;
+    return;
+  }
+  const GraphMemory::MemoryUsage& peak = memory.GetPeakMemoryUsage();
+
+  const int64 memory_limit = GetMemoryLimit(*cluster);
+  if (memory_limit > 0 && peak.used_memory <= memory_limit) {
+    return;
+  }
+
+  NodeMap node_map(graph);
+  const NodeDef* peak_node = node_map.GetNode(peak.peak_node);
+  if (peak_node == nullptr) {
+    return;
+  }
+  std::unordered_set<string> peak_inputs;
+  for (const string& input : peak_node->input()) {
+    int position;
+    const string input_name = ParseNodeName(input, &position);
+    peak_inputs.insert(strings::StrCat(input_name, ":", position));
+  }
+
+  // Tensors read at the peak must stay in memory, and so must the ones read
+  // by several nodes after the peak, since swapping them in for each would
+  // cost more memory than it saves.
+  std::vector<const GraphMemory::LiveTensor*> candidates;
+  // The live tensors are listed in the order in which they were produced.
+  std::unordered_map<const GraphMemory::LiveTensor*, int64> memory_produced;
+  int64 produced = 0;
+  for (const auto& live : peak.live_tensors) {
+    produced += live.memory_used;
+    memory_produced[&live] = produced;
+    if (live.memory_used < kMinBytesToSwap || live.node == peak.peak_node ||
+        live.pending_consumers.size() != 1 ||
+        peak_inputs.count(strings::StrCat(live.node, ":", live.output_id)) >
+            0) {
+      continue;
+    }
+    const NodeDef* producer = node_map.GetNode(live.node);
+    const NodeDef* consumer = node_map.GetNode(live.pending_consumers[0]);
+    if (producer == nullptr || consumer == nullptr || !IsSwappable(*producer) ||
+        !IsSwappable(*consumer)) {
+      continue;
+    }
+    candidates.push_back(&live);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const GraphMemory::LiveTensor* a,
+                      const GraphMemory::LiveTensor* b) {
+                     return a->memory_used > b->memory_used;
+                   });
+
+  const int num_gpus = GetNumGpus(*cluster);
+  int64 used_memory = peak.used_memory;
+  for (const GraphMemory::LiveTensor* live : candidates) {
+    if (memory_limit > 0 && used_memory <= memory_limit) {
+      break;
+    }
+    NodeDef* consumer = node_map.GetNode(live->pending_consumers[0]);
+    int64 memory_saved = live->memory_used;
+    if (IsOnCpu(*consumer, num_gpus)) {
+      if (live->memory_used > kMaxBytesToSwapOnHost) {
+        continue;
+      }
+      const int64 compressed_size = ExpectedCompressedSize(live->memory_used);
+      memory_saved -= compressed_size;
+      const int64 transient_size = live->memory_used + compressed_size;
+      if (memory_limit > 0 &&
+          memory_produced[live] + transient_size > memory_limit) {
+        continue;
+      }
+    }
+    AttrValue& val = (*consumer->mutable_attr())["_swap_to_host"];
+    std::set<int64> inputs_to_swap(val.list().i().begin(),
+                                   val.list().i().end());
+    if (val.value_case() == AttrValue::kI) {
+      inputs_to_swap.insert(val.i());
+    }
+    for (int i = 0; i < consumer->input_size(); ++i) {
+      int position;
+      const string input_name = ParseNodeName(consumer->input(i), &position);
+      if (input_name == live->node && position == live->output_id) {
+        inputs_to_swap.insert(i);
+      }
+    }
+    val.mutable_list()->clear_i();
+    for (int64 input_id : inputs_to_swap) {
+      val.mutable_list()->add_i(input_id);
+    }
+    used_memory -= memory_saved;
+    VLOG(1) << "Swapping " << live->node << ":" << live->output_id << " ("
+            << live->memory_used << " bytes) out until " << consumer->name()
+            << " runs to free " << memory_saved << " bytes";
+  }
+}
+
 static const NodeDef* FindSwapTrigger(
     const NodeDef* node, const SwapInfo& swap_info,
     const std::unordered_map<string, const NodeDef*>& name_map,
@@ -590,6 +932,16 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
 
   RecomputationRewritingPass(optimization_level_, optimized_graph);
 
+  if (optimization_level_ == RewriterConfig::RECOMPUTATION_HEURISTICS &&
+      cluster != nullptr) {
+    AutomaticRecomputationPass(cluster, item, optimized_graph);
+  }
+
+  if (optimization_level_ == RewriterConfig::SWAPPING_HEURISTICS &&
+      cluster != nullptr) {
+    IdentifySwappingCandidates(cluster, item, optimized_graph);
+  }
+
   // Figure out what needs to be swapped;
   std::unordered_map<NodeDef*, SwapInfo> nodes_to_swap;
   for (auto& node : *optimized_graph->mutable_node()) {
@@ -622,8 +974,13 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       SwapInfo& swap_info = swap.second;
       int64 bytes_to_swap = 0;
       for (int64 input_id : swap_info.inputs_to_swap) {
+        if (input_id >= props.size()) {
+          swap_info.types_to_swap.push_back(DT_INVALID);
+          continue;
+        }
         const OpInfo::TensorProperties& t = props[input_id];
         bytes_to_swap += EstimateSize(t);
+        swap_info.types_to_swap.push_back(t.dtype());
       }
       // Let's assume we're going to swap over PCIe running at 16 GBps.
       swap_info.time_to_swap = bytes_to_swap / 16;
@@ -639,6 +996,8 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
     name_map[node.name()] = &node;
   }
 
+  const int num_gpus = GetNumGpus(*cluster);
+
   for (auto& swap : nodes_to_swap) {
     NodeDef* node = swap.first;
     SwapInfo& swap_info = swap.second;
@@ -652,9 +1011,12 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
     // Swap all the tensors that are marked with the 'swap_to_host' attribute.
-    for (int input_id : swap_info.inputs_to_swap) {
+    const bool on_host = IsOnCpu(*node, num_gpus);
+    for (int i = 0; i < swap_info.inputs_to_swap.size(); ++i) {
+      const int input_id = swap_info.inputs_to_swap[i];
       std::pair<NodeDef*, NodeDef*> swap_nodes =
-          BuildSwapPair(node, input_id, optimized_graph);
+          BuildSwapPair(node, input_id, swap_info.types_to_swap[i], on_host,
+                        optimized_graph);
       *swap_nodes.first->add_input() = node->input(input_id);
       *node->mutable_input(input_id) = swap_nodes.second->name();
 
@@ -166,12 +166,14 @@ TEST_F(RecomputeSubgraphTest, MultiNode) {
 
 class MemoryOptimizerTest : public ::testing::Test {
  public:
-  static std::unique_ptr<VirtualCluster> CreateVirtualCluster() {
+  static std::unique_ptr<VirtualCluster> CreateVirtualCluster(
+      int64 memory_size = 0) {
     DeviceProperties cpu_device;
     cpu_device.set_type("CPU");
     cpu_device.set_frequency(1000);
     cpu_device.set_num_cores(4);
     cpu_device.set_bandwidth(32);
+    cpu_device.set_memory_size(memory_size);
     std::unordered_map<string, DeviceProperties> devices;
     devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
     return std::unique_ptr<VirtualCluster>(new VirtualCluster(devices));
@@ -223,6 +225,131 @@ TEST_F(MemoryOptimizerTest, SimpleSwapping) {
   EXPECT_EQ("^c", swap_in.input(1));
 }
 
+TEST_F(MemoryOptimizerTest, SwappingHeuristics) {
+  // b is alive while c and d run, but not read until e runs.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Variable(s.WithOpName("a"), {512, 512}, DT_FLOAT);
+  Output b = ops::AddN(s.WithOpName("b"), {a});
+  Output c = ops::AddN(s.WithOpName("c"), {b});
+  Output d = ops::AddN(s.WithOpName("d"), {c});
+  Output e = ops::AddN(s.WithOpName("e"), {b, d});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("e");
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+
+  MemoryOptimizer optimizer(RewriterConfig::SWAPPING_HEURISTICS);
+  GraphDef output;
+  Status status = optimizer.Optimize(cluster.get(), item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(7, output.node_size());
+  const NodeDef& new_e = output.node(4);
+  EXPECT_EQ(NodeName(e.name()), new_e.name());
+  EXPECT_EQ(2, new_e.input_size());
+  EXPECT_EQ("swap_in_e_0", new_e.input(0));
+  EXPECT_EQ(NodeName(d.name()), new_e.input(1));
+
+  // The tensor is already in host memory, so it gets compressed.
+  const NodeDef& swap_out = output.node(5);
+  EXPECT_EQ("swap_out_e_0", swap_out.name());
+  EXPECT_EQ("_SwapOut", swap_out.op());
+  EXPECT_EQ(NodeName(b.name()), swap_out.input(0));
+  EXPECT_EQ(DT_FLOAT, swap_out.attr().at("T").type());
+
+  const NodeDef& swap_in = output.node(6);
+  EXPECT_EQ("swap_in_e_0", swap_in.name());
+  EXPECT_EQ("_SwapIn", swap_in.op());
+  EXPECT_EQ(NodeName(swap_out.name()), swap_in.input(0));
+  EXPECT_EQ("^c", swap_in.input(1));
+}
+
+TEST_F(MemoryOptimizerTest, SwappingOnHostAccountsForCompression) {
+  // The peak is reached when d runs, with b, c and d (1MB each) alive. Only b
+  // can be swapped out. It runs when 1MB is in use, and _SwapOut then needs
+  // 1.5MB more for the serialized and compressed copies of b. Once swapped
+  // out, b is expected to keep 0.5MB resident.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Variable(s.WithOpName("a"), {512, 512}, DT_FLOAT);
+  Output b = ops::AddN(s.WithOpName("b"), {a});
+  Output c = ops::AddN(s.WithOpName("c"), {b});
+  Output d = ops::AddN(s.WithOpName("d"), {c});
+  Output e = ops::AddN(s.WithOpName("e"), {b, d});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("e");
+
+  const int64 kMB = 1 << 20;
+  {
+    std::unique_ptr<VirtualCluster> cluster(
+        CreateVirtualCluster(11 * kMB / 4));
+    MemoryOptimizer optimizer(RewriterConfig::SWAPPING_HEURISTICS);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+    NodeMap node_map(&output);
+    ASSERT_NE(nullptr, node_map.GetNode("swap_out_e_0"));
+    EXPECT_EQ("swap_in_e_0", node_map.GetNode("e")->input(0));
+  }
+  {
+    // The transient buffers of _SwapOut don't fit: leave b alone.
+    std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster(2 * kMB));
+    MemoryOptimizer optimizer(RewriterConfig::SWAPPING_HEURISTICS);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+    NodeMap node_map(&output);
+    EXPECT_EQ(nullptr, node_map.GetNode("swap_out_e_0"));
+    EXPECT_EQ("b", node_map.GetNode("e")->input(0));
+  }
+}
+
+TEST_F(MemoryOptimizerTest, RecomputationHeuristics) {
+  // b is alive while c and d run, but not read until e runs.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Variable(s.WithOpName("a"), {512, 512}, DT_FLOAT);
+  Output b = ops::AddN(s.WithOpName("b"), {a});
+  Output c = ops::AddN(s.WithOpName("c"), {b});
+  Output d = ops::AddN(s.WithOpName("d"), {c});
+  Output e = ops::AddN(s.WithOpName("e"), {b, d});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("e");
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+
+  MemoryOptimizer optimizer(RewriterConfig::RECOMPUTATION_HEURISTICS);
+  GraphDef output;
+  Status status = optimizer.Optimize(cluster.get(), item, &output);
+  TF_EXPECT_OK(status);
+
+  NodeMap node_map(&output);
+  EXPECT_EQ(7, output.node_size());
+  const NodeDef* new_e = node_map.GetNode("e");
+  ASSERT_NE(nullptr, new_e);
+  ASSERT_EQ(2, new_e->input_size());
+  EXPECT_EQ("Recomputed/b", new_e->input(0));
+  EXPECT_EQ("d", new_e->input(1));
+  // c still reads the original b.
+  EXPECT_EQ("b", node_map.GetNode("c")->input(0));
+
+  const NodeDef* recomputed_b = node_map.GetNode("Recomputed/b");
+  ASSERT_NE(nullptr, recomputed_b);
+  EXPECT_EQ("AddN", recomputed_b->op());
+  ASSERT_EQ(2, recomputed_b->input_size());
+  EXPECT_EQ("a", recomputed_b->input(0));
+  EXPECT_EQ("^RecomputeTrigger/b", recomputed_b->input(1));
+  const NodeDef* trigger = node_map.GetNode("RecomputeTrigger/b");
+  ASSERT_NE(nullptr, trigger);
+  ASSERT_EQ(1, trigger->input_size());
+  EXPECT_EQ("^d", trigger->input(0));
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -16,12 +16,17 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/auto_parallel.h"
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/input_staging_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/layout_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
+#include "tensorflow/core/grappler/optimizers/op_fusion_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/placement_optimizer.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/lib/core/status.h"
 
@@ -38,9 +43,25 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::NewOptimizer(
   if (optimizer == "constfold") {
     graph_optimizer.reset(new ConstantFolding());
   }
+  if (optimizer == "arithmetic") {
+    graph_optimizer.reset(new ArithmeticOptimizer());
+  }
+  if (optimizer == "loop") {
+    graph_optimizer.reset(new LoopOptimizer());
+  }
+  if (optimizer == "fusion") {
+    graph_optimizer.reset(new OpFusionOptimizer());
+  }
   if (optimizer == "layout") {
     graph_optimizer.reset(new LayoutOptimizer());
   }
+  if (optimizer == "placement") {
+    graph_optimizer.reset(new PlacementOptimizer());
+  }
+  if (optimizer == "staging") {
+    graph_optimizer.reset(
+        new InputStagingOptimizer(cfg_.input_staging().depth()));
+  }
   if (optimizer == "memory") {
     graph_optimizer.reset(new MemoryOptimizer(RewriterConfig::MANUAL));
   }
@@ -62,10 +83,30 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       optimizers.push_back(
           std::unique_ptr<GraphOptimizer>(new ConstantFolding()));
     }
+    if (cfg_.arithmetic_optimization()) {
+      optimizers.push_back(
+          std::unique_ptr<GraphOptimizer>(new ArithmeticOptimizer()));
+    }
+    if (cfg_.loop_optimization()) {
+      optimizers.push_back(
+          std::unique_ptr<GraphOptimizer>(new LoopOptimizer()));
+    }
+    if (cfg_.op_fusion()) {
+      optimizers.push_back(
+          std::unique_ptr<GraphOptimizer>(new OpFusionOptimizer()));
+    }
     if (cfg_.optimize_tensor_layout()) {
       optimizers.push_back(
           std::unique_ptr<GraphOptimizer>(new LayoutOptimizer()));
     }
+    if (cfg_.placement_optimization()) {
+      optimizers.push_back(
+          std::unique_ptr<GraphOptimizer>(new PlacementOptimizer()));
+    }
+    if (cfg_.input_staging().enable()) {
+      optimizers.push_back(std::unique_ptr<GraphOptimizer>(
+          new InputStagingOptimizer(cfg_.input_staging().depth())));
+    }
     if (cfg_.memory_optimization() > 0) {
       optimizers.push_back(std::unique_ptr<GraphOptimizer>(
           new MemoryOptimizer(cfg_.memory_optimization())));
@@ -75,8 +116,10 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
           new AutoParallel(cfg_.auto_parallel().num_replicas())));
     }
   } else {
-    std::set<string> available_optimizers = {"pruning", "constfold", "layout",
-                                             "memory", "autoparallel"};
+    std::set<string> available_optimizers = {
+        "pruning",   "constfold", "arithmetic", "loop",
+        "fusion",    "layout",    "placement",  "staging",
+        "memory",    "autoparallel"};
     for (const auto& optimizer : cfg_.optimizers()) {
       if (available_optimizers.find(optimizer) != available_optimizers.end()) {
         optimizers.push_back(NewOptimizer(optimizer));
@@ -121,7 +164,10 @@ void MetaOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
 
 bool MetaOptimizerEnabled(const RewriterConfig& cfg) {
   return cfg.optimize_tensor_layout() || cfg.constant_folding() ||
-         cfg.auto_parallel().enable() || cfg.memory_optimization() > 0 ||
+         cfg.arithmetic_optimization() || cfg.loop_optimization() ||
+         cfg.op_fusion() || cfg.placement_optimization() ||
+         cfg.input_staging().enable() || cfg.auto_parallel().enable() ||
+         cfg.memory_optimization() > 0 ||
          !cfg.optimizers().empty();
 }
 
@@ -0,0 +1,395 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/op_fusion_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/grappler/devices.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Returns true if the attr 'name' of 'node' is 'value', or is missing and
+// defaults to 'value'.
+bool HasStringAttr(const NodeDef& node, const string& name,
+                   const string& value) {
+  auto it = node.attr().find(name);
+  return it == node.attr().end() || it->second.s() == value;
+}
+
+bool HasFloatType(const NodeDef& node) {
+  auto it = node.attr().find("T");
+  return it != node.attr().end() && it->second.type() == DT_FLOAT;
+}
+
+// Gets the value of 'node' if it is a float constant that doesn't depend on
+// anything else.
+bool GetConstantValue(const NodeDef& node, Tensor* value) {
+  if (!IsConstant(node) || node.input_size() > 0) {
+    return false;
+  }
+  auto dtype = node.attr().find("dtype");
+  auto tensor = node.attr().find("value");
+  if (dtype == node.attr().end() || dtype->second.type() != DT_FLOAT ||
+      tensor == node.attr().end()) {
+    return false;
+  }
+  return value->FromProto(tensor->second.tensor());
+}
+
+// Returns the producer of input 'index' of 'node' if it is a float constant,
+// and stores its value in 'value'.
+const NodeDef* GetConstantInput(const NodeMap& node_map, const NodeDef& node,
+                                int index, Tensor* value) {
+  if (index >= node.input_size() || IsControlInput(node.input(index))) {
+    return nullptr;
+  }
+  const NodeDef* input = node_map.GetNode(NodeName(node.input(index)));
+  if (input == nullptr || !GetConstantValue(*input, value)) {
+    return nullptr;
+  }
+  return input;
+}
+
+NodeDef* AddConstant(const string& name, const Tensor& value,
+                     const string& device, GraphDef* graph,
+                     NodeMap* node_map) {
+  NodeDef* node = graph->add_node();
+  node->set_name(name);
+  node->set_op("Const");
+  node->set_device(device);
+  (*node->mutable_attr())["dtype"].set_type(value.dtype());
+  value.AsProtoTensorContent(
+      (*node->mutable_attr())["value"].mutable_tensor());
+  node_map->AddNode(name, node);
+  return node;
+}
+
+// Appends the control inputs of 'node' to 'inputs', except those on the
+// nodes in 'excluded' and those already in 'inputs'.
+void AppendControlInputs(const NodeDef& node,
+                         const std::unordered_set<string>& excluded,
+                         std::vector<string>* inputs) {
+  for (const string& input : node.input()) {
+    if (!IsControlInput(input) ||
+        excluded.find(NodeName(input)) != excluded.end() ||
+        std::find(inputs->begin(), inputs->end(), input) != inputs->end()) {
+      continue;
+    }
+    inputs->push_back(input);
+  }
+}
+
+}  // namespace
+
+bool OpFusionOptimizer::IsPreserved(const NodeDef& node) const {
+  return nodes_to_preserve_.find(node.name()) != nodes_to_preserve_.end();
+}
+
+NodeDef* OpFusionOptimizer::GetFusableInput(const NodeDef& node,
+                                            int index) const {
+  if (index >= node.input_size()) {
+    return nullptr;
+  }
+  int position;
+  const string name = ParseNodeName(node.input(index), &position);
+  if (position != 0) {
+    return nullptr;
+  }
+  NodeDef* input = node_map_->GetNode(name);
+  if (input == nullptr || GetOnlyConsumer(*input) != &node) {
+    return nullptr;
+  }
+  return input;
+}
+
+NodeDef* OpFusionOptimizer::GetOnlyConsumer(const NodeDef& node) const {
+  if (IsPreserved(node) ||
+      fetched_side_outputs_.find(node.name()) != fetched_side_outputs_.end()) {
+    return nullptr;
+  }
+  const std::set<NodeDef*>& outputs = node_map_->GetOutputs(node.name());
+  if (outputs.size() != 1) {
+    return nullptr;
+  }
+  NodeDef* consumer = *outputs.begin();
+  if (consumer->device() != node.device() ||
+      fused_nodes_.find(consumer->name()) != fused_nodes_.end()) {
+    return nullptr;
+  }
+  // The consumer must only read output 0 of 'node', as its first input.
+  for (int i = 0; i < consumer->input_size(); ++i) {
+    const string& input = consumer->input(i);
+    if (NodeName(input) == node.name() && (i != 0 || input != node.name())) {
+      return nullptr;
+    }
+  }
+  return consumer;
+}
+
+bool OpFusionOptimizer::FoldBatchNorm(NodeDef* node) {
+  if (node->op() != "FusedBatchNorm" ||
+      fused_nodes_.find(node->name()) != fused_nodes_.end() ||
+      !HasStringAttr(*node, "data_format", "NHWC")) {
+    return false;
+  }
+  // Batch statistics depend on the input, and is_training defaults to true.
+  auto is_training = node->attr().find("is_training");
+  if (is_training == node->attr().end() || is_training->second.b()) {
+    return false;
+  }
+  // Only the normalized output survives the rewrite.
+  if (fetched_side_outputs_.find(node->name()) !=
+      fetched_side_outputs_.end()) {
+    return false;
+  }
+  for (const NodeDef* consumer : node_map_->GetOutputs(node->name())) {
+    for (const string& input : consumer->input()) {
+      int position;
+      if (ParseNodeName(input, &position) == node->name() && position > 0) {
+        return false;
+      }
+    }
+  }
+
+  NodeDef* conv = GetFusableInput(*node, 0);
+  if (conv == nullptr || conv->op() != "Conv2D" || !HasFloatType(*conv) ||
+      !HasStringAttr(*conv, "data_format", "NHWC")) {
+    return false;
+  }
+  Tensor filter;
+  const NodeDef* filter_node = GetConstantInput(*node_map_, *conv, 1, &filter);
+  if (filter_node == nullptr || filter.dims() != 4) {
+    return false;
+  }
+  const int64 depth = filter.dim_size(3);
+  // The inputs of FusedBatchNorm following x are scale, offset, mean and
+  // variance.
+  Tensor params[4];
+  const NodeDef* param_nodes[4];
+  for (int i = 0; i < 4; ++i) {
+    param_nodes[i] = GetConstantInput(*node_map_, *node, i + 1, &params[i]);
+    if (param_nodes[i] == nullptr || params[i].dims() != 1 ||
+        params[i].NumElements() != depth) {
+      return false;
+    }
+  }
+  const string filter_name = AddPrefixToNodeName(
+      strings::StrCat(conv->name(), "/filter"), kOpFusionOptimizer);
+  const string bias_name = AddPrefixToNodeName(
+      strings::StrCat(node->name(), "/bias"), kOpFusionOptimizer);
+  if (node_map_->GetNode(filter_name) != nullptr ||
+      node_map_->GetNode(bias_name) != nullptr) {
+    return false;
+  }
+
+  float epsilon = 0.0001f;
+  auto epsilon_attr = node->attr().find("epsilon");
+  if (epsilon_attr != node->attr().end()) {
+    epsilon = epsilon_attr->second.f();
+  }
+  auto scale = params[0].vec<float>();
+  auto offset = params[1].vec<float>();
+  auto mean = params[2].vec<float>();
+  auto variance = params[3].vec<float>();
+  // y = (x * w - mean) * scale / sqrt(variance + epsilon) + offset, so the
+  // normalization scales every output channel of the filter and adds a bias.
+  Tensor scaled_filter(DT_FLOAT, filter.shape());
+  Tensor bias(DT_FLOAT, TensorShape({depth}));
+  auto weights = filter.flat_inner_dims<float>();
+  auto scaled_weights = scaled_filter.flat_inner_dims<float>();
+  auto biases = bias.vec<float>();
+  for (int64 c = 0; c < depth; ++c) {
+    const float multiplier = scale(c) / std::sqrt(variance(c) + epsilon);
+    biases(c) = offset(c) - mean(c) * multiplier;
+    for (int64 r = 0; r < weights.dimension(0); ++r) {
+      scaled_weights(r, c) = weights(r, c) * multiplier;
+    }
+  }
+
+  AddConstant(filter_name, scaled_filter, conv->device(), graph_,
+              node_map_.get());
+  AddConstant(bias_name, bias, node->device(), graph_, node_map_.get());
+  dead_candidates_.insert(filter_node->name());
+  for (const NodeDef* param_node : param_nodes) {
+    dead_candidates_.insert(param_node->name());
+  }
+  conv->set_input(1, filter_name);
+  node_map_->AddOutput(filter_name, conv->name());
+
+  std::vector<string> control_inputs;
+  AppendControlInputs(*node, {}, &control_inputs);
+  node->set_op("BiasAdd");
+  node->mutable_input()->DeleteSubrange(1, node->input_size() - 1);
+  node->add_input(bias_name);
+  for (const string& input : control_inputs) {
+    node->add_input(input);
+  }
+  node_map_->AddOutput(bias_name, node->name());
+  node->mutable_attr()->clear();
+  (*node->mutable_attr())["T"].set_type(DT_FLOAT);
+  (*node->mutable_attr())["data_format"].set_s("NHWC");
+  return true;
+}
+
+bool OpFusionOptimizer::FuseBiasAdd(NodeDef* node) {
+  if (node->op() != "BiasAdd" ||
+      fused_nodes_.find(node->name()) != fused_nodes_.end() ||
+      !HasFloatType(*node) || !IsOnCpu(*node, num_gpus_)) {
+    return false;
+  }
+  NodeDef* producer = GetFusableInput(*node, 0);
+  if (producer == nullptr || !HasFloatType(*producer)) {
+    return false;
+  }
+  string fused_op;
+  if (producer->op() == "Conv2D") {
+    if (!HasStringAttr(*producer, "data_format", "NHWC") ||
+        !HasStringAttr(*node, "data_format", "NHWC")) {
+      return false;
+    }
+    fused_op = "_FusedConv2D";
+  } else if (producer->op() == "MatMul") {
+    fused_op = "_FusedMatMul";
+  } else {
+    return false;
+  }
+  if (producer->input_size() < 2 || IsControlInput(producer->input(1)) ||
+      node->input_size() < 2 || IsControlInput(node->input(1))) {
+    return false;
+  }
+
+  NodeDef* activation = GetOnlyConsumer(*node);
+  if (activation != nullptr && activation->op() != "Relu" &&
+      activation->op() != "Relu6" && activation->op() != "Elu") {
+    activation = nullptr;
+  }
+  // The fused node takes the place of the last node of the chain.
+  NodeDef* fused = activation != nullptr ? activation : node;
+  std::unordered_set<string> chain = {producer->name(), node->name()};
+
+  std::vector<string> inputs = {producer->input(0), producer->input(1),
+                                node->input(1)};
+  AppendControlInputs(*producer, chain, &inputs);
+  AppendControlInputs(*node, chain, &inputs);
+  if (activation != nullptr) {
+    AppendControlInputs(*activation, chain, &inputs);
+    fused_nodes_.insert(node->name());
+  }
+  fused_nodes_.insert(producer->name());
+
+  const string activation_op =
+      activation != nullptr ? activation->op() : "Identity";
+  fused->set_op(fused_op);
+  fused->clear_input();
+  for (const string& input : inputs) {
+    fused->add_input(input);
+    node_map_->AddOutput(NodeName(input), fused->name());
+  }
+  *fused->mutable_attr() = producer->attr();
+  (*fused->mutable_attr())["activation"].set_s(activation_op);
+  return true;
+}
+
+void OpFusionOptimizer::RemoveDeadNodes() {
+  std::unordered_map<string, int> num_consumers;
+  for (const NodeDef& node : graph_->node()) {
+    if (fused_nodes_.find(node.name()) != fused_nodes_.end()) {
+      continue;
+    }
+    for (const string& input : node.input()) {
+      ++num_consumers[NodeName(input)];
+    }
+  }
+  std::unordered_set<string> dead_nodes = fused_nodes_;
+  for (const string& name : dead_candidates_) {
+    if (num_consumers[name] == 0 &&
+        nodes_to_preserve_.find(name) == nodes_to_preserve_.end()) {
+      dead_nodes.insert(name);
+    }
+  }
+
+  const int num_deleted = DeleteNodes(dead_nodes, graph_);
+  VLOG(1) << "Removed " << num_deleted << " nodes from the graph.";
+}
+
+Status OpFusionOptimizer::Optimize(Cluster* /*cluster*/,
+                                   const GrapplerItem& item,
+                                   GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  graph_ = optimized_graph;
+  if (num_gpus_ == 0) {
+    num_gpus_ = GetNumAvailableGPUs();
+  }
+  nodes_to_preserve_.clear();
+  fetched_side_outputs_.clear();
+  fused_nodes_.clear();
+  dead_candidates_.clear();
+  std::vector<string> outputs = item.fetch;
+  for (const auto& feed : item.feed) {
+    outputs.push_back(feed.first);
+  }
+  for (const string& output : outputs) {
+    int position;
+    const string name = ParseNodeName(output, &position);
+    nodes_to_preserve_.insert(name);
+    if (position > 0) {
+      fetched_side_outputs_.insert(name);
+    }
+  }
+  node_map_.reset(new NodeMap(graph_));
+
+  // Batch norms are folded first so that the BiasAdds they turn into can be
+  // fused in turn.  Constants added by the folding are appended to the graph
+  // and are skipped by both loops.
+  int num_folded = 0;
+  const int num_nodes = graph_->node_size();
+  for (int i = 0; i < num_nodes; ++i) {
+    if (FoldBatchNorm(graph_->mutable_node(i))) {
+      ++num_folded;
+    }
+  }
+  int num_fused = 0;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (FuseBiasAdd(graph_->mutable_node(i))) {
+      ++num_fused;
+    }
+  }
+  VLOG(1) << "Folded " << num_folded << " batch norms and fused " << num_fused
+          << " bias additions.";
+
+  RemoveDeadNodes();
+  return Status::OK();
+}
+
+void OpFusionOptimizer::Feedback(Cluster* /*cluster*/,
+                                 const GrapplerItem& /*item*/,
+                                 const GraphDef& /*optimized_graph*/,
+                                 double /*result*/) {
+  // Nothing to do for OpFusionOptimizer.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
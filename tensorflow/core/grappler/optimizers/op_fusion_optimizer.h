@@ -0,0 +1,88 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_OP_FUSION_OPTIMIZER_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_OP_FUSION_OPTIMIZER_H_
+
+#include <unordered_set>
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/utils.h"
+
+namespace tensorflow {
+namespace grappler {
+
+const char kOpFusionOptimizer[] = "OpFusion";
+
+// Fuses chains of ops into single kernels for inference on CPU:
+//  * An inference FusedBatchNorm of a Conv2D with constant filter and
+//    statistics is folded into the filter, leaving a BiasAdd with a constant
+//    bias.
+//  * Conv2D or MatMul followed by BiasAdd, and optionally by Relu, Relu6 or
+//    Elu, becomes a single _FusedConv2D or _FusedMatMul node that adds the
+//    bias and applies the activation while the output is still in cache.
+// Intermediate results are only fused away when nothing else consumes them.
+class OpFusionOptimizer : public GraphOptimizer {
+ public:
+  OpFusionOptimizer() : num_gpus_(0) {}
+  explicit OpFusionOptimizer(int num_gpus) : num_gpus_(num_gpus) {}
+  ~OpFusionOptimizer() override {}
+
+  string name() const override { return "op_fusion_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+
+ private:
+  // Folds the FusedBatchNorm 'node' into the filter of the Conv2D it
+  // normalizes, and rewrites it into a BiasAdd.
+  bool FoldBatchNorm(NodeDef* node);
+
+  // Fuses the BiasAdd 'node' with the Conv2D or MatMul that produces its
+  // input, and with the activation that consumes its output if any.
+  bool FuseBiasAdd(NodeDef* node);
+
+  // Returns the node that produces the data input 'index' of 'node', or
+  // nullptr if it is not output 0 of a node that may be fused into 'node'.
+  NodeDef* GetFusableInput(const NodeDef& node, int index) const;
+
+  // Returns the only consumer of 'node', or nullptr if it has several or if
+  // the output of 'node' may not be fused away.
+  NodeDef* GetOnlyConsumer(const NodeDef& node) const;
+
+  bool IsPreserved(const NodeDef& node) const;
+
+  // Removes the fused nodes from graph_, along with the constants that were
+  // only used by them.
+  void RemoveDeadNodes();
+
+  int num_gpus_;
+  GraphDef* graph_;
+  std::unique_ptr<NodeMap> node_map_;
+  std::unordered_set<string> nodes_to_preserve_;
+  // Nodes whose outputs other than output 0 are fetched.
+  std::unordered_set<string> fetched_side_outputs_;
+  // Nodes that were merged into another node.
+  std::unordered_set<string> fused_nodes_;
+  // Constants that may have become unused.
+  std::unordered_set<string> dead_candidates_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_OP_FUSION_OPTIMIZER_H_
@@ -0,0 +1,229 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/op_fusion_optimizer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class OpFusionOptimizerTest : public ::testing::Test {
+ protected:
+  // Returns the node named 'name' in 'graph', or nullptr.
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+
+  Output RandomConstant(const Scope& s, const TensorShape& shape) {
+    Tensor value(DT_FLOAT, shape);
+    value.flat<float>().setRandom();
+    return ops::Const(s, Input::Initializer(value));
+  }
+
+  std::vector<Tensor> EvaluateNodes(const GraphDef& graph,
+                                    const std::vector<string>& fetch) {
+    SessionOptions options;
+    std::unique_ptr<tensorflow::Session> session(NewSession(options));
+    TF_CHECK_OK(session->Create(graph));
+    RunOptions run_options;
+    std::vector<Tensor> output_tensors;
+    TF_CHECK_OK(
+        session->Run(run_options, {}, fetch, fetch, &output_tensors, nullptr));
+    TF_CHECK_OK(session->Close());
+    return output_tensors;
+  }
+};
+
+TEST_F(OpFusionOptimizerTest, FuseConv2DBiasAddRelu) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConstant(s.WithOpName("x"), {2, 6, 6, 3});
+  Output w = RandomConstant(s.WithOpName("w"), {3, 3, 3, 4});
+  Output b = RandomConstant(s.WithOpName("b"), {4});
+  Output conv =
+      ops::Conv2D(s.WithOpName("conv"), x, w, {1, 1, 1, 1}, "SAME");
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv, b);
+  Output relu = ops::Relu(s.WithOpName("relu"), bias_add);
+
+  GrapplerItem item;
+  item.fetch.push_back("relu");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpFusionOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(4, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "conv"));
+  EXPECT_EQ(nullptr, FindNode(output, "bias_add"));
+  const NodeDef* fused = FindNode(output, "relu");
+  ASSERT_NE(nullptr, fused);
+  EXPECT_EQ("_FusedConv2D", fused->op());
+  EXPECT_EQ("Relu", fused->attr().at("activation").s());
+  ASSERT_EQ(3, fused->input_size());
+  EXPECT_EQ("x", fused->input(0));
+  EXPECT_EQ("w", fused->input(1));
+  EXPECT_EQ("b", fused->input(2));
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"relu"});
+  auto tensors = EvaluateNodes(output, {"relu"});
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+}
+
+TEST_F(OpFusionOptimizerTest, FuseMatMulBiasAdd) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = RandomConstant(s.WithOpName("a"), {3, 5});
+  Output w = RandomConstant(s.WithOpName("w"), {4, 5});
+  Output b = RandomConstant(s.WithOpName("b"), {4});
+  Output matmul = ops::MatMul(s.WithOpName("matmul"), a, w,
+                              ops::MatMul::TransposeB(true));
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, b);
+  Output elu = ops::Elu(s.WithOpName("elu"), bias_add);
+
+  GrapplerItem item;
+  item.fetch.push_back("bias_add");
+  item.fetch.push_back("elu");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpFusionOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // The fetched BiasAdd can't be fused with the Elu.
+  EXPECT_EQ(5, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "matmul"));
+  const NodeDef* fused = FindNode(output, "bias_add");
+  ASSERT_NE(nullptr, fused);
+  EXPECT_EQ("_FusedMatMul", fused->op());
+  EXPECT_EQ("Identity", fused->attr().at("activation").s());
+  EXPECT_TRUE(fused->attr().at("transpose_b").b());
+  EXPECT_EQ("Elu", FindNode(output, "elu")->op());
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"bias_add", "elu"});
+  auto tensors = EvaluateNodes(output, {"bias_add", "elu"});
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+  test::ExpectTensorNear<float>(tensors_expected[1], tensors[1], 1e-5);
+}
+
+TEST_F(OpFusionOptimizerTest, FoldBatchNorm) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConstant(s.WithOpName("x"), {1, 5, 5, 2});
+  Output w = RandomConstant(s.WithOpName("w"), {2, 2, 2, 3});
+  Output scale = ops::Const(s.WithOpName("scale"), {0.5f, 1.0f, 2.0f}, {3});
+  Output offset = ops::Const(s.WithOpName("offset"), {0.1f, 0.2f, 0.3f}, {3});
+  Output mean = ops::Const(s.WithOpName("mean"), {-0.3f, 0.0f, 0.4f}, {3});
+  Output variance =
+      ops::Const(s.WithOpName("variance"), {0.25f, 1.0f, 4.0f}, {3});
+  Output conv =
+      ops::Conv2D(s.WithOpName("conv"), x, w, {1, 1, 1, 1}, "VALID");
+  auto bn = ops::FusedBatchNorm(s.WithOpName("bn"), conv, scale, offset, mean,
+                                variance,
+                                ops::FusedBatchNorm::IsTraining(false));
+  Output relu6 = ops::Relu6(s.WithOpName("relu6"), bn.y);
+
+  GrapplerItem item;
+  item.fetch.push_back("relu6");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpFusionOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  // The original filter and statistics are replaced by two constants.
+  EXPECT_EQ(4, output.node_size());
+  EXPECT_EQ(nullptr, FindNode(output, "bn"));
+  EXPECT_EQ(nullptr, FindNode(output, "w"));
+  EXPECT_EQ(nullptr, FindNode(output, "mean"));
+  const NodeDef* fused = FindNode(output, "relu6");
+  ASSERT_NE(nullptr, fused);
+  EXPECT_EQ("_FusedConv2D", fused->op());
+  EXPECT_EQ("Relu6", fused->attr().at("activation").s());
+  ASSERT_EQ(3, fused->input_size());
+  EXPECT_EQ("x", fused->input(0));
+  EXPECT_EQ("OpFusion/conv/filter", fused->input(1));
+  EXPECT_EQ("OpFusion/bn/bias", fused->input(2));
+
+  auto tensors_expected = EvaluateNodes(item.graph, {"relu6"});
+  auto tensors = EvaluateNodes(output, {"relu6"});
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-4);
+}
+
+TEST_F(OpFusionOptimizerTest, KeepsSharedOutputs) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = RandomConstant(s.WithOpName("a"), {3, 5});
+  Output w = RandomConstant(s.WithOpName("w"), {5, 4});
+  Output b = RandomConstant(s.WithOpName("b"), {4});
+  Output matmul = ops::MatMul(s.WithOpName("matmul"), a, w);
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, b);
+  Output sum = ops::Add(s.WithOpName("sum"), matmul, bias_add);
+
+  GrapplerItem item;
+  item.fetch.push_back("sum");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpFusionOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    EXPECT_EQ(item.graph.node(i).DebugString(), output.node(i).DebugString());
+  }
+}
+
+TEST_F(OpFusionOptimizerTest, OnlyFusesOnCpu) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/gpu:0");
+  Output a = RandomConstant(s.WithOpName("a"), {3, 5});
+  Output w = RandomConstant(s.WithOpName("w"), {5, 4});
+  Output b = RandomConstant(s.WithOpName("b"), {4});
+  Output matmul = ops::MatMul(s.WithOpName("matmul"), a, w);
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, b);
+  Output relu = ops::Relu(s.WithOpName("relu"), bias_add);
+
+  GrapplerItem item;
+  item.fetch.push_back("relu");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpFusionOptimizer optimizer;
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    EXPECT_EQ(item.graph.node(i).DebugString(), output.node(i).DebugString());
+  }
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,405 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/placement_optimizer.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/analytical_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Returns true if 'node' must stay on the device it was placed on.
+bool IsPinned(const NodeDef& node) {
+  if (node.device().empty() || IsPlaceholder(node) || IsVariable(node) ||
+      IsSend(node) || IsRecv(node) || IsEnter(node) || IsExit(node) ||
+      IsMerge(node) || IsSwitch(node) || IsNextIteration(node) ||
+      IsLoopCond(node)) {
+    return true;
+  }
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok() ||
+      op_def->is_stateful()) {
+    return true;
+  }
+  DataTypeVector inputs;
+  DataTypeVector outputs;
+  if (!InOutTypesForNode(node, *op_def, &inputs, &outputs).ok()) {
+    return true;
+  }
+  for (const DataTypeVector* types : {&inputs, &outputs}) {
+    for (DataType type : *types) {
+      if (IsRefType(type) || type == DT_RESOURCE) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Returns the size in bytes of 'tensor', counting the unknown dimensions as 1.
+int64 TensorSize(const OpInfo::TensorProperties& tensor) {
+  int64 num_elements = 1;
+  if (!tensor.shape().unknown_rank()) {
+    for (const auto& dim : tensor.shape().dim()) {
+      num_elements *= std::max<int64>(dim.size(), 1);
+    }
+  }
+  return num_elements * DataTypeSize(BaseType(tensor.dtype()));
+}
+
+// Builds a placement of the nodes of 'graph', a topologically sorted copy of
+// the graph of 'item', by list scheduling.
+class ListScheduler {
+ public:
+  ListScheduler(const Cluster& cluster, const GrapplerItem& item,
+                GraphDef* graph)
+      : devices_(cluster.GetDevices()), item_(item), graph_(graph) {}
+
+  // Assigns the nodes to their devices, and sets 'num_moved' to the number of
+  // nodes that changed device.
+  Status PlaceNodes(int* num_moved);
+
+ private:
+  struct Input {
+    int node;
+    // The size in bytes of the tensor, or -1 for control dependencies.
+    int64 size;
+    OpInfo::TensorProperties properties;
+  };
+
+  int FindGroup(int node) {
+    while (group_[node] != node) {
+      group_[node] = group_[group_[node]];
+      node = group_[node];
+    }
+    return node;
+  }
+
+  // Puts the nodes that must be placed together in the same group.
+  void BuildGroups();
+
+  // Returns the predicted execution time of 'node' on 'device'.
+  int64 ComputeTime(int node, const string& device);
+
+  // Returns the time it takes to send 'input' from 'src' to 'dst'.
+  int64 TransferTime(const Input& input, const string& src, const string& dst);
+
+  const std::unordered_map<string, DeviceProperties>& devices_;
+  const GrapplerItem& item_;
+  GraphDef* graph_;
+  OpLevelCostEstimator estimator_;
+  std::vector<OpInfo> op_infos_;
+  std::vector<std::vector<Input>> inputs_;
+  std::vector<std::vector<int>> outputs_;
+
+  // Union-find forest of the colocation groups.
+  std::vector<int> group_;
+  // Indexed by group.
+  std::vector<bool> pinned_;
+  std::vector<std::vector<string>> candidates_;
+};
+
+void ListScheduler::BuildGroups() {
+  const int num_nodes = graph_->node_size();
+  std::unordered_map<string, int> index;
+  for (int i = 0; i < num_nodes; ++i) {
+    index[graph_->node(i).name()] = i;
+  }
+  group_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    group_[i] = i;
+  }
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = graph_->node(i);
+    auto attr = node.attr().find(kColocationAttrName);
+    if (attr == node.attr().end()) {
+      continue;
+    }
+    for (const string& colocation : attr->second.list().s()) {
+      StringPiece name(colocation);
+      if (!name.Consume(kColocationGroupPrefix)) {
+        continue;
+      }
+      auto it = index.find(name.ToString());
+      if (it != index.end()) {
+        group_[FindGroup(i)] = FindGroup(it->second);
+      }
+    }
+  }
+
+  std::unordered_map<string, std::vector<string>> devices_by_type;
+  for (const auto& device : devices_) {
+    devices_by_type[device.second.type()].push_back(device.first);
+  }
+  for (auto& devices : devices_by_type) {
+    std::sort(devices.second.begin(), devices.second.end());
+  }
+
+  pinned_.assign(num_nodes, false);
+  candidates_.resize(num_nodes);
+  std::vector<const string*> group_device(num_nodes, nullptr);
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = graph_->node(i);
+    const int group = FindGroup(i);
+    auto device = devices_.find(node.device());
+    if (device == devices_.end() || IsPinned(node)) {
+      pinned_[group] = true;
+      continue;
+    }
+    // The members of a group must all start on the same device.
+    if (group_device[group] != nullptr &&
+        *group_device[group] != node.device()) {
+      pinned_[group] = true;
+      continue;
+    }
+    group_device[group] = &node.device();
+    candidates_[group] = devices_by_type[device->second.type()];
+  }
+}
+
+int64 ListScheduler::ComputeTime(int node, const string& device) {
+  OpInfo& op_info = op_infos_[node];
+  *op_info.mutable_device() = devices_.at(device);
+  // Make sure the estimates are at least one nanosecond per node.
+  return std::max<int64>(
+      estimator_.PredictCosts(op_info).execution_time.count(), 1);
+}
+
+int64 ListScheduler::TransferTime(const Input& input, const string& src,
+                                  const string& dst) {
+  if (input.size < 0 || src == dst || devices_.count(src) == 0 ||
+      devices_.count(dst) == 0) {
+    return 0;
+  }
+  OpInfo op_info;
+  op_info.set_op("_Send");
+  *op_info.add_inputs() = input.properties;
+  *op_info.mutable_device() = GetChannelProperties(src, devices_.at(src), dst,
+                                                   devices_.at(dst));
+  return estimator_.PredictCosts(op_info).execution_time.count();
+}
+
+Status ListScheduler::PlaceNodes(int* num_moved) {
+  *num_moved = 0;
+  GraphProperties properties(item_);
+  TF_RETURN_IF_ERROR(properties.InferStatically());
+
+  const int num_nodes = graph_->node_size();
+  std::unordered_map<string, int> index;
+  for (int i = 0; i < num_nodes; ++i) {
+    index[graph_->node(i).name()] = i;
+  }
+  op_infos_.resize(num_nodes);
+  inputs_.resize(num_nodes);
+  outputs_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = graph_->node(i);
+    OpInfo& op_info = op_infos_[i];
+    op_info.set_op(node.op());
+    *op_info.mutable_attr() = node.attr();
+    for (const auto& input : properties.GetInputProperties(node.name())) {
+      *op_info.add_inputs() = input;
+    }
+    for (const auto& output : properties.GetOutputProperties(node.name())) {
+      *op_info.add_outputs() = output;
+    }
+
+    for (const string& input_name : node.input()) {
+      int position;
+      auto it = index.find(ParseNodeName(input_name, &position));
+      // Loops are scheduled as if their back edges didn't exist.
+      if (it == index.end() || IsNextIteration(graph_->node(it->second))) {
+        continue;
+      }
+      Input input;
+      input.node = it->second;
+      input.size = -1;
+      const auto& src_outputs =
+          properties.GetOutputProperties(graph_->node(it->second).name());
+      if (position >= 0 && position < src_outputs.size()) {
+        input.properties = src_outputs[position];
+        input.size = TensorSize(input.properties);
+      }
+      inputs_[i].push_back(input);
+      outputs_[it->second].push_back(i);
+    }
+  }
+  BuildGroups();
+
+  // The priority of a node is the length of the longest path, in compute
+  // time on its current device, from the node to the end of the graph.
+  std::vector<int64> priority(num_nodes, 0);
+  for (int i = num_nodes - 1; i >= 0; --i) {
+    int64 longest_path = 0;
+    for (int output : outputs_[i]) {
+      longest_path = std::max(longest_path, priority[output]);
+    }
+    const string& device = graph_->node(i).device();
+    priority[i] = longest_path + (devices_.count(device) > 0
+                                      ? ComputeTime(i, device)
+                                      : 1);
+  }
+
+  auto lower_priority = [&priority](int a, int b) {
+    if (priority[a] != priority[b]) {
+      return priority[a] < priority[b];
+    }
+    return a > b;
+  };
+  std::priority_queue<int, std::vector<int>, decltype(lower_priority)> ready(
+      lower_priority);
+  std::vector<int> num_pending(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    num_pending[i] = inputs_[i].size();
+    if (num_pending[i] == 0) {
+      ready.push(i);
+    }
+  }
+
+  std::vector<string> placement(num_nodes);
+  std::vector<const string*> group_device(num_nodes, nullptr);
+  std::vector<int64> completion_time(num_nodes, 0);
+  std::unordered_map<string, int64> device_available;
+  while (!ready.empty()) {
+    const int node = ready.top();
+    ready.pop();
+    const NodeDef& node_def = graph_->node(node);
+    const int group = FindGroup(node);
+
+    std::vector<string> candidates;
+    if (pinned_[group]) {
+      candidates.push_back(node_def.device());
+    } else if (group_device[group] != nullptr) {
+      candidates.push_back(*group_device[group]);
+    } else {
+      candidates = candidates_[group];
+    }
+
+    int64 best_completion = -1;
+    for (const string& device : candidates) {
+      int64 start = device_available[device];
+      for (const Input& input : inputs_[node]) {
+        start = std::max(start, completion_time[input.node] +
+                                    TransferTime(input, placement[input.node],
+                                                 device));
+      }
+      const int64 completion =
+          start + (devices_.count(device) > 0 ? ComputeTime(node, device) : 1);
+      if (best_completion < 0 || completion < best_completion) {
+        best_completion = completion;
+        placement[node] = device;
+      }
+    }
+    completion_time[node] = best_completion;
+    device_available[placement[node]] = best_completion;
+    if (!pinned_[group] && group_device[group] == nullptr) {
+      group_device[group] = &placement[node];
+    }
+
+    for (int output : outputs_[node]) {
+      if (--num_pending[output] == 0) {
+        ready.push(output);
+      }
+    }
+  }
+
+  for (int i = 0; i < num_nodes; ++i) {
+    NodeDef* node = graph_->mutable_node(i);
+    // The nodes that weren't scheduled, e.g. in cycles, keep their device.
+    if (!placement[i].empty() && placement[i] != node->device()) {
+      node->set_device(placement[i]);
+      ++*num_moved;
+    }
+  }
+  return Status::OK();
+}
+
+Status PredictStepTime(Cluster* cluster, const GrapplerItem& item,
+                       const GraphDef& graph, Costs* costs) {
+  AnalyticalCostEstimator estimator(cluster, true /*use_static_shapes*/);
+  TF_RETURN_IF_ERROR(estimator.Initialize(item));
+  return estimator.PredictCosts(graph, nullptr, costs);
+}
+
+}  // namespace
+
+Status PlacementOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                    GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  if (cluster == nullptr || cluster->GetDevices().size() < 2) {
+    return Status::OK();
+  }
+
+  GrapplerItem candidate = item;
+  TopologicalSort(&candidate.graph);
+  int num_moved = 0;
+  ListScheduler scheduler(*cluster, candidate, &candidate.graph);
+  Status status = scheduler.PlaceNodes(&num_moved);
+  if (!status.ok() || num_moved == 0) {
+    VLOG(1) << "No placement change: " << status;
+    return Status::OK();
+  }
+
+  // Keep the original placement unless the candidate is predicted to be
+  // faster.
+  Costs original_costs;
+  Costs candidate_costs;
+  status = PredictStepTime(cluster, item, item.graph, &original_costs);
+  if (status.ok()) {
+    status = PredictStepTime(cluster, item, candidate.graph, &candidate_costs);
+  }
+  if (!status.ok()) {
+    VLOG(1) << "Unable to predict the step time: " << status;
+    return Status::OK();
+  }
+  VLOG(1) << "Moving " << num_moved << " nodes changes the predicted step time "
+          << "from " << original_costs.execution_time.count() << " ns to "
+          << candidate_costs.execution_time.count() << " ns";
+  if (candidate_costs.execution_time < original_costs.execution_time) {
+    *optimized_graph = candidate.graph;
+  }
+  return Status::OK();
+}
+
+void PlacementOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                  const GraphDef& optimized_graph,
+                                  double result) {
+  // Nothing to do for PlacementOptimizer.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,55 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_PLACEMENT_OPTIMIZER_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_PLACEMENT_OPTIMIZER_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Reassigns the nodes of a placed graph to the devices of the cluster to
+// minimize the step time predicted by the VirtualScheduler, including the
+// time spent transferring tensors between devices.
+//
+// Nodes only move between devices of the same type, so that their kernels and
+// memory types remain valid. Stateful nodes, nodes that read or produce
+// references or resources, placeholders, control flow and Send/Recv nodes
+// keep their device, and the nodes that must be colocated move together.
+//
+// The candidate placement is built by list scheduling: the nodes are visited
+// by decreasing length of the longest path to the end of the graph, and each
+// one goes to the device on which it would complete the earliest, given the
+// placement of its inputs. The candidate only replaces the original placement
+// when the AnalyticalCostEstimator predicts a shorter step for it.
+class PlacementOptimizer : public GraphOptimizer {
+ public:
+  PlacementOptimizer() {}
+  ~PlacementOptimizer() override {}
+
+  string name() const override { return "placement_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_PLACEMENT_OPTIMIZER_H_
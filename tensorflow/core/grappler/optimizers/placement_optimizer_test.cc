@@ -0,0 +1,212 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/placement_optimizer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+const char kCpu0[] = "/job:localhost/replica:0/task:0/cpu:0";
+const char kCpu1[] = "/job:localhost/replica:0/task:0/cpu:1";
+
+class PlacementOptimizerTest : public ::testing::Test {
+ protected:
+  static std::unique_ptr<VirtualCluster> CreateVirtualCluster() {
+    DeviceProperties cpu_device;
+    cpu_device.set_type("CPU");
+    cpu_device.set_frequency(1000);
+    cpu_device.set_num_cores(4);
+    cpu_device.set_bandwidth(10000000);  // 10 GB/s
+    std::unordered_map<string, DeviceProperties> devices;
+    devices[kCpu0] = cpu_device;
+    devices[kCpu1] = cpu_device;
+    return std::unique_ptr<VirtualCluster>(new VirtualCluster(devices));
+  }
+
+  static const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+
+  // Adds 'node' to the colocation group of 'colocate_with'.
+  static void Colocate(const string& node, const string& colocate_with,
+                       GraphDef* graph) {
+    for (NodeDef& node_def : *graph->mutable_node()) {
+      if (node_def.name() == node) {
+        (*node_def.mutable_attr())["_class"].mutable_list()->add_s(
+            strings::StrCat("loc@", colocate_with));
+      }
+    }
+  }
+};
+
+TEST_F(PlacementOptimizerTest, SpreadsIndependentWork) {
+  // b and c are expensive and independent, but both placed on cpu:0.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {256, 256});
+  Output b = ops::MatMul(s.WithOpName("b"), a, a);
+  Output c = ops::MatMul(s.WithOpName("c"), a, a);
+  Output d = ops::Add(s.WithOpName("d"), b, c);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("d");
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  PlacementOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  const NodeDef* new_b = FindNode(output, "b");
+  const NodeDef* new_c = FindNode(output, "c");
+  ASSERT_NE(nullptr, new_b);
+  ASSERT_NE(nullptr, new_c);
+  EXPECT_NE(new_b->device(), new_c->device());
+}
+
+TEST_F(PlacementOptimizerTest, KeepsPlacementOfSerialWork) {
+  // Nothing runs in parallel, so moving nodes only adds transfers.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output a = ops::Variable(s.WithOpName("a"), {256, 256}, DT_FLOAT);
+  Output b = ops::MatMul(s.WithOpName("b"), a, a);
+  Output c = ops::MatMul(s.WithOpName("c"), b, b);
+  Output d = ops::MatMul(s.WithOpName("d"), c, c);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("d");
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  PlacementOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  for (const NodeDef& node : output.node()) {
+    EXPECT_EQ(kCpu0, node.device());
+  }
+}
+
+TEST_F(PlacementOptimizerTest, ColocatedNodesMoveTogether) {
+  // e is cheap, but colocated with c: it follows c wherever c goes.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {256, 256});
+  Output b = ops::MatMul(s.WithOpName("b"), a, a);
+  Output c = ops::MatMul(s.WithOpName("c"), a, a);
+  Output d = ops::Add(s.WithOpName("d"), b, c);
+  Output e = ops::Square(s.WithOpName("e").ColocateWith(c), a);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch.push_back("d");
+  item.fetch.push_back("e");
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  PlacementOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  const NodeDef* new_b = FindNode(output, "b");
+  const NodeDef* new_c = FindNode(output, "c");
+  const NodeDef* new_e = FindNode(output, "e");
+  ASSERT_NE(nullptr, new_b);
+  ASSERT_NE(nullptr, new_c);
+  ASSERT_NE(nullptr, new_e);
+  EXPECT_NE(new_b->device(), new_c->device());
+  EXPECT_EQ(new_c->device(), new_e->device());
+}
+
+TEST_F(PlacementOptimizerTest, PinnedNodesStayPut) {
+  // c is colocated with a node that can't move, so b moves instead.
+  using test::function::NDef;
+  const std::vector<std::vector<NodeDef>> pinned_nodes = {
+      // Stateful.
+      {NDef("shape", "Const", {},
+            {{"dtype", DT_INT32}, {"value", test::AsTensor<int32>({2, 2})}},
+            kCpu0),
+       NDef("pinned", "RandomUniform", {"shape"},
+            {{"T", DT_INT32}, {"dtype", DT_FLOAT}}, kCpu0)},
+      // Reads a resource.
+      {NDef("handle", "VarHandleOp", {},
+            {{"dtype", DT_FLOAT}, {"shape", TensorShape({})}}, kCpu0),
+       NDef("pinned", "ReadVariableOp", {"handle"}, {{"dtype", DT_FLOAT}},
+            kCpu0)},
+      {NDef("pinned", "_Send", {"a"},
+            {{"T", DT_FLOAT},
+             {"tensor_name", "a"},
+             {"send_device", kCpu0},
+             {"send_device_incarnation", 0},
+             {"recv_device", kCpu1}},
+            kCpu0)},
+      {NDef("pinned", "_Recv", {},
+            {{"tensor_type", DT_FLOAT},
+             {"tensor_name", "x"},
+             {"send_device", kCpu1},
+             {"send_device_incarnation", 0},
+             {"recv_device", kCpu0}},
+            kCpu0)},
+  };
+  for (const std::vector<NodeDef>& nodes : pinned_nodes) {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+    Output a = ops::Const(s.WithOpName("a"), 1.0f, {256, 256});
+    Output b = ops::MatMul(s.WithOpName("b"), a, a);
+    Output c = ops::MatMul(s.WithOpName("c"), a, a);
+    Output d = ops::Add(s.WithOpName("d"), b, c);
+
+    GrapplerItem item;
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    for (const NodeDef& node : nodes) {
+      *item.graph.add_node() = node;
+    }
+    Colocate("c", "pinned", &item.graph);
+    item.fetch.push_back("d");
+    item.fetch.push_back("pinned");
+
+    std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+    PlacementOptimizer optimizer;
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+    const NodeDef* pinned = FindNode(output, "pinned");
+    const NodeDef* new_b = FindNode(output, "b");
+    const NodeDef* new_c = FindNode(output, "c");
+    ASSERT_NE(nullptr, pinned);
+    ASSERT_NE(nullptr, new_b);
+    ASSERT_NE(nullptr, new_c);
+    EXPECT_EQ(kCpu0, pinned->device()) << pinned->op();
+    EXPECT_EQ(kCpu0, new_c->device()) << pinned->op();
+    EXPECT_EQ(kCpu1, new_b->device()) << pinned->op();
+  }
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -119,5 +119,20 @@ Status EstimateEarliestExecutionTimes(
   return Status::OK();
 }
 
+Status EstimateExecutionTimes(
+    const GrapplerItem& item, const Cluster* cluster,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>* execution_times) {
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically());
+  OpLevelCostEstimator estimator;
+  VirtualPlacer placer(cluster);
+
+  for (const NodeDef& node : item.graph.node()) {
+    (*execution_times)[&node] =
+        PredictExecutionTime(properties, estimator, placer, node);
+  }
+  return Status::OK();
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
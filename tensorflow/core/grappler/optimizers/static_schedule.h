@@ -35,6 +35,12 @@ Status EstimateEarliestExecutionTimes(
     const GrapplerItem& item, const Cluster* cluster,
     std::unordered_map<const NodeDef*, Costs::NanoSeconds>* execution_times);
 
+// Estimate the time each node in the graph takes to execute, which is at
+// least one nanosecond.
+Status EstimateExecutionTimes(
+    const GrapplerItem& item, const Cluster* cluster,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>* execution_times);
+
 }  // namespace grappler
 }  // end namespace tensorflow
 
@@ -18,8 +18,10 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/scanner.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/util/device_name_utils.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -111,6 +113,16 @@ string NodeName(const string& name) {
   return ParseNodeName(name, &position);
 }
 
+string OutputName(const string& node_name, int position) {
+  if (position < 0) {
+    return strings::StrCat("^", node_name);
+  }
+  if (position == 0) {
+    return node_name;
+  }
+  return strings::StrCat(node_name, ":", position);
+}
+
 int NodePosition(const string& name) {
   int position;
   ParseNodeName(name, &position);
@@ -131,6 +143,30 @@ string AddPrefixToNodeName(const string& name, const string& prefix) {
   return AddPrefixToNodeName(name, prefix, "/");
 }
 
+int DeleteNodes(const std::unordered_set<string>& nodes, GraphDef* graph) {
+  int num_live = 0;
+  for (int i = 0; i < graph->node_size(); ++i) {
+    if (nodes.find(graph->node(i).name()) == nodes.end()) {
+      graph->mutable_node()->SwapElements(i, num_live++);
+    }
+  }
+  const int num_deleted = graph->node_size() - num_live;
+  graph->mutable_node()->DeleteSubrange(num_live, num_deleted);
+  return num_deleted;
+}
+
+bool IsOnCpu(const NodeDef& node, int num_gpus) {
+  if (node.device().empty()) {
+    return num_gpus == 0;
+  }
+  DeviceNameUtils::ParsedName parsed;
+  if (!DeviceNameUtils::ParseFullName(node.device(), &parsed) &&
+      !DeviceNameUtils::ParseLocalName(node.device(), &parsed)) {
+    return false;
+  }
+  return parsed.has_type && str_util::Lowercase(parsed.type) == "cpu";
+}
+
 bool ExecuteWithTimeout(std::function<void()> fn, const int64 timeout_in_ms,
                         thread::ThreadPool* const thread_pool) {
   if (timeout_in_ms <= 0) {
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_GRAPPLER_UTILS_H_
 
 #include <functional>
+#include <unordered_set>
 
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
@@ -64,6 +65,10 @@ int NodePosition(const string& name);
 // Returns the node name and position in a single call.
 string ParseNodeName(const string& name, int* position);
 
+// Returns the input referring to output 'position' of node 'node_name', i.e.
+// the reverse of ParseNodeName(). A negative position is a control input.
+string OutputName(const string& node_name, int position);
+
 // Add a prefix to a node name with a custom delimiter.
 string AddPrefixToNodeName(const string& name, const string& prefix,
                            const string& delimiter);
@@ -71,6 +76,16 @@ string AddPrefixToNodeName(const string& name, const string& prefix,
 // Add a prefix to a node name.
 string AddPrefixToNodeName(const string& name, const string& prefix);
 
+// Removes the nodes named in 'nodes' from 'graph', keeping the other nodes in
+// the same order. This moves the nodes of the graph, so the NodeMaps built on
+// it must not be used afterwards. Returns the number of removed nodes.
+int DeleteNodes(const std::unordered_set<string>& nodes, GraphDef* graph);
+
+// Returns true if 'node' is placed on a CPU. A node without a device is left
+// to the placer, which prefers a GPU if there is one, so it runs on a CPU iff
+// 'num_gpus' is 0.
+bool IsOnCpu(const NodeDef& node, int num_gpus);
+
 // Executes a 'fn' in the 'thread_pool'. The method waits for the configured
 // timeout (in milliseconds) for 'fn' to complete, before returning false.
 //
@@ -58,6 +58,46 @@ TEST_F(UtilsTest, NodePosition) {
   EXPECT_EQ(0, NodePosition(""));
 }
 
+TEST_F(UtilsTest, OutputName) {
+  EXPECT_EQ("abc", OutputName("abc", 0));
+  EXPECT_EQ("abc:1", OutputName("abc", 1));
+  EXPECT_EQ("^abc", OutputName("abc", -1));
+  for (const string& input : {"abc/def", "abc/def:2", "^abc/def"}) {
+    int position;
+    const string name = ParseNodeName(input, &position);
+    EXPECT_EQ(input, OutputName(name, position));
+  }
+}
+
+TEST_F(UtilsTest, IsOnCpu) {
+  NodeDef node;
+  EXPECT_TRUE(IsOnCpu(node, 0));
+  EXPECT_FALSE(IsOnCpu(node, 1));
+  node.set_device("/job:localhost/replica:0/task:0/cpu:0");
+  EXPECT_TRUE(IsOnCpu(node, 1));
+  node.set_device("/job:localhost/replica:0/task:0/device:CPU:0");
+  EXPECT_TRUE(IsOnCpu(node, 1));
+  node.set_device("/cpu:0");
+  EXPECT_TRUE(IsOnCpu(node, 1));
+  node.set_device("/job:localhost/replica:0/task:0/gpu:0");
+  EXPECT_FALSE(IsOnCpu(node, 0));
+  node.set_device("/job:localhost");
+  EXPECT_FALSE(IsOnCpu(node, 0));
+  node.set_device("not a device");
+  EXPECT_FALSE(IsOnCpu(node, 0));
+}
+
+TEST_F(UtilsTest, DeleteNodes) {
+  GraphDef graph;
+  for (const string& name : {"a", "b", "c", "d"}) {
+    graph.add_node()->set_name(name);
+  }
+  EXPECT_EQ(2, DeleteNodes({"a", "c", "e"}, &graph));
+  ASSERT_EQ(2, graph.node_size());
+  EXPECT_EQ("b", graph.node(0).name());
+  EXPECT_EQ("d", graph.node(1).name());
+}
+
 TEST_F(UtilsTest, AddNodeNamePrefix) {
   EXPECT_EQ("OPTIMIZED/abc", AddPrefixToNodeName("abc", "OPTIMIZED"));
   EXPECT_EQ("^OPTIMIZED/abc", AddPrefixToNodeName("^abc", "OPTIMIZED"));
@@ -31,7 +31,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/conv_2d.h"
 #include "tensorflow/core/kernels/deep_conv2d.h"
+#include "tensorflow/core/kernels/fused_bias_activation.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/kernels/packed_matmul.h"
 #ifdef TENSORFLOW_USE_LIBXSMM
 #include "tensorflow/core/kernels/xsmm_conv2d.h"
 #endif
@@ -181,6 +183,56 @@ class LaunchDeepConvOp<CPUDevice, float> {
   }
 };
 
+// Runs a convolution that reduces to a matrix multiplication, as in
+// LaunchGeneric, with a cached packed copy of the filter, and returns true,
+// if that is expected to be faster than the other implementations.
+template <typename Device, typename T>
+class LaunchPackedConvOp {
+ public:
+  static bool Run(OpKernelContext* ctx, PackedMatMulRhsCache* cache,
+                  const Tensor& input, const Tensor& filter, int batch,
+                  int input_rows, int input_cols, int in_depth,
+                  int filter_rows, int filter_cols, int out_rows, int out_cols,
+                  int out_depth, int stride_rows, int stride_cols,
+                  Padding padding, Tensor* output, TensorFormat data_format) {
+    return false;
+  }
+};
+
+template <>
+class LaunchPackedConvOp<CPUDevice, float> {
+ public:
+  static bool Run(OpKernelContext* ctx, PackedMatMulRhsCache* cache,
+                  const Tensor& input, const Tensor& filter, int batch,
+                  int input_rows, int input_cols, int in_depth,
+                  int filter_rows, int filter_cols, int out_rows, int out_cols,
+                  int out_depth, int stride_rows, int stride_cols,
+                  Padding padding, Tensor* output, TensorFormat data_format) {
+    if (data_format != FORMAT_NHWC) return false;
+    int64 m;
+    if (filter_rows == 1 && filter_cols == 1 && stride_rows == 1 &&
+        stride_cols == 1) {
+      m = static_cast<int64>(batch) * out_rows * out_cols;
+    } else if (filter_rows == input_rows && filter_cols == input_cols &&
+               padding == VALID) {
+      m = batch;
+    } else {
+      return false;
+    }
+    if (!UsePackedMatMul(m)) return false;
+
+    // The filter is a row major [filter_rows * filter_cols * in_depth,
+    // out_depth] matrix, and each row of the input a row of the lhs.
+    const int64 k = static_cast<int64>(filter_rows) * filter_cols * in_depth;
+    const CPUDevice& d = ctx->eigen_device<CPUDevice>();
+    std::shared_ptr<const PackedMatMulRhs> packed_filter =
+        cache->Get(d, filter, false, k, out_depth);
+    PackedMatMul(d, false, input.flat<float>().data(), m, k, *packed_filter,
+                 output->flat<float>().data(), out_depth);
+    return true;
+  }
+};
+
 #ifdef TENSORFLOW_USE_LIBXSMM
 template <typename Device, typename T>
 class LaunchXsmmConvOp {
@@ -251,9 +303,17 @@ class LaunchXsmmConvOp<CPUDevice, float> {
 #endif
 
 template <typename Device, typename T>
-class Conv2DOp : public BinaryOp<T> {
+class Conv2DOp : public OpKernel {
  public:
-  explicit Conv2DOp(OpKernelConstruction* context) : BinaryOp<T>(context) {
+  explicit Conv2DOp(OpKernelConstruction* context) : Conv2DOp(context, 2) {}
+
+ protected:
+  // Expects 'num_inputs' inputs of type T: the input and filter, followed by
+  // the inputs of the ops fused with the convolution.
+  Conv2DOp(OpKernelConstruction* context, int num_inputs) : OpKernel(context) {
+    const DataType dt = DataTypeToEnum<T>::v();
+    OP_REQUIRES_OK(context, context->MatchSignature(
+                                DataTypeVector(num_inputs, dt), {dt}));
     OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
     string data_format;
     OP_REQUIRES_OK(context, context->GetAttr("data_format", &data_format));
@@ -272,8 +332,13 @@ class Conv2DOp : public BinaryOp<T> {
         errors::InvalidArgument("Current implementation does not yet support "
                                 "strides in the batch and depth dimensions."));
     OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    // Set by MarkConstantWeights() when the filter is produced by a constant.
+    if (!context->GetAttr(kConstantWeightsAttr, &constant_weights_).ok()) {
+      constant_weights_ = false;
+    }
   }
 
+ public:
   void Compute(OpKernelContext* context) override {
     // Input tensor is of the following dimensions:
     // [ batch, in_rows, in_cols, in_depth ]
@@ -387,6 +452,15 @@ class Conv2DOp : public BinaryOp<T> {
       return;
     }
 
+    if (constant_weights_ &&
+        LaunchPackedConvOp<Device, T>::Run(
+            context, &packed_filter_, input, filter, batch, input_rows,
+            input_cols, in_depth, filter_rows, filter_cols, out_rows, out_cols,
+            out_depth, stride_rows, stride_cols, padding_, output,
+            data_format_)) {
+      return;
+    }
+
     launcher_.launch(context, use_cudnn_, cudnn_use_autotune_, input, filter,
                      stride_rows, stride_cols,
                      BrainPadding2EigenPadding(padding_), output, data_format_);
@@ -399,6 +473,8 @@ class Conv2DOp : public BinaryOp<T> {
   TensorFormat data_format_;
   LaunchConv2DOp<Device, T> launcher_;
   bool cudnn_use_autotune_;
+  bool constant_weights_;
+  PackedMatMulRhsCache packed_filter_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(Conv2DOp);
 };
@@ -415,6 +491,59 @@ TF_CALL_half(REGISTER_CPU);
 TF_CALL_float(REGISTER_CPU);
 #endif  // USE_GEMM_FOR_CONV
 
+// Conv2D followed by a BiasAdd and an activation, as fused by grappler's
+// OpFusionOptimizer.  The bias and activation are applied in a single pass
+// over the output of the convolution, and the BiasAdd node and its output
+// buffer go away.
+template <typename Device, typename T>
+class FusedConv2DOp : public Conv2DOp<Device, T> {
+ public:
+  explicit FusedConv2DOp(OpKernelConstruction* context)
+      : Conv2DOp<Device, T>(context, 3) {
+    // The bias is added along the innermost dimension of the output.
+    string data_format;
+    OP_REQUIRES_OK(context, context->GetAttr("data_format", &data_format));
+    OP_REQUIRES(context, data_format == "NHWC",
+                errors::InvalidArgument("_FusedConv2D only supports NHWC, got ",
+                                        data_format));
+    string activation;
+    OP_REQUIRES_OK(context, context->GetAttr("activation", &activation));
+    OP_REQUIRES_OK(context, GetFusedActivation(activation, &activation_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& filter = context->input(1);
+    const Tensor& bias = context->input(2);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(bias.shape()),
+                errors::InvalidArgument("bias must be 1-dimensional: ",
+                                        bias.shape().DebugString()));
+    OP_REQUIRES(context,
+                filter.dims() == 4 && bias.dim_size(0) == filter.dim_size(3),
+                errors::InvalidArgument(
+                    "bias must have one element per output channel: ",
+                    bias.shape().DebugString(), " vs. filter ",
+                    filter.shape().DebugString()));
+
+    Conv2DOp<Device, T>::Compute(context);
+    if (!context->status().ok()) return;
+
+    Tensor* output = context->mutable_output(0);
+    if (output->NumElements() == 0) return;
+    functor::BiasActivation<Device, T>()(
+        context->eigen_device<Device>(), activation_, bias.vec<T>(),
+        output->flat_inner_dims<T>());
+  }
+
+ private:
+  FusedActivation activation_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedConv2DOp);
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("_FusedConv2D").Device(DEVICE_CPU).TypeConstraint<float>("T"),
+    FusedConv2DOp<CPUDevice, float>);
+
 // To be used inside depthwise_conv_op.cc.
 template class LaunchConv2DOp<CPUDevice, float>;
 
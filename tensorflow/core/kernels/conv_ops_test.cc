@@ -21,9 +21,12 @@ limitations under the License.
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
@@ -72,6 +75,95 @@ TEST(ConvParameters, WinogradNonfusedAlgoSize) {
 
 #endif  // GOOGLE_CUDA
 
+class ConvConstantWeightsTest : public OpsTestBase {
+ protected:
+  // Convolves input with filter, marked as constant weights or not.
+  Tensor RunConv(const Tensor& input, const Tensor& filter, int stride,
+                 const string& padding, bool constant_weights) {
+    TF_CHECK_OK(NodeDefBuilder("conv", "Conv2D")
+                    .Input(FakeInput(DT_FLOAT))
+                    .Input(FakeInput(DT_FLOAT))
+                    .Attr("T", DT_FLOAT)
+                    .Attr("strides", {1, stride, stride, 1})
+                    .Attr("padding", padding)
+                    .Attr("_constant_weights", constant_weights)
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    inputs_.clear();
+    AddInputFromArray<float>(input.shape(), input.flat<float>());
+    AddInputFromArray<float>(filter.shape(), filter.flat<float>());
+    TF_CHECK_OK(RunOpKernel());
+    return *GetOutput(0);
+  }
+
+  void Compare(const TensorShape& input_shape, const TensorShape& filter_shape,
+               int stride, const string& padding) {
+    Tensor input(DT_FLOAT, input_shape);
+    input.flat<float>().setRandom();
+    Tensor filter(DT_FLOAT, filter_shape);
+    filter.flat<float>().setRandom();
+    const Tensor expected = RunConv(input, filter, stride, padding, false);
+    const Tensor packed = RunConv(input, filter, stride, padding, true);
+    test::ExpectTensorNear<float>(expected, packed, 1e-4);
+    // The second run reuses the packed copy of the filter.
+    TF_ASSERT_OK(RunOpKernel());
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+  }
+};
+
+TEST_F(ConvConstantWeightsTest, OneByOneStrideOne) {
+  Compare(TensorShape({2, 3, 5, 11}), TensorShape({1, 1, 11, 7}), 1, "SAME");
+  Compare(TensorShape({2, 3, 5, 11}), TensorShape({1, 1, 11, 7}), 1, "VALID");
+}
+
+TEST_F(ConvConstantWeightsTest, ValidFullFilter) {
+  Compare(TensorShape({5, 3, 4, 6}), TensorShape({3, 4, 6, 9}), 1, "VALID");
+  Compare(TensorShape({5, 3, 4, 6}), TensorShape({3, 4, 6, 9}), 2, "VALID");
+}
+
+TEST_F(ConvConstantWeightsTest, OtherShapesMatchUnpacked) {
+  // Convolutions that do not reduce to a single matmul ignore the attr.
+  Compare(TensorShape({2, 6, 6, 3}), TensorShape({1, 1, 3, 4}), 2, "SAME");
+  Compare(TensorShape({2, 6, 6, 3}), TensorShape({3, 3, 3, 4}), 1, "SAME");
+}
+
+class FusedConv2DOpTest : public OpsTestBase {
+ protected:
+  Status MakeOp(const string& data_format, const string& activation) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("fused_conv", "_FusedConv2D")
+                           .Input(FakeInput(DT_FLOAT))
+                           .Input(FakeInput(DT_FLOAT))
+                           .Input(FakeInput(DT_FLOAT))
+                           .Attr("T", DT_FLOAT)
+                           .Attr("strides", {1, 1, 1, 1})
+                           .Attr("padding", "VALID")
+                           .Attr("data_format", data_format)
+                           .Attr("activation", activation)
+                           .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(FusedConv2DOpTest, AddsBiasAndAppliesActivation) {
+  TF_ASSERT_OK(MakeOp("NHWC", "Relu"));
+  // A 1x2x2x1 image and a 2x2x1x2 filter give a 1x1x1x2 output.
+  AddInputFromArray<float>(TensorShape({1, 2, 2, 1}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({2, 2, 1, 2}),
+                           {1, -1, 1, -1, 1, -1, 1, -1});
+  AddInputFromArray<float>(TensorShape({2}), {-3, 5});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(DT_FLOAT, TensorShape({1, 1, 1, 2}));
+  // Relu(10 - 3) and Relu(-10 + 5).
+  test::FillValues<float>(&expected, {7, 0});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedConv2DOpTest, RejectsNCHW) {
+  Status s = MakeOp("NCHW", "Identity");
+  EXPECT_FALSE(s.ok());
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("NCHW")) << s;
+}
+
 class FusedResizePadConvOpTest : public OpsTestBase {
  protected:
   void HandwrittenConv() {
@@ -15,6 +15,8 @@ limitations under the License.
 
 // See docs in ../ops/data_flow_ops.cc.
 
+#include <string.h>
+#include <algorithm>
 #include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -22,10 +24,16 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
+// Inputs with at least this many bytes of data per worker thread are
+// partitioned in parallel.
+static const int64 kMinParallelPartitionBytes = 64 * 1024;
+
 // Shared code that is not dependent on the type of T.  We do this to reduce
 // code size by not duplicating all this for all T (float, double, int32, etc.)
 class DynamicPartitionOp_Shared : public OpKernel {
@@ -97,6 +105,13 @@ class DynamicPartitionOp : public DynamicPartitionOp_Shared {
 
     auto e_partitions = partitions->flat<int32>();
     const int64 N = e_partitions.dimension(0);
+    const int64 data_bytes = data->NumElements() * sizeof(T);
+    const int num_threads =
+        c->device()->tensorflow_cpu_worker_threads()->num_threads;
+    if (num_threads > 1 && data_bytes >= 2 * kMinParallelPartitionBytes) {
+      ComputeParallel(c, *data, *partitions, &outputs);
+      return;
+    }
     gtl::InlinedVector<int, 32> output_index(num_partitions_);
 
     if (partitions->dims() == data->dims()) {
@@ -154,6 +169,95 @@ class DynamicPartitionOp : public DynamicPartitionOp_Shared {
       }
     }
   }
+
+ private:
+  // Splits the rows of data into one contiguous block per thread, and copies
+  // them to the outputs in two parallel passes: the first counts the rows
+  // each block sends to every partition, and the second copies the rows of
+  // each block to the output offsets left free by the preceding blocks.
+  void ComputeParallel(OpKernelContext* c, const Tensor& data,
+                       const Tensor& partitions, OpOutputList* outputs) {
+    auto e_partitions = partitions.flat<int32>();
+    const int64 N = e_partitions.dimension(0);
+    const int64 slice_size = data.NumElements() / N;
+    const int64 slice_bytes = slice_size * sizeof(T);
+    const T* data_base = data.flat<T>().data();
+    const int num_partitions = num_partitions_;
+
+    auto worker_threads = *(c->device()->tensorflow_cpu_worker_threads());
+    const int64 num_blocks = std::max<int64>(
+        1, std::min<int64>(worker_threads.num_threads,
+                           N * slice_bytes / kMinParallelPartitionBytes));
+    auto block_begin = [N, num_blocks](int64 b) { return N * b / num_blocks; };
+    const int64 cost_per_block = N * slice_bytes / num_blocks;
+
+    // offsets[b * num_partitions + p] first holds the number of rows of block
+    // b in partition p, and then the output row of the first of them.
+    std::vector<int64> offsets(num_blocks * num_partitions, 0);
+    // The partition of each row, read once so that both passes agree even if
+    // partitions is overwritten concurrently.
+    std::vector<int32> row_partitions(N);
+    mutex mu;
+    Status status;
+    auto count = [&](int64 first, int64 last) {
+      for (int64 b = first; b < last; ++b) {
+        int64* block_counts = &offsets[b * num_partitions];
+        for (int64 i = block_begin(b); i < block_begin(b + 1); ++i) {
+          const int32 p = internal::SubtleMustCopy(e_partitions(i));
+          if (!FastBoundsCheck(p, num_partitions)) {
+            mutex_lock l(mu);
+            status.Update(errors::InvalidArgument(
+                "indices[", i,
+                "] has been asynchronously overwitten and is no longer in "
+                "range!"));
+            return;
+          }
+          row_partitions[i] = p;
+          ++block_counts[p];
+        }
+      }
+    };
+    Shard(num_blocks, worker_threads.workers, num_blocks, cost_per_block,
+          count);
+    OP_REQUIRES_OK(c, status);
+
+    for (int p = 0; p < num_partitions; ++p) {
+      int64 next = 0;
+      for (int64 b = 0; b < num_blocks; ++b) {
+        const int64 block_count = offsets[b * num_partitions + p];
+        offsets[b * num_partitions + p] = next;
+        next += block_count;
+      }
+      OP_REQUIRES(c, next == (*outputs)[p]->dim_size(0),
+                  errors::InvalidArgument(
+                      "partitions has been asynchronously overwritten: ", next,
+                      " rows for output ", p, " of size ",
+                      (*outputs)[p]->dim_size(0)));
+    }
+
+    std::vector<T*> out_base(num_partitions);
+    for (int p = 0; p < num_partitions; ++p) {
+      out_base[p] = (*outputs)[p]->flat<T>().data();
+    }
+    const bool can_memcpy = DataTypeCanUseMemcpy(DataTypeToEnum<T>::v());
+    auto copy = [&](int64 first, int64 last) {
+      for (int64 b = first; b < last; ++b) {
+        int64* block_offsets = &offsets[b * num_partitions];
+        for (int64 i = block_begin(b); i < block_begin(b + 1); ++i) {
+          const int32 p = row_partitions[i];
+          T* out = out_base[p] + block_offsets[p]++ * slice_size;
+          const T* in = data_base + i * slice_size;
+          if (can_memcpy) {
+            memcpy(out, in, slice_bytes);
+          } else {
+            std::copy(in, in + slice_size, out);
+          }
+        }
+      }
+    };
+    Shard(num_blocks, worker_threads.workers, num_blocks, cost_per_block,
+          copy);
+  }
 };
 
 #define REGISTER_DYNAMIC_PARTITION(T)                                     \
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
@@ -23,10 +25,14 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -153,5 +159,90 @@ TEST_F(DynamicPartitionOpTest, Error_IndexOutOfRange) {
       << s;
 }
 
+// Partitions 'rows' rows of 'cols' values, which is large enough for the
+// rows to be copied in parallel, and checks that every output keeps the rows
+// of its partition in order.
+void CheckLargePartition(OpsTestBase* test, int rows, int cols) {
+  std::vector<float> data;
+  std::vector<int32> partitions;
+  std::vector<std::vector<float>> expected(4);
+  for (int i = 0; i < rows; ++i) {
+    const int32 p = (i * 7 + i / 3) % 4;
+    partitions.push_back(p);
+    for (int j = 0; j < cols; ++j) {
+      data.push_back(i * cols + j);
+      expected[p].push_back(i * cols + j);
+    }
+  }
+  TensorShape data_shape({rows});
+  if (cols > 1) data_shape.AddDim(cols);
+  test->AddInputFromArray<float>(data_shape, data);
+  test->AddInputFromArray<int32>(TensorShape({rows}), partitions);
+  TF_ASSERT_OK(test->RunOpKernel());
+
+  for (int p = 0; p < 4; ++p) {
+    TensorShape shape({static_cast<int64>(expected[p].size() / cols)});
+    if (cols > 1) shape.AddDim(cols);
+    Tensor expected_output(test->allocator(), DT_FLOAT, shape);
+    test::FillValues<float>(&expected_output, expected[p]);
+    test::ExpectTensorEqual<float>(expected_output, *test->GetOutput(p));
+  }
+}
+
+TEST_F(DynamicPartitionOpTest, Large_OneD) {
+  MakeOp();
+  CheckLargePartition(this, 200000, 1);
+}
+
+TEST_F(DynamicPartitionOpTest, Large_TwoD) {
+  MakeOp();
+  CheckLargePartition(this, 20000, 64);
+}
+
+Node* DynamicPartitionNode(Graph* g, Node* in0, Node* in1,
+                           int num_partitions) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "DynamicPartition")
+                  .Input(in0)
+                  .Input(in1)
+                  .Attr("num_partitions", num_partitions)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+template <typename T>
+static Graph* DynamicPartition(int num_partitions, int dim) {
+  Graph* g = new Graph(OpRegistry::Global());
+  // Always use a 32MB buffer.
+  const int kRows = ((32 << 20) / sizeof(T)) / dim;
+  Tensor data(DataTypeToEnum<T>::value, TensorShape({kRows, dim}));
+  data.flat<T>().setRandom();
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor partitions(DT_INT32, TensorShape({kRows}));
+  for (int i = 0; i < kRows; i++) {
+    partitions.flat<int32>()(i) = rnd.Uniform(num_partitions);
+  }
+  DynamicPartitionNode(g, test::graph::Constant(g, data),
+                       test::graph::Constant(g, partitions), num_partitions);
+  return g;
+}
+
+#define BM_DYNAMIC_PARTITION(DEVICE, T, num)                            \
+  static void BM_##DEVICE##_dynpart_##T##_##num(int iters, int dim) {   \
+    const int64 items = ((32 << 20) / sizeof(T));                       \
+    const int64 tot = static_cast<int64>(iters) * items;                \
+    testing::ItemsProcessed(tot);                                       \
+    testing::UseRealTime();                                             \
+    test::Benchmark(#DEVICE, DynamicPartition<T>(num, dim)).Run(iters); \
+  }                                                                     \
+  BENCHMARK(BM_##DEVICE##_dynpart_##T##_##num)->Arg(1)->Arg(16)->Arg(256)
+
+BM_DYNAMIC_PARTITION(cpu, float, 2);
+BM_DYNAMIC_PARTITION(cpu, float, 100);
+BM_DYNAMIC_PARTITION(cpu, double, 2);
+BM_DYNAMIC_PARTITION(cpu, double, 100);
+
 }  // namespace
 }  // namespace tensorflow
@@ -15,13 +15,22 @@ limitations under the License.
 
 // See docs in ../ops/data_flow_ops.cc.
 
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
+// Results with at least this many bytes per worker thread are stitched in
+// parallel.
+static const int64 kMinParallelStitchBytes = 64 * 1024;
+
 template <class T>
 class DynamicStitchOp : public OpKernel {
  public:
@@ -98,7 +107,11 @@ class DynamicStitchOp : public OpKernel {
 
     // TODO(jeff): Currently we leave uninitialized any portions of
     // merged that aren't covered by an index in indices.  What should we do?
-    if (first_dim_size > 0) {
+    if (first_dim_size > 0 &&
+        merged->TotalBytes() >= 2 * kMinParallelStitchBytes &&
+        c->device()->tensorflow_cpu_worker_threads()->num_threads > 1) {
+      ComputeParallel(c, indices_inputs, data_inputs, merged);
+    } else if (first_dim_size > 0) {
       auto merged_flat = merged->flat_outer_dims<T>();
       const int slice_size = merged_flat.dimension(1);
       for (int input_num = 0; input_num < indices_inputs.size(); input_num++) {
@@ -139,6 +152,51 @@ class DynamicStitchOp : public OpKernel {
   }
 
  private:
+  // Resolves the slice that ends up in each row of merged in a serial pass
+  // over the indices, where later slices replace earlier ones, and then copies
+  // the rows of merged in parallel.
+  void ComputeParallel(OpKernelContext* c, const OpInputList& indices_inputs,
+                       const OpInputList& data_inputs, Tensor* merged) {
+    auto merged_flat = merged->flat_outer_dims<T>();
+    const int64 first_dim_size = merged_flat.dimension(0);
+    const int64 slice_size = merged_flat.dimension(1);
+    const int64 slice_bytes = slice_size * sizeof(T);
+
+    // Rows not covered by any index are left uninitialized, as in the
+    // serial case.
+    std::vector<const T*> sources(first_dim_size, nullptr);
+    for (int input_num = 0; input_num < indices_inputs.size(); input_num++) {
+      auto indices_vec = indices_inputs[input_num].flat<int32>();
+      const T* data_base = data_inputs[input_num].flat<T>().data();
+      for (int i = 0; i < indices_vec.size(); i++) {
+        int32 index = internal::SubtleMustCopy(indices_vec(i));
+        OP_REQUIRES(
+            c, FastBoundsCheck(index, first_dim_size),
+            errors::InvalidArgument("indices[", i, "] is out of range"));
+        sources[index] = data_base + i * slice_size;
+      }
+    }
+
+    T* merged_base = merged_flat.data();
+    const bool can_memcpy = DataTypeCanUseMemcpy(DataTypeToEnum<T>::v());
+    auto copy = [&sources, merged_base, slice_size, slice_bytes, can_memcpy](
+                    int64 first, int64 last) {
+      for (int64 row = first; row < last; ++row) {
+        const T* source = sources[row];
+        if (source == nullptr) continue;
+        T* dest = merged_base + row * slice_size;
+        if (can_memcpy) {
+          memcpy(dest, source, slice_bytes);
+        } else {
+          std::copy(source, source + slice_size, dest);
+        }
+      }
+    };
+    auto worker_threads = *(c->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, first_dim_size,
+          slice_bytes, copy);
+  }
+
   // Check if data0.shape[indices0.dims():] == data1.shape[indices1.dims():]
   static bool SameExtraShape(const Tensor& data0, const Tensor& indices0,
                              const Tensor& data1, const Tensor& indices1) {
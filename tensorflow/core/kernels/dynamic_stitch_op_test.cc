@@ -15,7 +15,9 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
@@ -23,12 +25,15 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -79,6 +84,34 @@ TEST_F(DynamicStitchOpTest, Simple_TwoD) {
   test::ExpectTensorEqual<float>(expected, *GetOutput(0));
 }
 
+// Large enough for the rows of merged to be copied in parallel.  Every row
+// is written by both inputs, and the second input must win.
+TEST_F(DynamicStitchOpTest, Large_TwoD) {
+  MakeOp(2, DT_FLOAT);
+  const int kRows = 20000;
+  const int kCols = 64;
+  std::vector<int32> indices0, indices1;
+  std::vector<float> data0, data1, expected_values(kRows * kCols);
+  for (int i = 0; i < kRows; ++i) {
+    indices0.push_back(i);
+    indices1.push_back(kRows - 1 - i);
+    for (int j = 0; j < kCols; ++j) {
+      data0.push_back(-1);
+      data1.push_back(i * kCols + j);
+      expected_values[(kRows - 1 - i) * kCols + j] = i * kCols + j;
+    }
+  }
+  AddInputFromArray<int32>(TensorShape({kRows}), indices0);
+  AddInputFromArray<int32>(TensorShape({kRows}), indices1);
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), data0);
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), data1);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({kRows, kCols}));
+  test::FillValues<float>(&expected, expected_values);
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
 TEST_F(DynamicStitchOpTest, Error_IndicesMultiDimensional) {
   MakeOp(2, DT_FLOAT);
 
@@ -141,5 +174,46 @@ TEST_F(DynamicStitchOpTest, Error_DataAndIndicesSizeMismatch) {
       << s;
 }
 
+// Stitches back the 'num_partitions' parts of a 32MB tensor of rows with
+// 'dim' values, split by row modulo num_partitions.
+template <typename T>
+static Graph* DynamicStitch(int num_partitions, int dim) {
+  Graph* g = new Graph(OpRegistry::Global());
+  const int kRows = ((32 << 20) / sizeof(T)) / dim;
+  std::vector<NodeBuilder::NodeOut> indices, data;
+  for (int p = 0; p < num_partitions; ++p) {
+    const int part_rows = (kRows - p + num_partitions - 1) / num_partitions;
+    Tensor part_indices(DT_INT32, TensorShape({part_rows}));
+    for (int i = 0; i < part_rows; ++i) {
+      part_indices.flat<int32>()(i) = i * num_partitions + p;
+    }
+    Tensor part_data(DataTypeToEnum<T>::value, TensorShape({part_rows, dim}));
+    part_data.flat<T>().setRandom();
+    indices.push_back(test::graph::Constant(g, part_indices));
+    data.push_back(test::graph::Constant(g, part_data));
+  }
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "DynamicStitch")
+                  .Input(indices)
+                  .Input(data)
+                  .Finalize(g, &ret));
+  return g;
+}
+
+#define BM_DYNAMIC_STITCH(DEVICE, T, num)                               \
+  static void BM_##DEVICE##_dynstitch_##T##_##num(int iters, int dim) { \
+    const int64 items = ((32 << 20) / sizeof(T));                       \
+    const int64 tot = static_cast<int64>(iters) * items;                \
+    testing::ItemsProcessed(tot);                                       \
+    testing::UseRealTime();                                             \
+    test::Benchmark(#DEVICE, DynamicStitch<T>(num, dim)).Run(iters);    \
+  }                                                                     \
+  BENCHMARK(BM_##DEVICE##_dynstitch_##T##_##num)->Arg(1)->Arg(16)->Arg(256)
+
+BM_DYNAMIC_STITCH(cpu, float, 2);
+BM_DYNAMIC_STITCH(cpu, float, 100);
+BM_DYNAMIC_STITCH(cpu, double, 2);
+BM_DYNAMIC_STITCH(cpu, double, 100);
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,88 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_FUSED_BIAS_ACTIVATION_H_
+#define TENSORFLOW_KERNELS_FUSED_BIAS_ACTIVATION_H_
+
+// Bias and activation epilogue shared by the _FusedConv2D and _FusedMatMul
+// kernels, which grappler's OpFusionOptimizer substitutes for a Conv2D or
+// MatMul followed by a BiasAdd and an activation.
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+enum class FusedActivation { kIdentity, kRelu, kRelu6, kElu };
+
+// Parses the "activation" attr of the fused ops.
+inline Status GetFusedActivation(const string& name,
+                                 FusedActivation* activation) {
+  if (name == "Identity") {
+    *activation = FusedActivation::kIdentity;
+  } else if (name == "Relu") {
+    *activation = FusedActivation::kRelu;
+  } else if (name == "Relu6") {
+    *activation = FusedActivation::kRelu6;
+  } else if (name == "Elu") {
+    *activation = FusedActivation::kElu;
+  } else {
+    return errors::InvalidArgument("Unsupported fused activation: ", name);
+  }
+  return Status::OK();
+}
+
+namespace functor {
+
+// Adds 'bias' to every row of 'output' and applies 'activation', in place and
+// in a single pass over 'output'.
+template <typename Device, typename T>
+struct BiasActivation {
+  void operator()(const Device& d, FusedActivation activation,
+                  typename TTypes<T>::ConstVec bias,
+                  typename TTypes<T>::Matrix output) {
+    const int rows = output.dimension(0);
+    const int cols = output.dimension(1);
+    Eigen::DSizes<int, 2> bias_shape(1, cols);
+    Eigen::DSizes<int, 2> bcast(rows, 1);
+    auto biased = output + bias.reshape(bias_shape).broadcast(bcast);
+    switch (activation) {
+      case FusedActivation::kIdentity:
+        output.device(d) = biased;
+        break;
+      case FusedActivation::kRelu:
+        output.device(d) = biased.cwiseMax(static_cast<T>(0));
+        break;
+      case FusedActivation::kRelu6:
+        output.device(d) =
+            biased.cwiseMax(static_cast<T>(0)).cwiseMin(static_cast<T>(6));
+        break;
+      case FusedActivation::kElu:
+        // exp() - 1 is computed for every element, as in the Elu kernel.
+        output.device(d) = (biased < static_cast<T>(0))
+                               .select(biased.exp() - static_cast<T>(1),
+                                       biased);
+        break;
+    }
+  }
+};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_FUSED_BIAS_ACTIVATION_H_
@@ -137,6 +137,12 @@ class InitializableLookupTable : public LookupInterface {
   virtual Status DoFind(const Tensor& keys, Tensor* values,
                         const Tensor& default_value) = 0;
 
+  // Called once all the elements have been inserted, right before the table
+  // is marked as initialized. Since the table is read-only from then on,
+  // implementations may use it to move their contents into a layout that is
+  // cheaper to store and to look up.
+  virtual Status DoFreeze() { return Status::OK(); }
+
   mutex mu_;
   bool is_initialized_ = false;
 };
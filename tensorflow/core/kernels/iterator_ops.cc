@@ -78,15 +78,41 @@ class IteratorResource : public ResourceBase {
 
   Status GetNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                  bool* end_of_sequence) {
-    std::shared_ptr<IteratorBase> captured_iterator(iterator_);
+    std::shared_ptr<IteratorBase> captured_iterator;
+    {
+      mutex_lock l(mu_);
+      if (has_peeked_element_) {
+        *out_tensors = std::move(peeked_element_);
+        peeked_element_.clear();
+        has_peeked_element_ = false;
+        *end_of_sequence = false;
+        return Status::OK();
+      }
+      captured_iterator = iterator_;
+    }
     if (captured_iterator) {
       return captured_iterator->GetNext(ctx, out_tensors, end_of_sequence);
     } else {
-      return errors::FailedPrecondition(
-          "GetNext() failed because the iterator has not been initialized. "
-          "Ensure that you have run the initializer operation for this "
-          "iterator before getting the next element.");
+      return NotInitializedError();
+    }
+  }
+
+  // Gets the next element ahead of GetNext(), which returns it, unless it was
+  // gotten already. Sets `*has_next` to false at the end of the sequence.
+  Status HasNext(IteratorContext* ctx, bool* has_next) {
+    mutex_lock l(mu_);
+    if (!has_peeked_element_) {
+      if (!iterator_) {
+        return NotInitializedError();
+      }
+      bool end_of_sequence = false;
+      peeked_element_.clear();
+      TF_RETURN_IF_ERROR(
+          iterator_->GetNext(ctx, &peeked_element_, &end_of_sequence));
+      has_peeked_element_ = !end_of_sequence;
     }
+    *has_next = has_peeked_element_;
+    return Status::OK();
   }
 
   // Transfers ownership of iterator to this. This method is thread-safe.
@@ -97,7 +123,10 @@ class IteratorResource : public ResourceBase {
       TF_RETURN_IF_ERROR(
           VerifyShapesCompatible(output_shapes_, iterator->output_shapes()));
     }
+    mutex_lock l(mu_);
     iterator_.reset(iterator.release());
+    peeked_element_.clear();
+    has_peeked_element_ = false;
     return Status::OK();
   }
 
@@ -110,7 +139,19 @@ class IteratorResource : public ResourceBase {
   }
 
  private:
-  std::shared_ptr<IteratorBase> iterator_;
+  static Status NotInitializedError() {
+    return errors::FailedPrecondition(
+        "GetNext() failed because the iterator has not been initialized. "
+        "Ensure that you have run the initializer operation for this "
+        "iterator before getting the next element.");
+  }
+
+  mutex mu_;
+  std::shared_ptr<IteratorBase> iterator_ GUARDED_BY(mu_);
+  // The element gotten by HasNext(), if any, to be returned by the next call
+  // to GetNext().
+  std::vector<Tensor> peeked_element_ GUARDED_BY(mu_);
+  bool has_peeked_element_ GUARDED_BY(mu_) = false;
   const DataTypeVector output_dtypes_;
   const std::vector<PartialTensorShape> output_shapes_;
 };
@@ -402,6 +443,49 @@ class IteratorGetNextOp : public AsyncOpKernel {
   std::unique_ptr<thread::ThreadPool> thread_pool_;
 };
 
+class IteratorHasNextOp : public AsyncOpKernel {
+ public:
+  explicit IteratorHasNextOp(OpKernelConstruction* ctx)
+      : AsyncOpKernel(ctx),
+        thread_pool_(new thread::ThreadPool(
+            ctx->env(), ThreadOptions(),
+            strings::StrCat("iterator_has_next_thread_",
+                            SanitizeThreadSuffix(name())),
+            1 /* num_threads */, false /* low_latency_hint */)) {}
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    IteratorResource* iterator;
+    OP_REQUIRES_OK(ctx,
+                   LookupResource(ctx, HandleFromInput(ctx, 0), &iterator));
+
+    // As in IteratorGetNextOp, the call to `iterator->HasNext()` may block
+    // and is issued from the owned thread pool.
+    thread_pool_->Schedule([this, ctx, iterator, done]() {
+      core::ScopedUnref unref_iterator(iterator);
+
+      IteratorContext::Params params;
+      params.env = ctx->env();
+      params.step_id = ctx->step_id();
+      params.resource_manager = ctx->resource_manager();
+      params.runner = *(ctx->runner());
+      IteratorContext iter_ctx(std::move(params));
+
+      bool has_next = false;
+      OP_REQUIRES_OK_ASYNC(ctx, iterator->HasNext(&iter_ctx, &has_next),
+                           done);
+      Tensor* output;
+      OP_REQUIRES_OK_ASYNC(
+          ctx, ctx->allocate_output(0, TensorShape({}), &output), done);
+      output->scalar<bool>()() = has_next;
+
+      done();
+    });
+  }
+
+ private:
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
 class IteratorDisposeOp : public OpKernel {
  public:
   explicit IteratorDisposeOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
@@ -422,6 +506,8 @@ REGISTER_KERNEL_BUILDER(Name("OneShotIterator").Device(DEVICE_CPU),
                         OneShotIteratorOp);
 REGISTER_KERNEL_BUILDER(Name("IteratorGetNext").Device(DEVICE_CPU),
                         IteratorGetNextOp);
+REGISTER_KERNEL_BUILDER(Name("IteratorHasNext").Device(DEVICE_CPU),
+                        IteratorHasNextOp);
 REGISTER_KERNEL_BUILDER(Name("IteratorDispose").Device(DEVICE_CPU),
                         IteratorDisposeOp);
 
@@ -25,15 +25,101 @@ limitations under the License.
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace lookup {
 
+namespace {
+
+// A reader/writer lock for the mutable tables: any number of Find calls may
+// read a table concurrently, while inserts and imports get exclusive access.
+// Waiting writers block new readers, so that a steady stream of lookups cannot
+// starve inserts.
+class LOCKABLE ReaderWriterMutex {
+ public:
+  ReaderWriterMutex() {}
+
+  void ReaderLock() SHARED_LOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    while (writer_active_ || writers_waiting_ > 0) {
+      cv_.wait(l);
+    }
+    ++readers_;
+  }
+
+  void ReaderUnlock() UNLOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    if (--readers_ == 0) {
+      cv_.notify_all();
+    }
+  }
+
+  void WriterLock() EXCLUSIVE_LOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    ++writers_waiting_;
+    while (writer_active_ || readers_ > 0) {
+      cv_.wait(l);
+    }
+    --writers_waiting_;
+    writer_active_ = true;
+  }
+
+  void WriterUnlock() UNLOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    writer_active_ = false;
+    cv_.notify_all();
+  }
+
+ private:
+  mutex mu_;
+  condition_variable cv_;
+  int64 readers_ GUARDED_BY(mu_) = 0;
+  int64 writers_waiting_ GUARDED_BY(mu_) = 0;
+  bool writer_active_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReaderWriterMutex);
+};
+
+// Holds a ReaderWriterMutex in shared mode for the lifetime of the object.
+class SCOPED_LOCKABLE ReaderMutexLock {
+ public:
+  explicit ReaderMutexLock(ReaderWriterMutex* mu) SHARED_LOCK_FUNCTION(mu)
+      : mu_(mu) {
+    mu_->ReaderLock();
+  }
+  ~ReaderMutexLock() UNLOCK_FUNCTION() { mu_->ReaderUnlock(); }
+
+ private:
+  ReaderWriterMutex* const mu_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReaderMutexLock);
+};
+
+// Holds a ReaderWriterMutex in exclusive mode for the lifetime of the object.
+class SCOPED_LOCKABLE WriterMutexLock {
+ public:
+  explicit WriterMutexLock(ReaderWriterMutex* mu) EXCLUSIVE_LOCK_FUNCTION(mu)
+      : mu_(mu) {
+    mu_->WriterLock();
+  }
+  ~WriterMutexLock() UNLOCK_FUNCTION() { mu_->WriterUnlock(); }
+
+ private:
+  ReaderWriterMutex* const mu_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(WriterMutexLock);
+};
+
+}  // namespace
+
 // Lookup table that wraps an unordered_map, where the key and value data type
 // is specified. Each individual value must be a scalar. If vector values are
 // required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// Concurrent Find calls do not block each other.
 //
 // Sample use case:
 //
@@ -49,7 +135,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
   MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
 
   size_t size() const override {
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     return table_.size();
   }
 
@@ -59,7 +145,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     for (int64 i = 0; i < key_values.size(); ++i) {
       value_values(i) = gtl::FindWithDefault(
           table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
@@ -73,7 +159,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
+    WriterMutexLock l(&mu_);
     if (clear) {
       table_.clear();
     }
@@ -96,7 +182,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     int64 size = table_.size();
 
     Tensor* keys;
@@ -125,8 +211,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
   TensorShape value_shape() const override { return TensorShape(); }
 
  private:
-  // TODO(andreasst): consider using a read/write lock or a concurrent map
-  mutable mutex mu_;
+  mutable ReaderWriterMutex mu_;
   std::unordered_map<K, V> table_ GUARDED_BY(mu_);
 };
 
@@ -145,7 +230,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   size_t size() const override {
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     return table_.size();
   }
 
@@ -156,9 +241,9 @@ class MutableHashTableOfTensors final : public LookupInterface {
     auto value_values = value->flat_inner_dims<V, 2>();
     int64 value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     for (int64 i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec = gtl::FindOrNull(
+      const ValueArray* value_vec = gtl::FindOrNull(
           table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)));
       if (value_vec != nullptr) {
         for (int64 j = 0; j < value_dim; j++) {
@@ -179,7 +264,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64 value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
+    WriterMutexLock l(&mu_);
     if (clear) {
       table_.clear();
     }
@@ -206,7 +291,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     int64 size = table_.size();
     int64 value_dim = value_shape_.dim_size(0);
 
@@ -241,8 +326,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
  private:
   TensorShape value_shape_;
-  // TODO(andreasst): consider using a read/write lock or a concurrent map
-  mutable mutex mu_;
+  mutable ReaderWriterMutex mu_;
   typedef gtl::InlinedVector<V, 4> ValueArray;
   std::unordered_map<K, ValueArray> table_ GUARDED_BY(mu_);
 };
@@ -267,6 +351,9 @@ TensorShape MaybeVectorizeShape(const TensorShape& shape) {
 }  // namespace
 
 // Modeled after densehashtable in https://github.com/sparsehash/sparsehash
+//
+// Concurrent Find calls do not block each other, and large batches of keys are
+// looked up in parallel on the intra-op thread pool.
 template <class K, class V>
 class MutableDenseHashTable final : public LookupInterface {
  public:
@@ -308,7 +395,7 @@ class MutableDenseHashTable final : public LookupInterface {
   }
 
   size_t size() const override LOCKS_EXCLUDED(mu_) {
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     return num_entries_;
   }
 
@@ -328,7 +415,7 @@ class MutableDenseHashTable final : public LookupInterface {
     auto value_matrix = value->shaped<V, 2>({num_elements, value_size});
     const auto default_flat = default_value.flat<V>();
 
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     const auto key_buckets_matrix =
         key_buckets_.AccessTensor(ctx)->template matrix<K>();
     const auto value_buckets_matrix =
@@ -336,43 +423,60 @@ class MutableDenseHashTable final : public LookupInterface {
     const auto empty_key_matrix =
         empty_key_.AccessTensor(ctx)->template shaped<K, 2>({1, key_size});
     const int64 bit_mask = num_buckets_ - 1;
-    // TODO(andreasst): parallelize using work_sharder
-    for (int64 i = 0; i < num_elements; ++i) {
-      const uint64 key_hash = HashKey(key_matrix, i);
-      if (empty_key_hash_ == key_hash &&
-          IsEqualKey(empty_key_matrix, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the empty_key as a table key is not allowed");
-      }
-      int64 bucket_index = key_hash & bit_mask;
-      int64 num_probes = 0;
-      while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
-          for (int64 j = 0; j < value_size; ++j) {
-            // TODO(andreasst): check if we can get rid of SubtleMustCopy
-            // here and elsewhere in this file.
-            value_matrix(i, j) = SubtleMustCopyUnlessStringOrFloat(
-                value_buckets_matrix(bucket_index, j));
-          }
-          break;
+
+    // Large batches of keys are looked up in parallel on the intra-op thread
+    // pool. The table is only read, so the shards need no synchronization
+    // other than for reporting an error.
+    mutex status_mu;
+    Status status;
+    auto find_range = [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; ++i) {
+        const uint64 key_hash = HashKey(key_matrix, i);
+        if (empty_key_hash_ == key_hash &&
+            IsEqualKey(empty_key_matrix, 0, key_matrix, i)) {
+          mutex_lock status_lock(status_mu);
+          status.Update(errors::InvalidArgument(
+              "Using the empty_key as a table key is not allowed"));
+          return;
         }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_matrix, 0)) {
-          for (int64 j = 0; j < value_size; ++j) {
-            value_matrix(i, j) =
-                SubtleMustCopyUnlessStringOrFloat(default_flat(j));
+        int64 bucket_index = key_hash & bit_mask;
+        int64 num_probes = 0;
+        while (true) {
+          if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
+            for (int64 j = 0; j < value_size; ++j) {
+              // TODO(andreasst): check if we can get rid of SubtleMustCopy
+              // here and elsewhere in this file.
+              value_matrix(i, j) = SubtleMustCopyUnlessStringOrFloat(
+                  value_buckets_matrix(bucket_index, j));
+            }
+            break;
+          }
+          if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_matrix,
+                         0)) {
+            for (int64 j = 0; j < value_size; ++j) {
+              value_matrix(i, j) =
+                  SubtleMustCopyUnlessStringOrFloat(default_flat(j));
+            }
+            break;
+          }
+          ++num_probes;
+          bucket_index =
+              (bucket_index + num_probes) & bit_mask;  // quadratic probing
+          if (num_probes >= num_buckets_) {
+            mutex_lock status_lock(status_mu);
+            status.Update(errors::Internal(
+                "Internal error in MutableDenseHashTable lookup"));
+            return;
           }
-          break;
-        }
-        ++num_probes;
-        bucket_index =
-            (bucket_index + num_probes) & bit_mask;  // quadratic probing
-        if (num_probes >= num_buckets_) {
-          return errors::Internal(
-              "Internal error in MutableDenseHashTable lookup");
         }
       }
-    }
-    return Status::OK();
+    };
+    // Rough cost of hashing a key, probing a few buckets and copying a value.
+    const int64 cost_per_key = 50 * key_size + 10 * value_size;
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_elements,
+          cost_per_key, find_range);
+    return status;
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& key,
@@ -384,7 +488,7 @@ class MutableDenseHashTable final : public LookupInterface {
                                      expected_shape.DebugString(), " got ",
                                      key.shape().DebugString());
     }
-    mutex_lock l(mu_);
+    WriterMutexLock l(&mu_);
     // For simplicity we assume that all keys in the input result in inserts
     // rather than updates. That means we may grow the table even though we
     // don't need to. As long as the number of keys inserted in one call is
@@ -402,7 +506,7 @@ class MutableDenseHashTable final : public LookupInterface {
 
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override LOCKS_EXCLUDED(mu_) {
-    mutex_lock l(mu_);
+    WriterMutexLock l(&mu_);
     num_buckets_ = keys.dim_size(0);
     key_buckets_ = PersistentTensor(keys);
     value_buckets_ = PersistentTensor(values);
@@ -424,7 +528,7 @@ class MutableDenseHashTable final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override LOCKS_EXCLUDED(mu_) {
-    mutex_lock l(mu_);
+    ReaderMutexLock l(&mu_);
     Tensor key_buckets_tensor = *key_buckets_.AccessTensor(ctx);
     Tensor value_buckets_tensor = *value_buckets_.AccessTensor(ctx);
     TF_RETURN_IF_ERROR(ctx->set_output("keys", key_buckets_tensor));
@@ -603,7 +707,7 @@ class MutableDenseHashTable final : public LookupInterface {
   TensorShape key_shape_;
   TensorShape value_shape_;
   float max_load_factor_;
-  mutable mutex mu_;
+  mutable ReaderWriterMutex mu_;
   int64 num_entries_ GUARDED_BY(mu_);
   int64 num_buckets_ GUARDED_BY(mu_);
   PersistentTensor key_buckets_ GUARDED_BY(mu_);
@@ -0,0 +1,277 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/lookup_table_op.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(FlatStringMapTest, FindsAllKeys) {
+  std::unordered_map<string, int64> map;
+  for (int i = 0; i < 1000; ++i) {
+    map[strings::StrCat("key", i)] = i;
+  }
+  map[""] = -7;
+  lookup::FlatStringMap<int64> flat(map);
+  EXPECT_EQ(map.size(), flat.size());
+  for (const auto& entry : map) {
+    const int64* value = flat.Find(entry.first);
+    ASSERT_NE(nullptr, value) << entry.first;
+    EXPECT_EQ(entry.second, *value);
+  }
+  EXPECT_EQ(nullptr, flat.Find("key1000"));
+  EXPECT_EQ(nullptr, flat.Find("ke"));
+}
+
+TEST(FlatStringMapTest, Empty) {
+  lookup::FlatStringMap<bool> flat((std::unordered_map<string, bool>()));
+  EXPECT_EQ(0, flat.size());
+  EXPECT_EQ(nullptr, flat.Find("key"));
+}
+
+TEST(FlatStringMapTest, BoolValues) {
+  std::unordered_map<string, bool> map = {{"a", true}, {"b", false}};
+  lookup::FlatStringMap<bool> flat(map);
+  EXPECT_TRUE(*flat.Find("a"));
+  EXPECT_FALSE(*flat.Find("b"));
+  EXPECT_EQ(nullptr, flat.Find("c"));
+}
+
+// Yields a single batch of keys and values.
+class SingleBatchIterator
+    : public lookup::InitializableLookupTable::InitTableIterator {
+ public:
+  SingleBatchIterator(const Tensor& keys, const Tensor& values)
+      : keys_(keys), values_(values) {}
+
+  void Next() override { valid_ = false; }
+  bool Valid() const override { return valid_; }
+  const Tensor& keys() const override { return keys_; }
+  const Tensor& values() const override { return values_; }
+  Status status() const override {
+    return valid_ ? Status::OK() : errors::OutOfRange("No more data.");
+  }
+  int64 total_size() const override { return keys_.NumElements(); }
+
+ private:
+  const Tensor keys_;
+  const Tensor values_;
+  bool valid_ = true;
+};
+
+TEST(HashTableTest, FindAfterInitializeStringKeys) {
+  auto* table = new lookup::HashTable<string, int64>(nullptr, nullptr);
+  core::ScopedUnref unref(table);
+  Tensor keys = test::AsTensor<string>({"a", "", "brown", "fox", "jumps"});
+  Tensor values = test::AsTensor<int64>({0, 1, 2, 3, 4});
+  Tensor default_value = test::AsScalar<int64>(-1);
+
+  Tensor lookup_keys = test::AsTensor<string>({"fox", "dog", "", "a", "b"});
+  Tensor found(DT_INT64, lookup_keys.shape());
+  Status s = table->Find(nullptr, lookup_keys, &found, default_value);
+  EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+  EXPECT_EQ(0, table->size());
+
+  SingleBatchIterator iter(keys, values);
+  TF_ASSERT_OK(table->Initialize(iter));
+  EXPECT_EQ(5, table->size());
+  TF_ASSERT_OK(table->Find(nullptr, lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({3, -1, 1, 0, -1}),
+                                 found);
+
+  // The frozen table is read-only.
+  SingleBatchIterator reinit(test::AsTensor<string>({"dog"}),
+                             test::AsTensor<int64>({5}));
+  s = table->Initialize(reinit);
+  EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+  TF_ASSERT_OK(table->Find(nullptr, lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({3, -1, 1, 0, -1}),
+                                 found);
+}
+
+TEST(HashTableTest, FindAfterInitializeInt64Keys) {
+  auto* table = new lookup::HashTable<int64, string>(nullptr, nullptr);
+  core::ScopedUnref unref(table);
+  SingleBatchIterator iter(test::AsTensor<int64>({10, 20, 30}),
+                           test::AsTensor<string>({"ten", "twenty", "thirty"}));
+  TF_ASSERT_OK(table->Initialize(iter));
+  EXPECT_EQ(3, table->size());
+
+  Tensor lookup_keys = test::AsTensor<int64>({30, 15, 10, 0});
+  Tensor found(DT_STRING, lookup_keys.shape());
+  TF_ASSERT_OK(table->Find(nullptr, lookup_keys, &found,
+                           test::AsScalar<string>("n/a")));
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>({"thirty", "n/a", "ten", "n/a"}), found);
+}
+
+// Tables built with the same 'shared_name' refer to the same resource, so
+// keys inserted by one graph are visible to the lookups of another.
+Node* DenseHashTable(Graph* g, const string& shared_name) {
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableDenseHashTableV2")
+                  .Input(test::graph::Constant(g, test::AsScalar<int64>(-1)))
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_INT64)
+                  .Attr("shared_name", shared_name)
+                  .Finalize(g, &node));
+  return node;
+}
+
+Node* LookupTableFind(Graph* g, Node* table, const Tensor& keys,
+                      Node* default_value) {
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                  .Input(table)
+                  .Input(test::graph::Constant(g, keys))
+                  .Input(default_value)
+                  .Finalize(g, &node));
+  return node;
+}
+
+// Looks up enough keys for Find to split the work into several shards.
+TEST(MutableDenseHashTableTest, ShardedFind) {
+  const int kNumKeys = 10000;
+  Graph g(OpRegistry::Global());
+  Node* table = DenseHashTable(&g, "sharded_find_test");
+
+  // Inserts the even keys in [0, 2 * kNumKeys).
+  Tensor keys(DT_INT64, TensorShape({kNumKeys}));
+  Tensor values(DT_INT64, TensorShape({kNumKeys}));
+  for (int i = 0; i < kNumKeys; ++i) {
+    keys.flat<int64>()(i) = 2 * i;
+    values.flat<int64>()(i) = 10 * i;
+  }
+  Node* insert;
+  TF_ASSERT_OK(NodeBuilder(g.NewName("insert"), "LookupTableInsertV2")
+                   .Input(table)
+                   .Input(test::graph::Constant(&g, keys))
+                   .Input(test::graph::Constant(&g, values))
+                   .Finalize(&g, &insert));
+
+  Tensor lookup_keys(DT_INT64, TensorShape({2 * kNumKeys}));
+  for (int i = 0; i < 2 * kNumKeys; ++i) {
+    lookup_keys.flat<int64>()(i) = i;
+  }
+  Node* default_value = test::graph::Constant(&g, test::AsScalar<int64>(-7));
+  Node* find = LookupTableFind(&g, table, lookup_keys, default_value);
+  Tensor bad_keys(DT_INT64, TensorShape({3}));
+  test::FillValues<int64>(&bad_keys, {0, -1, 2});
+  Node* bad_find = LookupTableFind(&g, table, bad_keys, default_value);
+
+  GraphDef graph_def;
+  g.ToGraphDef(&graph_def);
+  SessionOptions options;
+  options.config.set_intra_op_parallelism_threads(4);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(graph_def));
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {find->name()}, {}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  Tensor expected(DT_INT64, TensorShape({2 * kNumKeys}));
+  for (int i = 0; i < 2 * kNumKeys; ++i) {
+    expected.flat<int64>()(i) = i % 2 == 0 ? 5 * i : -7;
+  }
+  test::ExpectTensorEqual<int64>(expected, outputs[0]);
+
+  Status s = session->Run({}, {bad_find->name()}, {}, &outputs);
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Using the empty_key as a table key is not "
+                            "allowed"))
+      << s;
+  TF_ASSERT_OK(session->Close());
+}
+
+const int kTableSize = 1 << 20;
+const int kKeysPerCall = 4096;
+
+// All tables built below share one resource, so the keys inserted by the init
+// graph are visible to the lookups of the benchmarked graph.
+const char kBenchmarkTable[] = "dense_hash_table_benchmark";
+
+Graph* InsertKeys() {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor keys(DT_INT64, TensorShape({kTableSize}));
+  auto keys_flat = keys.flat<int64>();
+  for (int i = 0; i < kTableSize; ++i) {
+    keys_flat(i) = i;
+  }
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                  .Input(DenseHashTable(g, kBenchmarkTable))
+                  .Input(test::graph::Constant(g, keys))
+                  .Input(test::graph::Constant(g, keys))
+                  .Finalize(g, &node));
+  return g;
+}
+
+// Builds 'num_callers' independent lookups of random keys, which the executor
+// runs concurrently against the shared table.
+Graph* FindKeys(int num_callers) {
+  Graph* g = new Graph(OpRegistry::Global());
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Node* table = DenseHashTable(g, kBenchmarkTable);
+  Node* default_value = test::graph::Constant(g, test::AsScalar<int64>(-1));
+  for (int c = 0; c < num_callers; ++c) {
+    Tensor keys(DT_INT64, TensorShape({kKeysPerCall}));
+    auto keys_flat = keys.flat<int64>();
+    for (int i = 0; i < kKeysPerCall; ++i) {
+      keys_flat(i) = rnd.Uniform(kTableSize);
+    }
+    LookupTableFind(g, table, keys, default_value);
+  }
+  return g;
+}
+
+static void BM_MutableDenseHashTableFind(int iters, int num_callers) {
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_callers *
+                          kKeysPerCall);
+  testing::UseRealTime();
+  test::Benchmark("cpu", FindKeys(num_callers), nullptr, InsertKeys())
+      .Run(iters);
+}
+BENCHMARK(BM_MutableDenseHashTableFind)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32);
+
+}  // namespace
+}  // namespace tensorflow
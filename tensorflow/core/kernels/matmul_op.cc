@@ -23,6 +23,8 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/fill_functor.h"
+#include "tensorflow/core/kernels/fused_bias_activation.h"
+#include "tensorflow/core/kernels/packed_matmul.h"
 
 #if GOOGLE_CUDA
 #include "cuda/include/cuda.h"
@@ -254,12 +256,45 @@ struct LaunchMatMul<GPUDevice, T, true /* USE_CUBLAS */> {
 
 #endif  // GOOGLE_CUDA
 
+// Computes out = a * b with a cached packed copy of b, and returns true, if
+// that is expected to be faster than LaunchMatMul.
+template <typename Device, typename T>
+struct LaunchPackedMatMul {
+  static bool Run(OpKernelContext* ctx, PackedMatMulRhsCache* cache,
+                  const Tensor& a, const Tensor& b, bool transpose_a,
+                  bool transpose_b, Tensor* out) {
+    return false;
+  }
+};
+
+template <>
+struct LaunchPackedMatMul<CPUDevice, float> {
+  static bool Run(OpKernelContext* ctx, PackedMatMulRhsCache* cache,
+                  const Tensor& a, const Tensor& b, bool transpose_a,
+                  bool transpose_b, Tensor* out) {
+    const int64 m = out->dim_size(0);
+    if (!UsePackedMatMul(m)) return false;
+    const int64 n = out->dim_size(1);
+    const int64 k = a.dim_size(transpose_a ? 0 : 1);
+    const CPUDevice& d = ctx->eigen_device<CPUDevice>();
+    std::shared_ptr<const PackedMatMulRhs> packed_b =
+        cache->Get(d, b, transpose_b, k, n);
+    PackedMatMul(d, transpose_a, a.flat<float>().data(), m, a.dim_size(1),
+                 *packed_b, out->flat<float>().data(), n);
+    return true;
+  }
+};
+
 template <typename Device, typename T, bool USE_CUBLAS>
 class MatMulOp : public OpKernel {
  public:
   explicit MatMulOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("transpose_a", &transpose_a_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("transpose_b", &transpose_b_));
+    // Set by MarkConstantWeights() when b is produced by a constant.
+    if (!ctx->GetAttr(kConstantWeightsAttr, &constant_weights_).ok()) {
+      constant_weights_ = false;
+    }
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -302,12 +337,20 @@ class MatMulOp : public OpKernel {
       return;
     }
 
+    if (constant_weights_ &&
+        LaunchPackedMatMul<Device, T>::Run(ctx, &packed_b_, a, b, transpose_a_,
+                                           transpose_b_, out)) {
+      return;
+    }
+
     LaunchMatMul<Device, T, USE_CUBLAS>::launch(ctx, this, a, b, dim_pair, out);
   }
 
  private:
   bool transpose_a_;
   bool transpose_b_;
+  bool constant_weights_;
+  PackedMatMulRhsCache packed_b_;
 };
 
 namespace functor {
@@ -374,6 +417,48 @@ TF_CALL_complex64(REGISTER_CPU);
 TF_CALL_complex128(REGISTER_CPU);
 #endif
 
+// MatMul followed by a BiasAdd and an activation, as fused by grappler's
+// OpFusionOptimizer.  The bias and activation are applied in a single pass
+// over the product, and the BiasAdd node and its output buffer go away.
+template <typename Device, typename T>
+class FusedMatMulOp : public MatMulOp<Device, T, false> {
+ public:
+  explicit FusedMatMulOp(OpKernelConstruction* ctx)
+      : MatMulOp<Device, T, false>(ctx) {
+    string activation;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("activation", &activation));
+    OP_REQUIRES_OK(ctx, GetFusedActivation(activation, &activation_));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& bias = ctx->input(2);
+    OP_REQUIRES(ctx, TensorShapeUtils::IsVector(bias.shape()),
+                errors::InvalidArgument("bias must be 1-dimensional: ",
+                                        bias.shape().DebugString()));
+
+    MatMulOp<Device, T, false>::Compute(ctx);
+    if (!ctx->status().ok()) return;
+
+    Tensor* out = ctx->mutable_output(0);
+    OP_REQUIRES(ctx, bias.dim_size(0) == out->dim_size(1),
+                errors::InvalidArgument(
+                    "bias must have one element per column of the product: ",
+                    bias.shape().DebugString(), " vs. product ",
+                    out->shape().DebugString()));
+    if (out->NumElements() == 0) return;
+    functor::BiasActivation<Device, T>()(ctx->eigen_device<Device>(),
+                                         activation_, bias.vec<T>(),
+                                         out->matrix<T>());
+  }
+
+ private:
+  FusedActivation activation_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("_FusedMatMul").Device(DEVICE_CPU).TypeConstraint<float>("T"),
+    FusedMatMulOp<CPUDevice, float>);
+
 #if GOOGLE_CUDA
 TF_CALL_float(REGISTER_GPU);
 TF_CALL_double(REGISTER_GPU);
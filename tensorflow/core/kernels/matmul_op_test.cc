@@ -14,12 +14,63 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
+class MatMulConstantWeightsTest : public OpsTestBase {
+ protected:
+  // Multiplies a and b, with b marked as constant weights or not.
+  Tensor RunMatMul(const Tensor& a, const Tensor& b, bool transpose_a,
+                   bool transpose_b, bool constant_weights) {
+    TF_CHECK_OK(NodeDefBuilder("matmul", "MatMul")
+                    .Input(FakeInput(DT_FLOAT))
+                    .Input(FakeInput(DT_FLOAT))
+                    .Attr("transpose_a", transpose_a)
+                    .Attr("transpose_b", transpose_b)
+                    .Attr("_constant_weights", constant_weights)
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    inputs_.clear();
+    AddInputFromArray<float>(a.shape(), a.flat<float>());
+    AddInputFromArray<float>(b.shape(), b.flat<float>());
+    TF_CHECK_OK(RunOpKernel());
+    return *GetOutput(0);
+  }
+
+  void Compare(int m, int k, int n, bool transpose_a, bool transpose_b) {
+    Tensor a(DT_FLOAT, transpose_a ? TensorShape({k, m}) : TensorShape({m, k}));
+    a.flat<float>().setRandom();
+    Tensor b(DT_FLOAT, transpose_b ? TensorShape({n, k}) : TensorShape({k, n}));
+    b.flat<float>().setRandom();
+    const Tensor expected = RunMatMul(a, b, transpose_a, transpose_b, false);
+    const Tensor packed = RunMatMul(a, b, transpose_a, transpose_b, true);
+    test::ExpectTensorNear<float>(expected, packed, 1e-4);
+    // The second run reuses the packed copy of b.
+    TF_ASSERT_OK(RunOpKernel());
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+  }
+};
+
+TEST_F(MatMulConstantWeightsTest, MatchesUnpacked) {
+  // Sizes that are not multiples of the packet size, with numbers of rows on
+  // both sides of the range of the packed kernel.
+  for (int m : {1, 2, 5, 64, 65}) {
+    for (bool transpose_a : {false, true}) {
+      for (bool transpose_b : {false, true}) {
+        Compare(m, 37, 19, transpose_a, transpose_b);
+      }
+    }
+  }
+}
+
 template <typename T>
 static Graph* Matmul(int m, int k, int n, bool transpose_a, bool transpose_b,
                      DataType type) {
@@ -53,6 +104,38 @@ static Graph* Matmul(int m, int k, int n, bool transpose_a, bool transpose_b,
 // BM_MatmulDev(M, K, N, TA, TB, double, DT_DOUBLE, gpu);                   \
 // BM_MatmulDev(M, K, N, TA, TB, std::complex<double>, DT_COMPLEX128, gpu);
 
+// Matmul with a constant rhs that the kernel is allowed to cache in packed
+// form, as it is after MarkConstantWeights().
+static Graph* MatmulConstantWeights(int m, int k, int n, bool cache) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor in0(DT_FLOAT, TensorShape({m, k}));
+  in0.flat<float>().setRandom();
+  Tensor in1(DT_FLOAT, TensorShape({k, n}));
+  in1.flat<float>().setRandom();
+  Node* matmul =
+      test::graph::Matmul(g, test::graph::Constant(g, in0),
+                          test::graph::Constant(g, in1), false, false);
+  if (cache) matmul->AddAttr("_constant_weights", true);
+  return g;
+}
+
+#define BM_MatmulConstantWeights(M, K, N, CACHE)                          \
+  static void BM_MatmulConstantWeights##_##M##_##K##_##N##_##CACHE(       \
+      int iters) {                                                        \
+    testing::UseRealTime();                                               \
+    testing::ItemsProcessed(static_cast<int64>(iters) * M * K * N * 2);   \
+    test::Benchmark("cpu", MatmulConstantWeights(M, K, N, CACHE))         \
+        .Run(iters);                                                      \
+  }                                                                       \
+  BENCHMARK(BM_MatmulConstantWeights##_##M##_##K##_##N##_##CACHE);
+
+BM_MatmulConstantWeights(4, 1024, 1024, false);
+BM_MatmulConstantWeights(4, 1024, 1024, true);
+BM_MatmulConstantWeights(16, 1024, 1024, false);
+BM_MatmulConstantWeights(16, 1024, 1024, true);
+BM_MatmulConstantWeights(64, 1024, 1024, false);
+BM_MatmulConstantWeights(64, 1024, 1024, true);
+
 // Batch size of 1 included for inference.
 // Typical fully connected layers
 BM_Matmul(1, 512, 512, false, false);
@@ -0,0 +1,238 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/packed_matmul.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+const char* const kConstantWeightsAttr = "_constant_weights";
+
+namespace {
+
+typedef Eigen::internal::packet_traits<float>::type Packet;
+
+// The packed rhs is a sequence of panels of kPanelWidth columns, one packet
+// wide.  Each panel stores its k rows contiguously, with the columns past n
+// set to zero:
+//
+//   panel[l][j] = b[l, panel_start + j]
+const int kPanelWidth = Eigen::internal::packet_traits<float>::size;
+
+// Each unit of work computes kBlockRows rows of kBlockPanels panels, which
+// keeps the accumulators in registers.  The number of panels is padded to a
+// multiple of kBlockPanels.
+const int kBlockRows = 4;
+const int kBlockPanels = 3;
+
+int64 NumPanels(int64 n) {
+  const int64 block_columns = kBlockPanels * kPanelWidth;
+  return (n + block_columns - 1) / block_columns * kBlockPanels;
+}
+
+inline Packet LoadRhs(const float* rhs) {
+  return Eigen::internal::ploadu<Packet>(rhs);
+}
+
+inline Packet Broadcast(float value) {
+  return Eigen::internal::pset1<Packet>(value);
+}
+
+inline Packet MultiplyAdd(Packet a, Packet b, Packet c) {
+  return Eigen::internal::pmadd(a, b, c);
+}
+
+// Stores the first 'columns' values of the kBlockPanels packets to c.
+inline void StoreRow(Packet c0, Packet c1, Packet c2, int64 columns, float* c) {
+  if (columns == kBlockPanels * kPanelWidth) {
+    Eigen::internal::pstoreu(c, c0);
+    Eigen::internal::pstoreu(c + kPanelWidth, c1);
+    Eigen::internal::pstoreu(c + 2 * kPanelWidth, c2);
+  } else {
+    float buffer[kBlockPanels * kPanelWidth];
+    Eigen::internal::pstoreu(buffer, c0);
+    Eigen::internal::pstoreu(buffer + kPanelWidth, c1);
+    Eigen::internal::pstoreu(buffer + 2 * kPanelWidth, c2);
+    memcpy(c, buffer, columns * sizeof(float));
+  }
+}
+
+// Computes one row of the result for kBlockPanels panels.  The lhs row is
+// read from a + l * depth_stride, and the first 'columns' columns of the
+// result are stored to c.
+void ComputeRow(const float* a, int64 depth_stride, const float* rhs, int64 k,
+                int64 columns, float* c) {
+  const int64 panel_size = k * kPanelWidth;
+  Packet c0 = Broadcast(0.0f);
+  Packet c1 = Broadcast(0.0f);
+  Packet c2 = Broadcast(0.0f);
+  for (int64 l = 0; l < k; ++l) {
+    const float* b = rhs + l * kPanelWidth;
+    const Packet a0 = Broadcast(a[l * depth_stride]);
+    c0 = MultiplyAdd(a0, LoadRhs(b), c0);
+    c1 = MultiplyAdd(a0, LoadRhs(b + panel_size), c1);
+    c2 = MultiplyAdd(a0, LoadRhs(b + 2 * panel_size), c2);
+  }
+  StoreRow(c0, c1, c2, columns, c);
+}
+
+// Like ComputeRow(), for kBlockRows rows, with row r of the lhs read from
+// a + r * row_stride and stored to c + r * ldc.
+void ComputeBlock(const float* a, int64 row_stride, int64 depth_stride,
+                  const float* rhs, int64 k, int64 columns, float* c,
+                  int64 ldc) {
+  static_assert(kBlockRows == 4 && kBlockPanels == 3,
+                "ComputeBlock() is unrolled for 4 rows and 3 panels");
+  const int64 panel_size = k * kPanelWidth;
+  Packet c00 = Broadcast(0.0f), c01 = c00, c02 = c00;
+  Packet c10 = c00, c11 = c00, c12 = c00;
+  Packet c20 = c00, c21 = c00, c22 = c00;
+  Packet c30 = c00, c31 = c00, c32 = c00;
+  const float* a0 = a;
+  const float* a1 = a + row_stride;
+  const float* a2 = a + 2 * row_stride;
+  const float* a3 = a + 3 * row_stride;
+  for (int64 l = 0; l < k; ++l) {
+    const float* b = rhs + l * kPanelWidth;
+    const Packet b0 = LoadRhs(b);
+    const Packet b1 = LoadRhs(b + panel_size);
+    const Packet b2 = LoadRhs(b + 2 * panel_size);
+    const int64 offset = l * depth_stride;
+    Packet lhs = Broadcast(a0[offset]);
+    c00 = MultiplyAdd(lhs, b0, c00);
+    c01 = MultiplyAdd(lhs, b1, c01);
+    c02 = MultiplyAdd(lhs, b2, c02);
+    lhs = Broadcast(a1[offset]);
+    c10 = MultiplyAdd(lhs, b0, c10);
+    c11 = MultiplyAdd(lhs, b1, c11);
+    c12 = MultiplyAdd(lhs, b2, c12);
+    lhs = Broadcast(a2[offset]);
+    c20 = MultiplyAdd(lhs, b0, c20);
+    c21 = MultiplyAdd(lhs, b1, c21);
+    c22 = MultiplyAdd(lhs, b2, c22);
+    lhs = Broadcast(a3[offset]);
+    c30 = MultiplyAdd(lhs, b0, c30);
+    c31 = MultiplyAdd(lhs, b1, c31);
+    c32 = MultiplyAdd(lhs, b2, c32);
+  }
+  StoreRow(c00, c01, c02, columns, c);
+  StoreRow(c10, c11, c12, columns, c + ldc);
+  StoreRow(c20, c21, c22, columns, c + 2 * ldc);
+  StoreRow(c30, c31, c32, columns, c + 3 * ldc);
+}
+
+}  // namespace
+
+PackedMatMulRhs::PackedMatMulRhs(const Eigen::ThreadPoolDevice& d,
+                                 bool transpose, const float* data, int64 k,
+                                 int64 n, int64 ld)
+    : k_(k), n_(n), data_(NumPanels(n) * k * kPanelWidth, 0.0f) {
+  auto pack_panels = [this, transpose, data, k, n, ld](int64 first_panel,
+                                                       int64 last_panel) {
+    for (int64 panel = first_panel; panel < last_panel; ++panel) {
+      float* packed = data_.data() + panel * k * kPanelWidth;
+      const int64 first_column = panel * kPanelWidth;
+      const int64 columns = std::min<int64>(kPanelWidth, n - first_column);
+      if (columns <= 0) continue;
+      if (transpose) {
+        for (int64 j = 0; j < columns; ++j) {
+          const float* column = data + (first_column + j) * ld;
+          for (int64 l = 0; l < k; ++l) {
+            packed[l * kPanelWidth + j] = column[l];
+          }
+        }
+      } else {
+        for (int64 l = 0; l < k; ++l) {
+          memcpy(packed + l * kPanelWidth, data + l * ld + first_column,
+                 columns * sizeof(float));
+        }
+      }
+    }
+  };
+  d.parallelFor(NumPanels(n),
+                Eigen::TensorOpCost(k * kPanelWidth * sizeof(float),
+                                    k * kPanelWidth * sizeof(float), 0),
+                pack_panels);
+}
+
+void PackedMatMul(const Eigen::ThreadPoolDevice& d, bool transpose_a,
+                  const float* a, int64 m, int64 lda, const PackedMatMulRhs& b,
+                  float* c, int64 ldc) {
+  const int64 k = b.k();
+  const int64 n = b.n();
+  const int64 row_stride = transpose_a ? 1 : lda;
+  const int64 depth_stride = transpose_a ? lda : 1;
+  const int64 num_panels = NumPanels(n);
+  const int64 row_blocks = (m + kBlockRows - 1) / kBlockRows;
+  const int64 column_blocks = (num_panels + kBlockPanels - 1) / kBlockPanels;
+  const int64 panel_size = k * kPanelWidth;
+
+  auto compute = [&](int64 first_unit, int64 last_unit) {
+    for (int64 unit = first_unit; unit < last_unit; ++unit) {
+      // Consecutive units share their panels, which stay in cache.
+      const int64 row = (unit % row_blocks) * kBlockRows;
+      const int64 panel = (unit / row_blocks) * kBlockPanels;
+      const int64 column = panel * kPanelWidth;
+      const int64 columns =
+          std::min<int64>(kBlockPanels * kPanelWidth, n - column);
+      const float* block_a = a + row * row_stride;
+      const float* block_rhs = b.data_.data() + panel * panel_size;
+      float* block_c = c + row * ldc + column;
+      if (m - row >= kBlockRows) {
+        ComputeBlock(block_a, row_stride, depth_stride, block_rhs, k, columns,
+                     block_c, ldc);
+      } else {
+        for (int64 r = 0; r < m - row; ++r) {
+          ComputeRow(block_a + r * row_stride, depth_stride, block_rhs, k,
+                     columns, block_c + r * ldc);
+        }
+      }
+    }
+  };
+  const int64 block_columns = kBlockPanels * kPanelWidth;
+  d.parallelFor(
+      row_blocks * column_blocks,
+      Eigen::TensorOpCost(
+          (kBlockRows + block_columns) * k * sizeof(float),
+          kBlockRows * block_columns * sizeof(float),
+          kBlockRows * kBlockPanels * k *
+              Eigen::TensorOpCost::MulCost<float>()),
+      compute);
+}
+
+std::shared_ptr<const PackedMatMulRhs> PackedMatMulRhsCache::Get(
+    const Eigen::ThreadPoolDevice& d, const Tensor& weights, bool transpose,
+    int64 k, int64 n) {
+  mutex_lock l(mu_);
+  if (packed_ == nullptr || !weights.SharesBufferWith(weights_) ||
+      weights.shape() != weights_.shape()) {
+    const int64 ld = transpose ? k : n;
+    packed_ = std::make_shared<const PackedMatMulRhs>(
+        d, transpose, weights.flat<float>().data(), k, n, ld);
+    // Holding a reference keeps the buffer from being reused by a different
+    // tensor that would then compare equal.
+    weights_ = weights;
+  }
+  return packed_;
+}
+
+}  // namespace tensorflow
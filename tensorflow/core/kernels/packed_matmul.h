@@ -0,0 +1,102 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_PACKED_MATMUL_H_
+#define TENSORFLOW_KERNELS_PACKED_MATMUL_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace Eigen {
+struct ThreadPoolDevice;
+}  // namespace Eigen
+
+namespace tensorflow {
+
+// Float matrix multiplication for an rhs that is packed once and reused, as
+// the weights of MatMul and Conv2D are when they come from a constant.
+// Eigen's contraction repacks its rhs on every call, which dominates the
+// cost when the lhs has few rows.
+
+// Boolean attr set by MarkConstantWeights() (common_runtime/
+// constant_weights.h) on MatMul and Conv2D nodes whose weights are produced
+// by a constant, so that their kernels may cache the packed weights.
+extern const char* const kConstantWeightsAttr;
+
+// Returns true if PackedMatMul() with a cached rhs is expected to be faster
+// than Eigen's contraction for an lhs with m rows.  A single row is handled
+// by Eigen as a matrix-vector product that does not pack the rhs, and Eigen's
+// blocking wins once the lhs is tall enough to amortize the packing.
+inline bool UsePackedMatMul(int64 m) { return m > 1 && m <= 64; }
+
+// A k x n float matrix reordered into panels of columns that
+// PackedMatMul() reads sequentially.
+class PackedMatMulRhs {
+ public:
+  // If transpose is false 'data' has row major layout, otherwise column
+  // major.  'ld' is the stride of 'data'.
+  PackedMatMulRhs(const Eigen::ThreadPoolDevice& d, bool transpose,
+                  const float* data, int64 k, int64 n, int64 ld);
+
+  int64 k() const { return k_; }
+  int64 n() const { return n_; }
+
+ private:
+  friend void PackedMatMul(const Eigen::ThreadPoolDevice& d, bool transpose_a,
+                           const float* a, int64 m, int64 lda,
+                           const PackedMatMulRhs& b, float* c, int64 ldc);
+
+  const int64 k_;
+  const int64 n_;
+  std::vector<float> data_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PackedMatMulRhs);
+};
+
+// Computes the m x n row major product c = a * b, where a is m x k with row
+// major layout, or column major if transpose_a is true.
+void PackedMatMul(const Eigen::ThreadPoolDevice& d, bool transpose_a,
+                  const float* a, int64 m, int64 lda, const PackedMatMulRhs& b,
+                  float* c, int64 ldc);
+
+// Holds the packed copy of a kernel's constant weights.
+class PackedMatMulRhsCache {
+ public:
+  PackedMatMulRhsCache() {}
+
+  // Returns 'weights', viewed as a k x n matrix as in PackedMatMulRhs, in
+  // packed form.  The packed copy is made on the first call and reused for
+  // as long as 'weights' refers to the same buffer and shape.
+  std::shared_ptr<const PackedMatMulRhs> Get(const Eigen::ThreadPoolDevice& d,
+                                             const Tensor& weights,
+                                             bool transpose, int64 k, int64 n);
+
+ private:
+  mutex mu_;
+  Tensor weights_ GUARDED_BY(mu_);
+  std::shared_ptr<const PackedMatMulRhs> packed_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PackedMatMulRhsCache);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_PACKED_MATMUL_H_
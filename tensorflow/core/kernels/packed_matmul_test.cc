@@ -0,0 +1,119 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/packed_matmul.h"
+
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/common_runtime/eigen_thread_pool.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class PackedMatMulTest : public ::testing::Test {
+ protected:
+  PackedMatMulTest()
+      : threadpool_(Env::Default(), "test", 4 /* num_threads */),
+        wrapper_(&threadpool_),
+        device_(&wrapper_, 4 /* num_threads */),
+        philox_(123, 17),
+        rnd_(&philox_) {}
+
+  std::vector<float> Random(int64 size) {
+    std::vector<float> values(size);
+    for (float& value : values) value = rnd_.RandFloat() - 0.5f;
+    return values;
+  }
+
+  // Checks PackedMatMul() against a naive product for every combination of
+  // transposed operands.
+  void TestMatMul(int64 m, int64 k, int64 n) {
+    for (bool transpose_a : {false, true}) {
+      for (bool transpose_b : {false, true}) {
+        const std::vector<float> a = Random(m * k);
+        const std::vector<float> b = Random(k * n);
+        const int64 lda = transpose_a ? m : k;
+        const int64 ldb = transpose_b ? k : n;
+        PackedMatMulRhs packed_b(device_, transpose_b, b.data(), k, n, ldb);
+        std::vector<float> c(m * n, -1.0f);
+        PackedMatMul(device_, transpose_a, a.data(), m, lda, packed_b,
+                     c.data(), n);
+        for (int64 i = 0; i < m; ++i) {
+          for (int64 j = 0; j < n; ++j) {
+            float expected = 0.0f;
+            for (int64 l = 0; l < k; ++l) {
+              expected += (transpose_a ? a[l * lda + i] : a[i * lda + l]) *
+                          (transpose_b ? b[j * ldb + l] : b[l * ldb + j]);
+            }
+            EXPECT_NEAR(expected, c[i * n + j], 1e-4)
+                << "m=" << m << " k=" << k << " n=" << n
+                << " transpose_a=" << transpose_a
+                << " transpose_b=" << transpose_b << " i=" << i << " j=" << j;
+          }
+        }
+      }
+    }
+  }
+
+  thread::ThreadPool threadpool_;
+  EigenThreadPoolWrapper wrapper_;
+  Eigen::ThreadPoolDevice device_;
+  random::PhiloxRandom philox_;
+  random::SimplePhilox rnd_;
+};
+
+TEST_F(PackedMatMulTest, Shapes) {
+  TestMatMul(1, 1, 1);
+  TestMatMul(2, 3, 5);
+  TestMatMul(4, 16, 24);
+  TestMatMul(7, 33, 17);
+  TestMatMul(16, 64, 100);
+  TestMatMul(64, 128, 257);
+}
+
+TEST_F(PackedMatMulTest, Cache) {
+  PackedMatMulRhsCache cache;
+  Tensor weights(DT_FLOAT, TensorShape({8, 4}));
+  weights.flat<float>().setRandom();
+  std::shared_ptr<const PackedMatMulRhs> packed =
+      cache.Get(device_, weights, false, 8, 4);
+  EXPECT_EQ(8, packed->k());
+  EXPECT_EQ(4, packed->n());
+
+  // The same buffer reuses the packed copy.
+  Tensor alias = weights;
+  EXPECT_EQ(packed, cache.Get(device_, alias, false, 8, 4));
+
+  // A different buffer or shape is packed again.
+  Tensor copy(DT_FLOAT, TensorShape({8, 4}));
+  copy.flat<float>() = weights.flat<float>();
+  EXPECT_NE(packed, cache.Get(device_, copy, false, 8, 4));
+  Tensor reshaped(DT_FLOAT, TensorShape({4, 8}));
+  CHECK(reshaped.CopyFrom(copy, TensorShape({4, 8})));
+  std::shared_ptr<const PackedMatMulRhs> repacked =
+      cache.Get(device_, reshaped, false, 4, 8);
+  EXPECT_EQ(4, repacked->k());
+  EXPECT_EQ(8, repacked->n());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,310 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/quantized_gemm_x86.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#define TENSORFLOW_QUANTIZED_GEMM_AVX512_VNNI
+#define TENSORFLOW_QUANTIZED_GEMM_SUPPORTED
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define TENSORFLOW_QUANTIZED_GEMM_AVX2
+#define TENSORFLOW_QUANTIZED_GEMM_SUPPORTED
+#include <immintrin.h>
+#endif
+
+namespace tensorflow {
+namespace x86 {
+namespace {
+
+// The packed rhs is a sequence of panels of kPanelWidth columns.  Within a
+// panel, the depth is split into groups of kDepthGroup consecutive values,
+// and each group holds kDepthGroup values for every column of the panel, so
+// that one 32 bit lane of a vector register accumulates one column:
+//
+//   panel[g][j][d] = b[g * kDepthGroup + d, panel_start + j]
+//
+// The lhs is packed the same way, with the kDepthGroup values of a group
+// forming one int32 that is broadcast to all lanes.
+#ifdef TENSORFLOW_QUANTIZED_GEMM_AVX512_VNNI
+// vpdpbusd multiplies unsigned by signed bytes, so the rhs is stored with
+// 128 subtracted, which is added back through the row sums of the lhs.
+const int kPanelWidth = 16;
+const int kDepthGroup = 4;
+const uint8 kRhsXor = 0x80;
+const int32 kRhsOffset = 128;
+#else
+// vpmaddwd multiplies pairs of int16, which the bytes of the rhs are widened
+// to, so each lhs value takes 16 bits of the int32.
+const int kPanelWidth = 8;
+const int kDepthGroup = 2;
+const uint8 kRhsXor = 0;
+const int32 kRhsOffset = 0;
+#endif
+const int kLhsShift = 32 / kDepthGroup;
+const int kPanelBytes = kPanelWidth * kDepthGroup;
+
+// Each unit of work computes kBlockRows rows of kBlockPanels panels.
+const int kBlockRows = 4;
+const int kBlockPanels = 2;
+
+int NumDepthGroups(int k) { return (k + kDepthGroup - 1) / kDepthGroup; }
+
+int NumPanels(int n) { return (n + kPanelWidth - 1) / kPanelWidth; }
+
+#ifdef TENSORFLOW_QUANTIZED_GEMM_SUPPORTED
+
+#ifdef TENSORFLOW_QUANTIZED_GEMM_AVX512_VNNI
+typedef __m512i Vector;
+inline Vector Zero() { return _mm512_setzero_si512(); }
+inline Vector Broadcast(int32 value) { return _mm512_set1_epi32(value); }
+inline Vector LoadRhs(const uint8* data) {
+  return _mm512_loadu_si512(reinterpret_cast<const void*>(data));
+}
+inline Vector LoadInt32(const int32* data) {
+  return _mm512_loadu_si512(reinterpret_cast<const void*>(data));
+}
+inline Vector MultiplyAdd(Vector acc, Vector lhs, Vector rhs) {
+  return _mm512_dpbusd_epi32(acc, lhs, rhs);
+}
+inline Vector Add(Vector a, Vector b) { return _mm512_add_epi32(a, b); }
+inline void Store(int32* data, Vector value) {
+  _mm512_storeu_si512(reinterpret_cast<void*>(data), value);
+}
+#else
+typedef __m256i Vector;
+inline Vector Zero() { return _mm256_setzero_si256(); }
+inline Vector Broadcast(int32 value) { return _mm256_set1_epi32(value); }
+inline Vector LoadRhs(const uint8* data) {
+  return _mm256_cvtepu8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+inline Vector LoadInt32(const int32* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+inline Vector MultiplyAdd(Vector acc, Vector lhs, Vector rhs) {
+  return _mm256_add_epi32(acc, _mm256_madd_epi16(lhs, rhs));
+}
+inline Vector Add(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+inline void Store(int32* data, Vector value) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), value);
+}
+#endif
+
+// Computes kBlockRows rows of the result for NumPanels consecutive panels,
+// from the packed lhs block (depth_groups x kBlockRows int32) and the first
+// of the packed panels, and stores the rows and columns that are in range.
+// row_terms and column_terms hold the offset corrections of each row and
+// column.
+template <int NumPanels>
+void ComputeBlock(const int32* lhs, const uint8* rhs, int depth_groups,
+                  const int32* row_terms, const int32* column_terms, int rows,
+                  int columns, int32* c_data, int ldc) {
+  Vector acc[kBlockRows][NumPanels];
+  for (int r = 0; r < kBlockRows; ++r) {
+    for (int p = 0; p < NumPanels; ++p) {
+      acc[r][p] = Zero();
+    }
+  }
+  const int64 panel_stride = static_cast<int64>(depth_groups) * kPanelBytes;
+  for (int g = 0; g < depth_groups; ++g) {
+    Vector rhs_values[NumPanels];
+    for (int p = 0; p < NumPanels; ++p) {
+      rhs_values[p] = LoadRhs(rhs + p * panel_stride + g * kPanelBytes);
+    }
+    for (int r = 0; r < kBlockRows; ++r) {
+      const Vector lhs_value = Broadcast(lhs[g * kBlockRows + r]);
+      for (int p = 0; p < NumPanels; ++p) {
+        acc[r][p] = MultiplyAdd(acc[r][p], lhs_value, rhs_values[p]);
+      }
+    }
+  }
+
+  for (int r = 0; r < rows; ++r) {
+    const Vector row_term = Broadcast(row_terms[r]);
+    for (int p = 0; p < NumPanels; ++p) {
+      const int column = p * kPanelWidth;
+      if (column >= columns) break;
+      const Vector result =
+          Add(Add(acc[r][p], row_term), LoadInt32(column_terms + column));
+      int32* out = c_data + static_cast<int64>(r) * ldc + column;
+      if (column + kPanelWidth <= columns) {
+        Store(out, result);
+      } else {
+        int32 buffer[kPanelWidth];
+        Store(buffer, result);
+        memcpy(out, buffer, (columns - column) * sizeof(int32));
+      }
+    }
+  }
+}
+
+#endif  // TENSORFLOW_QUANTIZED_GEMM_SUPPORTED
+
+}  // namespace
+
+bool IsQuantizedGemmSupported() {
+#ifdef TENSORFLOW_QUANTIZED_GEMM_SUPPORTED
+  return true;
+#else
+  return false;
+#endif
+}
+
+PackedQuantizedRhs::PackedQuantizedRhs(OpKernelContext* context,
+                                       bool transpose_b, const quint8* b_data,
+                                       int k, int n, int ldb)
+    : k_(k), n_(n), column_sums_(NumPanels(n) * kPanelWidth, 0) {
+  const int depth_groups = NumDepthGroups(k);
+  const int num_panels = NumPanels(n);
+  data_.resize(static_cast<int64>(num_panels) * depth_groups * kPanelBytes,
+               kRhsXor);
+  const uint8* b = &(b_data->value);
+  auto pack_panels = [this, transpose_b, b, k, n, ldb, depth_groups](
+      int64 first_panel, int64 last_panel) {
+    for (int64 panel = first_panel; panel < last_panel; ++panel) {
+      uint8* packed = data_.data() + panel * depth_groups * kPanelBytes;
+      const int first_column = panel * kPanelWidth;
+      const int columns = std::min(kPanelWidth, n - first_column);
+      if (transpose_b) {
+        // Columns of b are contiguous.
+        for (int j = 0; j < columns; ++j) {
+          const uint8* column = b + static_cast<int64>(first_column + j) * ldb;
+          int32 sum = 0;
+          for (int l = 0; l < k; ++l) {
+            packed[(l / kDepthGroup) * kPanelBytes + j * kDepthGroup +
+                   l % kDepthGroup] = column[l] ^ kRhsXor;
+            sum += column[l];
+          }
+          column_sums_[first_column + j] = sum;
+        }
+      } else {
+        // Rows of b are contiguous.
+        int32 sums[kPanelWidth] = {0};
+        for (int l = 0; l < k; ++l) {
+          const uint8* row = b + static_cast<int64>(l) * ldb + first_column;
+          uint8* group =
+              packed + (l / kDepthGroup) * kPanelBytes + l % kDepthGroup;
+          for (int j = 0; j < columns; ++j) {
+            group[j * kDepthGroup] = row[j] ^ kRhsXor;
+            sums[j] += row[j];
+          }
+        }
+        std::copy(sums, sums + columns, &column_sums_[first_column]);
+      }
+    }
+  };
+  auto& worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+  Shard(worker_threads.num_threads, worker_threads.workers, num_panels,
+        static_cast<int64>(kPanelWidth) * k, pack_panels);
+}
+
+void QuantizedGemm(OpKernelContext* context, bool transpose_a,
+                   const quint8* a_data, const PackedQuantizedRhs& b,
+                   qint32* c_data, int m, int offset_a, int offset_b, int lda,
+                   int ldc) {
+#ifdef TENSORFLOW_QUANTIZED_GEMM_SUPPORTED
+  const int k = b.k();
+  const int n = b.n();
+  if (m == 0 || n == 0) return;
+  const int depth_groups = NumDepthGroups(k);
+  const int num_panels = NumPanels(n);
+  const int row_blocks = (m + kBlockRows - 1) / kBlockRows;
+  const int column_blocks = (num_panels + kBlockPanels - 1) / kBlockPanels;
+  const uint8* a = &(a_data->value);
+  int32* c = &(c_data->value);
+  auto& worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+
+  // Pack the lhs into blocks of kBlockRows rows, each stored as depth_groups
+  // x kBlockRows int32, and fold its row sums into the offset correction
+  //   offset_b * sum(a[i, :]) + kRhsOffset * sum(a[i, :]).
+  std::vector<int32> lhs(static_cast<int64>(row_blocks) * depth_groups *
+                         kBlockRows);
+  std::vector<int32> row_terms(static_cast<int64>(row_blocks) * kBlockRows);
+  auto pack_lhs = [&](int64 first_block, int64 last_block) {
+    for (int64 block = first_block; block < last_block; ++block) {
+      int32* packed = lhs.data() + block * depth_groups * kBlockRows;
+      for (int r = 0; r < kBlockRows; ++r) {
+        const int64 i = block * kBlockRows + r;
+        int32 row_sum = 0;
+        for (int g = 0; g < depth_groups; ++g) {
+          uint32 group = 0;
+          for (int d = 0; d < kDepthGroup; ++d) {
+            const int l = g * kDepthGroup + d;
+            if (i >= m || l >= k) continue;
+            const uint32 value = transpose_a
+                                     ? a[l * static_cast<int64>(lda) + i]
+                                     : a[i * lda + l];
+            group |= value << (d * kLhsShift);
+            row_sum += value;
+          }
+          packed[g * kBlockRows + r] = static_cast<int32>(group);
+        }
+        row_terms[block * kBlockRows + r] = (offset_b + kRhsOffset) * row_sum;
+      }
+    }
+  };
+  Shard(worker_threads.num_threads, worker_threads.workers, row_blocks,
+        static_cast<int64>(kBlockRows) * k, pack_lhs);
+
+  // The offset correction of each column, offset_a * sum(b[:, j]) +
+  // k * offset_a * offset_b, padded to whole panels.
+  std::vector<int32> column_terms(num_panels * kPanelWidth);
+  for (size_t j = 0; j < column_terms.size(); ++j) {
+    column_terms[j] = offset_a * b.column_sums_[j] + k * offset_a * offset_b;
+  }
+
+  const int64 lhs_block_size = static_cast<int64>(depth_groups) * kBlockRows;
+  const int64 panel_size = static_cast<int64>(depth_groups) * kPanelBytes;
+  auto compute = [&](int64 first_unit, int64 last_unit) {
+    for (int64 unit = first_unit; unit < last_unit; ++unit) {
+      const int row_block = unit / column_blocks;
+      const int column_block = unit % column_blocks;
+      const int row = row_block * kBlockRows;
+      const int panel = column_block * kBlockPanels;
+      const int column = panel * kPanelWidth;
+      const int32* block_lhs = lhs.data() + row_block * lhs_block_size;
+      const uint8* block_rhs = b.data_.data() + panel * panel_size;
+      const int rows = std::min(kBlockRows, m - row);
+      const int columns = std::min(kBlockPanels * kPanelWidth, n - column);
+      int32* block_c = c + static_cast<int64>(row) * ldc + column;
+      if (num_panels - panel >= kBlockPanels) {
+        ComputeBlock<kBlockPanels>(block_lhs, block_rhs, depth_groups,
+                                   &row_terms[row], &column_terms[column],
+                                   rows, columns, block_c, ldc);
+      } else {
+        ComputeBlock<1>(block_lhs, block_rhs, depth_groups, &row_terms[row],
+                        &column_terms[column], rows, columns, block_c, ldc);
+      }
+    }
+  };
+  const int64 cost_per_unit =
+      static_cast<int64>(kBlockRows) * kBlockPanels * kPanelWidth * k;
+  Shard(worker_threads.num_threads, worker_threads.workers,
+        static_cast<int64>(row_blocks) * column_blocks, cost_per_unit, compute);
+#else
+  LOG(FATAL) << "x86 quantized gemm is not supported by this binary.";
+#endif
+}
+
+}  // namespace x86
+}  // namespace tensorflow
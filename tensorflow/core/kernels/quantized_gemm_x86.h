@@ -0,0 +1,88 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_QUANTIZED_GEMM_X86_H_
+#define TENSORFLOW_KERNELS_QUANTIZED_GEMM_X86_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class OpKernelContext;
+
+namespace x86 {
+
+// Eight bit matrix multiplication kernels for x86, built on the integer
+// multiply-add instructions of AVX2 (vpmaddwd) or, when the binary is compiled
+// for it, AVX-512 VNNI (vpdpbusd).  Unlike gemmlowp, the rhs operand is packed
+// by the caller, so that a constant rhs can be packed only once.
+
+// Returns true if this binary was compiled with AVX2 or AVX-512 VNNI support.
+// If it returns false, the functions below must not be called.
+bool IsQuantizedGemmSupported();
+
+// The k x n rhs operand of QuantizedGemm(), reordered into panels of columns
+// that the kernels can read sequentially, along with its column sums.
+class PackedQuantizedRhs {
+ public:
+  // If transpose_b is false b_data has row major layout, otherwise column
+  // major.  ldb is the stride of b_data.  The packing is sharded across the
+  // CPU worker threads of the context.
+  PackedQuantizedRhs(OpKernelContext* context, bool transpose_b,
+                     const quint8* b_data, int k, int n, int ldb);
+
+  int k() const { return k_; }
+  int n() const { return n_; }
+
+  // Number of bytes used by the packed copy.
+  int64 MemoryUsed() const { return data_.size() + 4 * column_sums_.size(); }
+
+ private:
+  friend void QuantizedGemm(OpKernelContext* context, bool transpose_a,
+                            const quint8* a_data, const PackedQuantizedRhs& b,
+                            qint32* c_data, int m, int offset_a, int offset_b,
+                            int lda, int ldc);
+
+  const int k_;
+  const int n_;
+  std::vector<uint8> data_;
+  std::vector<int32> column_sums_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PackedQuantizedRhs);
+};
+
+// Calculate the quantized matrix multiplication:
+//
+// for (i, j) in [0, m) x [0, n) do
+//   c_data[i, j] :=
+//     sum((a_data[i, l] + offset_a) * (b[l, j] + offset_b)) : l in [0, k)
+//
+// where k and n are the dimensions of b.  If transpose_a is false the lhs
+// operand has row major layout, otherwise column major.  lda and ldc are the
+// strides of the lhs operand and the row major result.  The work is sharded
+// across the CPU worker threads of the context.
+void QuantizedGemm(OpKernelContext* context, bool transpose_a,
+                   const quint8* a_data, const PackedQuantizedRhs& b,
+                   qint32* c_data, int m, int offset_a, int offset_b, int lda,
+                   int ldc);
+
+}  // namespace x86
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_QUANTIZED_GEMM_X86_H_
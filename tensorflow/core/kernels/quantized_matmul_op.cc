@@ -17,14 +17,18 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <memory>
+
 #define GEMMLOWP_ALLOW_SLOW_SCALAR_FALLBACK
 #include "public/gemmlowp.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/meta_support.h"
 #include "tensorflow/core/kernels/quantization_utils.h"
+#include "tensorflow/core/kernels/quantized_gemm_x86.h"
 #include "tensorflow/core/kernels/reference_gemm.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 
@@ -70,6 +74,7 @@ class QuantizedMatMulOp : public OpKernel {
       : OpKernel(context) {
     OP_REQUIRES_OK(context, context->GetAttr("transpose_a", &transpose_a_));
     OP_REQUIRES_OK(context, context->GetAttr("transpose_b", &transpose_b_));
+    OP_REQUIRES_OK(context, context->GetAttr("b_is_constant", &b_is_constant_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -140,6 +145,16 @@ class QuantizedMatMulOp : public OpKernel {
       // allows optimized quantized 8bit to 32bit gemm.
       meta::QuantizedGemm(context, transpose_a_, transpose_b_, a_data, b_data,
                           c_data, m, n, k, -offset_a, -offset_b, lda, ldb, ldc);
+    } else if (x86::IsQuantizedGemmSupported() &&
+               std::is_same<T1, quint8>() && std::is_same<T2, quint8>() &&
+               std::is_same<Toutput, qint32>() && (offset_c == 0) &&
+               (mult_c == 1) && (shift_c == 0) && (transpose_c == false)) {
+      // The x86 code path works with AVX2 or AVX-512 VNNI, and can reuse the
+      // packed copy of a constant b across runs.
+      std::shared_ptr<const x86::PackedQuantizedRhs> packed_b =
+          PackB(context, b, b_data, k, n, ldb);
+      x86::QuantizedGemm(context, transpose_a_, a_data, *packed_b, c_data, m,
+                         -offset_a, -offset_b, lda, ldc);
     } else if (std::is_same<T1, quint8>() && std::is_same<T2, quint8>() &&
                std::is_same<Toutput, qint32>() && (offset_c == 0) &&
                (mult_c == 1) && (shift_c == 0) && (transpose_c == false)) {
@@ -187,8 +202,35 @@ class QuantizedMatMulOp : public OpKernel {
   }
 
  private:
+  // Returns b packed for x86::QuantizedGemm().  If b_is_constant is set, the
+  // first packed copy is kept and returned again for as long as b refers to
+  // the same buffer.
+  std::shared_ptr<const x86::PackedQuantizedRhs> PackB(
+      OpKernelContext* context, const Tensor& b, const quint8* b_data, int k,
+      int n, int ldb) {
+    if (!b_is_constant_) {
+      return std::make_shared<const x86::PackedQuantizedRhs>(
+          context, transpose_b_, b_data, k, n, ldb);
+    }
+    mutex_lock l(mu_);
+    if (packed_b_ == nullptr || !b.SharesBufferWith(packed_b_tensor_) ||
+        b.shape() != packed_b_tensor_.shape()) {
+      packed_b_ = std::make_shared<const x86::PackedQuantizedRhs>(
+          context, transpose_b_, b_data, k, n, ldb);
+      // Holding a reference keeps the buffer from being reused for a
+      // different tensor that would then compare equal.
+      packed_b_tensor_ = b;
+    }
+    return packed_b_;
+  }
+
   bool transpose_a_;
   bool transpose_b_;
+  bool b_is_constant_;
+
+  mutex mu_;
+  Tensor packed_b_tensor_ GUARDED_BY(mu_);
+  std::shared_ptr<const x86::PackedQuantizedRhs> packed_b_ GUARDED_BY(mu_);
 };
 
 REGISTER_KERNEL_BUILDER(Name("QuantizedMatMul")
@@ -19,6 +19,7 @@ limitations under the License.
 #include <memory>
 #include <vector>
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
@@ -27,16 +28,76 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/kernels/quantization_utils.h"
+#include "tensorflow/core/kernels/reference_gemm.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
 class QuantizedMatMulTest : public OpsTestBase {
  protected:
+  // Multiplies random [m, k] and [k, n] matrices, stored transposed as given,
+  // num_runs times with new values of a, and compares every result against
+  // ReferenceGemm.
+  void RunRandomMatMul(int m, int n, int k, bool transpose_a,
+                       bool transpose_b, bool b_is_constant, int num_runs) {
+    TF_ASSERT_OK(NodeDefBuilder("quantized_mat_mul_op", "QuantizedMatMul")
+                     .Input(FakeInput(DT_QUINT8))
+                     .Input(FakeInput(DT_QUINT8))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("Toutput", DataTypeToEnum<qint32>::v())
+                     .Attr("transpose_a", transpose_a)
+                     .Attr("transpose_b", transpose_b)
+                     .Attr("b_is_constant", b_is_constant)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    random::PhiloxRandom philox(testing::RandomSeed(), 17);
+    random::SimplePhilox rnd(&philox);
+    auto random_values = [&rnd](int i) {
+      return static_cast<quint8>(rnd.Uniform(256));
+    };
+    const float a_min = -3.0f;
+    const float a_max = 5.0f;
+    const float b_min = -1.0f;
+    const float b_max = 0.25f;
+    AddInput<quint8>(transpose_a ? TensorShape({k, m}) : TensorShape({m, k}),
+                     random_values);
+    AddInput<quint8>(transpose_b ? TensorShape({n, k}) : TensorShape({k, n}),
+                     random_values);
+    AddInputFromArray<float>(TensorShape({1}), {a_min});
+    AddInputFromArray<float>(TensorShape({1}), {a_max});
+    AddInputFromArray<float>(TensorShape({1}), {b_min});
+    AddInputFromArray<float>(TensorShape({1}), {b_max});
+    const int32 offset_a =
+        FloatToQuantizedUnclamped<quint8>(0.0f, a_min, a_max);
+    const int32 offset_b =
+        FloatToQuantizedUnclamped<quint8>(0.0f, b_min, b_max);
+
+    for (int run = 0; run < num_runs; ++run) {
+      Tensor* a = inputs_[0].tensor;
+      const Tensor& b = *inputs_[1].tensor;
+      if (run > 0) test::FillFn<quint8>(a, random_values);
+      TF_ASSERT_OK(RunOpKernel());
+
+      Tensor expected(DT_QINT32, TensorShape({m, n}));
+      ReferenceGemm<quint8, quint8, qint32>(
+          transpose_a, transpose_b, false, m, n, k, a->flat<quint8>().data(),
+          offset_a, a->dim_size(1), b.flat<quint8>().data(), offset_b,
+          b.dim_size(1), expected.flat<qint32>().data(), 0, 0, 1, n);
+      test::ExpectTensorEqual<qint32>(expected, *GetOutput(0));
+    }
+  }
 };
 
 // Runs two small matrices through the operator, and leaves all the parameters
@@ -334,4 +395,72 @@ TEST_F(QuantizedMatMulTest, Medium_WithParams) {
   test::ExpectTensorNear<float>(expected_float, output_float, 15.0);
 }
 
+// Covers partial row blocks, partial column panels and an odd depth for
+// every combination of transposes.
+TEST_F(QuantizedMatMulTest, Random_NoTranspose) {
+  RunRandomMatMul(37, 45, 71, false, false, false, 1);
+}
+
+TEST_F(QuantizedMatMulTest, Random_TransposeA) {
+  RunRandomMatMul(37, 45, 71, true, false, false, 1);
+}
+
+TEST_F(QuantizedMatMulTest, Random_TransposeB) {
+  RunRandomMatMul(37, 45, 71, false, true, false, 1);
+}
+
+TEST_F(QuantizedMatMulTest, Random_TransposeAB) {
+  RunRandomMatMul(37, 45, 71, true, true, false, 1);
+}
+
+TEST_F(QuantizedMatMulTest, Random_ConstantB) {
+  RunRandomMatMul(64, 200, 300, false, false, true, 3);
+}
+
+TEST_F(QuantizedMatMulTest, Random_ConstantTransposedB) {
+  RunRandomMatMul(1, 200, 300, false, true, true, 3);
+}
+
+static Graph* QuantizedMatMul(int m, int n, int k, bool b_is_constant) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor a(DT_QUINT8, TensorShape({m, k}));
+  a.flat<quint8>().setRandom();
+  Tensor b(DT_QUINT8, TensorShape({k, n}));
+  b.flat<quint8>().setRandom();
+  Node* node;
+  TF_CHECK_OK(
+      NodeBuilder(g->NewName("n"), "QuantizedMatMul")
+          .Input(test::graph::Constant(g, a))
+          .Input(test::graph::Constant(g, b))
+          .Input(test::graph::Constant(g, test::AsScalar<float>(-1.0f)))
+          .Input(test::graph::Constant(g, test::AsScalar<float>(1.0f)))
+          .Input(test::graph::Constant(g, test::AsScalar<float>(-1.0f)))
+          .Input(test::graph::Constant(g, test::AsScalar<float>(1.0f)))
+          .Attr("Toutput", DT_QINT32)
+          .Attr("b_is_constant", b_is_constant)
+          .Finalize(g, &node));
+  return g;
+}
+
+// Multiplies [m, 1024] by a constant [1024, 1024] matrix, packing b on every
+// run or only once.
+static void BM_QuantizedMatMul(int iters, int m, bool b_is_constant) {
+  const int k = 1024;
+  const int n = 1024;
+  testing::ItemsProcessed(static_cast<int64>(iters) * m * n * k * 2);
+  testing::UseRealTime();
+  test::Benchmark("cpu", QuantizedMatMul(m, n, k, b_is_constant)).Run(iters);
+}
+
+static void BM_QuantizedMatMul_PackedEveryRun(int iters, int m) {
+  BM_QuantizedMatMul(iters, m, false);
+}
+
+static void BM_QuantizedMatMul_ConstantB(int iters, int m) {
+  BM_QuantizedMatMul(iters, m, true);
+}
+
+BENCHMARK(BM_QuantizedMatMul_PackedEveryRun)->Arg(1)->Arg(64)->Arg(256);
+BENCHMARK(BM_QuantizedMatMul_ConstantB)->Arg(1)->Arg(64)->Arg(256);
+
 }  // namespace tensorflow
@@ -0,0 +1,116 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_ROW_UPDATE_SHARDER_H_
+#define TENSORFLOW_KERNELS_ROW_UPDATE_SHARDER_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Minimum estimated cost, in cycles, of the updates given to each thread by
+// ShardRowUpdates().  Smaller batches are applied on the calling thread.
+const int64 kMinRowUpdateCostPerShard = 1 << 16;
+
+// Calls update(i, indices(i)) for every i in [0, indices.size()), where each
+// update modifies row indices(i) of one or more tensors with num_rows rows,
+// and costs about cost_per_update cycles.
+//
+// Large batches are partitioned by row across the threads of 'd', so that
+// every row is owned by a single thread.  Updates to different rows then run
+// concurrently without locking, while repeated indices are applied in their
+// original order, giving the same result as applying the updates serially.
+//
+// Returns -1 on success, or the position of the first index outside
+// [0, num_rows), in which case the value that failed the bounds check is
+// stored in *bad_index if bad_index is not null.  The indices may be modified
+// concurrently, so callers should report that value rather than read the
+// index again.  Small batches apply the updates preceding that position, like
+// a serial loop; large batches are validated before any update is made.
+template <typename Index, typename UpdateFn>
+Index ShardRowUpdates(const Eigen::ThreadPoolDevice& d,
+                      typename TTypes<Index>::ConstFlat indices,
+                      Index num_rows, int64 cost_per_update,
+                      const UpdateFn& update, Index* bad_index = nullptr) {
+  const Index N = static_cast<Index>(indices.size());
+  const int64 num_shards =
+      std::min<int64>(d.numThreads(), static_cast<int64>(N) *
+                                          cost_per_update /
+                                          kMinRowUpdateCostPerShard);
+  if (num_shards <= 1) {
+    for (Index i = 0; i < N; i++) {
+      // Grab the index and check its validity.  An earlier version of the
+      // code checked it and then grabbed it from memory a second time, which
+      // was a security risk since it could have changed in between.
+      const Index index = ::tensorflow::internal::SubtleMustCopy(indices(i));
+      if (!FastBoundsCheck(index, num_rows)) {
+        if (bad_index != nullptr) *bad_index = index;
+        return i;
+      }
+      update(i, index);
+    }
+    return -1;
+  }
+
+  // Validate and copy the indices once, then bucket the update positions by
+  // owning shard with a stable counting sort.
+  std::vector<Index> rows(N);
+  std::vector<int64> shard_begin(num_shards + 1, 0);
+  for (Index i = 0; i < N; i++) {
+    const Index index = ::tensorflow::internal::SubtleMustCopy(indices(i));
+    if (!FastBoundsCheck(index, num_rows)) {
+      if (bad_index != nullptr) *bad_index = index;
+      return i;
+    }
+    rows[i] = index;
+    ++shard_begin[index % num_shards + 1];
+  }
+  for (int64 s = 0; s < num_shards; ++s) {
+    shard_begin[s + 1] += shard_begin[s];
+  }
+  std::vector<Index> positions(N);
+  {
+    std::vector<int64> next(shard_begin.begin(), shard_begin.end() - 1);
+    for (Index i = 0; i < N; i++) {
+      positions[next[rows[i] % num_shards]++] = i;
+    }
+  }
+
+  auto work = [&rows, &shard_begin, &positions, &update](int64 first,
+                                                         int64 last) {
+    for (int64 s = first; s < last; ++s) {
+      for (int64 p = shard_begin[s]; p < shard_begin[s + 1]; ++p) {
+        const Index i = positions[p];
+        update(i, rows[i]);
+      }
+    }
+  };
+  // Every shard is given the same cost, which makes each one its own task.
+  d.parallelFor(num_shards,
+                Eigen::TensorOpCost(0, 0, static_cast<double>(N) *
+                                              cost_per_update / num_shards),
+                work);
+  return -1;
+}
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_ROW_UPDATE_SHARDER_H_
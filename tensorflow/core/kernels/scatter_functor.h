@@ -21,6 +21,9 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/platform/types.h"
+#ifdef EIGEN_USE_THREADS
+#include "tensorflow/core/kernels/row_update_sharder.h"
+#endif  // EIGEN_USE_THREADS
 
 namespace tensorflow {
 
@@ -179,6 +182,37 @@ struct ScatterFunctorBase <SYCLDevice, T, Index, op> {
 };
 #endif // TENSORFLOW_USE_SYCL
 
+// On the CPU, large batches of updates are sharded by row across the worker
+// threads; see ShardRowUpdates().  The specializations are declared for every
+// includer, so that no compilation unit falls back to the generic
+// ScatterFunctorBase for the CPU.  Their definitions need the ThreadPoolDevice,
+// so they are left out of the GPU compilation units, which only use the GPU
+// specializations; CPU kernels must define EIGEN_USE_THREADS to use them.
+template <typename T, typename Index, scatter_op::UpdateOp op>
+struct ScatterFunctorBase<CPUDevice, T, Index, op>;
+template <typename T, typename Index>
+struct ScatterFunctorBase<CPUDevice, T, Index, scatter_op::UpdateOp::ASSIGN>;
+
+#ifdef EIGEN_USE_THREADS
+template <typename T, typename Index, scatter_op::UpdateOp op>
+struct ScatterFunctorBase<CPUDevice, T, Index, op> {
+  Index operator()(OpKernelContext* c, const CPUDevice& d,
+                   typename TTypes<T>::Matrix params,
+                   typename TTypes<T>::ConstMatrix updates,
+                   typename TTypes<Index>::ConstFlat indices) {
+    // indices and params sizes were validated in DoCompute().
+    const Index limit = static_cast<Index>(params.dimension(0));
+    const int64 cost_per_update = updates.dimension(1) * sizeof(T);
+    return ShardRowUpdates<Index>(
+        d, indices, limit, cost_per_update,
+        [&params, &updates](Index i, Index index) {
+          // Copy last Ndim-1 dimensions of updates[i] to params[index]
+          scatter_op::internal::Assign<op>::Run(
+              params.template chip<0>(index), updates.template chip<0>(i));
+        });
+  }
+};
+
 template <typename T, typename Index>
 struct ScatterFunctorBase<CPUDevice, T, Index, scatter_op::UpdateOp::ASSIGN> {
   Index operator()(OpKernelContext* c, const CPUDevice& d,
@@ -186,34 +220,28 @@ struct ScatterFunctorBase<CPUDevice, T, Index, scatter_op::UpdateOp::ASSIGN> {
                    typename TTypes<T>::ConstMatrix updates,
                    typename TTypes<Index>::ConstFlat indices) {
     // indices and params sizes were validated in DoCompute().
-    const Index N = static_cast<Index>(indices.size());
     const Index limit = static_cast<Index>(params.dimension(0));
+    const int64 cost_per_update = updates.dimension(1) * sizeof(T);
     if (!std::is_same<T, string>::value) {
-      for (Index i = 0; i < N; i++) {
-        // Grab the index and check its validity.  An earlier version of the
-        // code checked it and then grabbed it from memory a second time, which
-        // was a security risk since it could have changed in between.
-        const Index index = ::tensorflow::internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, limit)) return i;
-        memmove(params.data() + index * params.dimension(1),
-                updates.data() + i * updates.dimension(1),
-                updates.dimension(1) * sizeof(T));
-      }
+      return ShardRowUpdates<Index>(
+          d, indices, limit, cost_per_update,
+          [&params, &updates](Index i, Index index) {
+            memmove(params.data() + index * params.dimension(1),
+                    updates.data() + i * updates.dimension(1),
+                    updates.dimension(1) * sizeof(T));
+          });
     } else {
-      for (Index i = 0; i < N; i++) {
-        // Grab the index and check its validity.  An earlier version of the
-        // code checked it and then grabbed it from memory a second time, which
-        // was a security risk since it could have changed in between.
-        const Index index = ::tensorflow::internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, limit)) return i;
-        // Copy last Ndim-1 dimensions of updates[i] to params[index]
-        scatter_op::internal::Assign<scatter_op::UpdateOp::ASSIGN>::Run(
-            params.template chip<0>(index), updates.template chip<0>(i));
-      }
+      return ShardRowUpdates<Index>(
+          d, indices, limit, cost_per_update,
+          [&params, &updates](Index i, Index index) {
+            // Copy last Ndim-1 dimensions of updates[i] to params[index]
+            scatter_op::internal::Assign<scatter_op::UpdateOp::ASSIGN>::Run(
+                params.template chip<0>(index), updates.template chip<0>(i));
+          });
     }
-    return -1;
   }
 };
+#endif  // EIGEN_USE_THREADS
 
 template <typename T, typename Index, scatter_op::UpdateOp op>
 struct ScatterFunctor<CPUDevice, T, Index, op>
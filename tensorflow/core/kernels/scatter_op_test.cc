@@ -223,6 +223,99 @@ TEST_F(ScatterUpdateOpTest, Error_MismatchedIndicesAndUpdateDimensions) {
       << s;
 }
 
+// Enough updates for the CPU kernels to shard them across threads by row.
+const int kLargeBatchRows = 1000;
+const int kLargeBatchCols = 16;
+const int kLargeBatchUpdates = 20000;
+
+// Returns random row indices, with many repeats, and distinct update values.
+void MakeLargeBatch(std::vector<int32>* indices, std::vector<float>* updates) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  for (int i = 0; i < kLargeBatchUpdates; ++i) {
+    indices->push_back(rnd.Uniform(kLargeBatchRows));
+    for (int j = 0; j < kLargeBatchCols; ++j) {
+      updates->push_back(i * kLargeBatchCols + j);
+    }
+  }
+}
+
+TEST_F(ScatterUpdateOpTest, LargeBatch_RepeatedIndices) {
+  MakeOp(DT_FLOAT_REF, DT_INT32);
+  std::vector<int32> indices;
+  std::vector<float> updates;
+  MakeLargeBatch(&indices, &updates);
+  AddInputFromArray<float>(
+      TensorShape({kLargeBatchRows, kLargeBatchCols}),
+      std::vector<float>(kLargeBatchRows * kLargeBatchCols, 0));
+  AddInputFromArray<int32>(TensorShape({kLargeBatchUpdates}), indices);
+  AddInputFromArray<float>(TensorShape({kLargeBatchUpdates, kLargeBatchCols}),
+                           updates);
+  TF_ASSERT_OK(RunOpKernel());
+
+  // The last update of each row wins, as if applied serially.
+  Tensor expected(allocator(), DT_FLOAT,
+                  TensorShape({kLargeBatchRows, kLargeBatchCols}));
+  auto expected_matrix = expected.matrix<float>();
+  expected_matrix.setZero();
+  for (int i = 0; i < kLargeBatchUpdates; ++i) {
+    for (int j = 0; j < kLargeBatchCols; ++j) {
+      expected_matrix(indices[i], j) = updates[i * kLargeBatchCols + j];
+    }
+  }
+  test::ExpectTensorEqual<float>(expected, *mutable_input(0).tensor);
+}
+
+TEST_F(ScatterUpdateOpTest, LargeBatch_Add) {
+  TF_ASSERT_OK(NodeDefBuilder("myop", "ScatterAdd")
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  std::vector<int32> indices;
+  std::vector<float> updates;
+  MakeLargeBatch(&indices, &updates);
+  AddInputFromArray<float>(
+      TensorShape({kLargeBatchRows, kLargeBatchCols}),
+      std::vector<float>(kLargeBatchRows * kLargeBatchCols, 1));
+  AddInputFromArray<int32>(TensorShape({kLargeBatchUpdates}), indices);
+  AddInputFromArray<float>(TensorShape({kLargeBatchUpdates, kLargeBatchCols}),
+                           updates);
+  TF_ASSERT_OK(RunOpKernel());
+
+  // All sums are integers below 2^24, so they are exact in any order.
+  Tensor expected(allocator(), DT_FLOAT,
+                  TensorShape({kLargeBatchRows, kLargeBatchCols}));
+  auto expected_matrix = expected.matrix<float>();
+  expected_matrix.setConstant(1);
+  for (int i = 0; i < kLargeBatchUpdates; ++i) {
+    for (int j = 0; j < kLargeBatchCols; ++j) {
+      expected_matrix(indices[i], j) += updates[i * kLargeBatchCols + j];
+    }
+  }
+  test::ExpectTensorEqual<float>(expected, *mutable_input(0).tensor);
+}
+
+TEST_F(ScatterUpdateOpTest, LargeBatch_Error_IndexOutOfRange) {
+  MakeOp(DT_FLOAT_REF, DT_INT32);
+  std::vector<int32> indices;
+  std::vector<float> updates;
+  MakeLargeBatch(&indices, &updates);
+  indices[kLargeBatchUpdates / 2] = kLargeBatchRows;
+  indices.back() = -1;
+  AddInputFromArray<float>(
+      TensorShape({kLargeBatchRows, kLargeBatchCols}),
+      std::vector<float>(kLargeBatchRows * kLargeBatchCols, 0));
+  AddInputFromArray<int32>(TensorShape({kLargeBatchUpdates}), indices);
+  AddInputFromArray<float>(TensorShape({kLargeBatchUpdates, kLargeBatchCols}),
+                           updates);
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("indices[10000] = 1000 is not in [0, 1000)"))
+      << s;
+}
+
 class ScatterUpdateBM : public ScatterUpdateOpTest {
  public:
   void TestBody() override {}
@@ -18,6 +18,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/kernels/segment_reduction_ops.h"
+#include <unordered_map>
 #include <vector>
 #include "third_party/eigen3/Eigen/Core"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
@@ -30,7 +31,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -468,58 +471,90 @@ class SparseSegmentReductionOpBase : public OpKernel {
                 errors::InvalidArgument("segment ids must be >= 0"));
     auto output_flat = output->flat_outer_dims<T>();
 
-    int64 start = 0, end = 1;
-    // Index from which the output is not initialized.
-    OutputRow uninitialized_index = 0;
-    OutputRow out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    while (true) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      OutputRow next_index = 0;
+    // Validate the segment ids up front, so that the reduction below can be
+    // split at any segment boundary into shards that write disjoint rows.
+    OutputRow segment_id = internal::SubtleMustCopy(segment_vec(0));
+    for (int64 end = 1;; ++end) {
+      OutputRow next_segment_id = 0;
       if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
-        }
-        // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
+        next_segment_id = internal::SubtleMustCopy(segment_vec(end));
+        if (segment_id == next_segment_id) continue;
+        OP_REQUIRES(context, segment_id < next_segment_id,
                     errors::InvalidArgument("segment ids are not increasing"));
       }
-
       OP_REQUIRES(
-          context, FastBoundsCheck(out_index, output_rows),
+          context, FastBoundsCheck(segment_id, output_rows),
           errors::InvalidArgument(
-              "Segment id ", out_index, " out of range [0, ", output_rows,
+              "Segment id ", segment_id, " out of range [0, ", output_rows,
               "), possibly because 'segment_ids' input is not sorted."));
+      if (end >= num_indices) break;
+      segment_id = next_segment_id;
+    }
 
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(default_value_);
+    mutex mu;
+    Status status;
+    // Reduces the segments that start in [begin, end) of the indices.
+    auto reduce_range = [&](int64 begin, int64 end) {
+      while (begin > 0 && begin < num_indices &&
+             segment_vec(begin) == segment_vec(begin - 1)) {
+        ++begin;
       }
+      while (end < num_indices && segment_vec(end) == segment_vec(end - 1)) {
+        ++end;
+      }
+      // Index from which the output is not initialized.
+      OutputRow uninitialized_index =
+          begin > 0 ? segment_vec(begin - 1) + 1 : 0;
+      for (int64 start = begin; start < end;) {
+        const OutputRow out_index = segment_vec(start);
+        int64 next = start + 1;
+        while (next < end && segment_vec(next) == out_index) {
+          ++next;
+        }
+        if (!FastBoundsCheck(out_index, output_rows) ||
+            out_index < uninitialized_index) {
+          mutex_lock l(mu);
+          status.Update(errors::InvalidArgument(
+              "Segment id ", out_index, " out of range [0, ", output_rows,
+              "), possibly because 'segment_ids' input is not sorted."));
+          return;
+        }
 
-      auto out = output_flat.template chip<0>(out_index);
-      const int bad_offset =
-          Reduce(input_flat, indices_vec, start, end - start, out);
-      OP_REQUIRES(context, bad_offset < 0,
-                  errors::InvalidArgument(
-                      "Bad: indices[", start + bad_offset, "] == ",
-                      indices_vec(start + bad_offset), " out of range [0, ",
-                      input_flat.dimension(0), ")"));
+        // If there is a gap between two indices, we need to set that gap to
+        // the default value.
+        if (out_index > uninitialized_index) {
+          Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+              out_index - uninitialized_index, num_col);
+          Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+              gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
+          gap_slice.setConstant(default_value_);
+        }
 
-      if (end >= num_indices) break;
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-    }
+        auto out = output_flat.template chip<0>(out_index);
+        const int bad_offset =
+            Reduce(input_flat, indices_vec, start, next - start, out);
+        if (bad_offset >= 0) {
+          mutex_lock l(mu);
+          status.Update(errors::InvalidArgument(
+              "Bad: indices[", start + bad_offset, "] == ",
+              indices_vec(start + bad_offset), " out of range [0, ",
+              input_flat.dimension(0), ")"));
+          return;
+        }
+        start = next;
+        uninitialized_index = out_index + 1;
+      }
+    };
+
+    // Segments are sharded by the position of their first index, so the work
+    // per shard is proportional to the number of input rows it gathers.
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    const int64 cost_per_index = num_col * (sizeof(T) + 1);
+    Shard(worker_threads.num_threads, worker_threads.workers, num_indices,
+          cost_per_index, reduce_range);
+    OP_REQUIRES_OK(context, status);
   }
 
  private:
@@ -717,6 +752,36 @@ REGISTER_CPU_SPARSE_KERNELS(float);
 REGISTER_CPU_SPARSE_KERNELS(double);
 #undef REGISTER_CPU_SPARSE_KERNELS
 
+// Reads the rows of params by index and reduces them into the output segments
+// like SparseSegmentReductionOpBase, with the reduction given by the
+// "combiner" attr.
+template <typename Device, class T>
+class FusedEmbeddingLookupSparseOp
+    : public SparseSegmentReductionOpBase<Device, T> {
+ public:
+  explicit FusedEmbeddingLookupSparseOp(OpKernelConstruction* context)
+      : SparseSegmentReductionOpBase<Device, T>(
+            context, GetCombiner(context) == "mean",
+            GetCombiner(context) == "sqrtn", T(0) /* default_value */) {}
+
+ private:
+  static string GetCombiner(OpKernelConstruction* context) {
+    string combiner;
+    // The op registration guarantees that the attr is present and valid.
+    TF_CHECK_OK(context->GetAttr("combiner", &combiner));
+    return combiner;
+  }
+};
+
+#define REGISTER_CPU_SPARSE_KERNELS(type)                    \
+  REGISTER_KERNEL_BUILDER(Name("FusedEmbeddingLookupSparse") \
+                              .Device(DEVICE_CPU)            \
+                              .TypeConstraint<type>("T"),    \
+                          FusedEmbeddingLookupSparseOp<CPUDevice, type>);
+REGISTER_CPU_SPARSE_KERNELS(float);
+REGISTER_CPU_SPARSE_KERNELS(double);
+#undef REGISTER_CPU_SPARSE_KERNELS
+
 template <class T>
 class SparseSegmentGradOpBase : public OpKernel {
  public:
@@ -855,4 +920,123 @@ REGISTER_CPU_SPARSE_KERNELS(double);
 REGISTER_CPU_SPARSE_KERNELS(float);
 REGISTER_CPU_SPARSE_KERNELS(double);
 #undef REGISTER_CPU_SPARSE_KERNELS
+
+// Computes the gradient of FusedEmbeddingLookupSparse as slices of params: one
+// row per distinct id, accumulating the scaled gradients of all the segments
+// the id was reduced into. Unlike SparseSegmentMeanGrad, the output does not
+// span all the rows of params.
+template <class T>
+class FusedEmbeddingLookupSparseGradOp : public OpKernel {
+ public:
+  explicit FusedEmbeddingLookupSparseGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    is_mean_ = combiner == "mean";
+    is_sqrtn_ = combiner == "sqrtn";
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& grad = context->input(0);
+    const Tensor& ids = context->input(1);
+    const Tensor& segment_ids = context->input(2);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(grad.shape()),
+                errors::InvalidArgument("grad should be at least a vector."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(ids.shape()),
+                errors::InvalidArgument("ids should be a vector."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(segment_ids.shape()),
+                errors::InvalidArgument("segment_ids should be a vector."));
+
+    const int64 N = ids.NumElements();
+    OP_REQUIRES(
+        context, N == segment_ids.NumElements(),
+        errors::InvalidArgument("segment_ids and ids should have same size."));
+
+    typedef int32 Index;
+    typedef int32 SegmentId;
+    auto grad_flat = grad.flat_outer_dims<T>();
+    const auto ids_vec = ids.vec<Index>();
+    const auto segment_vec = segment_ids.vec<SegmentId>();
+    const SegmentId num_segments = grad.dim_size(0);
+
+    // Copy the segment ids once so that both passes below read the values
+    // that were bounds checked, and compute the scaling factors for the
+    // gradient of each segment.
+    std::vector<SegmentId> segments(N);
+    std::vector<double> scaling(num_segments, 0.0);
+    for (int64 i = 0; i < N; ++i) {
+      const SegmentId idx = internal::SubtleMustCopy(segment_vec(i));
+      OP_REQUIRES(
+          context, FastBoundsCheck(idx, num_segments),
+          errors::InvalidArgument("Segment id ", idx, " out of range [0, ",
+                                  num_segments, ")."));
+      segments[i] = idx;
+      scaling[idx] += 1;
+    }
+    for (size_t i = 0; i < scaling.size(); ++i) {
+      if (is_sqrtn_) {
+        scaling[i] = 1.0 / sqrt(std::max(scaling[i], 1.0));
+      } else if (is_mean_) {
+        scaling[i] = 1.0 / std::max(scaling[i], 1.0);
+      } else {
+        scaling[i] = 1.0;
+      }
+    }
+
+    // Assign each distinct id the output row it accumulates into.
+    std::unordered_map<Index, int64> rows;
+    rows.reserve(N);
+    std::vector<int64> output_rows(N);
+    std::vector<Index> unique_ids;
+    for (int64 i = 0; i < N; ++i) {
+      const Index id = internal::SubtleMustCopy(ids_vec(i));
+      auto it = rows.emplace(id, unique_ids.size());
+      if (it.second) {
+        unique_ids.push_back(id);
+      }
+      output_rows[i] = it.first->second;
+    }
+    const int64 num_unique = unique_ids.size();
+
+    Tensor* unique_ids_out = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape({num_unique}),
+                                            &unique_ids_out));
+    std::copy(unique_ids.begin(), unique_ids.end(),
+              unique_ids_out->vec<Index>().data());
+
+    TensorShape values_shape = grad.shape();
+    values_shape.set_dim(0, num_unique);
+    Tensor* values = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(1, values_shape, &values));
+    auto values_flat = values->flat_outer_dims<T>();
+    values_flat.setZero();
+    for (int64 i = 0; i < N; ++i) {
+      const SegmentId idx = segments[i];
+      const T scale = static_cast<T>(scaling[idx]);
+      if (scale == T(1)) {
+        values_flat.template chip<0>(output_rows[i]) +=
+            grad_flat.template chip<0>(idx);
+      } else {
+        values_flat.template chip<0>(output_rows[i]) +=
+            grad_flat.template chip<0>(idx) * scale;
+      }
+    }
+  }
+
+ private:
+  bool is_mean_;
+  bool is_sqrtn_;
+};
+
+#define REGISTER_CPU_SPARSE_KERNELS(type)                        \
+  REGISTER_KERNEL_BUILDER(Name("FusedEmbeddingLookupSparseGrad") \
+                              .Device(DEVICE_CPU)                \
+                              .TypeConstraint<type>("T"),        \
+                          FusedEmbeddingLookupSparseGradOp<type>);
+REGISTER_CPU_SPARSE_KERNELS(float);
+REGISTER_CPU_SPARSE_KERNELS(double);
+#undef REGISTER_CPU_SPARSE_KERNELS
+
 }  // namespace tensorflow
@@ -31,6 +31,11 @@ limitations under the License.
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
@@ -38,6 +43,131 @@ limitations under the License.
 
 namespace tensorflow {
 
+// Runs the sparse segment reductions with a fixed number of worker threads,
+// so that large enough inputs are always split into several shards.
+class SparseSegmentReductionOpTest : public OpsTestBase {
+ protected:
+  static const int kNumShards = 4;
+  static const int kNumRows = 1000;
+  static const int kNumCols = 4;
+
+  SparseSegmentReductionOpTest()
+      : workers_(Env::Default(), "sparse_segment_test", 2 * kNumShards) {
+    // Shard splits the work into at most num_threads shards, and leaves it to
+    // the thread pool when num_threads covers the whole pool.
+    worker_threads_.num_threads = kNumShards;
+    worker_threads_.workers = &workers_;
+    device_->set_tensorflow_cpu_worker_threads(&worker_threads_);
+  }
+
+  void MakeOp(const string& reduction) {
+    inputs_.clear();
+    TF_ASSERT_OK(NodeDefBuilder("reduction", reduction)
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT32))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Reduces the rows of a kNumRows x kNumCols input picked by 'indices', and
+  // compares the result with a serial reference.
+  void RunAndCheck(const string& reduction, const std::vector<int32>& indices,
+                   const std::vector<int32>& segment_ids) {
+    const bool is_mean = reduction == "SparseSegmentMean";
+    MakeOp(reduction);
+    AddInput<float>(TensorShape({kNumRows, kNumCols}),
+                    [](int i) -> float { return i % 97 - 48; });
+    const int64 num_indices = indices.size();
+    AddInputFromArray<int32>(TensorShape({num_indices}), indices);
+    AddInputFromArray<int32>(TensorShape({num_indices}), segment_ids);
+    TF_ASSERT_OK(RunOpKernel());
+
+    const int output_rows = segment_ids.back() + 1;
+    Tensor expected(allocator(), DT_FLOAT,
+                    TensorShape({output_rows, kNumCols}));
+    auto expected_flat = expected.matrix<float>();
+    expected_flat.setZero();
+    std::vector<int> counts(output_rows, 0);
+    for (int64 i = 0; i < num_indices; ++i) {
+      ++counts[segment_ids[i]];
+      for (int j = 0; j < kNumCols; ++j) {
+        expected_flat(segment_ids[i], j) +=
+            (indices[i] * kNumCols + j) % 97 - 48;
+      }
+    }
+    if (is_mean) {
+      for (int row = 0; row < output_rows; ++row) {
+        if (counts[row] == 0) continue;
+        for (int j = 0; j < kNumCols; ++j) {
+          expected_flat(row, j) /= counts[row];
+        }
+      }
+    }
+    test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+  }
+
+  // Builds the ids of 'num_indices' indices in segments of 'segment_length',
+  // with gaps of zero to two empty segments before each, and the indices they
+  // gather.
+  static void MakeSegments(int64 num_indices, int64 segment_length,
+                           std::vector<int32>* indices,
+                           std::vector<int32>* segment_ids) {
+    for (int64 i = 0; i < num_indices; ++i) {
+      const int64 segment = i / segment_length;
+      indices->push_back((i * 7919) % kNumRows);
+      segment_ids->push_back(2 + 2 * segment + (segment % 3 == 0 ? 0 : 1));
+    }
+  }
+
+ private:
+  thread::ThreadPool workers_;
+  DeviceBase::CpuWorkerThreads worker_threads_;
+};
+
+// Enough indices for Shard to use every shard with the cost per index of a
+// kNumCols wide float input.
+const int kShardedIndices = 10000;
+
+TEST_F(SparseSegmentReductionOpTest, SingleIndexSegmentsWithGaps) {
+  // Every shard starts with a new segment, most of them after a gap.
+  std::vector<int32> indices, segment_ids;
+  MakeSegments(kShardedIndices, 1, &indices, &segment_ids);
+  RunAndCheck("SparseSegmentSum", indices, segment_ids);
+}
+
+TEST_F(SparseSegmentReductionOpTest, SegmentsStraddleShards) {
+  for (int segment_length : {7, 100, 2500, 3001}) {
+    std::vector<int32> indices, segment_ids;
+    MakeSegments(kShardedIndices, segment_length, &indices, &segment_ids);
+    RunAndCheck("SparseSegmentSum", indices, segment_ids);
+    RunAndCheck("SparseSegmentMean", indices, segment_ids);
+  }
+}
+
+TEST_F(SparseSegmentReductionOpTest, SingleSegmentAcrossAllShards) {
+  std::vector<int32> indices, segment_ids;
+  MakeSegments(kShardedIndices, kShardedIndices, &indices, &segment_ids);
+  RunAndCheck("SparseSegmentMean", indices, segment_ids);
+}
+
+TEST_F(SparseSegmentReductionOpTest, BadIndexInLaterShard) {
+  std::vector<int32> indices, segment_ids;
+  MakeSegments(kShardedIndices, 7, &indices, &segment_ids);
+  indices[kShardedIndices - 10] = kNumRows;
+  MakeOp("SparseSegmentSum");
+  AddInput<float>(TensorShape({kNumRows, kNumCols}),
+                  [](int i) -> float { return i; });
+  AddInputFromArray<int32>(TensorShape({kShardedIndices}), indices);
+  AddInputFromArray<int32>(TensorShape({kShardedIndices}), segment_ids);
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains(strings::StrCat("Bad: indices[",
+                                            kShardedIndices - 10, "] == 1000 "
+                                            "out of range [0, 1000)")))
+      << s;
+}
+
 template <typename Index>
 static void BM_SegmentReduction(int iters, const string& reduction,
                                 Index num_rows, Index num_cols,
@@ -166,4 +296,64 @@ static void BM_SparseSegmentMeanGrad_High(int iters, int size) {
 BENCHMARK(BM_SparseSegmentMeanGrad_Low)->Arg(1000)->Arg(100000);
 BENCHMARK(BM_SparseSegmentMeanGrad_High)->Arg(1000)->Arg(100000);
 
+// Reduces bags of kIdsPerSegment random rows, as embedding_lookup_sparse does
+// with its combiner.
+static void SparseSegmentReductionHelper(int iters, const string& reduction,
+                                         int num_indices, int dim) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  const int kNumRows = 100000;
+  const int kIdsPerSegment = 10;
+
+  Tensor indices(DT_INT32, TensorShape({num_indices}));
+  auto indices_flat = indices.flat<int32>();
+  Tensor segments(DT_INT32, TensorShape({num_indices}));
+  auto segments_flat = segments.flat<int32>();
+  for (int i = 0; i < num_indices; ++i) {
+    indices_flat(i) = (i * 7919) % kNumRows;
+    segments_flat(i) = i / kIdsPerSegment;
+  }
+
+  Tensor input(DT_FLOAT, TensorShape({kNumRows, dim}));
+  input.flat<float>().setRandom();
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), reduction)
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, indices))
+                  .Input(test::graph::Constant(g, segments))
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+
+  testing::UseRealTime();
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_indices);
+  testing::BytesProcessed(static_cast<int64>(iters) * num_indices * dim *
+                          sizeof(float));
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+static void BM_SparseSegmentSum(int iters, int num_indices, int dim) {
+  SparseSegmentReductionHelper(iters, "SparseSegmentSum", num_indices, dim);
+}
+
+static void BM_SparseSegmentMean(int iters, int num_indices, int dim) {
+  SparseSegmentReductionHelper(iters, "SparseSegmentMean", num_indices, dim);
+}
+
+BENCHMARK(BM_SparseSegmentSum)
+    ->ArgPair(1000, 16)
+    ->ArgPair(1000, 128)
+    ->ArgPair(10000, 16)
+    ->ArgPair(10000, 128)
+    ->ArgPair(100000, 16)
+    ->ArgPair(100000, 128);
+BENCHMARK(BM_SparseSegmentMean)
+    ->ArgPair(1000, 16)
+    ->ArgPair(1000, 128)
+    ->ArgPair(10000, 16)
+    ->ArgPair(10000, 128)
+    ->ArgPair(100000, 16)
+    ->ArgPair(100000, 128);
+
 }  // namespace tensorflow
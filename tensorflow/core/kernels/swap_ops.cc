@@ -0,0 +1,125 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/data_flow_ops.cc.
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+
+// The first byte of a swapped tensor tells how the serialized tensor that
+// follows is stored.
+const char kSnappyCompressed = 's';
+const char kUncompressed = 'u';
+
+// Protocol buffers can't be larger than 2GB.
+const size_t kMaxSerializedSize = kint32max;
+
+}  // namespace
+
+class SwapOutOp : public OpKernel {
+ public:
+  explicit SwapOutOp(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& value = context->input(0);
+    TensorProto proto;
+    value.AsProtoTensorContent(&proto);
+    string serialized;
+    OP_REQUIRES(context, proto.SerializeToString(&serialized),
+                errors::Internal("Unable to serialize a tensor of shape ",
+                                 value.shape().DebugString()));
+
+    Tensor* swapped = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape({}), &swapped));
+    string* output = &swapped->scalar<string>()();
+    // Keep the tensor uncompressed if snappy isn't available.
+    if (port::Snappy_Compress(serialized.data(), serialized.size(), output)) {
+      output->insert(output->begin(), kSnappyCompressed);
+    } else {
+      output->reserve(serialized.size() + 1);
+      output->assign(1, kUncompressed);
+      output->append(serialized);
+    }
+  }
+};
+
+class SwapInOp : public OpKernel {
+ public:
+  explicit SwapInOp(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& swapped_tensor = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(swapped_tensor.shape()),
+                errors::InvalidArgument("swapped must be a scalar, got shape ",
+                                        swapped_tensor.shape().DebugString()));
+    const string& swapped = swapped_tensor.scalar<string>()();
+    OP_REQUIRES(context, !swapped.empty(),
+                errors::InvalidArgument("swapped is empty"));
+    const char* data = swapped.data() + 1;
+    size_t size = swapped.size() - 1;
+
+    string uncompressed;
+    if (swapped[0] == kSnappyCompressed) {
+      size_t uncompressed_size;
+      OP_REQUIRES(
+          context,
+          port::Snappy_GetUncompressedLength(data, size, &uncompressed_size),
+          errors::DataLoss("Invalid compressed tensor"));
+      // Check the size before allocating, as the header may be corrupt.
+      OP_REQUIRES(context, uncompressed_size <= kMaxSerializedSize,
+                  errors::DataLoss("Compressed tensor claims ",
+                                   uncompressed_size, " bytes, more than a ",
+                                   "tensor proto can hold"));
+      uncompressed.resize(uncompressed_size);
+      OP_REQUIRES(context,
+                  port::Snappy_Uncompress(data, size, &uncompressed[0]),
+                  errors::DataLoss("Unable to decompress a tensor"));
+      data = uncompressed.data();
+      size = uncompressed.size();
+    } else {
+      OP_REQUIRES(context, swapped[0] == kUncompressed,
+                  errors::InvalidArgument("Unknown swapped tensor format"));
+      OP_REQUIRES(context, size <= kMaxSerializedSize,
+                  errors::DataLoss("Swapped tensor has ", size, " bytes, ",
+                                   "more than a tensor proto can hold"));
+    }
+
+    TensorProto proto;
+    OP_REQUIRES(context, proto.ParseFromArray(data, size),
+                errors::DataLoss("Unable to parse a swapped tensor"));
+    Tensor value;
+    OP_REQUIRES(context, value.FromProto(proto),
+                errors::DataLoss("Invalid swapped tensor"));
+    OP_REQUIRES(context, value.dtype() == output_type(0),
+                errors::InvalidArgument(
+                    "Swapped a tensor of type ", DataTypeString(value.dtype()),
+                    " but expected ", DataTypeString(output_type(0))));
+    context->set_output(0, value);
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("_SwapOut").Device(DEVICE_CPU), SwapOutOp);
+REGISTER_KERNEL_BUILDER(Name("_SwapIn").Device(DEVICE_CPU), SwapInOp);
+
+}  // namespace tensorflow
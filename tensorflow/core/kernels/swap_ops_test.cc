@@ -0,0 +1,143 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class SwapOpsTest : public OpsTestBase {
+ protected:
+  // Returns the output of _SwapOut for 'value'.
+  string SwapOut(const Tensor& value) {
+    TF_CHECK_OK(NodeDefBuilder("swap_out", "_SwapOut")
+                    .Input(FakeInput(value.dtype()))
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    inputs_.clear();
+    AddInputFromArray<float>(value.shape(), value.flat<float>());
+    TF_CHECK_OK(RunOpKernel());
+    return GetOutput(0)->scalar<string>()();
+  }
+
+  // Runs _SwapIn on 'swapped', and stores its output in 'value'.
+  Status SwapIn(const string& swapped, DataType type, Tensor* value) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("swap_in", "_SwapIn")
+                           .Input(FakeInput(DT_STRING))
+                           .Attr("T", type)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    AddInputFromArray<string>(TensorShape({}), {swapped});
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *value = *GetOutput(0);
+    return Status::OK();
+  }
+
+  static bool SnappyAvailable() {
+    string compressed;
+    return port::Snappy_Compress("x", 1, &compressed);
+  }
+
+  static Tensor MakeTensor() {
+    Tensor value(DT_FLOAT, TensorShape({64, 3}));
+    test::FillFn<float>(&value, [](int i) -> float { return i % 5; });
+    return value;
+  }
+};
+
+TEST_F(SwapOpsTest, RoundTrip) {
+  const Tensor value = MakeTensor();
+  const string swapped = SwapOut(value);
+  if (SnappyAvailable()) {
+    EXPECT_EQ('s', swapped[0]);
+    // The repeated values compress well.
+    EXPECT_LT(swapped.size(), value.TotalBytes());
+  } else {
+    EXPECT_EQ('u', swapped[0]);
+  }
+  Tensor restored;
+  TF_ASSERT_OK(SwapIn(swapped, DT_FLOAT, &restored));
+  test::ExpectTensorEqual<float>(value, restored);
+}
+
+TEST_F(SwapOpsTest, RestoresUncompressed) {
+  // The format _SwapOut falls back to when snappy isn't available.
+  const Tensor value = MakeTensor();
+  TensorProto proto;
+  value.AsProtoTensorContent(&proto);
+  string swapped = "u";
+  swapped.append(proto.SerializeAsString());
+  Tensor restored;
+  TF_ASSERT_OK(SwapIn(swapped, DT_FLOAT, &restored));
+  test::ExpectTensorEqual<float>(value, restored);
+}
+
+TEST_F(SwapOpsTest, WrongType) {
+  Tensor restored;
+  Status s = SwapIn(SwapOut(MakeTensor()), DT_INT32, &restored);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("but expected int32")) << s;
+}
+
+TEST_F(SwapOpsTest, CorruptInput) {
+  Tensor restored;
+  Status s = SwapIn("", DT_FLOAT, &restored);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  s = SwapIn("x123", DT_FLOAT, &restored);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("Unknown swapped tensor"))
+      << s;
+  s = SwapIn("u\xff\xff\xff", DT_FLOAT, &restored);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+
+  // A truncated compressed tensor.
+  string swapped = SwapOut(MakeTensor());
+  swapped.resize(swapped.size() / 2);
+  s = SwapIn(swapped, DT_FLOAT, &restored);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+}
+
+TEST_F(SwapOpsTest, OversizedInput) {
+  if (!SnappyAvailable()) {
+    return;
+  }
+  // A compressed tensor whose header claims 3GB once uncompressed is rejected
+  // before anything is allocated.
+  string swapped = "s";
+  core::PutVarint64(&swapped, 3ULL << 30);
+  swapped.append("abc");
+  Tensor restored;
+  Status s = SwapIn(swapped, DT_FLOAT, &restored);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+  EXPECT_TRUE(
+      StringPiece(s.ToString()).contains("more than a tensor proto can hold"))
+      << s;
+}
+
+}  // namespace
+}  // namespace tensorflow
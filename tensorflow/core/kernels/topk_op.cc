@@ -18,6 +18,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include <algorithm>
+#include <functional>
 #include <numeric>
 #include <vector>
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
@@ -33,6 +34,75 @@ namespace tensorflow {
 typedef Eigen::ThreadPoolDevice CPUDevice;
 typedef Eigen::GpuDevice GPUDevice;
 
+namespace {
+
+// Rows with at least this many columns are reduced with SelectTopK rather than
+// a TopN heap, if k is at least kMinSelectK or the row is at least
+// kMinSelectLongCols long. For smaller k, rejecting most elements against the
+// bottom of the heap is about as cheap as the selection.
+const int64 kMinSelectCols = 1024;
+const int64 kMinSelectK = 32;
+const int64 kMinSelectLongCols = 64 * 1024;
+
+// Number of elements sampled from a row to estimate the selection threshold.
+const int64 kThresholdSampleSize = 1024;
+
+bool UseSelectTopK(int64 num_cols, int64 k) {
+  return k < num_cols && num_cols >= kMinSelectCols &&
+         (k >= kMinSelectK || num_cols >= kMinSelectLongCols);
+}
+
+// Writes the indices of the k largest elements of 'row' to 'indices', ordered
+// by decreasing value, and by increasing index among equal values, if
+// 'sorted'. Requires 0 < k < num_cols.
+//
+// A strided sample of the row gives a threshold that, most likely, slightly
+// more than k elements of the row reach; a single branch-light pass then
+// discards the elements below it, and only the survivors are partitioned with
+// std::nth_element. If too few elements survive, the whole row is partitioned.
+// 'sample' and 'candidates' are scratch space, reused across rows.
+template <typename T>
+void SelectTopK(const T* row, int64 num_cols, int64 k, bool sorted,
+                std::vector<T>* sample, std::vector<int32>* candidates,
+                int32* indices) {
+  const auto greater = [row](const int32 a, const int32 b) {
+    return row[a] > row[b] || (row[a] == row[b] && a < b);
+  };
+
+  candidates->clear();
+  const int64 stride = num_cols / kThresholdSampleSize;
+  // Rank in the sample whose value is expected to be reached by twice as many
+  // elements of the row as needed.
+  const int64 rank = 2 * k / std::max<int64>(stride, 1) + 8;
+  if (stride > 1 && rank < kThresholdSampleSize) {
+    sample->resize(kThresholdSampleSize);
+    for (int64 i = 0; i < kThresholdSampleSize; ++i) {
+      (*sample)[i] = row[i * stride];
+    }
+    std::nth_element(sample->begin(), sample->begin() + rank, sample->end(),
+                     std::greater<T>());
+    const T threshold = (*sample)[rank];
+    for (int32 c = 0; c < num_cols; ++c) {
+      if (row[c] >= threshold) candidates->push_back(c);
+    }
+  }
+  if (candidates->size() < static_cast<size_t>(k)) {
+    candidates->resize(num_cols);
+    std::iota(candidates->begin(), candidates->end(), 0);
+  }
+
+  const auto kth = candidates->begin() + k;
+  if (kth != candidates->end()) {
+    std::nth_element(candidates->begin(), kth, candidates->end(), greater);
+  }
+  if (sorted) {
+    std::sort(candidates->begin(), kth, greater);
+  }
+  std::copy(candidates->begin(), kth, indices);
+}
+
+}  // namespace
+
 template <typename T>
 class TopK : public OpKernel {
  public:
@@ -111,23 +181,24 @@ class TopK : public OpKernel {
       return;
     }
 
+    const bool use_select = UseSelectTopK(num_cols, k);
     auto SortIndices = [&, context](int start_batch, int limit_batch) {
+      std::vector<T> sample;
+      std::vector<int32> candidates;
       for (int32 b = start_batch; b < limit_batch; ++b) {
         const T* input_data = &input(b, 0);
         const auto comp = [input_data](const int32 a, const int32 b) {
           return input_data[a] > input_data[b];
         };
         gtl::TopN<int32, decltype(comp)> filter(k, comp);
-        // TODO(ebrevdo): For large k < num_cols, instead of using
-        // TopN, it may be faster to create a temporary vector of
-        // values 0..num_cols - 1 and then use std::partial_sort_copy
-        // of this into indices. Choosing the appropriate minimum k or
-        // ratio of k/num_cols will require some experimentation.
         if (k == num_cols) {
           // Set the initial array of indices 0 ... k - 1.
           std::iota(&indices(b, 0), &indices(b, k), 0);
           // Use an in-place sort.
           std::sort(&indices(b, 0), &indices(b, k), comp);
+        } else if (use_select) {
+          SelectTopK(input_data, num_cols, k, sorted_, &sample, &candidates,
+                     &indices(b, 0));
         } else {
           // Use the TopN heap object to sort.
           filter.reserve(num_cols);
@@ -164,7 +235,15 @@ class TopK : public OpKernel {
         cmp_cost *
         static_cast<int64>(num_cols *
                            Eigen::numext::log2(static_cast<float>(k + 1)));
-    const int64 sort_cost = (k == num_cols) ? base_cost : 4 * base_cost;
+    int64 sort_cost = (k == num_cols) ? base_cost : 4 * base_cost;
+    if (use_select) {
+      // One pass over the row, then a sort of the k survivors.
+      sort_cost = cmp_cost * num_cols;
+      if (sorted_) {
+        sort_cost += cmp_cost * static_cast<int64>(k * Eigen::numext::log2(
+                                    static_cast<float>(k + 1)));
+      }
+    }
     const int64 copy_cost = 2 * k * Eigen::TensorOpCost::AddCost<T>();
     const int64 total_cost = sort_cost + copy_cost;
     auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
@@ -0,0 +1,118 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class TopKOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(bool sorted) {
+    TF_EXPECT_OK(NodeDefBuilder("topk_op", "TopKV2")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("sorted", sorted)
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+
+  // Checks the top k of a row long enough to be reduced by selection against
+  // a full sort of its indices. The row has many repeated values, which must
+  // be ordered by index.
+  void CheckLongRow(int num_cols, int k) {
+    MakeOp(/*sorted=*/true);
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    std::vector<float> row(num_cols);
+    for (int c = 0; c < num_cols; ++c) {
+      row[c] = rnd.Uniform(num_cols / 4);
+    }
+    AddInputFromArray<float>(TensorShape({1, num_cols}), row);
+    AddInputFromArray<int32>(TensorShape({}), {k});
+    TF_ASSERT_OK(RunOpKernel());
+
+    std::vector<int32> order(num_cols);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&row](int32 a, int32 b) {
+      return row[a] > row[b];
+    });
+    order.resize(k);
+    std::vector<float> expected_values;
+    for (const int32 c : order) {
+      expected_values.push_back(row[c]);
+    }
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>(expected_values, {1, k}), *GetOutput(0));
+    test::ExpectTensorEqual<int32>(test::AsTensor<int32>(order, {1, k}),
+                                   *GetOutput(1));
+  }
+};
+
+TEST_F(TopKOpTest, LongRowLargeK) { CheckLongRow(4096, 1000); }
+
+TEST_F(TopKOpTest, VeryLongRowSmallK) { CheckLongRow(1 << 20, 10); }
+
+TEST_F(TopKOpTest, VeryLongRowLargeK) { CheckLongRow(1 << 20, 5000); }
+
+static Graph* TopK(int rows, int cols, int k) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, TensorShape({rows, cols}));
+  input.flat<float>().setRandom();
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "TopKV2")
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, test::AsScalar<int32>(k)))
+                  .Attr("sorted", true)
+                  .Finalize(g, &node));
+  return g;
+}
+
+#define BM_TopK(R, C, K)                                        \
+  static void BM_TopK_##R##_##C##_##K(int iters) {              \
+    testing::ItemsProcessed(static_cast<int64>(iters) * R * C); \
+    testing::UseRealTime();                                     \
+    test::Benchmark("cpu", TopK(R, C, K)).Run(iters);           \
+  }                                                             \
+  BENCHMARK(BM_TopK_##R##_##C##_##K);
+
+// Small rows, as in classification.
+BM_TopK(128, 1000, 5);
+BM_TopK(128, 1000, 100);
+// Candidate retrieval over long rows of logits.
+BM_TopK(1, 1048576, 10);
+BM_TopK(1, 1048576, 1000);
+BM_TopK(1, 1048576, 100000);
+BM_TopK(32, 1048576, 100);
+BM_TopK(256, 65536, 1000);
+
+}  // namespace
+}  // namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/kernels/row_update_sharder.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 
@@ -1246,6 +1247,10 @@ inline T FtrlCompute(const T& accum, const T& linear, const T& lr, const T& l1,
 }
 }  // namespace
 
+// Rough cost, in cycles, of the sparse Adagrad update of one element: a few
+// loads and stores, a square root and a division.
+const int64 kSparseAdagradCostPerElement = 32;
+
 // Note, this op works on cpu only.
 template <typename T, typename Tindex>
 class SparseApplyAdagradOp : public OpKernel {
@@ -1314,20 +1319,25 @@ class SparseApplyAdagradOp : public OpKernel {
         auto grad_flat = grad.flat_outer_dims<T>();
         T lr_scalar = lr.scalar<T>()();
 
-        // Note(yonghui): It might be worth multi-threading square() and
-        // rsqrt().
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-          auto a = accum_flat.template chip<0>(index);
-          auto g = grad_flat.template chip<0>(i);
-          auto v = var_flat.template chip<0>(index);
-          a += g.square();
-          v -= g.constant(lr_scalar) * g * a.rsqrt();
-        }
+        // Large batches update distinct rows concurrently; see
+        // ShardRowUpdates().
+        Tindex bad_index = 0;
+        const Tindex bad_i = ShardRowUpdates<Tindex>(
+            ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+            inner_dim * kSparseAdagradCostPerElement,
+            [&var_flat, &accum_flat, &grad_flat, lr_scalar](Tindex i,
+                                                            Tindex index) {
+              auto a = accum_flat.template chip<0>(index);
+              auto g = grad_flat.template chip<0>(i);
+              auto v = var_flat.template chip<0>(index);
+              a += g.square();
+              v -= g.constant(lr_scalar) * g * a.rsqrt();
+            },
+            &bad_index);
+        OP_REQUIRES(ctx, bad_i < 0,
+                    errors::InvalidArgument(strings::StrCat(
+                        "Index ", bad_index, " at offset ", bad_i,
+                        " in indices is out of range")));
       } else {
         auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
@@ -1336,17 +1346,22 @@ class SparseApplyAdagradOp : public OpKernel {
         T lr_scalar = lr.scalar<T>()();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-          T& a = accum_flat(index);
-          const T& g = grad_flat(i);
-          a += g * g;
-          var_flat(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
-        }
+        Tindex bad_index = 0;
+        const Tindex bad_i = ShardRowUpdates<Tindex>(
+            ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+            kSparseAdagradCostPerElement,
+            [&var_flat, &accum_flat, &grad_flat, lr_scalar](Tindex i,
+                                                            Tindex index) {
+              T& a = accum_flat(index);
+              const T& g = grad_flat(i);
+              a += g * g;
+              var_flat(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
+            },
+            &bad_index);
+        OP_REQUIRES(ctx, bad_i < 0,
+                    errors::InvalidArgument(strings::StrCat(
+                        "Index ", bad_index, " at offset ", bad_i,
+                        " in indices is out of range")));
       }
     }
 
@@ -1965,6 +1980,10 @@ TF_CALL_double(REGISTER_CPU_KERNELS);
 #undef REGISTER_CPU_KERNELS
 #undef REGISTER_KERNELS
 
+// Rough cost, in cycles, of the sparse Ftrl update of one element, which
+// needs two powers or square roots and two divisions.
+const int64 kSparseFtrlCostPerElement = 128;
+
 // Note, this op works on cpu only.
 template <typename Device, typename T, typename Tindex>
 class SparseApplyFtrlOp : public OpKernel {
@@ -2074,12 +2093,9 @@ class SparseApplyFtrlOp : public OpKernel {
         T l2_scalar = l2.scalar<T>()();
         T lr_power_scalar = lr_power.scalar<T>()();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&var_flat, &accum_flat, &linear_flat, &grad_flat,
+                       lr_scalar, l1_scalar, l2_scalar,
+                       lr_power_scalar](Tindex i, Tindex index) {
           auto accum = accum_flat.template chip<0>(index);
           auto linear = linear_flat.template chip<0>(index);
           auto grad = grad_flat.template chip<0>(i);
@@ -2109,7 +2125,17 @@ class SparseApplyFtrlOp : public OpKernel {
           var = (linear.abs() > linear.constant(l1_scalar))
                     .select(var, var.constant(static_cast<T>(0)));
           accum += grad.square();
-        }
+        };
+        // Large batches update distinct rows concurrently; see
+        // ShardRowUpdates().
+        Tindex bad_index = 0;
+        const Tindex bad_i = ShardRowUpdates<Tindex>(
+            ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+            inner_dim * kSparseFtrlCostPerElement, update, &bad_index);
+        OP_REQUIRES(ctx, bad_i < 0,
+                    errors::InvalidArgument(strings::StrCat(
+                        "Index ", bad_index, " at offset ", bad_i,
+                        " in indices is out of range")));
       } else {
         auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
@@ -2122,12 +2148,9 @@ class SparseApplyFtrlOp : public OpKernel {
         T lr_power_scalar = lr_power.scalar<T>()();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&var_flat, &accum_flat, &linear_flat, &grad_flat,
+                       lr_scalar, l1_scalar, l2_scalar,
+                       lr_power_scalar](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           T& l = linear_flat(index);
           T& v = var_flat(index);
@@ -2142,7 +2165,15 @@ class SparseApplyFtrlOp : public OpKernel {
                           lr_power_scalar);
           a = updated_a;
           l = updated_l;
-        }
+        };
+        Tindex bad_index = 0;
+        const Tindex bad_i = ShardRowUpdates<Tindex>(
+            ctx->eigen_device<CPUDevice>(), indices_vec, first_dim_size,
+            kSparseFtrlCostPerElement, update, &bad_index);
+        OP_REQUIRES(ctx, bad_i < 0,
+                    errors::InvalidArgument(strings::StrCat(
+                        "Index ", bad_index, " at offset ", bad_i,
+                        " in indices is out of range")));
       }
     }
 
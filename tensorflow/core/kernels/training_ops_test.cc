@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
@@ -233,4 +234,53 @@ static void BM_RMSProp(int iters, int params) {
 }
 BENCHMARK(BM_RMSProp)->Arg(128 << 10)->Arg(256 << 10);
 
+// Sparse updates of a 64-wide embedding, which run on all the worker threads.
+static const int kEmbeddingRows = 1 << 20;
+static const int kEmbeddingDim = 64;
+
+static void SparseAdagrad(int32 num_updates, Graph** init_g,
+                          Graph** train_g) {
+  TensorShape shape({kEmbeddingRows, kEmbeddingDim});
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = test::graph::Var(g, DT_FLOAT, shape);
+    auto accum = test::graph::Var(g, DT_FLOAT, shape);
+    Tensor data(DT_FLOAT, shape);
+    data.flat<float>().setConstant(0.1);
+    auto init = test::graph::Constant(g, data);
+    test::graph::Assign(g, var, init);
+    test::graph::Assign(g, accum, init);
+    *init_g = g;
+  }
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = test::graph::Var(g, DT_FLOAT, shape);
+    auto accum = test::graph::Var(g, DT_FLOAT, shape);
+    auto lr = Scalar(g, 0.01);
+    Tensor grad(DT_FLOAT, TensorShape({num_updates, kEmbeddingDim}));
+    grad.flat<float>().setRandom();
+    Tensor indices(DT_INT32, TensorShape({num_updates}));
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    for (int i = 0; i < num_updates; ++i) {
+      indices.flat<int32>()(i) = rnd.Uniform(kEmbeddingRows);
+    }
+    test::graph::Multi(g, "SparseApplyAdagrad",
+                       {var, accum, lr, test::graph::Constant(g, grad),
+                        test::graph::Constant(g, indices)});
+    *train_g = g;
+  }
+}
+
+static void BM_SparseAdagrad(int iters, int num_updates) {
+  const int64 tot = static_cast<int64>(iters) * num_updates * kEmbeddingDim;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * sizeof(float));
+  Graph* init;
+  Graph* train;
+  SparseAdagrad(num_updates, &init, &train);
+  test::Benchmark("cpu", train, nullptr, init).Run(iters);
+}
+BENCHMARK(BM_SparseAdagrad)->Arg(1 << 10)->Arg(16 << 10)->Arg(128 << 10);
+
 }  // end namespace tensorflow
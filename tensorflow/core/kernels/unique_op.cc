@@ -13,20 +13,48 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#include <unordered_map>
+#include <limits>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/flatmap.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
 typedef Eigen::ThreadPoolDevice CPUDevice;
 
+namespace {
+
+// Hashes the elements to deduplicate. std::hash is the identity for integers,
+// which would put runs of consecutive ids into the same gtl::FlatMap bucket, so
+// its result is mixed before use.
 template <typename T>
+struct UniqueHash {
+  size_t operator()(const T& value) const {
+    uint64 h = std::hash<T>()(value);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+};
+
+template <>
+struct UniqueHash<string> : HashStr {};
+
+// Inputs with fewer elements are deduplicated on a single thread.
+const int64 kMinParallelUniqueSize = 64 * 1024;
+
+}  // namespace
+
+template <typename T, typename TIndex>
 class UniqueOp : public OpKernel {
  public:
   explicit UniqueOp(OpKernelConstruction* context) : OpKernel(context) {}
@@ -35,23 +63,27 @@ class UniqueOp : public OpKernel {
     const Tensor& input = context->input(0);
     OP_REQUIRES(context, TensorShapeUtils::IsVector(input.shape()),
                 errors::InvalidArgument("unique expects a 1D vector."));
-    // TODO(dga):  Make unique polymorphic for returning int32 and int64
-    // vectors to support large tensors.
     OP_REQUIRES(context,
-                input.NumElements() <= std::numeric_limits<int32>::max(),
+                input.NumElements() <= std::numeric_limits<TIndex>::max(),
                 errors::InvalidArgument(
                     "unique does not support input tensors larger than ",
-                    std::numeric_limits<int32>::max(), " elements"));
+                    std::numeric_limits<TIndex>::max(), " elements"));
     auto Tin = input.vec<T>();
     const int64 N = static_cast<int64>(Tin.size());
 
     Tensor* idx = nullptr;
     OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
                                 {0}, 1, input.shape(), &idx));
-    auto idx_vec = idx->template vec<int32>();
+    auto idx_vec = idx->template vec<TIndex>();
+
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    if (N >= kMinParallelUniqueSize && worker_threads.num_threads > 1) {
+      ComputeParallel(context, worker_threads, Tin, idx_vec);
+      return;
+    }
 
-    std::unordered_map<T, int32> uniq;
-    uniq.reserve(2 * N);
+    gtl::FlatMap<T, TIndex, UniqueHash<T>> uniq(N);
     for (int64 i = 0, j = 0; i < N; ++i) {
       auto it = uniq.insert(std::make_pair(Tin(i), j));
       idx_vec(i) = it.first->second;
@@ -65,20 +97,120 @@ class UniqueOp : public OpKernel {
                                 0, TensorShape({uniq_size}), &output));
     auto output_vec = output->template vec<T>();
 
-    for (auto it : uniq) {
+    for (const auto& it : uniq) {
       output_vec(it.second) = it.first;
     }
 
     if (num_outputs() > 2) {
       OP_REQUIRES_OK(context, context->allocate_output(
                                   2, TensorShape({uniq_size}), &output));
-      auto count_output_vec = output->template vec<int32>();
+      auto count_output_vec = output->template vec<TIndex>();
       count_output_vec.setZero();
       for (int64 i = 0; i < N; ++i) {
         count_output_vec(idx_vec(i))++;
       }
     }
   }
+
+ private:
+  // Deduplicates the input on several threads. The elements are partitioned
+  // by hash and each partition is deduplicated by a single thread, after which
+  // the partitions are merged by order of first occurrence, so the outputs are
+  // the same as those of the serial version.
+  //
+  // 'idx_vec' may share its buffer with the input, so it is only written once
+  // the input is no longer read.
+  void ComputeParallel(OpKernelContext* context,
+                       const DeviceBase::CpuWorkerThreads& worker_threads,
+                       typename TTypes<T>::ConstVec Tin,
+                       typename TTypes<TIndex>::Vec idx_vec) {
+    const int64 N = Tin.size();
+    const int num_parts = worker_threads.num_threads;
+    // Runs fn(0), ..., fn(num_parts - 1) in parallel.
+    auto for_each_part = [&worker_threads, num_parts](
+                             const std::function<void(int)>& fn) {
+      Shard(num_parts, worker_threads.workers, num_parts,
+            std::numeric_limits<int32>::max(), [&fn](int64 begin, int64 end) {
+              for (int64 part = begin; part < end; ++part) {
+                fn(part);
+              }
+            });
+    };
+
+    // Split the input into num_parts contiguous blocks, and sort the positions
+    // in each block by the partition of their element.
+    std::vector<int32> partition_of(N);
+    std::vector<std::vector<std::vector<int64>>> positions(
+        num_parts, std::vector<std::vector<int64>>(num_parts));
+    for_each_part([&](int block) {
+      const UniqueHash<T> hasher;
+      for (int64 i = N * block / num_parts; i < N * (block + 1) / num_parts;
+           ++i) {
+        const uint64 h = hasher(Tin(i));
+        const int part = ((h >> 32) * num_parts) >> 32;
+        partition_of[i] = part;
+        positions[block][part].push_back(i);
+      }
+    });
+
+    // Deduplicate each partition, visiting its elements in input order.
+    const bool need_counts = num_outputs() > 2;
+    std::vector<int64> local_index(N);
+    std::vector<char> is_first(N, 0);
+    std::vector<int64> num_unique(num_parts);
+    std::vector<std::vector<int64>> counts(num_parts);
+    for_each_part([&](int part) {
+      gtl::FlatMap<T, int64, UniqueHash<T>> uniq;
+      for (int block = 0; block < num_parts; ++block) {
+        for (const int64 i : positions[block][part]) {
+          auto it = uniq.insert(std::make_pair(Tin(i), num_unique[part]));
+          local_index[i] = it.first->second;
+          if (it.second) {
+            is_first[i] = 1;
+            ++num_unique[part];
+            if (need_counts) counts[part].push_back(0);
+          }
+          if (need_counts) ++counts[part][it.first->second];
+        }
+      }
+    });
+
+    // Number the unique elements of all partitions by first occurrence.
+    int64 uniq_size = 0;
+    std::vector<std::vector<TIndex>> global_index(num_parts);
+    for (int part = 0; part < num_parts; ++part) {
+      global_index[part].resize(num_unique[part]);
+      uniq_size += num_unique[part];
+    }
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({uniq_size}), &output));
+    auto output_vec = output->template vec<T>();
+    for (int64 i = 0, j = 0; i < N; ++i) {
+      if (is_first[i]) {
+        global_index[partition_of[i]][local_index[i]] = j;
+        output_vec(j++) = Tin(i);
+      }
+    }
+
+    for_each_part([&](int block) {
+      for (int64 i = N * block / num_parts; i < N * (block + 1) / num_parts;
+           ++i) {
+        idx_vec(i) = global_index[partition_of[i]][local_index[i]];
+      }
+    });
+
+    if (need_counts) {
+      OP_REQUIRES_OK(context, context->allocate_output(
+                                  2, TensorShape({uniq_size}), &output));
+      auto count_output_vec = output->template vec<TIndex>();
+      for_each_part([&](int part) {
+        for (size_t j = 0; j < counts[part].size(); ++j) {
+          count_output_vec(global_index[part][j]) = counts[part][j];
+        }
+      });
+    }
+  }
 };
 
 #define REGISTER_UNIQUE(type)                                    \
@@ -86,12 +218,22 @@ class UniqueOp : public OpKernel {
                               .Device(DEVICE_CPU)                \
                               .TypeConstraint<type>("T")         \
                               .TypeConstraint<int32>("out_idx"), \
-                          UniqueOp<type>);                       \
+                          UniqueOp<type, int32>);                \
+  REGISTER_KERNEL_BUILDER(Name("Unique")                         \
+                              .Device(DEVICE_CPU)                \
+                              .TypeConstraint<type>("T")         \
+                              .TypeConstraint<int64>("out_idx"), \
+                          UniqueOp<type, int64>);                \
   REGISTER_KERNEL_BUILDER(Name("UniqueWithCounts")               \
                               .Device(DEVICE_CPU)                \
                               .TypeConstraint<type>("T")         \
                               .TypeConstraint<int32>("out_idx"), \
-                          UniqueOp<type>)
+                          UniqueOp<type, int32>);                \
+  REGISTER_KERNEL_BUILDER(Name("UniqueWithCounts")               \
+                              .Device(DEVICE_CPU)                \
+                              .TypeConstraint<type>("T")         \
+                              .TypeConstraint<int64>("out_idx"), \
+                          UniqueOp<type, int64>)
 TF_CALL_REAL_NUMBER_TYPES(REGISTER_UNIQUE);
 REGISTER_UNIQUE(string)
 #undef REGISTER_UNIQUE
@@ -107,7 +249,7 @@ REGISTER_KERNEL_BUILDER(Name("Unique")
                             .HostMemory("x")
                             .HostMemory("y")
                             .HostMemory("idx"),
-                        UniqueOp<int32>);
+                        UniqueOp<int32, int32>);
 REGISTER_KERNEL_BUILDER(Name("Unique")
                             .Device(DEVICE_GPU)
                             .TypeConstraint<int64>("T")
@@ -115,7 +257,7 @@ REGISTER_KERNEL_BUILDER(Name("Unique")
                             .HostMemory("x")
                             .HostMemory("y")
                             .HostMemory("idx"),
-                        UniqueOp<int64>);
+                        UniqueOp<int64, int32>);
 
 #ifdef TENSORFLOW_USE_SYCL
 REGISTER_KERNEL_BUILDER(Name("Unique")
@@ -125,7 +267,7 @@ REGISTER_KERNEL_BUILDER(Name("Unique")
                             .HostMemory("x")
                             .HostMemory("y")
                             .HostMemory("idx"),
-                        UniqueOp<int32>);
+                        UniqueOp<int32, int32>);
 REGISTER_KERNEL_BUILDER(Name("Unique")
                             .Device(DEVICE_SYCL)
                             .TypeConstraint<int64>("T")
@@ -133,6 +275,6 @@ REGISTER_KERNEL_BUILDER(Name("Unique")
                             .HostMemory("x")
                             .HostMemory("y")
                             .HostMemory("idx"),
-                        UniqueOp<int64>);
+                        UniqueOp<int64, int32>);
 #endif // TENSORFLOW_USE_SYCL
 }  // namespace tensorflow
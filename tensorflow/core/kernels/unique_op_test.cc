@@ -15,10 +15,15 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/node_builder.h"
@@ -26,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -35,6 +41,56 @@ namespace {
 
 const int kMaxStrLen = 40;
 
+class UniqueOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType index_type) {
+    TF_EXPECT_OK(NodeDefBuilder("unique_op", "UniqueWithCounts")
+                     .Input(FakeInput(DT_INT64))
+                     .Attr("out_idx", index_type)
+                     .Finalize(node_def()));
+    TF_EXPECT_OK(InitOp());
+  }
+
+  // Checks the outputs for an input large enough to be deduplicated on
+  // several threads against a serial reference.
+  template <typename TIndex>
+  void CheckLargeInput() {
+    MakeOp(DataTypeToEnum<TIndex>::v());
+    const int64 kSize = 200000;
+    const int64 kNumUnique = 1000;
+    std::vector<int64> input(kSize);
+    for (int64 i = 0; i < kSize; ++i) {
+      input[i] = ((kSize - i) * 7919 % kNumUnique) * 1000003;
+    }
+    AddInputFromArray<int64>(TensorShape({kSize}), input);
+    TF_ASSERT_OK(RunOpKernel());
+
+    std::unordered_map<int64, TIndex> index;
+    std::vector<int64> expected_y;
+    std::vector<TIndex> expected_idx;
+    std::vector<TIndex> expected_count;
+    for (const int64 value : input) {
+      auto it = index.emplace(value, expected_y.size());
+      if (it.second) {
+        expected_y.push_back(value);
+        expected_count.push_back(0);
+      }
+      expected_idx.push_back(it.first->second);
+      ++expected_count[it.first->second];
+    }
+    test::ExpectTensorEqual<int64>(
+        test::AsTensor<int64>(expected_y, {kNumUnique}), *GetOutput(0));
+    test::ExpectTensorEqual<TIndex>(
+        test::AsTensor<TIndex>(expected_idx, {kSize}), *GetOutput(1));
+    test::ExpectTensorEqual<TIndex>(
+        test::AsTensor<TIndex>(expected_count, {kNumUnique}), *GetOutput(2));
+  }
+};
+
+TEST_F(UniqueOpTest, LargeInputInt32Index) { CheckLargeInput<int32>(); }
+
+TEST_F(UniqueOpTest, LargeInputInt64Index) { CheckLargeInput<int64>(); }
+
 static void BM_Unique_INT32(int iters, int dim) {
   testing::StopTiming();
   Graph* g = new Graph(OpRegistry::Global());
@@ -54,6 +110,32 @@ static void BM_Unique_INT32(int iters, int dim) {
   test::Benchmark("cpu", g).Run(iters);
 }
 
+// Deduplicates 'dim' ids drawn from [0, max_int), with int64 indices.
+static void BM_Unique_INT64(int iters, int dim, int max_int) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor input(DT_INT64, TensorShape({dim}));
+  auto input_vec = input.vec<int64>();
+  for (int i = 0; i < dim; ++i) {
+    input_vec(i) = rnd.Uniform64(max_int);
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Unique")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("T", DT_INT64)
+                  .Attr("out_idx", DT_INT64)
+                  .Finalize(g, &node));
+
+  testing::BytesProcessed(static_cast<int64>(iters) * dim * sizeof(int64));
+  testing::UseRealTime();
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
 TensorProto GetRandomStringsTensorProto(int dim, int max_str_len) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_STRING);
@@ -97,7 +179,17 @@ BENCHMARK(BM_Unique_INT32)
     ->Arg(4 * 1024)
     ->Arg(16 * 1024)
     ->Arg(64 * 1024)
-    ->Arg(256 * 1024);
+    ->Arg(256 * 1024)
+    ->Arg(1024 * 1024)
+    ->Arg(4 * 1024 * 1024);
+
+BENCHMARK(BM_Unique_INT64)
+    ->ArgPair(64 * 1024, 1024)
+    ->ArgPair(64 * 1024, 64 * 1024)
+    ->ArgPair(1024 * 1024, 1024)
+    ->ArgPair(1024 * 1024, 1024 * 1024)
+    ->ArgPair(4 * 1024 * 1024, 64 * 1024)
+    ->ArgPair(4 * 1024 * 1024, 4 * 1024 * 1024);
 
 BENCHMARK(BM_Unique_STRING)
     ->Arg(32)
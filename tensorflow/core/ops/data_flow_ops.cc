@@ -2366,4 +2366,34 @@ file_parallelism: How many sstables are opened and concurrently iterated over.
 batch_size: The batch size.
 )doc");
 
+REGISTER_OP("_SwapOut")
+    .Input("value: T")
+    .Output("swapped: string")
+    .Attr("T: type")
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Compresses a tensor to keep it in less memory until it is needed again.
+
+NOTE Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+
+value: The tensor to swap out.
+swapped: The compressed content of `value`, to be restored by _SwapIn.
+)doc");
+
+REGISTER_OP("_SwapIn")
+    .Input("swapped: string")
+    .Output("value: T")
+    .Attr("T: type")
+    .SetShapeFn(shape_inference::UnknownShape)
+    .Doc(R"doc(
+Restores a tensor compressed by _SwapOut.
+
+NOTE Do not invoke this operator directly in Python. Grappler is expected to
+create these operators.
+
+swapped: The output of _SwapOut.
+value: The restored tensor.
+)doc");
+
 }  // namespace tensorflow
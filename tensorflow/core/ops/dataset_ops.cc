@@ -490,6 +490,26 @@ REGISTER_OP("IteratorGetNext")
 Gets the next output from the given iterator.
 )doc");
 
+REGISTER_OP("IteratorHasNext")
+    .Input("iterator: resource")
+    .Output("has_next: bool")
+    .SetIsStateful()
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Returns whether the given iterator has a next output.
+
+The next output is gotten from the iterator to find out, and is returned by the
+next "IteratorGetNext" operation on that iterator. Running "MakeIterator" again
+discards it.
+
+has_next: False at the end of the sequence.
+)doc");
+
 REGISTER_OP("IteratorDispose")
     .Input("iterator: resource")
     .SetShapeFn(shape_inference::NoOutputs)
@@ -1102,6 +1102,35 @@ transpose_a: If true, "a" is transposed before multiplication.
 transpose_b: If true, "b" is transposed before multiplication.
 )doc");
 
+REGISTER_OP("_FusedMatMul")
+    .Input("a: T")
+    .Input("b: T")
+    .Input("bias: T")
+    .Output("product: T")
+    .Attr("transpose_a: bool = false")
+    .Attr("transpose_b: bool = false")
+    .Attr("T: {float}")
+    .Attr("activation: {'Identity', 'Relu', 'Relu6', 'Elu'} = 'Identity'")
+    .SetShapeFn([](InferenceContext* c) {
+      TF_RETURN_IF_ERROR(shape_inference::MatMulShape(c));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &bias));
+      DimensionHandle unused;
+      return c->Merge(c->Dim(c->output(0), 1), c->Dim(bias, 0), &unused);
+    })
+    .Doc(R"doc(
+NOTE Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+
+Computes activation(MatMul(a, b) + bias) in a single kernel, which replaces a
+MatMul followed by a BiasAdd and optionally a Relu, Relu6 or Elu.
+
+bias: A 1-D tensor with one element per column of the product.
+transpose_a: If true, "a" is transposed before multiplication.
+transpose_b: If true, "b" is transposed before multiplication.
+activation: The activation applied after the bias is added.
+)doc");
+
 REGISTER_OP("SparseMatMul")
     .Input("a: Ta")
     .Input("b: Tb")
@@ -1809,6 +1838,72 @@ segment_ids: segment_ids passed to the corresponding SparseSegmentSqrtN op.
 output_dim0: dimension 0 of "data" passed to SparseSegmentSqrtN op.
 )doc");
 
+REGISTER_OP("FusedEmbeddingLookupSparse")
+    .Input("params: T")
+    .Input("ids: int32")
+    .Input("segment_ids: int32")
+    .Output("output: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'}")
+    .Attr("T: {float, double}")
+    .SetShapeFn(SparseSegmentReductionShapeFn)
+    .Doc(R"doc(
+Looks up rows of `params` and combines them into segments.
+
+Computes the same result as gathering `params` at `ids` and reducing the
+gathered rows with SparseSegmentSum, SparseSegmentMean or SparseSegmentSqrtN,
+but reads each row straight into its output segment, without materializing the
+gathered rows.
+
+params: The embedding table.
+ids: A 1-D tensor of row indices into `params`. Has same rank as `segment_ids`.
+segment_ids: A 1-D tensor. Values should be sorted and can be repeated.
+output: Has same shape as params, except for dimension 0 which
+  has size `k`, the number of segments.
+combiner: How the rows of each segment are reduced.
+)doc");
+
+REGISTER_OP("FusedEmbeddingLookupSparseGrad")
+    .Input("grad: T")
+    .Input("ids: int32")
+    .Input("segment_ids: int32")
+    .Output("unique_ids: int32")
+    .Output("values: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'}")
+    .Attr("T: {float, double}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle grad_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &grad_shape));
+      ShapeHandle ids_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &ids_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->Merge(c->input(2), ids_shape, &unused));
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(grad_shape, 1, &subshape));
+      ShapeHandle values_shape;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(InferenceContext::kUnknownDim), subshape, &values_shape));
+      c->set_output(0, c->Vector(InferenceContext::kUnknownDim));
+      c->set_output(1, values_shape);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes the gradient of FusedEmbeddingLookupSparse with respect to `params`.
+
+The gradient is returned as slices of `params`: row `i` of `values` is the
+gradient of the row `unique_ids[i]`, accumulated over all the segments that row
+was combined into. Each distinct id appears once in `unique_ids`, in order of
+first appearance in `ids`.
+
+grad: gradient propagated to the FusedEmbeddingLookupSparse op.
+ids: ids passed to the corresponding FusedEmbeddingLookupSparse op.
+segment_ids: segment_ids passed to the corresponding FusedEmbeddingLookupSparse
+  op.
+unique_ids: The distinct rows of `params` the gradient applies to.
+values: The gradient of each row in `unique_ids`.
+combiner: combiner passed to the corresponding FusedEmbeddingLookupSparse op.
+)doc");
+
 REGISTER_OP("All")
     .Input("input: bool")
     .Input("reduction_indices: Tidx")
@@ -2238,6 +2333,7 @@ REGISTER_OP("QuantizedMatMul")
     .Attr("transpose_a: bool = false")
     .Attr("transpose_b: bool = false")
     .Attr("Tactivation: quantizedtype = DT_QUINT8")
+    .Attr("b_is_constant: bool = false")
     .SetShapeFn([](InferenceContext* c) {
       TF_RETURN_IF_ERROR(shape_inference::MatMulShape(c));
       ShapeHandle unused;
@@ -2270,6 +2366,9 @@ min_out: The float value that the lowest quantized output value represents.
 max_out: The float value that the highest quantized output value represents.
 Tactivation: The type of output produced by activation function
     following this operation.
+b_is_constant: If true, `b` must hold the same values on every run, for
+    example because it is produced by a Const node. The kernel may then
+    reorder `b` for faster multiplication once and reuse the result.
 
 )doc");
 
@@ -552,6 +552,43 @@ data_format: Specify the data format of the input and output data. With the
         [batch, channels, height, width].
 )doc");
 
+REGISTER_OP("_FusedConv2D")
+    .Input("input: T")
+    .Input("filter: T")
+    .Input("bias: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("strides: list(int)")
+    .Attr("use_cudnn_on_gpu: bool = true")
+    .Attr(GetPaddingAttrString())
+    .Attr("data_format: { 'NHWC' } = 'NHWC'")
+    .Attr("activation: {'Identity', 'Relu', 'Relu6', 'Elu'} = 'Identity'")
+    .SetShapeFn([](InferenceContext* c) {
+      TF_RETURN_IF_ERROR(shape_inference::Conv2DShape(c));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &bias));
+      DimensionHandle unused;
+      return c->Merge(c->Dim(c->output(0), 3), c->Dim(bias, 0), &unused);
+    })
+    .Doc(R"doc(
+NOTE Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+
+Computes activation(Conv2D(input, filter) + bias) in a single kernel, which
+replaces a Conv2D followed by a BiasAdd and optionally a Relu, Relu6 or Elu.
+
+input: A 4-D tensor of shape `[batch, in_height, in_width, in_channels]`.
+filter: A 4-D tensor of shape
+    `[filter_height, filter_width, in_channels, out_channels]`
+bias: A 1-D tensor of size `out_channels`.
+output: A 4-D tensor of shape `[batch, out_height, out_width, out_channels]`.
+strides: 1-D tensor of length 4.  The stride of the sliding window for each
+  dimension of `input`.
+padding: The type of padding algorithm to use.
+data_format: Only "NHWC" is supported.
+activation: The activation applied after the bias is added.
+)doc");
+
 REGISTER_OP("Conv2DBackpropInput")
     .Input("input_sizes: int32")
     .Input("filter: T")
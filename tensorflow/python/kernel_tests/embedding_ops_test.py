@@ -31,9 +31,11 @@ from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import data_flow_ops
 from tensorflow.python.ops import embedding_ops
 from tensorflow.python.ops import gradient_checker
+from tensorflow.python.ops import gradients_impl
 from tensorflow.python.ops import linalg_ops
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import partitioned_variables
+from tensorflow.python.ops import resource_variable_ops
 from tensorflow.python.ops import state_ops
 from tensorflow.python.ops import variable_scope
 from tensorflow.python.ops import variables
@@ -719,6 +721,82 @@ class EmbeddingLookupSparseTest(test.TestCase):
             x, x_shape, y, y_shape, x_init_value=x_init_value)
       self.assertLess(err, 1e-5 if dtype == dtypes.float64 else 2e-3)
 
+  def testFusedGradientsAreIndexedSlices(self):
+    with self.test_session() as sess:
+      with ops.device("/cpu:0"):
+        x = constant_op.constant(
+            np.arange(12, dtype=np.float32).reshape([6, 2]))
+      sp_ids = sparse_tensor.SparseTensor(
+          constant_op.constant([[0, 0], [0, 1], [1, 0], [2, 0]], dtypes.int64),
+          constant_op.constant([4, 1, 4, 0], dtypes.int64),
+          constant_op.constant([3, 2], dtypes.int64))
+      for combiner, expected in (("sum", [[2., 2.], [1., 1.], [1., 1.]]),
+                                 ("mean", [[1.5, 1.5], [.5, .5], [1., 1.]]),
+                                 ("sqrtn", [[1. + 2**-.5, 1. + 2**-.5],
+                                            [2**-.5, 2**-.5], [1., 1.]])):
+        y = embedding_ops.embedding_lookup_sparse(
+            x, sp_ids, None, combiner=combiner)
+        self.assertEqual("FusedEmbeddingLookupSparse", y.op.type)
+        grad = gradients_impl.gradients(y, x)[0]
+        self.assertIsInstance(grad, ops.IndexedSlices)
+        grad_indices, grad_values = sess.run([grad.indices, grad.values])
+        self.assertAllEqual([4, 1, 0], grad_indices)
+        self.assertAllClose(expected, grad_values)
+
+  def testFusedUnlessParamsOnOtherDevices(self):
+    sp_ids = sparse_tensor.SparseTensor(
+        constant_op.constant([[0, 0], [1, 0]], dtypes.int64),
+        constant_op.constant([1, 0], dtypes.int64),
+        constant_op.constant([2, 1], dtypes.int64))
+    params = np.arange(6, dtype=np.float32).reshape([3, 2])
+    # The fused op has no GPU kernel.
+    with ops.device("/gpu:0"):
+      x = constant_op.constant(params)
+    y = embedding_ops.embedding_lookup_sparse(x, sp_ids, None, combiner="sum")
+    self.assertNotEqual("FusedEmbeddingLookupSparse", y.op.type)
+    for device in ("/cpu:0", "/job:ps/task:0", None):
+      with ops.device(device):
+        x = constant_op.constant(params)
+      y = embedding_ops.embedding_lookup_sparse(
+          x, sp_ids, None, combiner="sum")
+      self.assertEqual("FusedEmbeddingLookupSparse", y.op.type)
+    # Unplaced params may be placed on a GPU, in which case only their looked
+    # up rows are copied to the fused op.
+    with self.test_session(use_gpu=True):
+      self.assertAllEqual([[2., 3.], [0., 1.]], y.eval())
+
+  def testNotFusedForResourceVariables(self):
+    sp_ids = sparse_tensor.SparseTensor(
+        constant_op.constant([[0, 0], [1, 0]], dtypes.int64),
+        constant_op.constant([1, 0], dtypes.int64),
+        constant_op.constant([2, 1], dtypes.int64))
+    with self.test_session():
+      with ops.device("/cpu:0"):
+        x = resource_variable_ops.ResourceVariable(
+            np.arange(6, dtype=np.float32).reshape([3, 2]))
+      y = embedding_ops.embedding_lookup_sparse(
+          x, sp_ids, None, combiner="sum")
+      self.assertNotEqual("FusedEmbeddingLookupSparse", y.op.type)
+      variables.global_variables_initializer().run()
+      self.assertAllEqual([[2., 3.], [0., 1.]], y.eval())
+
+  def testFusedRejectsInt64IdsOutsideInt32(self):
+    with self.test_session():
+      with ops.device("/cpu:0"):
+        x = constant_op.constant(
+            np.arange(6, dtype=np.float32).reshape([3, 2]))
+      # Both ids would wrap around to row 1 if narrowed to int32 directly.
+      for bad_id in (2**32 + 1, -2**32 + 1):
+        sp_ids = sparse_tensor.SparseTensor(
+            constant_op.constant([[0, 0], [1, 0]], dtypes.int64),
+            constant_op.constant([0, bad_id], dtypes.int64),
+            constant_op.constant([2, 1], dtypes.int64))
+        y = embedding_ops.embedding_lookup_sparse(
+            x, sp_ids, None, combiner="sum")
+        self.assertEqual("FusedEmbeddingLookupSparse", y.op.type)
+        with self.assertRaisesOpError("out of range"):
+          y.eval()
+
   def testIncompatibleShapes(self):
     with self.test_session():
       x, _, _ = _EmbeddingParams(1, 10, dtype=dtypes.float32)
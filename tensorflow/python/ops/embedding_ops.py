@@ -20,6 +20,7 @@ from __future__ import print_function
 from six.moves import xrange  # pylint: disable=redefined-builtin
 
 from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import device as pydev
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
@@ -28,6 +29,8 @@ from tensorflow.python.ops import clip_ops
 # Imports gradient definitions.
 from tensorflow.python.ops import data_flow_grad  # pylint: disable=unused-import
 from tensorflow.python.ops import data_flow_ops
+from tensorflow.python.ops import gen_math_ops
+from tensorflow.python.ops import math_grad  # pylint: disable=unused-import
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import resource_variable_ops
 from tensorflow.python.ops import variables
@@ -294,6 +297,33 @@ def embedding_lookup(
       transform_fn=None)
 
 
+def _can_fuse_lookup_sparse(params, ids, max_norm):
+  """Returns whether embedding_lookup_sparse can use a single fused op.
+
+  The fused op reads rows from one unpartitioned tensor of floats, indexed by
+  int32 ids. It only has a CPU kernel, so params pinned to another device type
+  are not fused. Params without a device type are fused as well: after
+  placement the fused op is moved to their device, or, if they end up on an
+  accelerator, fed only the rows gathered there. Resource variables are not
+  fused: the op takes the params as a dense tensor, and reading a resource
+  variable densely copies the whole table on every step, where the unfused path
+  only reads the looked up rows with `sparse_read`.
+  """
+  if len(params) != 1 or max_norm is not None:
+    return False
+  if isinstance(params[0], resource_variable_ops.ResourceVariable):
+    return False
+  device_type = pydev.DeviceSpec.from_string(params[0].device).device_type
+  if device_type is not None and device_type.upper() != "CPU":
+    return False
+  if params[0].dtype.base_dtype not in (dtypes.float32, dtypes.float64):
+    return False
+  if ids.dtype == dtypes.int32:
+    return True
+  num_rows = params[0].get_shape()[:1].num_elements()
+  return num_rows is not None and num_rows <= dtypes.int32.max
+
+
 def embedding_lookup_sparse(params,
                             sp_ids,
                             sp_weights,
@@ -402,6 +432,26 @@ def embedding_lookup_sparse(params,
       segment_ids = math_ops.cast(segment_ids, dtypes.int32)
 
     ids = sp_ids.values
+    if ignore_weights and _can_fuse_lookup_sparse(params, ids, max_norm):
+      # Read the rows of params straight into their segments, rather than
+      # gathering them into an intermediate tensor that is then reduced.
+      if ids.dtype != dtypes.int32:
+        # Clip the ids into the int32 range before narrowing them, so that
+        # ids that would wrap around into valid rows fail the bounds check of
+        # the kernel instead: params has at most int32.max rows, so int32.max
+        # is never a valid row.
+        ids = math_ops.cast(
+            clip_ops.clip_by_value(ids, -1, dtypes.int32.max), dtypes.int32)
+      if pydev.DeviceSpec.from_string(params[0].device).device_type:
+        placement = ops.colocate_with(params[0])
+      else:
+        # The params may still be placed on any device. Leave the fused op
+        # unpinned, and let it be placed after the params.
+        placement = ops.device(None)
+      with placement:
+        return gen_math_ops._fused_embedding_lookup_sparse(
+            params[0], ids, segment_ids, combiner=combiner, name=name)
+
     if ignore_weights:
       ids, idx = array_ops.unique(ids)
     else:
@@ -190,6 +190,15 @@ def _SparseSegmentSqrtNGrad(op, grad):
                                               dim0), None, None)
 
 
+@ops.RegisterGradient("FusedEmbeddingLookupSparse")
+def _FusedEmbeddingLookupSparseGrad(op, grad):
+  """Gradient for FusedEmbeddingLookupSparse, as IndexedSlices of params."""
+  unique_ids, values = gen_math_ops._fused_embedding_lookup_sparse_grad(
+      grad, op.inputs[1], op.inputs[2], combiner=op.get_attr("combiner"))
+  params_shape = array_ops.shape(op.inputs[0])
+  return (ops.IndexedSlices(values, unique_ids, params_shape), None, None)
+
+
 def _SegmentMinOrMaxGrad(op, grad, is_sorted):
   """Gradient for SegmentMin and (unsorted) SegmentMax. They share similar code."""
   zeros = array_ops.zeros(array_ops.shape(op.inputs[0]),